@@ -16,6 +16,7 @@
 #include <QDir>
 #include <QDomDocument>
 #include <QTemporaryFile>
+#include <QTextStream>
 #include <QtGlobal>
 
 int main(int argc, char **argv)
@@ -44,7 +45,7 @@ int main(int argc, char **argv)
         parser.addPositionalArgument("preview-chunks", "Mode: Render splited in to multiple files for timeline preview.");
         parser.addPositionalArgument("source", "Source file (usually MLT XML).");
         parser.addPositionalArgument("destination", "Destination directory.");
-        parser.addPositionalArgument("chunks", "Chunks to render.");
+        parser.addPositionalArgument("chunks", "Chunks to render, or - to read them from stdin.");
         parser.addPositionalArgument("chunk_size", "Chunks to render.");
         parser.addPositionalArgument("profile_path", "Path to profile.");
         parser.addPositionalArgument("file_extension", "Rendered file extension.");
@@ -88,6 +89,62 @@ int main(int argc, char **argv)
         const char *localename = prod.get_lcnumeric();
         QLocale::setDefault(QLocale(localename));
 
+        // Render one chunk to the file named after @p key, or after the frame, returns false if the consumer cannot be created
+        auto renderChunk = [&](int frame, const QString &key) {
+            fprintf(stderr, "START:%d \n", frame);
+            QString fileName = QStringLiteral("%1.%2").arg(key.isEmpty() ? QString::number(frame) : key, extension);
+            if (baseFolder.exists(fileName)) {
+                // Don't overwrite an existing file
+                fprintf(stderr, "DONE:%d \n", frame);
+                return true;
+            }
+            QScopedPointer<Mlt::Producer> playlst(prod.cut(frame, frame + chunkSize));
+            QScopedPointer<Mlt::Consumer> cons(
+                new Mlt::Consumer(profile, QStringLiteral("avformat:%1").arg(baseFolder.absoluteFilePath(fileName)).toUtf8().constData()));
+            for (const QString &param : std::as_const(consumerParams)) {
+                if (param.contains(QLatin1Char('='))) {
+                    cons->set(param.section(QLatin1Char('='), 0, 0).toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
+                }
+            }
+            if (!cons->is_valid()) {
+                fprintf(stderr, " = =  = INVALID CONSUMER\n\n");
+                return false;
+            }
+            cons->set("terminate_on_pause", 1);
+            cons->connect(*playlst);
+            playlst.reset();
+            cons->run();
+            cons->stop();
+            cons->purge();
+            fprintf(stderr, "DONE:%d \n", frame);
+            return true;
+        };
+
+        if (chunks == QStringList{QStringLiteral("-")}) {
+            // Chunks are sent one per line on stdin as the previous ones are done, until an empty line or the end of input.
+            // This allows Kdenlive to share the chunks between several processes and choose the next one when a process is free.
+            // A line is the first frame of the chunk, optionally followed by the base name of its file.
+            QTextStream input(stdin);
+            while (true) {
+                const QString line = input.readLine().simplified();
+                bool ok;
+                const int frame = line.section(QLatin1Char(' '), 0, 0).toInt(&ok);
+                if (!ok) {
+                    break;
+                }
+                const QString key = line.section(QLatin1Char(' '), 1, 1);
+                if (key.contains(QLatin1Char('/')) || key.contains(QLatin1Char('\\')) || key.startsWith(QLatin1Char('.'))) {
+                    fprintf(stderr, "INVALID chunk name: %s \n", key.toUtf8().constData());
+                    return 1;
+                }
+                if (!renderChunk(frame, key)) {
+                    return 1;
+                }
+            }
+            fprintf(stderr, "+ + + RENDERING FINISHED + + + \n");
+            return 0;
+        }
+
         int currentFrame = 0;
         int rangeStart = 0;
         int rangeEnd = 0;
@@ -117,32 +174,9 @@ int main(int argc, char **argv)
                 // Frame will be processed, remove from stack
                 chunks.removeFirst();
             }
-            fprintf(stderr, "START:%d \n", frame.toInt());
-            QString fileName = QStringLiteral("%1.%2").arg(frame, extension);
-            if (baseFolder.exists(fileName)) {
-                // Don't overwrite an existing file
-                fprintf(stderr, "DONE:%d \n", frame.toInt());
-                continue;
-            }
-            QScopedPointer<Mlt::Producer> playlst(prod.cut(frame.toInt(), frame.toInt() + chunkSize));
-            QScopedPointer<Mlt::Consumer> cons(
-                new Mlt::Consumer(profile, QStringLiteral("avformat:%1").arg(baseFolder.absoluteFilePath(fileName)).toUtf8().constData()));
-            for (const QString &param : std::as_const(consumerParams)) {
-                if (param.contains(QLatin1Char('='))) {
-                    cons->set(param.section(QLatin1Char('='), 0, 0).toUtf8().constData(), param.section(QLatin1Char('='), 1).toUtf8().constData());
-                }
-            }
-            if (!cons->is_valid()) {
-                fprintf(stderr, " = =  = INVALID CONSUMER\n\n");
+            if (!renderChunk(frame.toInt(), QString())) {
                 return 1;
             }
-            cons->set("terminate_on_pause", 1);
-            cons->connect(*playlst);
-            playlst.reset();
-            cons->run();
-            cons->stop();
-            cons->purge();
-            fprintf(stderr, "DONE:%d \n", frame.toInt());
         }
         // Mlt::Factory::close();
         fprintf(stderr, "+ + + RENDERING FINISHED + + + \n");
@@ -6,6 +6,8 @@
 #pragma once
 
 #include "definitions.h"
+#include <QByteArray>
+#include <QDomDocument>
 #include <QSet>
 #include <memory>
 #include <mlt++/Mlt.h>
@@ -48,6 +50,20 @@ public:
     /** @brief Returns a DomElement representing the asset's properties */
     QDomElement getXml(const QString &assetId) const;
 
+    /** @brief Statistics of the repository initialization, to measure the startup cost */
+    struct InitStats
+    {
+        /** @brief The assets were read from the on-disk cache */
+        bool fromCache{false};
+        int assetCount{0};
+        /** @brief Time spent reading the MLT metadata, 0 when the cache was used */
+        qint64 mltMs{0};
+        /** @brief Time spent parsing the custom asset files, 0 when the cache was used */
+        qint64 customMs{0};
+        qint64 totalMs{0};
+    };
+    const InitStats &initStats() const;
+
 protected:
     struct Info
     {
@@ -87,7 +103,12 @@ protected:
     /** @brief Retrieves additional info about asset from a custom XML file
        The resulting assets are stored in customAssets
      */
-    virtual void parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const = 0;
+    void parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const;
+
+    /** @brief Retrieves additional info about asset from the parsed content of a custom XML file
+       The resulting assets are stored in customAssets
+     */
+    virtual void parseCustomAssetDocument(QDomDocument &doc, const QString &file_name, std::unordered_map<QString, Info> &customAssets) const = 0;
 
     /** @brief Returns the path to custom XML description of the assets*/
     virtual QStringList assetDirs() const = 0;
@@ -101,7 +122,19 @@ protected:
     /** @brief Returns the path to the assets' preferred list*/
     virtual QString assetPreferredListPath() const = 0;
 
+    /** @brief Returns the name of the file caching the parsed assets between runs */
+    virtual QString cacheName() const = 0;
+
+    /** @brief Returns a hash of everything the parsed assets depend on:
+       application and MLT versions, language, available MLT services and asset files with their modification times
+     */
+    QByteArray cacheKey() const;
+    /** @brief Reads the assets from the cache if it was written with the same key */
+    bool loadCache(const QByteArray &key);
+    void saveCache(const QByteArray &key) const;
+
     std::unordered_map<QString, Info> m_assets;
+    InitStats m_initStats;
 
     QSet<QString> m_excludedList;
     QSet<QString> m_includedList;
@@ -6,12 +6,22 @@
 #include "xml/xml.hpp"
 #include "kdenlivesettings.h"
 #include "core.h"
+#include "kdenlive_debug.h"
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QString>
 #include <QTextStream>
+#include <QtConcurrent/QtConcurrentMap>
 #include <KLocalizedString>
 
 #include <locale>
@@ -23,6 +33,9 @@ template <typename AssetType> AbstractAssetsRepository<AssetType>::AbstractAsset
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
 {
+    QElapsedTimer timer;
+    timer.start();
+    m_initStats = InitStats();
     // Parse include/exclude lists
     parseAssetList(assetExcludedPath(), m_excludedList);
     parseAssetList(assetIncludedPath(), m_includedList);
@@ -30,6 +43,15 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
     // Parse preferred list
     parseAssetList({assetPreferredListPath()}, m_preferred_list);
 
+    // Warm start: nothing changed since the assets were last parsed
+    if (loadCache(cacheKey())) {
+        m_initStats.fromCache = true;
+        m_initStats.assetCount = int(m_assets.size());
+        m_initStats.totalMs = timer.elapsed();
+        qCDebug(KDENLIVE_LOG) << "Loaded" << m_initStats.assetCount << cacheName() << "from cache in" << m_initStats.totalMs << "ms";
+        return;
+    }
+
     // Retrieve the list of MLT's available assets.
     QScopedPointer<Mlt::Properties> assets(retrieveListFromMlt());
     QStringList emptyMetaAssets;
@@ -59,6 +81,8 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
         }
     }
 
+    m_initStats.mltMs = timer.elapsed();
+
     // We now parse custom effect xml
     // Set the directories to look into for effects.
     QStringList asset_dirs = assetDirs();
@@ -69,6 +93,7 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
        list, while discarding the bare version of each tag (the one with no file associated)
     */
     std::unordered_map<QString, Info> customAssets;
+    QStringList customFiles;
     // reverse order to prioritize local install
     QListIterator<QString> dirs_it(asset_dirs);
     for (dirs_it.toBack(); dirs_it.hasPrevious();) { auto dir=dirs_it.previous();
@@ -76,10 +101,23 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
         QStringList filter {QStringLiteral("*.xml")};
         QStringList fileList = current_dir.entryList(filter, QDir::Files);
         for (const auto &file : std::as_const(fileList)) {
-            QString path = current_dir.absoluteFilePath(file);
-            parseCustomAssetFile(path, customAssets);
+            customFiles << current_dir.absoluteFilePath(file);
         }
     }
+    // The files are read and parsed in parallel, then processed in order since assets can refer to the previous ones
+    QList<QDomDocument> customDocs = QtConcurrent::blockingMapped<QList<QDomDocument>>(customFiles, [](const QString &path) {
+        QDomDocument doc;
+        if (!Xml::docContentFromFile(doc, path, false)) {
+            return QDomDocument();
+        }
+        return doc;
+    });
+    for (int i = 0; i < customFiles.count(); ++i) {
+        if (!customDocs[i].isNull()) {
+            parseCustomAssetDocument(customDocs[i], customFiles.at(i), customAssets);
+        }
+    }
+    m_initStats.customMs = timer.elapsed() - m_initStats.mltMs;
 
     // We add the custom assets
     QStringList missingDependency;
@@ -126,6 +164,163 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
     for (const auto &invalid : std::as_const(emptyMetaAssets)) {
         m_assets.erase(invalid);
     }
+    // Parsing custom files may have updated some of them, compute the key again
+    saveCache(cacheKey());
+    m_initStats.assetCount = int(m_assets.size());
+    m_initStats.totalMs = timer.elapsed();
+    qCDebug(KDENLIVE_LOG) << "Parsed" << m_initStats.assetCount << cacheName() << "in" << m_initStats.totalMs << "ms, MLT metadata:" << m_initStats.mltMs
+                          << "ms, custom files:" << m_initStats.customMs << "ms";
+}
+
+template <typename AssetType> const typename AbstractAssetsRepository<AssetType>::InitStats &AbstractAssetsRepository<AssetType>::initStats() const
+{
+    return m_initStats;
+}
+
+template <typename AssetType>
+void AbstractAssetsRepository<AssetType>::parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
+{
+    QDomDocument doc;
+    if (!Xml::docContentFromFile(doc, file_name, false)) {
+        return;
+    }
+    parseCustomAssetDocument(doc, file_name, customAssets);
+}
+
+namespace AssetsCache {
+// Increase when the cache content changes
+constexpr quint32 formatVersion = 1;
+constexpr quint32 magic = 0x4b415243; // "KARC"
+
+inline QString path(const QString &name)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/assets/%1.cache").arg(name);
+}
+} // namespace AssetsCache
+
+template <typename AssetType> QByteArray AbstractAssetsRepository<AssetType>::cacheKey() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const auto add = [&hash](const QString &value) {
+        hash.addData(value.toUtf8());
+        hash.addData(QByteArrayLiteral("\n"));
+    };
+    add(QString::number(AssetsCache::formatVersion));
+    add(QCoreApplication::applicationVersion());
+    add(QString::fromLatin1(mlt_version_get_string()));
+    // Names and descriptions are translated
+    add(KLocalizedString::languages().join(QLatin1Char(',')));
+    add(QLocale().name());
+    // Custom assets can depend on services of the other kind
+    const auto addServices = [&add](Mlt::Properties *list) {
+        QScopedPointer<Mlt::Properties> services(list);
+        for (int i = 0; i < services->count(); ++i) {
+            add(QString::fromUtf8(services->get_name(i)));
+        }
+    };
+    addServices(pCore->getMltRepository()->filters());
+    addServices(pCore->getMltRepository()->transitions());
+    const auto addFile = [&add](const QFileInfo &info) {
+        add(info.absoluteFilePath());
+        add(QString::number(info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1));
+        add(QString::number(info.size()));
+    };
+    for (const QString &path : assetExcludedPath() + assetIncludedPath()) {
+        addFile(QFileInfo(path));
+    }
+    for (const QString &dir : assetDirs()) {
+        add(dir);
+        const QFileInfoList files = QDir(dir).entryInfoList({QStringLiteral("*.xml")}, QDir::Files, QDir::Name);
+        for (const QFileInfo &info : files) {
+            addFile(info);
+        }
+    }
+    return hash.result();
+}
+
+template <typename AssetType> bool AbstractAssetsRepository<AssetType>::loadCache(const QByteArray &key)
+{
+    QFile file(AssetsCache::path(cacheName()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray storedKey;
+    in >> magic >> version >> storedKey;
+    if (in.status() != QDataStream::Ok || magic != AssetsCache::magic || version != AssetsCache::formatVersion || storedKey != key) {
+        return false;
+    }
+    // The xml of all assets is stored in a single document, parsed at once
+    QByteArray xmlData;
+    qint32 count = 0;
+    in >> xmlData >> count;
+    QDomDocument doc;
+    if (in.status() != QDataStream::Ok || count < 0 || !doc.setContent(xmlData)) {
+        return false;
+    }
+    QDomElement xml = doc.documentElement().firstChildElement();
+    std::unordered_map<QString, Info> assets;
+    assets.reserve(size_t(count));
+    for (int i = 0; i < count; ++i) {
+        QString assetId;
+        Info info;
+        qint32 assetVersion;
+        qint32 type;
+        bool hasXml;
+        in >> assetId >> info.id >> info.mltId >> info.name >> info.description >> info.author >> info.version_str >> assetVersion >> info.included >> type >>
+            hasXml;
+        info.version = assetVersion;
+        info.type = AssetType(type);
+        if (hasXml) {
+            if (xml.isNull()) {
+                return false;
+            }
+            info.xml = xml;
+            xml = xml.nextSiblingElement();
+        }
+        assets[assetId] = info;
+    }
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Corrupted assets cache" << file.fileName();
+        return false;
+    }
+    m_assets = std::move(assets);
+    return true;
+}
+
+template <typename AssetType> void AbstractAssetsRepository<AssetType>::saveCache(const QByteArray &key) const
+{
+    const QString path = AssetsCache::path(cacheName());
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return;
+    }
+    QDomDocument doc;
+    QDomElement root = doc.createElement(QStringLiteral("assets"));
+    doc.appendChild(root);
+    for (const auto &asset : m_assets) {
+        if (!asset.second.xml.isNull()) {
+            root.appendChild(doc.importNode(asset.second.xml, true));
+        }
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write assets cache" << path;
+        return;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << AssetsCache::magic << AssetsCache::formatVersion << key << doc.toByteArray(-1) << qint32(m_assets.size());
+    for (const auto &asset : m_assets) {
+        const Info &info = asset.second;
+        out << asset.first << info.id << info.mltId << info.name << info.description << info.author << info.version_str << qint32(info.version) << info.included
+            << qint32(info.type) << !info.xml.isNull();
+    }
+    if (!file.commit()) {
+        qWarning() << "Cannot write assets cache" << path;
+    }
 }
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::parseAssetList(const QStringList &filePaths, QSet<QString> &destination)
@@ -593,6 +593,7 @@ Fun KeyframeModel::updateKeyframe_lambda(GenTime pos, KeyframeType::KeyframeEnum
         int row = static_cast<int>(std::distance(m_keyframeList.begin(), m_keyframeList.find(pos)));
         m_keyframeList[pos].first = type;
         m_keyframeList[pos].second = value;
+        invalidateAnimation();
         if (notify) Q_EMIT dataChanged(index(row), index(row), {ValueRole, NormalizedValueRole, TypeRole});
         return true;
     };
@@ -613,6 +614,7 @@ Fun KeyframeModel::addKeyframe_lambda(GenTime pos, KeyframeType::KeyframeEnum ty
         if (notify) beginInsertRows(QModelIndex(), insertionRow, insertionRow);
         m_keyframeList[pos].first = type;
         m_keyframeList[pos].second = value;
+        invalidateAnimation();
         if (notify) endInsertRows();
         return true;
     };
@@ -629,6 +631,7 @@ Fun KeyframeModel::deleteKeyframe_lambda(GenTime pos, bool notify)
         int row = static_cast<int>(std::distance(m_keyframeList.begin(), m_keyframeList.find(pos)));
         if (notify) beginRemoveRows(QModelIndex(), row, row);
         m_keyframeList.erase(pos);
+        invalidateAnimation();
         if (notify) endRemoveRows();
         qDebug() << "after" << getAnimProperty();
         return true;
@@ -1126,6 +1129,7 @@ void KeyframeModel::parseRotoProperty(const QString &prop)
     } else {
         // Empty doc, clear all keyframes
         m_keyframeList.clear();
+        invalidateAnimation();
     }
 }
 
@@ -1178,8 +1182,58 @@ QVariant KeyframeModel::getNormalizedValue(double newVal) const
 
 QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
 {
-    if (m_keyframeList.count(pos) > 0) {
-        return m_keyframeList.at(pos).second;
+    const int duration = parentDuration();
+    QMutexLocker lock(&m_animationMutex);
+    return interpolatedValue(pos, duration);
+}
+
+QList<QVariant> KeyframeModel::getInterpolatedValues(int start, int end) const
+{
+    QList<QVariant> values;
+    values.reserve(qMax(0, end - start + 1));
+    const double fps = pCore->getCurrentFps();
+    const int duration = parentDuration();
+    QMutexLocker lock(&m_animationMutex);
+    for (int frame = start; frame <= end; ++frame) {
+        values << interpolatedValue(GenTime(frame, fps), duration);
+    }
+    return values;
+}
+
+int KeyframeModel::parentDuration() const
+{
+    if (auto ptr = m_model.lock()) {
+        return ptr->data(m_index, AssetParameterModel::ParentDurationRole).toInt();
+    }
+    return 0;
+}
+
+void KeyframeModel::invalidateAnimation()
+{
+    QMutexLocker lock(&m_animationMutex);
+    m_animation.valid = false;
+    m_animation.properties.reset();
+    m_animation.rotoPoints.clear();
+}
+
+const QList<BPoint> &KeyframeModel::rotoPoints(const GenTime &pos, const QVariant &value, const QSize &frame) const
+{
+    if (frame != m_animation.rotoFrameSize) {
+        m_animation.rotoPoints.clear();
+        m_animation.rotoFrameSize = frame;
+    }
+    auto it = m_animation.rotoPoints.find(pos);
+    if (it == m_animation.rotoPoints.end()) {
+        it = m_animation.rotoPoints.emplace(pos, RotoHelper::getPoints(value, frame)).first;
+    }
+    return it->second;
+}
+
+QVariant KeyframeModel::interpolatedValue(const GenTime &pos, int duration) const
+{
+    auto current = m_keyframeList.find(pos);
+    if (current != m_keyframeList.end()) {
+        return current->second.second;
     }
     if (m_keyframeList.size() == 0) {
         return QVariant();
@@ -1199,8 +1253,8 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
         --prev;
 
         const QSize frame = pCore->getCurrentFrameSize();
-        QList<BPoint> p1 = RotoHelper::getPoints(prev->second.second, frame);
-        QList<BPoint> p2 = RotoHelper::getPoints(next->second.second, frame);
+        const QList<BPoint> &p1 = rotoPoints(prev->first, prev->second.second, frame);
+        const QList<BPoint> &p2 = rotoPoints(next->first, next->second.second, frame);
         // relPos should be in [0,1]:
         // - equal to 0 on prev keyframe
         // - equal to 1 on next keyframe
@@ -1226,29 +1280,35 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
         }
         return vlist;
     }
-    Mlt::Properties mlt_prop;
-    QString animData;
-    int out = 0;
-    bool useOpacity = false;
-    if (auto ptr = m_model.lock()) {
-        ptr->passProperties(mlt_prop);
-        out = ptr->data(m_index, AssetParameterModel::ParentDurationRole).toInt();
-        useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
-        animData = ptr->data(m_index, AssetParameterModel::ValueRole).toString();
+    if (!m_animation.valid || m_animation.duration != duration) {
+        // Parse the animation once, the following queries only evaluate it
+        m_animation.valid = true;
+        m_animation.duration = duration;
+        m_animation.properties.reset();
+        if (auto ptr = m_model.lock()) {
+            const QString animData = ptr->data(m_index, AssetParameterModel::ValueRole).toString();
+            if (!animData.isEmpty()) {
+                m_animation.properties = std::make_shared<Mlt::Properties>();
+                ptr->passProperties(*m_animation.properties.get());
+                m_animation.properties->set("key", animData.toUtf8().constData());
+                // This is a fake query to force the animation to be parsed
+                (void)m_animation.properties->anim_get_double("key", 0, duration);
+                m_animation.relative = animData.contains(QLatin1Char('%'));
+                m_animation.useOpacity = ptr->data(m_index, AssetParameterModel::OpacityRole).toBool();
+            }
+        }
     }
-
-    if (!animData.isEmpty() && (m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel)) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        return QVariant(mlt_prop.anim_get_double("key", pos.frames(pCore->getCurrentFps())));
+    Mlt::Properties *mlt_prop = m_animation.properties.get();
+    if (mlt_prop == nullptr) {
+        return QVariant();
+    }
+    const int frame = pos.frames(pCore->getCurrentFps());
+    if (m_paramType == ParamType::KeyframeParam || m_paramType == ParamType::ColorWheel) {
+        return QVariant(mlt_prop->anim_get_double("key", frame));
     }
-    if (!animData.isEmpty() && m_paramType == ParamType::AnimatedRect) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        mlt_rect rect = mlt_prop.anim_get_rect("key", pos.frames(pCore->getCurrentFps()));
-        if (animData.contains(QLatin1Char('%'))) {
+    if (m_paramType == ParamType::AnimatedRect) {
+        mlt_rect rect = mlt_prop->anim_get_rect("key", frame);
+        if (m_animation.relative) {
             const QSize profileSize = pCore->getCurrentFrameSize();
             rect.x *= profileSize.width();
             rect.y *= profileSize.height();
@@ -1256,16 +1316,13 @@ QVariant KeyframeModel::getInterpolatedValue(const GenTime &pos) const
             rect.h *= profileSize.height();
         }
         QString res = QStringLiteral("%1 %2 %3 %4").arg(int(rect.x)).arg(int(rect.y)).arg(int(rect.w)).arg(int(rect.h));
-        if (useOpacity) {
+        if (m_animation.useOpacity) {
             res.append(QStringLiteral(" %1").arg(QString::number(rect.o, 'f')));
         }
         return QVariant(res);
     }
-    if (!animData.isEmpty() && m_paramType == ParamType::Color) {
-        mlt_prop.set("key", animData.toUtf8().constData());
-        // This is a fake query to force the animation to be parsed
-        (void)mlt_prop.anim_get_double("key", 0, out);
-        mlt_color mltColor = mlt_prop.anim_get_color("key", pos.frames(pCore->getCurrentFps()));
+    if (m_paramType == ParamType::Color) {
+        mlt_color mltColor = mlt_prop->anim_get_color("key", frame);
         QColor color(mltColor.r, mltColor.g, mltColor.b, mltColor.a);
         return QVariant(QColorUtils::colorToString(color, true));
     }
@@ -1280,6 +1337,7 @@ void KeyframeModel::sendModification()
         if (AssetParameterModel::isAnimated(m_paramType)) {
             m_lastData = getAnimProperty();
             ptr->setParameter(name, m_lastData, false, m_index);
+            invalidateAnimation();
         } else {
             Q_ASSERT(false); // Not implemented, TODO
         }
@@ -1331,6 +1389,7 @@ void KeyframeModel::refresh(int in, int out)
         // nothing to do
         return;
     }
+    invalidateAnimation();
     if (m_paramType == ParamType::Roto_spline) {
         parseRotoProperty(animData);
     } else if (AssetParameterModel::isAnimated(m_paramType)) {
@@ -1365,6 +1424,7 @@ void KeyframeModel::reset()
         qDebug() << "// DATA WAS ALREADY PARSED, ABORTING\n_________________";
         return;
     }
+    invalidateAnimation();
     if (m_paramType == ParamType::Roto_spline) {
         // TODO: resetRotoProperty(animData);
     } else if (AssetParameterModel::isAnimated(m_paramType)) {
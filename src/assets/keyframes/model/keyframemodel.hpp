@@ -5,13 +5,16 @@
 
 #pragma once
 
+#include "assets/bpoint.h"
 #include "assets/model/assetparametermodel.hpp"
 #include "definitions.h"
 #include "undohelper.hpp"
 #include "utils/gentime.h"
 
 #include <QAbstractListModel>
+#include <QMutex>
 #include <QReadWriteLock>
+#include <QSize>
 #include <QtGlobal>
 
 #include <framework/mlt_version.h>
@@ -146,6 +149,8 @@ public:
     /** @brief Return the interpolated value at given pos */
     QVariant getInterpolatedValue(int pos) const;
     QVariant getInterpolatedValue(const GenTime &pos) const;
+    /** @brief Return the interpolated values of the frames from start to end included */
+    QList<QVariant> getInterpolatedValues(int start, int end) const;
     QVariant updateInterpolated(const QVariant &interpValue, double val);
     /** @brief Return the real value from a normalized one */
     QVariant getNormalizedValue(double newVal) const;
@@ -216,6 +221,31 @@ private:
     mutable QReadWriteLock m_lock;
 
     std::map<GenTime, std::pair<KeyframeType::KeyframeEnum, QVariant>> m_keyframeList;
+
+    /** @brief The parameter animation, parsed once and reused by the interpolation queries until the keyframes change */
+    struct CompiledAnimation
+    {
+        bool valid{false};
+        /** @brief Duration of the parent item when the animation was parsed, it is needed to place the keyframes relative to the end */
+        int duration{0};
+        std::shared_ptr<Mlt::Properties> properties;
+        /** @brief The rect values are given in percents of the frame size */
+        bool relative{false};
+        bool useOpacity{false};
+        /** @brief Spline points of the roto keyframes, parsed when first needed */
+        std::map<GenTime, QList<BPoint>> rotoPoints;
+        QSize rotoFrameSize;
+    };
+    mutable CompiledAnimation m_animation;
+    mutable QMutex m_animationMutex;
+    /** @brief Discards the compiled animation, must be called when the keyframes or the parameter value change */
+    void invalidateAnimation();
+    /** @brief Computes the value at pos, m_animationMutex must be locked */
+    QVariant interpolatedValue(const GenTime &pos, int duration) const;
+    /** @brief Returns the spline points of a roto keyframe, m_animationMutex must be locked */
+    const QList<BPoint> &rotoPoints(const GenTime &pos, const QVariant &value, const QSize &frame) const;
+    int parentDuration() const;
+
     bool moveOneKeyframe(GenTime oldPos, GenTime pos, QVariant newVal, Fun &undo, Fun &redo, bool updateView = true, bool allowedToFail = false);
 
 Q_SIGNALS:
@@ -79,6 +79,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QCryptographicHash>
 #include <QDrag>
 #include <QFile>
+#include <QFileDialog>
+#include <QJsonDocument>
 #include <QMenu>
 #include <QMimeData>
 #include <QSlider>
@@ -1430,6 +1432,8 @@ Bin::Bin(std::shared_ptr<ProjectItemModel> model, QWidget *parent, bool isMainBi
         m_jobsMenu->addAction(m_cancelJobs);
         m_jobsMenu->addAction(m_discardCurrentClipJobs);
         m_jobsMenu->addAction(m_discardPendingJobs);
+        m_jobsMenu->addSeparator();
+        QAction *saveJobStatistics = m_jobsMenu->addAction(i18n("Save Job Statistics…"));
         m_infoLabel->setMenu(m_jobsMenu);
         m_infoLabel->setAction(infoAction);
 
@@ -1440,6 +1444,19 @@ Bin::Bin(std::shared_ptr<ProjectItemModel> model, QWidget *parent, bool isMainBi
             }
         });
         connect(m_cancelJobs, &QAction::triggered, [&]() { pCore->taskManager.slotCancelJobs(); });
+        connect(saveJobStatistics, &QAction::triggered, this, [this]() {
+            // Queue wait and run times per job type, to tune the number of concurrent jobs
+            const QString url = QFileDialog::getSaveFileName(this, i18nc("@title:window", "Save Job Statistics"), QString(), i18n("JSON Files (*.json)"));
+            if (url.isEmpty()) {
+                return;
+            }
+            QFile file(url);
+            if (!file.open(QIODevice::WriteOnly)) {
+                KMessageBox::error(this, i18n("Cannot write to file %1", url));
+                return;
+            }
+            file.write(QJsonDocument(pCore->taskManager.statistics()).toJson());
+        });
         connect(m_discardPendingJobs, &QAction::triggered, [&]() {
             // TODO: implement pending only deletion
             pCore->taskManager.slotCancelJobs();
@@ -17,6 +17,7 @@
 #include "projectitemmodel.h"
 #include "titler/titledocument.h"
 #include "utils/devices.hpp"
+#include "utils/filehashcache.hpp"
 #include "xml/xml.hpp"
 
 #include <KMessageBox>
@@ -405,6 +406,15 @@ const QString ClipCreator::createClipsFromList(const QList<QUrl> &list, bool che
     }
 
     qDebug() << "/////////// creatclipsfromlist" << cleanList << checkRemovable << parentFolder;
+    // Hash the files in background while the clips are created, so that loading the clips finds their hash in the cache
+    QStringList filePaths;
+    for (const QUrl &url : std::as_const(cleanList)) {
+        const QString path = url.toLocalFile();
+        if (QFileInfo(path).isFile()) {
+            filePaths << path;
+        }
+    }
+    FileHashCache::get()->prefetch(filePaths);
     QMimeDatabase db;
     QList<QDir> checkedDirectories;
     bool removableProject = checkRemovable ? isOnRemovableDevice(pCore->currentDoc()->projectDataFolder()) : false;
@@ -29,6 +29,7 @@
 #include <QJsonObject>
 #include <QRegularExpression>
 #include <QStringConverter>
+#include <limits>
 #include <utility>
 
 SubtitleModel::SubtitleModel(std::shared_ptr<TimelineItemModel> timeline, const std::weak_ptr<SnapInterface> &snapModel, QObject *parent)
@@ -491,6 +492,7 @@ bool SubtitleModel::addSubtitle(int id, std::pair<int, GenTime> start, const Sub
     int row = getSubtitleIndex(id);
     beginInsertRows(QModelIndex(), row, row);
     m_subtitleList[start] = event;
+    indexSubtitle(id, start, event.endTime());
     endInsertRows();
     addSnapPoint(start.second);
     addSnapPoint(event.endTime()); // {layer, end}
@@ -641,22 +643,20 @@ std::unordered_set<int> SubtitleModel::getItemsInRange(int layer, int startFrame
         return {};
     }
     GenTime startTime(startFrame, pCore->getCurrentFps());
-    GenTime endTime(endFrame, pCore->getCurrentFps());
+    // An end frame of -1 means no end
+    GenTime endTime = endFrame > -1 ? GenTime(endFrame, pCore->getCurrentFps()) : GenTime(std::numeric_limits<double>::max());
     std::unordered_set<int> matching;
-    for (const auto &subtitles : m_subtitleList) {
+    for (const auto &intervals : m_layerIntervals) {
         // if layer is -1, we check all layers
-        if ((endFrame > -1 && subtitles.first.second > endTime) || (layer != -1 && subtitles.first.first != layer)) {
-            // Outside range
+        if (layer != -1 && intervals.first != layer) {
             continue;
         }
-        if (subtitles.first.second >= startTime || subtitles.second.endTime() > startTime) {
-            int sid = getIdForStartPos(layer, subtitles.first.second);
-            if (sid > -1) {
+        intervals.second.forEachOverlapping(startTime, endTime, [&matching, startTime](GenTime start, GenTime end, int sid) {
+            // A subtitle ending at the range start is not in the range, unless it also starts there
+            if (start >= startTime || end > startTime) {
                 matching.emplace(sid);
-            } else {
-                qDebug() << "==== FOUND INVALID SUBTILE AT: " << subtitles.first.second.frames(pCore->getCurrentFps());
             }
-        }
+        });
     }
     return matching;
 }
@@ -679,11 +679,13 @@ int SubtitleModel::cutSubtitle(int layer, int position, Fun &undo, Fun &redo)
     }
     GenTime pos(position, pCore->getCurrentFps());
     GenTime start = GenTime(-1);
-    for (const auto &subtitles : m_subtitleList) {
-        if (subtitles.first.second <= pos && subtitles.second.endTime() > pos) {
-            start = subtitles.first.second;
-            break;
-        }
+    auto intervals = m_layerIntervals.find(layer);
+    if (intervals != m_layerIntervals.end()) {
+        intervals->second.forEachOverlapping(pos, pos, [&start, pos](GenTime subStart, GenTime subEnd, int) {
+            if (start < GenTime() && subEnd > pos) {
+                start = subStart;
+            }
+        });
     }
     if (start >= GenTime()) {
         const SubtitleEvent originalEvent = m_subtitleList.at({layer, start});
@@ -786,8 +788,10 @@ void SubtitleModel::editEndPos(int layer, GenTime startPos, GenTime newEndPos, b
         return;
     }
     m_subtitleList[{layer, startPos}].setEndTime(newEndPos);
-    // Trigger update of the qml view
     int id = getIdForStartPos(layer, startPos);
+    unindexSubtitle(id, {layer, startPos});
+    indexSubtitle(id, {layer, startPos}, newEndPos);
+    // Trigger update of the qml view
     int row = getSubtitleIndex(id);
     Q_EMIT dataChanged(index(row), index(row), {EndFrameRole});
     if (refreshModel) {
@@ -850,6 +854,8 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
         GenTime newEndPos = startPos.second + GenTime(size, pCore->getCurrentFps());
         operation = [this, id, startPos, endPos, newEndPos, logUndo]() {
             m_subtitleList[startPos].setEndTime(newEndPos);
+            unindexSubtitle(id, startPos);
+            indexSubtitle(id, startPos, newEndPos);
             removeSnapPoint(endPos);
             addSnapPoint(newEndPos);
             // Trigger update of the qml view
@@ -870,6 +876,8 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
         };
         reverse = [this, id, startPos, endPos, newEndPos, logUndo]() {
             m_subtitleList[startPos].setEndTime(endPos);
+            unindexSubtitle(id, startPos);
+            indexSubtitle(id, startPos, endPos);
             removeSnapPoint(newEndPos);
             addSnapPoint(endPos);
             // Trigger update of the qml view
@@ -899,6 +907,8 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
             m_allSubtitles[id] = newStartPos;
             m_subtitleList.erase(startPos);
             m_subtitleList[newStartPos] = event;
+            unindexSubtitle(id, startPos);
+            indexSubtitle(id, newStartPos, event.endTime());
             // Trigger update of the qml view
             removeSnapPoint(startPos.second);
             addSnapPoint(newStartPos.second);
@@ -921,6 +931,8 @@ bool SubtitleModel::requestResize(int id, int size, bool right, Fun &undo, Fun &
             m_allSubtitles[id] = startPos;
             m_subtitleList.erase(newStartPos);
             m_subtitleList[startPos] = event;
+            unindexSubtitle(id, newStartPos);
+            indexSubtitle(id, startPos, event.endTime());
             removeSnapPoint(newStartPos.second);
             addSnapPoint(startPos.second);
             // Trigger update of the qml view
@@ -995,6 +1007,7 @@ bool SubtitleModel::removeSubtitle(int id, bool temporary, bool updateFilter)
         lastSub = true;
     }
     m_subtitleList.erase(start);
+    unindexSubtitle(id, start);
     endRemoveRows();
     removeSnapPoint(start.second);
     removeSnapPoint(end);
@@ -1055,6 +1068,8 @@ bool SubtitleModel::moveSubtitle(int subId, int newLayer, GenTime newPos, bool u
     m_subtitleList.erase({oldLayer, oldPos});
     m_subtitleList[{newLayer, newPos}] = event;
     m_subtitleList[{newLayer, newPos}].setEndTime(endPos);
+    unindexSubtitle(id, {oldLayer, oldPos});
+    indexSubtitle(id, {newLayer, newPos}, endPos);
     addSnapPoint(newPos);
     addSnapPoint(endPos);
     setActiveSubLayer(newLayer);
@@ -1082,13 +1097,15 @@ bool SubtitleModel::moveSubtitle(int subId, int newLayer, GenTime newPos, bool u
 
 int SubtitleModel::getIdForStartPos(int layer, GenTime startTime) const
 {
-    auto findResult = std::find_if(std::begin(m_allSubtitles), std::end(m_allSubtitles), [&](const std::pair<int, std::pair<int, GenTime>> &pair) {
-        return pair.second.second == startTime && (pair.second.first == layer || layer == -1);
-    });
-    if (findResult != std::end(m_allSubtitles)) {
-        return findResult->first;
+    int id = -1;
+    for (const auto &intervals : m_layerIntervals) {
+        // if layer is -1, we return the smallest id starting there on any layer
+        int sid;
+        if ((layer == -1 || intervals.first == layer) && intervals.second.findStart(startTime, sid) && (id == -1 || sid < id)) {
+            id = sid;
+        }
     }
-    return -1;
+    return id;
 }
 
 int SubtitleModel::getLayerForId(int id) const
@@ -1984,6 +2001,7 @@ void SubtitleModel::activateSubtitle(int ix)
     }
     beginRemoveRows(QModelIndex(), 0, m_allSubtitles.size());
     m_subtitleList.clear();
+    m_layerIntervals.clear();
     m_subtitleStyles.clear();
     m_scriptInfo.clear();
     m_maxLayer = 0;
@@ -2014,6 +2032,23 @@ void SubtitleModel::registerSubtitle(int id, std::pair<int, GenTime> startpos, b
     }
 }
 
+void SubtitleModel::indexSubtitle(int id, std::pair<int, GenTime> start, GenTime end)
+{
+    m_layerIntervals[start.first].insert(start.second, end, id);
+}
+
+void SubtitleModel::unindexSubtitle(int id, std::pair<int, GenTime> start)
+{
+    auto intervals = m_layerIntervals.find(start.first);
+    if (intervals == m_layerIntervals.end() || !intervals->second.remove(start.second, id)) {
+        qDebug() << "==== SUBTITLE NOT FOUND IN INDEX: " << id;
+        return;
+    }
+    if (intervals->second.empty()) {
+        m_layerIntervals.erase(intervals);
+    }
+}
+
 void SubtitleModel::deregisterSubtitle(int id, bool temporary)
 {
     Q_ASSERT(m_allSubtitles.count(id) > 0);
@@ -9,6 +9,7 @@
 #include "definitions.h"
 #include "undohelper.hpp"
 #include "utils/gentime.h"
+#include "utils/intervaltree.hpp"
 
 #include <QAbstractListModel>
 #include <QReadWriteLock>
@@ -304,6 +305,8 @@ private:
     QMap<std::pair<int, QString>, QString> m_subtitlesList;
     /** @brief A list of subtitles as: item id, layer, start time */
     std::map<int, std::pair<int, GenTime>> m_allSubtitles;
+    /** @brief The [start, end] intervals of the subtitles of each layer, tagged with their item id */
+    std::map<int, IntervalTree<GenTime, int>> m_layerIntervals;
     /** @brief The max layer in the subtitle model */
     int m_maxLayer{0};
     /** @brief Default styles for subtitle layers */
@@ -344,6 +347,10 @@ protected:
     void setup();
     void registerSubtitle(int id, std::pair<int, GenTime> startpos, bool temporary = false);
     void deregisterSubtitle(int id, bool temporary = false);
+    /** @brief Add a subtitle to the interval index of its layer */
+    void indexSubtitle(int id, std::pair<int, GenTime> start, GenTime end);
+    /** @brief Remove a subtitle from the interval index of its layer */
+    void unindexSubtitle(int id, std::pair<int, GenTime> start);
     /** @brief Returns the index for a subtitle's id (it's position in the list
      */
     int positionForIndex(int id) const;
@@ -15,6 +15,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "doc/kdenlivedoc.h"
 #include "doc/kthumb.h"
 #include "effects/effectstack/model/effectstackmodel.hpp"
+#include "jobs/audiolevels/audiolevelscache.h"
 #include "jobs/audiolevels/audiolevelstask.h"
 #include "jobs/cachetask.h"
 #include "jobs/cliploadtask.h"
@@ -31,6 +32,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "projectitemmodel.h"
 #include "projectsubclip.h"
 #include "timeline2/model/snapmodel.hpp"
+#include "utils/filehashcache.hpp"
 #include "utils/thumbnailcache.hpp"
 #include "utils/timecode.h"
 #include "xml/xml.hpp"
@@ -1640,28 +1642,7 @@ const QString ProjectClip::getFileHash()
 
 const QPair<QByteArray, qint64> ProjectClip::calculateHash(const QString &path)
 {
-    QFile file(path);
-    QByteArray fileHash;
-    qint64 fSize = 0;
-    if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-        /*
-         * 1 MB = 1 second per 450 files (or faster)
-         * 10 MB = 9 seconds per 450 files (or faster)
-         */
-        QByteArray fileData;
-        fSize = file.size();
-        if (fSize > 2000000) {
-            fileData = file.read(1000000);
-            if (file.seek(file.size() - 1000000)) {
-                fileData.append(file.readAll());
-            }
-        } else {
-            fileData = file.readAll();
-        }
-        file.close();
-        fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-    }
-    return {fileHash, fSize};
+    return FileHashCache::get()->fileHash(path);
 }
 
 double ProjectClip::getOriginalFps() const
@@ -2066,6 +2047,7 @@ void ProjectClip::discardAudioThumb()
     for (const int &st : streams) {
         audioThumbPath = getAudioThumbPath(st);
         if (!audioThumbPath.isEmpty()) {
+            AudioLevelsCache::release(audioThumbPath);
             QFile::remove(audioThumbPath);
         }
         // Clear audio cache
@@ -2705,6 +2687,15 @@ QVector<int16_t> ProjectClip::audioFrameCache(const int streamIdx) const
     return {};
 }
 
+std::shared_ptr<const AudioLevelsCache> ProjectClip::audioLevelsCache(const int streamIdx) const
+{
+    const QString key = QStringLiteral("_kdenlive:audiocache%1").arg(streamIdx);
+    if (m_masterProducer->get_data(key.toUtf8().constData())) {
+        return *static_cast<std::shared_ptr<const AudioLevelsCache> *>(m_masterProducer->get_data(key.toUtf8().constData()));
+    }
+    return nullptr;
+}
+
 void ProjectClip::setClipStatus(FileStatus::ClipStatus status)
 {
     if (status == FileStatus::StatusMissing && hasProxy()) {
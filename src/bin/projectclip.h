@@ -21,6 +21,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QUuid>
 #include <memory>
 
+class AudioLevelsCache;
 class ClipPropertiesController;
 class ProjectFolder;
 class ProjectSubClip;
@@ -185,7 +186,7 @@ public:
     /** @brief The clip hash created from the clip's resource. */
     const QString hash(bool createIfEmpty = true);
 
-    /** @brief Callculate a file hash from a path. */
+    /** @brief Calculate a file hash from a path, reusing the cached hash if the file did not change (see FileHashCache). */
     static const QPair<QByteArray, qint64> calculateHash(const QString &path);
 
     /** Cache for every audio Frame with 10 Bytes */
@@ -249,6 +250,9 @@ public:
     /** @brief Return audio cache for a stream
      */
     QVector<int16_t> audioFrameCache(int streamIdx) const;
+    /** @brief Return the mapped audio cache file for a stream, nullptr while its levels are generated
+     */
+    std::shared_ptr<const AudioLevelsCache> audioLevelsCache(int streamIdx) const;
     /** @brief Return FFmpeg's audio stream index for an MLT audio stream index
      */
     int getAudioStreamFfmpegIndex(int mltStream);
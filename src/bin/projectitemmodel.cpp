@@ -1708,42 +1708,10 @@ const std::pair<QString, QString> ProjectItemModel::sceneList(const QString &roo
     tempFile.setAutoRemove(false);
 
     Mlt::Consumer xmlConsumer(pCore->getProjectProfile(), "xml", aspectRatio.isEmpty() ? "kdenlive_playlist" : tempFile.fileName().toUtf8().constData());
-    if (!root.isEmpty()) {
-        xmlConsumer.set("root", root.toUtf8().constData());
-    }
     if (!xmlConsumer.is_valid()) {
         return {};
     }
-    xmlConsumer.set("store", "kdenlive");
-    xmlConsumer.set("time_format", "clock");
-    // Disabling meta creates cleaner files, but then we don't have access to metadata on the fly (meta channels, etc)
-    // And we must use "avformat" instead of "avformat-novalidate" on project loading which causes a big delay on project opening
-    // xmlConsumer.set("no_meta", 1);
-    // Add active timeline as playlist of the main tractor so that when played through melt, the .kdenlive file reads the playlist
-    if (m_projectTractor->count() > 0) {
-        m_projectTractor->remove_track(0);
-    }
-    Mlt::Service s;
-    if (timelineProducerOnly) {
-        s = Mlt::Service(activeTractor->get_service());
-    } else {
-        std::unique_ptr<Mlt::Producer> cut(activeTractor->cut(0, duration));
-        m_projectTractor->insert_track(*cut.get(), 0);
-        s = Mlt::Service(m_projectTractor->get_service());
-    }
-
-    std::unique_ptr<Mlt::Filter> filter = nullptr;
-    if (!filterData.isEmpty()) {
-        filter = std::make_unique<Mlt::Filter>(pCore->getProjectProfile(), QStringLiteral("dynamictext:%1").arg(filterData).toUtf8().constData());
-        filter->set("fgcolour", "#ffffff");
-        filter->set("bgcolour", "#bb333333");
-        s.attach(*filter.get());
-    }
-    xmlConsumer.connect(s);
-    xmlConsumer.run();
-    if (filter) {
-        s.detach(*filter.get());
-    }
+    runSceneConsumer(xmlConsumer, root, filterData, activeTractor, duration, timelineProducerOnly);
     if (aspectRatio.isEmpty()) {
         playlist = QString::fromUtf8(xmlConsumer.get("kdenlive_playlist"));
         return {playlist, QString()};
@@ -1807,6 +1775,56 @@ const std::pair<QString, QString> ProjectItemModel::sceneList(const QString &roo
     return {playlist, tempFile.fileName()};
 }
 
+const QByteArray ProjectItemModel::sceneListData(const QString &root, Mlt::Tractor *activeTractor, int duration)
+{
+    QWriteLocker lock(&pCore->xmlMutex);
+    LocaleHandling::resetLocale();
+    Mlt::Consumer xmlConsumer(pCore->getProjectProfile(), "xml", "kdenlive_playlist");
+    if (!xmlConsumer.is_valid()) {
+        return {};
+    }
+    runSceneConsumer(xmlConsumer, root, QString(), activeTractor, duration, false);
+    return QByteArray(xmlConsumer.get("kdenlive_playlist"));
+}
+
+void ProjectItemModel::runSceneConsumer(Mlt::Consumer &xmlConsumer, const QString &root, const QString &filterData, Mlt::Tractor *activeTractor, int duration,
+                                        bool timelineProducerOnly)
+{
+    if (!root.isEmpty()) {
+        xmlConsumer.set("root", root.toUtf8().constData());
+    }
+    xmlConsumer.set("store", "kdenlive");
+    xmlConsumer.set("time_format", "clock");
+    // Disabling meta creates cleaner files, but then we don't have access to metadata on the fly (meta channels, etc)
+    // And we must use "avformat" instead of "avformat-novalidate" on project loading which causes a big delay on project opening
+    // xmlConsumer.set("no_meta", 1);
+    // Add active timeline as playlist of the main tractor so that when played through melt, the .kdenlive file reads the playlist
+    if (m_projectTractor->count() > 0) {
+        m_projectTractor->remove_track(0);
+    }
+    Mlt::Service s;
+    if (timelineProducerOnly) {
+        s = Mlt::Service(activeTractor->get_service());
+    } else {
+        std::unique_ptr<Mlt::Producer> cut(activeTractor->cut(0, duration));
+        m_projectTractor->insert_track(*cut.get(), 0);
+        s = Mlt::Service(m_projectTractor->get_service());
+    }
+
+    std::unique_ptr<Mlt::Filter> filter = nullptr;
+    if (!filterData.isEmpty()) {
+        filter = std::make_unique<Mlt::Filter>(pCore->getProjectProfile(), QStringLiteral("dynamictext:%1").arg(filterData).toUtf8().constData());
+        filter->set("fgcolour", "#ffffff");
+        filter->set("bgcolour", "#bb333333");
+        s.attach(*filter.get());
+    }
+    xmlConsumer.connect(s);
+    xmlConsumer.run();
+    if (filter) {
+        s.detach(*filter.get());
+    }
+}
+
 std::shared_ptr<Mlt::Tractor> ProjectItemModel::getExtraTimeline(const QString &uuid)
 {
     if (m_extraPlaylists.count(uuid) > 0) {
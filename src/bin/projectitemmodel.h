@@ -255,6 +255,8 @@ public:
      * file's path as second parameter */
     const std::pair<QString, QString> sceneList(const QString &root, const QString &filterData, Mlt::Tractor *activeTractor, int duration,
                                                 bool timelineProducerOnly = false, const QString &aspectRatio = QString());
+    /** @brief Return the project's xml as sceneList() does, encoded in UTF-8 as produced by MLT */
+    const QByteArray sceneListData(const QString &root, Mlt::Tractor *activeTractor, int duration);
     /** @brief Ensure that sequence @destUuid is not embedded in any dependency of sequence @srcUuid */
     bool canBeEmbeded(const QUuid destUuid, const QUuid srcUuid);
     /** @brief Store a newly created sequence tractor for reuse */
@@ -315,6 +317,9 @@ private:
     int mapToColumn(int column) const;
     /** @brief Return column number(s) responsible for a specific data type*/
     QList<int> mapDataToColumn(AbstractProjectItem::DataType type) const;
+    /** @brief Connect the project (or only the active timeline) to an xml consumer and run it, pCore->xmlMutex must be locked */
+    void runSceneConsumer(Mlt::Consumer &xmlConsumer, const QString &root, const QString &filterData, Mlt::Tractor *activeTractor, int duration,
+                          bool timelineProducerOnly);
 
     mutable QReadWriteLock m_lock; // This is a lock that ensures safety in case of concurrent access
 
@@ -15,7 +15,6 @@
 
 #include <KLocalizedString>
 
-#include <QCryptographicHash>
 #include <QStandardPaths>
 
 QDebug operator<<(QDebug qd, const DocumentChecker::DocumentResource &item)
@@ -1288,34 +1287,17 @@ QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &m
         return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
     }
     QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
     QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
         qApp->processEvents();
         /*if (m_abortSearch) {
             return QString();
         }*/
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
+        const QString filePath = dir.absoluteFilePath(filesAndDirs.at(i));
+        if (QString::number(QFileInfo(filePath).size()) == matchSize) {
+            const QByteArray fileHash = ProjectClip::calculateHash(filePath).first;
+            if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
+                return filePath;
             }
         }
     }
@@ -30,6 +30,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "timeline2/model/timelineitemmodel.hpp"
 #include "titler/titlewidget.h"
 #include "transitions/transitionsrepository.hpp"
+#include "utils/multireplacer.h"
 #include <config-kdenlive.h>
 
 #include <KBookmark>
@@ -342,6 +343,7 @@ KdenliveDoc::~KdenliveDoc()
     }
     m_commandStack->clear();
     m_timelines.clear();
+    waitForAutoSave();
     if (m_autosave) {
         if (!m_autosave->fileName().isEmpty()) {
             m_autosave->remove();
@@ -576,9 +578,11 @@ bool KdenliveDoc::autoGenerateImageProxy(int width) const
            (width < 0 || width > m_documentProperties.value(QStringLiteral("proxyimageminsize")).toInt());
 }
 
-void KdenliveDoc::slotAutoSave(const QString &scene)
+void KdenliveDoc::slotAutoSave(const QByteArray &scene, const QMap<QString, QString> &replacements)
 {
     if (m_autosave != nullptr) {
+        // Only one autosave is written at a time
+        waitForAutoSave();
         if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
             // show error: could not open the autosave file
             qCDebug(KDENLIVE_LOG) << "ERROR; CANNOT CREATE AUTOSAVE FILE";
@@ -587,17 +591,40 @@ void KdenliveDoc::slotAutoSave(const QString &scene)
         }
         if (scene.isEmpty()) {
             // Make sure we don't save if scenelist is corrupted
-            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
+            pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"),
+                                  ErrorMessage);
             return;
         }
-        m_autosave->resize(0);
-        if (m_autosave->write(scene.toUtf8()) < 0) {
-            pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
-        }
-        m_autosave->flush();
+        KAutoSaveFile *file = m_autosave;
+        m_autoSaveFuture = QtConcurrent::run([this, file, scene, replacements]() {
+            const QByteArray data = MultiReplacer(replacements).apply(scene);
+            if (!data.contains("<track ")) {
+                // In some unexplained cases, the MLT playlist is corrupted and all tracks are deleted. Don't save in that case.
+                QMetaObject::invokeMethod(
+                    this,
+                    []() {
+                        pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"),
+                                              ErrorMessage);
+                    },
+                    Qt::QueuedConnection);
+                return;
+            }
+            file->resize(0);
+            if (file->write(data) < 0) {
+                const QString fileName = file->fileName();
+                QMetaObject::invokeMethod(
+                    this, [fileName]() { pCore->displayMessage(i18n("Cannot create autosave file %1", fileName), ErrorMessage); }, Qt::QueuedConnection);
+            }
+            file->flush();
+        });
     }
 }
 
+void KdenliveDoc::waitForAutoSave()
+{
+    m_autoSaveFuture.waitForFinished();
+}
+
 void KdenliveDoc::setZoom(const QUuid &uuid, int horizontal, int vertical)
 {
     setSequenceProperty(uuid, QStringLiteral("zoom"), horizontal);
@@ -1137,32 +1164,15 @@ const QString KdenliveDoc::description(const QString suffix) const
 QString KdenliveDoc::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const
 {
     QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
     QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
     for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (file.open(QIODevice::ReadOnly)) {
-            if (QString::number(file.size()) == matchSize) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-                qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
+        const QString filePath = dir.absoluteFilePath(filesAndDirs.at(i));
+        if (QString::number(QFileInfo(filePath).size()) == matchSize) {
+            const QByteArray fileHash = ProjectClip::calculateHash(filePath).first;
+            if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
+                return filePath;
             }
+            qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
         }
     }
     filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
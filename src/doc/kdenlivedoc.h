@@ -15,6 +15,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <KJob>
 #include <QAction>
 #include <QDir>
+#include <QFuture>
 #include <QList>
 #include <QMap>
 #include <QObject>
@@ -115,6 +116,8 @@ public:
     int height() const;
     QUrl url() const;
     KAutoSaveFile *m_autosave;
+    /** @brief Waits until the autosave file is written, it must be called before using m_autosave */
+    void waitForAutoSave();
     /** @brief Whether the project folder should be in the same folder as the project file (var is only used for new projects)*/
     bool m_sameProjectFolder{false};
     bool m_restoreFromBackup{false};
@@ -396,6 +399,8 @@ private:
     QString m_modifiedDecimalPoint;
     /** @brief A list of guide models for this project (one for each timeline). */
     QMap<QUuid, std::shared_ptr<TimelineItemModel>> m_timelines;
+    /** @brief The autosave being written in the background */
+    QFuture<void> m_autoSaveFuture;
     QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const;
 
     /** @brief Creates a new project. */
@@ -426,8 +431,10 @@ public Q_SLOTS:
                               QUndoCommand *masterCommand = nullptr);
     /** @brief Saves the current project at the autosave location.
      *
-     * The autosave files are in ~/.kde/data/stalefiles/kdenlive/ */
-    void slotAutoSave(const QString &scene);
+     * The autosave files are in ~/.kde/data/stalefiles/kdenlive/
+     * The replacement patterns are applied and the file is written in a background thread.
+     * @param scene the UTF-8 encoded scene list */
+    void slotAutoSave(const QByteArray &scene, const QMap<QString, QString> &replacements);
     void switchProfile(ProfileParam* pf, const QString &clipName);
 
 private Q_SLOTS:
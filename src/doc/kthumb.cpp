@@ -13,6 +13,59 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <mlt++/Mlt.h>
 
 #include <QPixmap>
+#include <vector>
+
+#ifdef KDENLIVE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+// Index of the source pixel sampled for each destination pixel, at the center of the destination pixel
+void nearestIndexes(int sourceSize, int destinationSize, std::vector<int> &indexes)
+{
+    indexes.resize(size_t(destinationSize));
+    for (int i = 0; i < destinationSize; ++i) {
+        indexes[size_t(i)] = int((qint64(2 * i + 1) * sourceSize) / (2 * destinationSize));
+    }
+}
+
+void convertRowScalar(const uchar *source, const int *columns, int width, QRgb *destination)
+{
+    for (int x = 0; x < width; ++x) {
+        const uchar *p = source + 4 * (columns ? columns[x] : x);
+        destination[x] = qRgba(p[0], p[1], p[2], p[3]);
+    }
+}
+
+#ifdef KDENLIVE_SIMD_SSE2
+// On little endian, rgba bytes read as a 32 bit value are 0xAABBGGRR, ARGB32 is 0xAARRGGBB: swap the R and B bytes
+inline __m128i swapRedBlue(__m128i px)
+{
+    const __m128i alphaGreen = _mm_set1_epi32(int(0xff00ff00));
+    const __m128i redBlue = _mm_andnot_si128(alphaGreen, px);
+    return _mm_or_si128(_mm_and_si128(px, alphaGreen), _mm_or_si128(_mm_slli_epi32(redBlue, 16), _mm_srli_epi32(redBlue, 16)));
+}
+
+void convertRowSSE2(const uchar *source, const int *columns, int width, QRgb *destination)
+{
+    int x = 0;
+    if (columns == nullptr) {
+        for (; x + 4 <= width; x += 4) {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + 4 * x));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x), swapRedBlue(px));
+        }
+    } else {
+        const auto *pixels = reinterpret_cast<const quint32 *>(source);
+        for (; x + 4 <= width; x += 4) {
+            const __m128i px = _mm_setr_epi32(int(pixels[columns[x]]), int(pixels[columns[x + 1]]), int(pixels[columns[x + 2]]), int(pixels[columns[x + 3]]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + x), swapRedBlue(px));
+        }
+    }
+    convertRowScalar(columns ? source : source + 4 * x, columns ? columns + x : nullptr, width - x, destination + x);
+}
+#endif
+} // namespace
+
 // static
 QPixmap KThumb::getImage(const QUrl &url, int width, int height)
 {
@@ -109,15 +162,64 @@ QImage KThumb::getFrame(Mlt::Frame *frame, int width, int height, int scaledWidt
     int oh = height;
     mlt_image_format format = mlt_image_rgba;
     const uchar *imagedata = frame->get_image(format, ow, oh);
-    if (imagedata) {
-        QImage temp(ow, oh, QImage::Format_ARGB32);
-        memcpy(temp.scanLine(0), imagedata, unsigned(ow * oh * 4));
-        if (scaledWidth == 0 || scaledWidth == width) {
-            return temp.rgbSwapped();
+    if (imagedata == nullptr || ow <= 0 || oh <= 0) {
+        return QImage();
+    }
+    QImage result;
+    if (scaledWidth == 0 || scaledWidth == width) {
+        result = QImage(ow, oh, QImage::Format_ARGB32);
+    } else {
+        result = QImage(scaledWidth, height == 0 ? oh : height, QImage::Format_ARGB32);
+    }
+    if (result.isNull()) {
+        return result;
+    }
+    convertRgba(imagedata, ow, oh, result);
+    return result;
+}
+
+KThumb::Kernel KThumb::bestKernel()
+{
+    return SimdKernels::bestKernel(Kernel::SSE2);
+}
+
+void KThumb::convertRgba(Kernel kernel, const uchar *rgba, int width, int height, QImage &destination)
+{
+    Q_ASSERT(isSupported(kernel));
+    Q_ASSERT(destination.format() == QImage::Format_ARGB32);
+    const int destinationWidth = destination.width();
+    const int destinationHeight = destination.height();
+    if (width <= 0 || height <= 0 || destinationWidth <= 0 || destinationHeight <= 0) {
+        return;
+    }
+    // Columns are only looked up when scaling horizontally
+    std::vector<int> columns;
+    if (destinationWidth != width) {
+        nearestIndexes(width, destinationWidth, columns);
+    }
+    std::vector<int> rows;
+    nearestIndexes(height, destinationHeight, rows);
+    const int *columnIndexes = columns.empty() ? nullptr : columns.data();
+    const auto sourceStride = size_t(width) * 4;
+    for (int y = 0; y < destinationHeight; ++y) {
+        const uchar *source = rgba + size_t(rows[size_t(y)]) * sourceStride;
+        auto *line = reinterpret_cast<QRgb *>(destination.scanLine(y));
+        switch (kernel) {
+#ifdef KDENLIVE_SIMD_SSE2
+        case Kernel::SSE2:
+            convertRowSSE2(source, columnIndexes, destinationWidth, line);
+            break;
+#endif
+        default:
+            convertRowScalar(source, columnIndexes, destinationWidth, line);
+            break;
         }
-        return temp.rgbSwapped().scaled(scaledWidth, height == 0 ? oh : height);
     }
-    return QImage();
+}
+
+void KThumb::convertRgba(const uchar *rgba, int width, int height, QImage &destination)
+{
+    convertRgba(bestKernel(), rgba, width, height, destination);
 }
 
 // static
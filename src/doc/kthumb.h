@@ -7,6 +7,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #pragma once
 
+#include "utils/simdkernels.h"
+
 #include <QImage>
 #include <QMap>
 #include <QUrl>
@@ -22,7 +24,25 @@ QPixmap getImage(const QUrl &url, int frame, int width, int height = -1, QMap<QS
 QPixmap getImageWithParams(const QUrl &url, QMap<QString, QString> params, int width, int height = -1);
 QImage getFrame(Mlt::Producer *producer, int framepos, int width, int height, int displayWidth = 0);
 QImage getFrame(Mlt::Producer &producer, int framepos, int width, int height, int displayWidth = 0);
+/** @brief Returns the frame image as ARGB32, scaled to scaledWidth if it is set and differs from width.
+ *  The MLT image is converted and scaled in a single pass, without intermediate copies.
+ */
 QImage getFrame(Mlt::Frame *frame, int width = 0, int height = 0, int scaledWidth = 0);
+
+/** @brief Pixel conversion kernels used by getFrame(), an SSE2 kernel is implemented */
+using SimdKernels::isSupported;
+using SimdKernels::Kernel;
+using SimdKernels::kernelName;
+/** @brief Returns the fastest supported kernel */
+Kernel bestKernel();
+/** @brief Converts an image in MLT's rgba format to the ARGB32 destination, scaling it to the size of destination
+ *  with nearest neighbour sampling.
+ *  @param rgba tightly packed pixels of the source image
+ *  @param destination an ARGB32 image allocated by the caller
+ */
+void convertRgba(Kernel kernel, const uchar *rgba, int width, int height, QImage &destination);
+/** @brief Same as above, with the best kernel */
+void convertRgba(const uchar *rgba, int width, int height, QImage &destination);
 /** @brief Calculates image variance, useful to know if a thumbnail is interesting.
  *  @return an integer between 0 and 100. 0 means no variance, eg. black image while bigger values mean contrasted image
  * */
@@ -56,13 +56,8 @@ Mlt::Properties *EffectsRepository::getMetadata(const QString &effectId) const
     return pCore->getMltRepository()->metadata(mlt_service_filter_type, effectId.toLatin1().data());
 }
 
-void EffectsRepository::parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
+void EffectsRepository::parseCustomAssetDocument(QDomDocument &doc, const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
 {
-    QDomDocument doc;
-    if (!Xml::docContentFromFile(doc, file_name, false)) {
-        return;
-    }
-
     QDomElement base = doc.documentElement();
     if (base.tagName() == QLatin1String("effectgroup")) {
         QDomNodeList effects = base.elementsByTagName(QStringLiteral("effect"));
@@ -196,6 +191,11 @@ std::unique_ptr<EffectsRepository> &EffectsRepository::get()
     return instance;
 }
 
+QString EffectsRepository::cacheName() const
+{
+    return QStringLiteral("effects");
+}
+
 QStringList EffectsRepository::assetDirs() const
 {
     QStringList dirs = QStandardPaths::locateAll(QStandardPaths::AppDataLocation, QStringLiteral("effect-templates"), QStandardPaths::LocateDirectory);
@@ -11,6 +11,7 @@
 #include "bin/projectitemmodel.h"
 #include "core.h"
 #include "kdenlivesettings.h"
+#include "taskstatistics.h"
 
 #ifdef Q_OS_UNIX
 // on Unix systems we can use setpriority() to make proxy-rendering tasks lower
@@ -96,6 +97,16 @@ bool AbstractTask::operator==(const AbstractTask &b)
     return m_owner == b.ownerId();
 }
 
+void AbstractTask::addBytesRead(qint64 bytes)
+{
+    m_bytesRead.fetchAndAddRelaxed(bytes);
+}
+
+void AbstractTask::addFramesDecoded(qint64 frames)
+{
+    m_framesDecoded.fetchAndAddRelaxed(frames);
+}
+
 void AbstractTask::run()
 {
     qDebug() << "============0\n\nABSTRACT TASKSTARTRING\n\n==================";
@@ -128,6 +139,13 @@ void AbstractTask::setPreferredPriority(qint64 pid)
 #endif
 }
 
+AbstractTaskDone::AbstractTaskDone(int cid, AbstractTask *task)
+    : m_cid(cid)
+    , m_task(task)
+{
+    m_task->m_startTime = TaskStatistics::timestamp();
+}
+
 AbstractTaskDone::~AbstractTaskDone() {
     pCore->taskManager.taskDone(m_cid, m_task);
 }
@@ -18,6 +18,7 @@ class AbstractTask : public QObject, public QRunnable
 {
     Q_OBJECT
     friend class TaskManager;
+    friend class AbstractTaskDone;
 
 public:
     enum JOBTYPE {
@@ -57,11 +58,22 @@ protected:
     QUuid m_uuid;
     void run() override;
     void cleanup();
+    /** @brief Report the bytes read from media files, for the job statistics */
+    void addBytesRead(qint64 bytes);
+    /** @brief Report the frames decoded, for the job statistics */
+    void addFramesDecoded(qint64 frames);
 
 private:
     //QString cacheKey();
     JOBTYPE m_type;
     int m_priority;
+    /** @brief Submission order, pending tasks with the same priority are started in this order */
+    quint64 m_queueOrder{0};
+    /** @brief When the task was submitted and started, see TaskStatistics::timestamp() */
+    qint64 m_enqueueTime{0};
+    qint64 m_startTime{0};
+    QAtomicInteger<qint64> m_bytesRead{0};
+    QAtomicInteger<qint64> m_framesDecoded{0};
     bool cancelJob(bool softDelete = false);
     bool isCanceled() const;
 
@@ -70,13 +82,11 @@ Q_SIGNALS:
 };
 
 /**
- * @brief When destroyed, notifies the taskManager that this task is done.
+ * @brief Records the start time of a task. When destroyed, notifies the taskManager that this task is done.
  */
 class AbstractTaskDone {
 public:
-    AbstractTaskDone(int cid, AbstractTask *task)
-        : m_cid(cid)
-        , m_task(task) {}
+    AbstractTaskDone(int cid, AbstractTask *task);
     ~AbstractTaskDone();
 private:
     int m_cid;
@@ -0,0 +1,329 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "audiolevelscache.h"
+#include "definitions.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+constexpr char cacheMagic[4] = {'K', 'D', 'A', 'L'};
+constexpr quint32 cacheVersion = 1;
+// magic, version, channels, points per frame, frame count, level count, reserved
+constexpr qint64 headerSize = 4 + 4 + 4 + 4 + 8 + 4 + 4;
+// decimation, values per point, offset, point count
+constexpr qint64 levelEntrySize = 4 + 4 + 8 + 8;
+// Don't decimate below this number of points
+constexpr qint64 minPyramidPoints = 2 * AudioLevelsCache::pyramidFactor;
+constexpr int maxLevels = 6;
+
+QMutex openedMutex;
+// Weak references, a cache is unmapped and forgotten when its last user drops it
+std::unordered_map<QString, std::weak_ptr<AudioLevelsCache>> openedCaches;
+} // namespace
+
+AudioLevelsCache::AudioLevelsCache(const QString &path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const qint64 size = m_file.size();
+    if (size >= headerSize) {
+        m_map = m_file.map(0, size);
+    }
+    // The mapping stays valid after the file is closed
+    m_file.close();
+    if (m_map == nullptr) {
+        return;
+    }
+    m_mapSize = size;
+    if (memcmp(m_map, cacheMagic, 4) != 0 || qFromLittleEndian<quint32>(m_map + 4) != cacheVersion ||
+        qFromLittleEndian<quint32>(m_map + 12) != quint32(AUDIOLEVELS_POINTS_PER_FRAME)) {
+        return;
+    }
+    m_channels = int(qFromLittleEndian<quint32>(m_map + 8));
+    const quint32 levelCount = qFromLittleEndian<quint32>(m_map + 24);
+    if (m_channels <= 0 || levelCount == 0 || headerSize + levelCount * levelEntrySize > size) {
+        m_channels = 0;
+        return;
+    }
+    for (quint32 i = 0; i < levelCount; ++i) {
+        const uchar *entry = m_map + headerSize + i * levelEntrySize;
+        Level level{int(qFromLittleEndian<quint32>(entry)), int(qFromLittleEndian<quint32>(entry + 4)), qint64(qFromLittleEndian<quint64>(entry + 8)),
+                    qint64(qFromLittleEndian<quint64>(entry + 16))};
+        if (level.decimation <= 0 || level.valuesPerPoint <= 0 || level.offset + level.points * m_channels * level.valuesPerPoint * qint64(sizeof(int16_t)) > size) {
+            m_levels.clear();
+            m_channels = 0;
+            return;
+        }
+        m_levels.push_back(level);
+    }
+}
+
+AudioLevelsCache::~AudioLevelsCache()
+{
+    unmap();
+}
+
+void AudioLevelsCache::unmap()
+{
+    QWriteLocker lock(&m_mapLock);
+    if (m_map != nullptr) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+}
+
+bool AudioLevelsCache::isValid() const
+{
+    return m_channels > 0 && !m_levels.empty();
+}
+
+// static
+std::shared_ptr<const AudioLevelsCache> AudioLevelsCache::open(const QString &path)
+{
+    QMutexLocker lock(&openedMutex);
+    auto it = openedCaches.find(path);
+    if (it != openedCaches.end()) {
+        if (auto cache = it->second.lock()) {
+            return cache;
+        }
+    }
+    std::unique_ptr<AudioLevelsCache> opened(new AudioLevelsCache(path));
+    if (!opened->isValid()) {
+        return nullptr;
+    }
+    // Forget the cache with its last user, unless the path was opened again since
+    std::shared_ptr<AudioLevelsCache> cache(opened.release(), [path](AudioLevelsCache *released) {
+        {
+            QMutexLocker deleterLock(&openedMutex);
+            auto it = openedCaches.find(path);
+            if (it != openedCaches.end() && it->second.expired()) {
+                openedCaches.erase(it);
+            }
+        }
+        delete released;
+    });
+    openedCaches[path] = cache;
+    return cache;
+}
+
+// static
+void AudioLevelsCache::release(const QString &path)
+{
+    std::shared_ptr<AudioLevelsCache> cache;
+    {
+        QMutexLocker lock(&openedMutex);
+        auto it = openedCaches.find(path);
+        if (it == openedCaches.end()) {
+            return;
+        }
+        cache = it->second.lock();
+        openedCaches.erase(it);
+    }
+    // Other users may still hold the cache, but the file must not stay mapped: it cannot be replaced on Windows
+    if (cache) {
+        cache->unmap();
+    }
+}
+
+// static
+void AudioLevelsCache::releaseFolder(const QString &folder)
+{
+    const QString prefix = QDir(folder).absolutePath() + QLatin1Char('/');
+    std::vector<std::shared_ptr<AudioLevelsCache>> caches;
+    {
+        QMutexLocker lock(&openedMutex);
+        for (auto it = openedCaches.begin(); it != openedCaches.end();) {
+            if (QFileInfo(it->first).absoluteFilePath().startsWith(prefix)) {
+                if (auto cache = it->second.lock()) {
+                    caches.push_back(std::move(cache));
+                }
+                it = openedCaches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    // Unmap outside of the lock, dropping the last reference to a cache takes it
+    for (const auto &cache : caches) {
+        cache->unmap();
+    }
+}
+
+// static
+bool AudioLevelsCache::isCacheFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return file.read(4) == QByteArray(cacheMagic, 4);
+}
+
+// static
+bool AudioLevelsCache::write(const QString &path, const QVector<int16_t> &levels, int channels)
+{
+    if (channels <= 0 || levels.isEmpty() || levels.size() % channels != 0) {
+        return false;
+    }
+    // Build the pyramid, level 0 is stored as is
+    std::vector<Level> table;
+    std::vector<QVector<int16_t>> data;
+    table.push_back({1, 1, 0, levels.size() / channels});
+    data.push_back(levels);
+    while (int(table.size()) < maxLevels && table.back().points >= minPyramidPoints) {
+        const Level &previous = table.back();
+        const QVector<int16_t> &previousData = data.back();
+        const qint64 points = (previous.points + pyramidFactor - 1) / pyramidFactor;
+        QVector<int16_t> minMax(points * channels * 2);
+        for (qint64 p = 0; p < points; ++p) {
+            const qint64 first = p * pyramidFactor;
+            const qint64 last = std::min(first + pyramidFactor, previous.points);
+            for (int ch = 0; ch < channels; ++ch) {
+                int16_t minValue = std::numeric_limits<int16_t>::max();
+                int16_t maxValue = std::numeric_limits<int16_t>::min();
+                for (qint64 i = first; i < last; ++i) {
+                    const qint64 ix = (i * channels + ch) * previous.valuesPerPoint;
+                    minValue = std::min(minValue, previousData.at(ix));
+                    maxValue = std::max(maxValue, previousData.at(ix + previous.valuesPerPoint - 1));
+                }
+                minMax[(p * channels + ch) * 2] = minValue;
+                minMax[(p * channels + ch) * 2 + 1] = maxValue;
+            }
+        }
+        table.push_back({previous.decimation * pyramidFactor, 2, 0, points});
+        data.push_back(std::move(minMax));
+    }
+    qint64 offset = headerSize + qint64(table.size()) * levelEntrySize;
+    for (auto &level : table) {
+        level.offset = offset;
+        offset += level.points * channels * level.valuesPerPoint * qint64(sizeof(int16_t));
+    }
+
+    QByteArray header(headerSize + qint64(table.size()) * levelEntrySize, '\0');
+    char *h = header.data();
+    memcpy(h, cacheMagic, 4);
+    qToLittleEndian<quint32>(cacheVersion, h + 4);
+    qToLittleEndian<quint32>(quint32(channels), h + 8);
+    qToLittleEndian<quint32>(quint32(AUDIOLEVELS_POINTS_PER_FRAME), h + 12);
+    qToLittleEndian<quint64>(quint64(table.front().points / AUDIOLEVELS_POINTS_PER_FRAME), h + 16);
+    qToLittleEndian<quint32>(quint32(table.size()), h + 24);
+    for (size_t i = 0; i < table.size(); ++i) {
+        char *entry = h + headerSize + qint64(i) * levelEntrySize;
+        qToLittleEndian<quint32>(quint32(table[i].decimation), entry);
+        qToLittleEndian<quint32>(quint32(table[i].valuesPerPoint), entry + 4);
+        qToLittleEndian<quint64>(quint64(table[i].offset), entry + 8);
+        qToLittleEndian<quint64>(quint64(table[i].points), entry + 16);
+    }
+
+    // The file might currently be mapped, it cannot be replaced then
+    release(path);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot write audio levels cache" << path;
+        return false;
+    }
+    file.write(header);
+    for (const auto &levelData : data) {
+        QByteArray bytes(levelData.size() * qsizetype(sizeof(int16_t)), Qt::Uninitialized);
+        qToLittleEndian<int16_t>(levelData.constData(), levelData.size(), bytes.data());
+        file.write(bytes);
+    }
+    return file.commit();
+}
+
+int AudioLevelsCache::channels() const
+{
+    return m_channels;
+}
+
+int AudioLevelsCache::levelCount() const
+{
+    return int(m_levels.size());
+}
+
+int AudioLevelsCache::decimation(int level) const
+{
+    return m_levels.at(size_t(level)).decimation;
+}
+
+qint64 AudioLevelsCache::pointCount(int level) const
+{
+    return m_levels.at(size_t(level)).points;
+}
+
+int AudioLevelsCache::levelForPointsPerPixel(double pointsPerPixel) const
+{
+    int result = 0;
+    for (int i = 1; i < levelCount(); ++i) {
+        if (m_levels.at(size_t(i)).decimation <= pointsPerPixel) {
+            result = i;
+        }
+    }
+    return result;
+}
+
+QVector<int16_t> AudioLevelsCache::read(int level, qint64 firstPoint, qint64 count) const
+{
+    const Level &l = m_levels.at(size_t(level));
+    firstPoint = qBound(qint64(0), firstPoint, l.points);
+    count = qBound(qint64(0), count, l.points - firstPoint);
+    const qint64 values = count * m_channels * l.valuesPerPoint;
+    QReadLocker lock(&m_mapLock);
+    if (m_map == nullptr) {
+        // The file was released
+        return {};
+    }
+    QVector<int16_t> result(values);
+    if (values > 0) {
+        qFromLittleEndian<int16_t>(m_map + l.offset + firstPoint * m_channels * l.valuesPerPoint * qint64(sizeof(int16_t)), values, result.data());
+    }
+    return result;
+}
+
+QVector<int16_t> AudioLevelsCache::peaks() const
+{
+    return read(0, 0, pointCount(0));
+}
+
+QVector<int16_t> AudioLevelsCache::maxLevels(int level, qint64 firstPoint, qint64 count) const
+{
+    QVector<int16_t> values = read(level, firstPoint, count);
+    if (m_levels.at(size_t(level)).valuesPerPoint == 1) {
+        return values;
+    }
+    // Keep the max of each (min, max) pair
+    const qsizetype size = values.size() / 2;
+    for (qsizetype i = 0; i < size; ++i) {
+        values[i] = values.at(i * 2 + 1);
+    }
+    values.resize(size);
+    return values;
+}
+
+QVector<int16_t> AudioLevelsCache::minMaxLevels(int level, qint64 firstPoint, qint64 count) const
+{
+    QVector<int16_t> values = read(level, firstPoint, count);
+    if (m_levels.at(size_t(level)).valuesPerPoint == 2) {
+        return values;
+    }
+    // Full resolution peaks, min and max are the same
+    QVector<int16_t> pairs(values.size() * 2);
+    for (qsizetype i = 0; i < values.size(); ++i) {
+        pairs[i * 2] = pairs[i * 2 + 1] = values.at(i);
+    }
+    return pairs;
+}
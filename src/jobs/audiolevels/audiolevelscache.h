@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+#include <QFile>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+#include <memory>
+
+/**
+ * @class AudioLevelsCache
+ * @brief Memory mapped cache file holding the audio levels of a stream, with a multi-resolution pyramid.
+ *
+ * Level 0 holds the peaks at full resolution (AUDIOLEVELS_POINTS_PER_FRAME points per frame, interleaved channels).
+ * Each following level is decimated by pyramidFactor and holds a (min, max) pair of the previous level's values
+ * for each point and channel. A zoomed out timeline can then read a coarse level without touching the full data.
+ *
+ * File layout (little endian): a header (magic, version, channels, points per frame, frame count, level count),
+ * a table of levels (decimation, values per point, offset, point count), then the int16 data of each level.
+ * Opened files are shared between users, they only need to be paged in when a level is read, and are unmapped with their last user.
+ * A file is unmapped by release() before it is deleted or rewritten, users still holding it then read empty values.
+ */
+class AudioLevelsCache
+{
+public:
+    /** @brief Each pyramid level has this many times fewer points than the previous one */
+    static constexpr int pyramidFactor = 8;
+
+    ~AudioLevelsCache();
+
+    /** @brief Returns the cache stored in this file, shared with other users of the same path.
+     *  @return nullptr if the file does not exist or is not in the expected format
+     */
+    static std::shared_ptr<const AudioLevelsCache> open(const QString &path);
+    /** @brief Unmap a file, must be called before the file is deleted or rewritten */
+    static void release(const QString &path);
+    /** @brief Unmap all the opened files of a folder and its subfolders, must be called before the folder is deleted */
+    static void releaseFolder(const QString &folder);
+    /** @brief Write levels and their decimated pyramid to a cache file, the file is released first */
+    static bool write(const QString &path, const QVector<int16_t> &levels, int channels);
+    /** @brief Returns true if the file starts with the header of this format */
+    static bool isCacheFile(const QString &path);
+
+    int channels() const;
+    int levelCount() const;
+    /** @brief The number of level 0 points represented by one point of this level */
+    int decimation(int level) const;
+    /** @brief The number of points (per channel) in this level */
+    qint64 pointCount(int level) const;
+    /** @brief The coarsest level with at least one point per pixel when displaying pointsPerPixel level 0 points per pixel */
+    int levelForPointsPerPixel(double pointsPerPixel) const;
+
+    /** @brief A copy of the full resolution peaks, interleaved channels */
+    QVector<int16_t> peaks() const;
+    /** @brief The max values of a range of points of a level, interleaved channels */
+    QVector<int16_t> maxLevels(int level, qint64 firstPoint, qint64 count) const;
+    /** @brief The (min, max) values of a range of points of a level, as min/max pairs of interleaved channels */
+    QVector<int16_t> minMaxLevels(int level, qint64 firstPoint, qint64 count) const;
+
+private:
+    explicit AudioLevelsCache(const QString &path);
+    struct Level
+    {
+        int decimation;
+        int valuesPerPoint;
+        qint64 offset;
+        qint64 points;
+    };
+    QFile m_file;
+    /** @brief Protects m_map, which is reset when the file is released */
+    mutable QReadWriteLock m_mapLock;
+    uchar *m_map{nullptr};
+    qint64 m_mapSize{0};
+    int m_channels{0};
+    std::vector<Level> m_levels;
+    bool isValid() const;
+    void unmap();
+    /** @brief Copy values of a level converting them from little endian */
+    QVector<int16_t> read(int level, qint64 firstPoint, qint64 count) const;
+};
@@ -11,12 +11,14 @@
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
 #include "core.h"
+#include "audiolevelscache.h"
 #include "generators.h"
 
 #include <KLocalizedString>
 #include <KMessageWidget>
 #include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QList>
 #include <QMutex>
 #include <QRgb>
@@ -24,6 +26,8 @@
 #include <QVariantList>
 #include <functional>
 constexpr int UPDATE_DELAY_MS = 1000;
+// Streams longer than this are split in ranges of this duration which are decoded concurrently
+constexpr int PARALLEL_RANGE_SECONDS = 300;
 
 AudioLevelsTask::AudioLevelsTask(const ObjectId &owner, QObject *object)
     : AbstractTask(owner, AbstractTask::AUDIOTHUMBJOB, object)
@@ -52,12 +56,30 @@ void AudioLevelsTask::storeLevels(const std::shared_ptr<ProjectClip> &binClip, c
     auto *levelsCopy = new QVector<int16_t>(levels);
     producer->set(QStringLiteral("_kdenlive:audio%1").arg(stream).toUtf8().constData(), levelsCopy, 0,
                   [](void *ptr) { delete static_cast<QVector<int16_t> *>(ptr); });
+    // The levels are being regenerated, a previous cache file is outdated
+    producer->clear(QStringLiteral("_kdenlive:audiocache%1").arg(stream).toUtf8().constData());
+
+    producer->unlock();
+}
+
+void AudioLevelsTask::storeCache(const std::shared_ptr<ProjectClip> &binClip, const int stream, const std::shared_ptr<const AudioLevelsCache> &cache)
+{
+    const auto producer = binClip->originalProducer();
+    producer->lock();
+
+    auto *cacheCopy = new std::shared_ptr<const AudioLevelsCache>(cache);
+    producer->set(QStringLiteral("_kdenlive:audiocache%1").arg(stream).toUtf8().constData(), cacheCopy, 0,
+                  [](void *ptr) { delete static_cast<std::shared_ptr<const AudioLevelsCache> *>(ptr); });
+    producer->clear(QStringLiteral("_kdenlive:audio%1").arg(stream).toUtf8().constData());
 
     producer->unlock();
 }
 
 void AudioLevelsTask::storeMax(const std::shared_ptr<ProjectClip> &binClip, const int stream, const QVector<int16_t> &levels)
 {
+    if (levels.isEmpty()) {
+        return;
+    }
     const auto max = *std::max_element(levels.constBegin(), levels.constEnd());
 
     const auto producer = binClip->originalProducer();
@@ -66,9 +88,14 @@ void AudioLevelsTask::storeMax(const std::shared_ptr<ProjectClip> &binClip, cons
     producer->unlock();
 }
 
-QVector<int16_t> AudioLevelsTask::getLevelsFromCache(const QString &cachePath)
+std::shared_ptr<const AudioLevelsCache> AudioLevelsTask::getLevelsFromCache(const QString &cachePath, int channels)
 {
     qDebug() << "Loading audio levels from cache" << cachePath;
+    if (AudioLevelsCache::isCacheFile(cachePath)) {
+        // nullptr for a broken file, the levels are then generated again
+        return AudioLevelsCache::open(cachePath);
+    }
+    // Cache written by an older version, as a serialized QVector
     QFile file(cachePath);
     QVector<int16_t> levels;
     if (file.open(QIODevice::ReadOnly)) {
@@ -76,17 +103,19 @@ QVector<int16_t> AudioLevelsTask::getLevelsFromCache(const QString &cachePath)
         in >> levels;
         file.close();
     }
-    return levels;
+    if (levels.isEmpty() || channels <= 0) {
+        return nullptr;
+    }
+    // Convert to the current format
+    saveLevelsToCache(cachePath, levels, channels);
+    return AudioLevelsCache::open(cachePath);
 }
 
-void AudioLevelsTask::saveLevelsToCache(const QString &cachePath, const QVector<int16_t> &levels)
+void AudioLevelsTask::saveLevelsToCache(const QString &cachePath, const QVector<int16_t> &levels, int channels)
 {
     qDebug() << "Saving audio levels to cache" << cachePath;
-    QFile file(cachePath);
-    if (file.open(QIODevice::WriteOnly)) {
-        QDataStream out(&file);
-        out << levels;
-        file.close();
+    if (!AudioLevelsCache::write(cachePath, levels, channels)) {
+        qWarning() << "Failed to save audio levels to cache" << cachePath;
     }
 }
 
@@ -160,32 +189,57 @@ void AudioLevelsTask::run()
         };
 
         const QString cachePath = binClip->getAudioThumbPath(streamIdx.key());
+        const int channels = binClip->audioInfo()->channelsForStream(streamIdx.key());
         QVector<int16_t> levels;
-        bool skipSaving = false;
+        std::shared_ptr<const AudioLevelsCache> cache;
         if (!m_isCanceled && !m_isForce && QFile::exists(cachePath)) {
             // load from cache
-            levels = getLevelsFromCache(cachePath);
-            skipSaving = true;
+            cache = getLevelsFromCache(cachePath, channels);
+            if (cache && cache->channels() != channels) {
+                cache.reset();
+            }
+            if (cache) {
+                addBytesRead(QFileInfo(cachePath).size());
+            }
         }
 
-        if (!m_isCanceled && levels.empty() && service == QStringLiteral("avformat")) {
+        if (!m_isCanceled && !cache && service == QStringLiteral("avformat")) {
             // if the resource is a media file, we can use libav for speed
             const auto fps = producer->get_fps();
-            levels = generateLibav(streamIdx.key(), res, lengthInFrames, fps, clbk, m_isCanceled);
+            const size_t rangeCount = size_t(lengthInFrames / (fps * PARALLEL_RANGE_SECONDS)) + 1;
+            if (rangeCount > 1 && pCore->taskManager.maxConcurrency() > 1) {
+                // long file, decode several ranges concurrently
+                levels = generateLibavParallel(streamIdx.key(), res, lengthInFrames, fps, rangeCount, clbk, m_isCanceled);
+            }
+            if (!m_isCanceled && levels.empty()) {
+                levels = generateLibav(streamIdx.key(), res, lengthInFrames, fps, clbk, m_isCanceled);
+            }
         }
 
-        if (!m_isCanceled && levels.empty()) {
+        if (!m_isCanceled && !cache && levels.empty()) {
             // else, or if using libav failed, use MLT
-            const int channels = binClip->audioInfo()->channelsForStream(streamIdx.key());
             levels = generateMLT(streamIdx.key(), service, res, channels, clbk, m_isCanceled);
         }
 
-        if (!m_isCanceled && !levels.empty()) {
+        if (!m_isCanceled && !cache && !levels.empty()) {
+            saveLevelsToCache(cachePath, levels, channels);
+            // The stream was decoded from the media file
+            addBytesRead(QFileInfo(res).size());
+            addFramesDecoded(lengthInFrames);
+            cache = AudioLevelsCache::open(cachePath);
+        }
+
+        if (!m_isCanceled && cache) {
+            // Keep the mapped file rather than a copy of the levels
+            storeCache(binClip, streamIdx.key(), cache);
+            const int top = cache->levelCount() - 1;
+            storeMax(binClip, streamIdx.key(), cache->maxLevels(top, 0, cache->pointCount(top)));
+            m_progress = 100;
+            QMetaObject::invokeMethod(m_object, "updateJobProgress");
+        } else if (!m_isCanceled && !levels.empty()) {
+            // The cache file could not be written
             storeLevels(binClip, streamIdx.key(), levels);
             storeMax(binClip, streamIdx.key(), levels);
-            if (!skipSaving) {
-                saveLevelsToCache(cachePath, levels);
-            }
             m_progress = 100;
             QMetaObject::invokeMethod(m_object, "updateJobProgress");
         }
@@ -16,19 +16,27 @@
 #include <QRunnable>
 #include <bin/projectclip.h>
 
+class AudioLevelsCache;
+
 class AudioLevelsTask : public AbstractTask
 {
 public:
     AudioLevelsTask(const ObjectId &owner, QObject *object);
     static void start(const ObjectId &owner, QObject *object, bool force = false);
-    static QVector<int16_t> getLevelsFromCache(const QString &cachePath);
-    static void saveLevelsToCache(const QString &cachePath, const QVector<int16_t> &levels);
+    /** @brief Open the mapped levels of a cache file, converting caches written by older versions when channels is known
+     *  @return nullptr if the file cannot be used
+     */
+    static std::shared_ptr<const AudioLevelsCache> getLevelsFromCache(const QString &cachePath, int channels = 0);
+    /** @brief Write levels and their decimated pyramid to a cache file, see AudioLevelsCache */
+    static void saveLevelsToCache(const QString &cachePath, const QVector<int16_t> &levels, int channels);
 
 protected:
     void run() override;
 
 private:
     static void storeLevels(const std::shared_ptr<ProjectClip> &binClip, int stream, const QVector<int16_t> &levels);
+    /** @brief Replace the levels stored on the clip by the cache file, which is only paged in when displayed */
+    static void storeCache(const std::shared_ptr<ProjectClip> &binClip, int stream, const std::shared_ptr<const AudioLevelsCache> &cache);
     static void storeMax(const std::shared_ptr<ProjectClip> &binClip, int stream, const QVector<int16_t> &levels);
     void progressCallback(const std::shared_ptr<ProjectClip> &binClip, const QVector<int16_t> &levels, int streamIdx, int progress);
     QElapsedTimer m_timer;
@@ -7,12 +7,16 @@
 #include "generators.h"
 
 #include "audiolevelstask.h"
+#include "peaks.h"
 #include "core.h"
 #include "definitions.h"
+#include "jobs/taskmanager.h"
 #include <KLocalizedString>
 #include <KMessageWidget>
 #include <QDebug>
+#include <QMutex>
 #include <QVector>
+#include <QWaitCondition>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -37,34 +41,7 @@ av_always_inline QString av_err2string(int errnum)
 
 void computePeaks(const int16_t *in, int16_t *out, const size_t nChannels, const size_t nSamplesIn, const size_t nSamplesOut)
 {
-    Q_ASSERT(in != nullptr);
-    Q_ASSERT(out != nullptr);
-    Q_ASSERT(nSamplesOut > 0);
-    Q_ASSERT(nSamplesIn > 0);
-    Q_ASSERT(nChannels > 0);
-
-    const float scale = static_cast<float>(nSamplesIn) / nSamplesOut;
-
-    for (size_t ch = 0; ch < nChannels; ++ch) {
-        const auto *pIn = in + ch; // Pointer to the start of the current channel in the input
-        auto *pOut = out + ch;     // Pointer to the start of the current channel in the output
-
-        for (size_t outIdx = 0; outIdx < nSamplesOut; ++outIdx) {
-            // [start, end] is a sliding window over the input samples
-            const size_t start = outIdx * scale;
-            size_t end = (outIdx + 1) * scale;
-            if (end > nSamplesIn) end = nSamplesIn;
-
-            Q_ASSERT(start < nSamplesIn);
-            Q_ASSERT(outIdx < nSamplesOut);
-
-            int16_t maxValue = std::abs(pIn[start * nChannels]);
-            for (size_t inIdx = start; inIdx < end; ++inIdx) {
-                maxValue = std::max(maxValue, static_cast<int16_t>(std::abs(pIn[inIdx * nChannels])));
-            }
-            pOut[outIdx * nChannels] = maxValue;
-        }
-    }
+    AudioPeaks::computePeaks(AudioPeaks::bestKernel(), in, out, nChannels, nSamplesIn, nSamplesOut);
 }
 
 QVector<int16_t> generateMLT(const size_t streamIdx, const QString &service, const QString &resource, int channels,
@@ -127,9 +104,24 @@ QVector<int16_t> generateLibav(const size_t streamIdx, const QString &uri, const
     qDebug() << "Generating audio levels for stream" << streamIdx << "of" << uri << "using libav";
     QElapsedTimer timer;
     timer.start();
+    const auto levels = generateLibavRange(streamIdx, uri, MLTlengthInFrames, MLTfps, 0, MLTlengthInFrames, progressCallback, isCanceled);
+    qDebug() << "Audio levels generation took" << timer.elapsed() / 1000.0 << "s (" << MLTlengthInFrames / (timer.elapsed() / 1000.0) << "frames/s)";
+    return levels;
+}
 
+QVector<int16_t> generateLibavRange(const size_t streamIdx, const QString &uri, const size_t MLTlengthInFrames, const double MLTfps, const size_t firstFrame,
+                                    const size_t frameCount, const std::function<void(int progress, const QVector<int16_t> &levels)> &progressCallback,
+                                    const QAtomicInt &isCanceled)
+{
     int ret = 0;
-    size_t MLTFrameCount = 0;
+    size_t MLTFrameCount = firstFrame;
+    // The last range keeps checking that the file does not contain more frames than expected
+    const bool lastRange = firstFrame + frameCount >= MLTlengthInFrames;
+    // When starting in the middle of the file, decoded samples are dropped until we reach this position
+    int64_t firstSample = 0;
+    // Position of the first decoded sample, the origin of the sample positions
+    int64_t originSample = 0;
+    bool aligned = firstFrame == 0;
 
     AVFormatContext *fmt_ctx = nullptr;
     const AVCodec *codec = nullptr;
@@ -234,12 +226,40 @@ QVector<int16_t> generateLibav(const size_t streamIdx, const QString &uri, const
         goto cleanup;
     }
 
+    if (!aligned && stream->start_time != 0 && stream->start_time != AV_NOPTS_VALUE) {
+        // Streams starting before 0 (Opus pre-skip, AAC priming) have their priming samples dropped by the decoder, so the first decoded
+        // sample is not always at the start time. Sequential decoding counts from that sample: read its timestamp to use the same origin.
+        originSample = AV_NOPTS_VALUE;
+        while (originSample == AV_NOPTS_VALUE && av_read_frame(fmt_ctx, packet) >= 0) {
+            if (packet->stream_index == streamIdx && avcodec_send_packet(codec_ctx, packet) >= 0 && avcodec_receive_frame(codec_ctx, frame) >= 0 &&
+                frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                originSample = av_rescale_q(frame->best_effort_timestamp, stream->time_base, AVRational{1, dst_rate});
+            }
+            av_packet_unref(packet);
+        }
+        if (originSample == AV_NOPTS_VALUE) {
+            qWarning() << "Cannot locate the first sample of stream with start time" << stream->start_time;
+            goto cleanup;
+        }
+        avcodec_flush_buffers(codec_ctx);
+    }
+
+    if (!aligned) {
+        // Seek to the keyframe preceding the first sample of the range
+        firstSample = mlt_audio_calculate_samples_to_position(MLTfps, dst_rate, firstFrame);
+        ret = av_seek_frame(fmt_ctx, streamIdx, av_rescale_q(originSample + firstSample, AVRational{1, dst_rate}, stream->time_base), AVSEEK_FLAG_BACKWARD);
+        if (ret < 0) {
+            qWarning() << "Failed to seek to frame" << firstFrame << ":" << av_err2string(ret);
+            goto cleanup;
+        }
+    }
+
     // Allocate fifo with a bit of space (will be grown automatically)
-    samplesPerMLTFrame = mlt_audio_calculate_frame_samples(MLTfps, dst_rate, 0);
+    samplesPerMLTFrame = mlt_audio_calculate_frame_samples(MLTfps, dst_rate, MLTFrameCount);
     fifo = av_audio_fifo_alloc(dst_sample_fmt, dst_nb_channels, 2 * samplesPerMLTFrame);
 
     // Allocate levels
-    levels.resize(MLTlengthInFrames * AUDIOLEVELS_POINTS_PER_FRAME * dst_nb_channels);
+    levels.resize(frameCount * AUDIOLEVELS_POINTS_PER_FRAME * dst_nb_channels);
 
     // /!\ libav frames != MLT frames !
     // Read each packet in the stream
@@ -298,8 +318,34 @@ QVector<int16_t> generateLibav(const size_t streamIdx, const QString &uri, const
                 goto cleanup;
             }
 
-            // Write the buffer into the fifo (grows automatically if needed)
-            ret = av_audio_fifo_write(fifo, reinterpret_cast<void **>(buf), dst_nb_samples);
+            if (!aligned) {
+                // Drop the samples decoded before the start of the range
+                const int64_t pts = frame->best_effort_timestamp;
+                if (pts == AV_NOPTS_VALUE) {
+                    qWarning() << "Cannot locate decoded samples after seeking";
+                    levels.clear();
+                    goto cleanup;
+                }
+                const int64_t frameSample = av_rescale_q(pts, stream->time_base, AVRational{1, dst_rate}) - originSample;
+                if (frameSample + dst_nb_samples <= firstSample) {
+                    continue;
+                }
+                aligned = true;
+                if (frameSample > firstSample) {
+                    // The seek went past the start of the range, should not happen with AVSEEK_FLAG_BACKWARD
+                    qWarning() << "Decoding started after the requested position" << frameSample << ">" << firstSample;
+                    levels.clear();
+                    goto cleanup;
+                }
+                const int skip = int(firstSample - frameSample);
+                ret = av_audio_fifo_write(fifo, reinterpret_cast<void **>(buf), dst_nb_samples);
+                if (ret >= 0) {
+                    ret = av_audio_fifo_drain(fifo, skip);
+                }
+            } else {
+                // Write the buffer into the fifo (grows automatically if needed)
+                ret = av_audio_fifo_write(fifo, reinterpret_cast<void **>(buf), dst_nb_samples);
+            }
             if (ret < 0) {
                 qWarning() << "Failed to write samples to audio fifo:" << av_err2string(ret);
                 levels.clear();
@@ -309,16 +355,22 @@ QVector<int16_t> generateLibav(const size_t streamIdx, const QString &uri, const
             // If there is enough samples for one MLT frame in the fifo, compute the peaks and advance one MLT frame !
             while (av_audio_fifo_size(fifo) >= samplesPerMLTFrame) {
                 av_audio_fifo_read(fifo, reinterpret_cast<void **>(buf), samplesPerMLTFrame);
-                const size_t requiredSize = (MLTFrameCount + 1) * AUDIOLEVELS_POINTS_PER_FRAME * dst_nb_channels;
+                const size_t rangeFrame = MLTFrameCount - firstFrame;
+                const size_t requiredSize = (rangeFrame + 1) * AUDIOLEVELS_POINTS_PER_FRAME * dst_nb_channels;
                 if (requiredSize > levels.size()) {
                     levels.resize(requiredSize);
                 }
-                computePeaks(reinterpret_cast<const int16_t *>(buf[0]), levels.data() + MLTFrameCount * AUDIOLEVELS_POINTS_PER_FRAME * dst_nb_channels,
+                computePeaks(reinterpret_cast<const int16_t *>(buf[0]), levels.data() + rangeFrame * AUDIOLEVELS_POINTS_PER_FRAME * dst_nb_channels,
                              dst_nb_channels, samplesPerMLTFrame, AUDIOLEVELS_POINTS_PER_FRAME);
 
-                progressCallback(100.0 * MLTFrameCount / MLTlengthInFrames, levels);
+                progressCallback(100.0 * rangeFrame / frameCount, levels);
 
                 MLTFrameCount++;
+                if (!lastRange && MLTFrameCount == firstFrame + frameCount) {
+                    // Range is complete
+                    av_packet_unref(packet);
+                    goto cleanup;
+                }
                 if (MLTFrameCount > MLTlengthInFrames) {
                     qWarning() << "MLT frame" << MLTFrameCount << "of" << MLTlengthInFrames << "is beyond the MLT length !!!";
                     levels.clear();
@@ -330,6 +382,10 @@ QVector<int16_t> generateLibav(const size_t streamIdx, const QString &uri, const
 
         av_packet_unref(packet);
     }
+    if (!lastRange && MLTFrameCount < firstFrame + frameCount) {
+        // Reached the end of file before the end of the range
+        levels.clear();
+    }
 cleanup:
     if (buf) {
         av_freep(&buf[0]);
@@ -341,7 +397,123 @@ cleanup:
     avcodec_free_context(&codec_ctx);
     swr_free(&swr_ctx);
     avformat_close_input(&fmt_ctx);
+    return levels;
+}
+
+QVector<int16_t> generateLibavParallel(const size_t streamIdx, const QString &uri, const size_t MLTlengthInFrames, const double MLTfps, const size_t rangeCount,
+                                       const std::function<void(int progress, const QVector<int16_t> &levels)> &progressCallback, const QAtomicInt &isCanceled)
+{
+    Q_ASSERT(rangeCount > 0);
+    qDebug() << "Generating audio levels for stream" << streamIdx << "of" << uri << "using libav in" << rangeCount << "ranges";
+    QElapsedTimer timer;
+    timer.start();
 
+    // State shared with the helper threads, which might start after this function returned
+    struct RangesState
+    {
+        QMutex mutex;
+        QWaitCondition rangeDone;
+        QAtomicInt canceled;
+        size_t nextRange{0};
+        int running{0};
+        bool failed{false};
+        // Completed ranges waiting to be copied in the final levels, as (range index, levels)
+        std::vector<std::pair<size_t, QVector<int16_t>>> finished;
+    };
+    auto state = std::make_shared<RangesState>();
+    const size_t framesPerRange = (MLTlengthInFrames + rangeCount - 1) / rangeCount;
+    // Decode the next range, rangeCanceled stops it: the job flag in this thread, the shared one in the helpers
+    // Returns false when no range is left to decode
+    auto processRange = [state, streamIdx, uri, MLTlengthInFrames, MLTfps, rangeCount, framesPerRange](const QAtomicInt &rangeCanceled) {
+        const auto noProgress = [](int, const QVector<int16_t> &) {};
+        QMutexLocker lock(&state->mutex);
+        if (rangeCanceled) {
+            state->canceled = 1;
+        }
+        if (state->nextRange >= rangeCount || state->canceled) {
+            return false;
+        }
+        const size_t range = state->nextRange++;
+        state->running++;
+        lock.unlock();
+        const size_t firstFrame = range * framesPerRange;
+        const size_t frameCount = std::min(framesPerRange, MLTlengthInFrames - firstFrame);
+        QVector<int16_t> rangeLevels = generateLibavRange(streamIdx, uri, MLTlengthInFrames, MLTfps, firstFrame, frameCount, noProgress, rangeCanceled);
+        lock.relock();
+        state->running--;
+        if (rangeCanceled) {
+            // Stop the helpers too
+            state->canceled = 1;
+        } else if (rangeLevels.isEmpty()) {
+            // Abort all ranges, the caller will fall back to sequential decoding
+            state->failed = true;
+            state->canceled = 1;
+        } else {
+            state->finished.emplace_back(range, std::move(rangeLevels));
+        }
+        state->rangeDone.wakeAll();
+        return true;
+    };
+
+    // Decode ranges on the task pool, this thread also processes ranges so that we never wait for a helper that did not start
+    const int helpers = int(std::min<size_t>(rangeCount, size_t(pCore->taskManager.maxConcurrency()))) - 1;
+    for (int i = 0; i < helpers; ++i) {
+        if (!pCore->taskManager.startHelper([processRange, state]() {
+                while (processRange(state->canceled)) {
+                }
+            })) {
+            // No free worker, the remaining ranges are decoded by this thread and the helpers already started
+            break;
+        }
+    }
+
+    QVector<int16_t> levels;
+    size_t completedRanges = 0;
+    size_t channels = 0;
+    // Copy finished ranges at their place in the final levels, caller must hold the state mutex
+    auto collectRanges = [&]() {
+        for (auto &range : state->finished) {
+            const size_t firstFrame = range.first * framesPerRange;
+            const size_t frameCount = std::min(framesPerRange, MLTlengthInFrames - firstFrame);
+            if (channels == 0) {
+                channels = range.second.size() / (frameCount * AUDIOLEVELS_POINTS_PER_FRAME);
+                levels.resize(MLTlengthInFrames * AUDIOLEVELS_POINTS_PER_FRAME * channels);
+            }
+            const size_t offset = firstFrame * AUDIOLEVELS_POINTS_PER_FRAME * channels;
+            // The last range may contain one more frame than expected, as in sequential decoding
+            const size_t copySize = std::min(size_t(range.second.size()), size_t(levels.size()) - offset);
+            std::copy_n(range.second.constBegin(), copySize, levels.begin() + offset);
+            completedRanges++;
+        }
+        state->finished.clear();
+    };
+
+    // Decode one range at a time in this thread, so that the ranges finished meanwhile are published between them
+    while (true) {
+        const bool decoded = processRange(isCanceled);
+        QMutexLocker lock(&state->mutex);
+        if (isCanceled) {
+            state->canceled = 1;
+        }
+        if (!state->finished.empty()) {
+            collectRanges();
+            lock.unlock();
+            // Publish partial levels, ranges fill in out of order
+            progressCallback(int(100.0 * completedRanges / rangeCount), levels);
+            continue;
+        }
+        if (state->running == 0 && (state->nextRange >= rangeCount || state->canceled)) {
+            break;
+        }
+        if (!decoded) {
+            // Only the helpers are still decoding
+            state->rangeDone.wait(&state->mutex, 100);
+        }
+    }
+
+    if (state->failed || isCanceled || completedRanges < rangeCount) {
+        return {};
+    }
     qDebug() << "Audio levels generation took" << timer.elapsed() / 1000.0 << "s (" << MLTlengthInFrames / (timer.elapsed() / 1000.0) << "frames/s)";
     return levels;
 }
@@ -13,6 +13,7 @@
  *
  * This function downsamples an interleaved input buffer by selecting the maximum value
  * within a sliding window for each output sample, preserving the number of channels.
+ * All channels are processed in a single pass, using the fastest SIMD kernel available on the CPU (see AudioPeaks).
  *
  * @param in Pointer to the input buffer of size nChannels * nIn (interleaved format).
  * @param out Pointer to the output buffer of size nChannels * nOut (interleaved format).
@@ -51,4 +52,29 @@ QVector<int16_t> generateMLT(size_t streamIdx, const QString &service, const QSt
  * @return the computed audio levels
  */
 QVector<int16_t> generateLibav(size_t streamIdx, const QString &uri, size_t MLTlengthInFrames, double MLTfps,
-                               const std::function<void(int progress, const QVector<int16_t> &levels)> &progressCallback, const QAtomicInt &isCanceled);
\ No newline at end of file
+                               const std::function<void(int progress, const QVector<int16_t> &levels)> &progressCallback, const QAtomicInt &isCanceled);
+
+/** @brief Computes the audio levels of a range of MLT frames using libav.
+ *
+ * Seeks to the first frame of the range and decodes until the range is complete.
+ * Sample positions count from the first decoded sample as in sequential decoding, also for streams starting before 0.
+ *
+ * @param firstFrame first MLT frame of the range
+ * @param frameCount number of MLT frames in the range
+ * @return the computed audio levels for the range
+ * @see generateLibav() for the other parameters
+ */
+QVector<int16_t> generateLibavRange(size_t streamIdx, const QString &uri, size_t MLTlengthInFrames, double MLTfps, size_t firstFrame, size_t frameCount,
+                                    const std::function<void(int progress, const QVector<int16_t> &levels)> &progressCallback, const QAtomicInt &isCanceled);
+
+/** @brief Computes the audio levels using libav, decoding several ranges of the file concurrently.
+ *
+ * The stream is split in seekable time ranges which are decoded on the TaskManager pool and stitched in order.
+ * Partial levels are published through progressCallback as ranges complete, so they fill in out of order.
+ *
+ * @param rangeCount number of ranges to split the stream into
+ * @return the computed audio levels, or an empty vector if any range failed
+ * @see generateLibav() for the other parameters
+ */
+QVector<int16_t> generateLibavParallel(size_t streamIdx, const QString &uri, size_t MLTlengthInFrames, double MLTfps, size_t rangeCount,
+                                       const std::function<void(int progress, const QVector<int16_t> &levels)> &progressCallback, const QAtomicInt &isCanceled);
\ No newline at end of file
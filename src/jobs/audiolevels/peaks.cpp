@@ -0,0 +1,195 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "peaks.h"
+
+#include <QtGlobal>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#ifdef KDENLIVE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef KDENLIVE_SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+namespace AudioPeaks {
+
+namespace {
+
+// Largest number of vector registers used to hold one block of interleaved samples.
+// A block spans lcm(nChannels, lanes) samples so that each lane always maps to the same channel.
+constexpr size_t maxBlockRegisters = 8;
+
+inline int16_t absSaturated(int16_t value)
+{
+    if (value == std::numeric_limits<int16_t>::min()) {
+        return std::numeric_limits<int16_t>::max();
+    }
+    return static_cast<int16_t>(value < 0 ? -value : value);
+}
+
+// [start, end[ is the window of input samples for output sample outIdx.
+// When upsampling the window may be empty, it then holds the start sample.
+inline void window(size_t outIdx, float scale, size_t nSamplesIn, size_t &start, size_t &end)
+{
+    start = outIdx * scale;
+    end = (outIdx + 1) * scale;
+    end = std::max(std::min(end, nSamplesIn), start + 1);
+}
+
+// Accumulate samples of [first, last[ interleaved frames into out, one value per channel
+inline void accumulateScalar(const int16_t *in, int16_t *out, size_t nChannels, size_t first, size_t last)
+{
+    const int16_t *pIn = in + first * nChannels;
+    for (size_t i = first; i < last; ++i) {
+        for (size_t ch = 0; ch < nChannels; ++ch) {
+            out[ch] = std::max(out[ch], absSaturated(pIn[ch]));
+        }
+        pIn += nChannels;
+    }
+}
+
+// Fold the lanes of a block of registers into out, lane j belongs to channel j % nChannels
+inline void reduceBlock(const int16_t *lanes, size_t count, int16_t *out, size_t nChannels)
+{
+    for (size_t j = 0; j < count; ++j) {
+        const size_t ch = j % nChannels;
+        out[ch] = std::max(out[ch], lanes[j]);
+    }
+}
+
+void peaksScalar(const int16_t *in, int16_t *out, size_t nChannels, size_t nSamplesIn, size_t nSamplesOut)
+{
+    const float scale = static_cast<float>(nSamplesIn) / nSamplesOut;
+    for (size_t outIdx = 0; outIdx < nSamplesOut; ++outIdx) {
+        size_t start, end;
+        window(outIdx, scale, nSamplesIn, start, end);
+        int16_t *pOut = out + outIdx * nChannels;
+        std::fill(pOut, pOut + nChannels, 0);
+        accumulateScalar(in, pOut, nChannels, start, end);
+    }
+}
+
+#ifdef KDENLIVE_SIMD_SSE2
+void peaksSSE2(const int16_t *in, int16_t *out, size_t nChannels, size_t nSamplesIn, size_t nSamplesOut)
+{
+    constexpr size_t lanes = 8;
+    const size_t blockSamples = std::lcm(nChannels, lanes);
+    const size_t registers = blockSamples / lanes;
+    if (registers > maxBlockRegisters) {
+        peaksScalar(in, out, nChannels, nSamplesIn, nSamplesOut);
+        return;
+    }
+    const size_t blockFrames = blockSamples / nChannels;
+    const float scale = static_cast<float>(nSamplesIn) / nSamplesOut;
+    const __m128i zero = _mm_setzero_si128();
+    alignas(16) int16_t lanesMax[maxBlockRegisters * lanes];
+    for (size_t outIdx = 0; outIdx < nSamplesOut; ++outIdx) {
+        size_t start, end;
+        window(outIdx, scale, nSamplesIn, start, end);
+        int16_t *pOut = out + outIdx * nChannels;
+        std::fill(pOut, pOut + nChannels, 0);
+        size_t frame = start;
+        if (end - start >= blockFrames) {
+            __m128i acc[maxBlockRegisters];
+            for (size_t r = 0; r < registers; ++r) {
+                acc[r] = zero;
+            }
+            const int16_t *pIn = in + start * nChannels;
+            for (; frame + blockFrames <= end; frame += blockFrames) {
+                for (size_t r = 0; r < registers; ++r) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pIn + r * lanes));
+                    // |v| with saturation: max(v, 0 - v) where the subtraction saturates -32768 to 32767
+                    acc[r] = _mm_max_epi16(acc[r], _mm_max_epi16(v, _mm_subs_epi16(zero, v)));
+                }
+                pIn += blockSamples;
+            }
+            for (size_t r = 0; r < registers; ++r) {
+                _mm_store_si128(reinterpret_cast<__m128i *>(lanesMax + r * lanes), acc[r]);
+            }
+            reduceBlock(lanesMax, blockSamples, pOut, nChannels);
+        }
+        accumulateScalar(in, pOut, nChannels, frame, end);
+    }
+}
+#endif
+
+#ifdef KDENLIVE_SIMD_AVX2
+__attribute__((target("avx2"))) void peaksAVX2(const int16_t *in, int16_t *out, size_t nChannels, size_t nSamplesIn, size_t nSamplesOut)
+{
+    constexpr size_t lanes = 16;
+    const size_t blockSamples = std::lcm(nChannels, lanes);
+    const size_t registers = blockSamples / lanes;
+    if (registers > maxBlockRegisters) {
+        peaksSSE2(in, out, nChannels, nSamplesIn, nSamplesOut);
+        return;
+    }
+    const size_t blockFrames = blockSamples / nChannels;
+    const float scale = static_cast<float>(nSamplesIn) / nSamplesOut;
+    const __m256i zero = _mm256_setzero_si256();
+    alignas(32) int16_t lanesMax[maxBlockRegisters * lanes];
+    for (size_t outIdx = 0; outIdx < nSamplesOut; ++outIdx) {
+        size_t start, end;
+        window(outIdx, scale, nSamplesIn, start, end);
+        int16_t *pOut = out + outIdx * nChannels;
+        std::fill(pOut, pOut + nChannels, 0);
+        size_t frame = start;
+        if (end - start >= blockFrames) {
+            __m256i acc[maxBlockRegisters];
+            for (size_t r = 0; r < registers; ++r) {
+                acc[r] = zero;
+            }
+            const int16_t *pIn = in + start * nChannels;
+            for (; frame + blockFrames <= end; frame += blockFrames) {
+                for (size_t r = 0; r < registers; ++r) {
+                    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pIn + r * lanes));
+                    acc[r] = _mm256_max_epi16(acc[r], _mm256_max_epi16(v, _mm256_subs_epi16(zero, v)));
+                }
+                pIn += blockSamples;
+            }
+            for (size_t r = 0; r < registers; ++r) {
+                _mm256_store_si256(reinterpret_cast<__m256i *>(lanesMax + r * lanes), acc[r]);
+            }
+            reduceBlock(lanesMax, blockSamples, pOut, nChannels);
+        }
+        accumulateScalar(in, pOut, nChannels, frame, end);
+    }
+}
+#endif
+
+} // namespace
+
+void computePeaks(Kernel kernel, const int16_t *in, int16_t *out, size_t nChannels, size_t nSamplesIn, size_t nSamplesOut)
+{
+    Q_ASSERT(in != nullptr);
+    Q_ASSERT(out != nullptr);
+    Q_ASSERT(nSamplesOut > 0);
+    Q_ASSERT(nSamplesIn > 0);
+    Q_ASSERT(nChannels > 0);
+    Q_ASSERT(isSupported(kernel));
+
+    switch (kernel) {
+#ifdef KDENLIVE_SIMD_AVX2
+    case Kernel::AVX2:
+        peaksAVX2(in, out, nChannels, nSamplesIn, nSamplesOut);
+        return;
+#endif
+#ifdef KDENLIVE_SIMD_SSE2
+    case Kernel::SSE2:
+        peaksSSE2(in, out, nChannels, nSamplesIn, nSamplesOut);
+        return;
+#endif
+    default:
+        peaksScalar(in, out, nChannels, nSamplesIn, nSamplesOut);
+        return;
+    }
+}
+
+} // namespace AudioPeaks
@@ -0,0 +1,33 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+#include "utils/simdkernels.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Peak extraction kernels used by computePeaks().
+ *
+ * All kernels process every channel in a single pass over the interleaved input and produce identical results.
+ * The absolute value saturates, so that -32768 gives a peak of 32767.
+ */
+namespace AudioPeaks {
+
+// SSE2 and AVX2 kernels are implemented
+using SimdKernels::bestKernel;
+using SimdKernels::isSupported;
+using SimdKernels::Kernel;
+using SimdKernels::kernelName;
+
+/**
+ * @brief Computes peaks on interleaved multichannel audio data with the given kernel.
+ * @see computePeaks() for the parameters. The kernel must be supported.
+ */
+void computePeaks(Kernel kernel, const int16_t *in, int16_t *out, size_t nChannels, size_t nSamplesIn, size_t nSamplesOut);
+
+} // namespace AudioPeaks
@@ -11,6 +11,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "core.h"
 #include "doc/kthumb.h"
 #include "kdenlivesettings.h"
+#include "thumbnailextractor.h"
 #include "utils/thumbnailcache.hpp"
 
 #include "xml/xml.hpp"
@@ -79,6 +80,13 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
         int imageWidth = pCore->thumbProfile().width();
         int fullWidth = qRound(imageHeight * pCore->getCurrentDar());
         const QString clipId = QString::number(m_owner.itemId);
+        // Media files are decoded directly with libav, snapping to keyframes for the thumbnails spread over the clip
+        std::unique_ptr<ThumbnailExtractor> extractor;
+        const QString service = binClip->getProducerProperty(QStringLiteral("mlt_service"));
+        bool useExtractor = (service == QLatin1String("avformat") || service == QLatin1String("avformat-novalidate")) && binClip->hasVideo() &&
+                            !KdenliveSettings::gpu_accel() && !binClip->hasProducerProperty(QStringLiteral("force_aspect_ratio")) &&
+                            !binClip->hasProducerProperty(QStringLiteral("force_fps")) && !binClip->hasProducerProperty(QStringLiteral("rotate"));
+        const bool exact = m_thumbsCount == 0;
         for (int i : m_frames) {
             int val = qMax(1, 100 * count / size);
             count++;
@@ -88,22 +96,49 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
             if (ThumbnailCache::get()->hasThumbnail(clipId, i)) {
                 continue;
             }
-            if (thumbProd == nullptr) {
-                thumbProd = binClip->getThumbProducer();
+            QImage result;
+            // The frame shown by the thumbnail, thumbnails snapped to a keyframe show another one
+            int decodedFrame = i;
+            if (useExtractor) {
+                if (extractor == nullptr) {
+                    const int videoIndex =
+                        binClip->hasProducerProperty(QStringLiteral("video_index")) ? binClip->getProducerIntProperty(QStringLiteral("video_index")) : -1;
+                    extractor = std::make_unique<ThumbnailExtractor>(binClip->getProducerProperty(QStringLiteral("resource")), videoIndex,
+                                                                     pCore->getCurrentFps());
+                    useExtractor = extractor->isValid();
+                }
+                result = QImage(fullWidth > 0 ? fullWidth : imageWidth, imageHeight, QImage::Format_ARGB32);
+                if (!useExtractor || !extractor->extract(i, exact, result)) {
+                    // Fall back to MLT for the remaining frames
+                    useExtractor = false;
+                    result = QImage();
+                } else {
+                    decodedFrame = extractor->lastFrame();
+                }
             }
-            if (thumbProd == nullptr) {
-                // Thumb producer not available
-                break;
+            if (result.isNull()) {
+                if (thumbProd == nullptr) {
+                    thumbProd = binClip->getThumbProducer();
+                }
+                if (thumbProd == nullptr) {
+                    // Thumb producer not available
+                    break;
+                }
+                thumbProd->seek(i);
+                QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
+                if (frame != nullptr && frame->is_valid()) {
+                    addFramesDecoded(1);
+                    frame->set("consumer.deinterlacer", "onefield");
+                    frame->set("consumer.top_field_first", -1);
+                    frame->set("consumer.rescale", "nearest");
+                    result = KThumb::getFrame(frame.get(), imageWidth, imageHeight, fullWidth);
+                }
             }
-            thumbProd->seek(i);
-            QScopedPointer<Mlt::Frame> frame(thumbProd->get_frame());
-            if (frame != nullptr && frame->is_valid()) {
-                frame->set("consumer.deinterlacer", "onefield");
-                frame->set("consumer.top_field_first", -1);
-                frame->set("consumer.rescale", "nearest");
-                const QImage result = KThumb::getFrame(frame.get(), imageWidth, imageHeight, fullWidth);
-                if (!result.isNull() && !m_isCanceled) {
-                    ThumbnailCache::get()->storeThumbnail(clipId, i, result, true);
+            if (!result.isNull() && !m_isCanceled) {
+                // Only exact thumbnails are saved with the project, others are kept for this session
+                ThumbnailCache::get()->storeThumbnail(clipId, i, result, decodedFrame == i);
+                if (decodedFrame != i && decodedFrame >= 0 && !ThumbnailCache::get()->hasThumbnail(clipId, decodedFrame)) {
+                    ThumbnailCache::get()->storeThumbnail(clipId, decodedFrame, result, true);
                 }
             }
             if (m_progress != val) {
@@ -111,6 +146,10 @@ void CacheTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip)
                 QMetaObject::invokeMethod(m_object, "updateJobProgress");
             }
         }
+        if (extractor) {
+            addFramesDecoded(extractor->framesDecoded());
+            addBytesRead(extractor->bytesRead());
+        }
     }
 }
 
@@ -16,6 +16,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "mltcontroller/clipcontroller.h"
 #include "project/dialogs/slideshowclip.h"
 #include "project/transcodeseek.h"
+#include "utils/filehashcache.hpp"
 #include "utils/thumbnailcache.hpp"
 
 #include "xml/xml.hpp"
@@ -225,6 +226,8 @@ void ClipLoadTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip, std::
         frameNumber = binClip->getThumbFrame();
     }
     if (producer->get_int("video_index") > -1) {
+        // Import the thumbnails of previous versions here, lookups from the GUI must not scan the cache folder
+        ThumbnailCache::get()->importLegacyThumbnails(binClip->hashForThumbs());
         QImage thumb = ThumbnailCache::get()->getThumbnail(binClip->hashForThumbs(), QString::number(m_owner.itemId), frameNumber);
         if (!thumb.isNull()) {
             // Thumbnail found in cache
@@ -251,6 +254,7 @@ void ClipLoadTask::generateThumbnail(std::shared_ptr<ProjectClip> binClip, std::
                 }
                 std::unique_ptr<Mlt::Frame> frame(thumbProd->get_frame());
                 if ((frame != nullptr) && frame->is_valid()) {
+                    addFramesDecoded(1);
                     frame->set("consumer.deinterlacer", "onefield");
                     frame->set("consumer.top_field_first", -1);
                     frame->set("consumer.rescale", "nearest");
@@ -768,6 +772,14 @@ void ClipLoadTask::run()
             producer->set("video_index", -1);
         }
     }
+    const QFileInfo resourceInfo(resource);
+    if (!m_isCanceled.loadAcquire() && type != ClipType::SlideShow && type != ClipType::Text && type != ClipType::TextTemplate &&
+        Xml::getXmlProperty(m_xml, QStringLiteral("kdenlive:proxy")).length() <= 2 && resourceInfo.isAbsolute() && resourceInfo.isFile()) {
+        // Hash the file in this thread, ProjectClip::getFileHash() then finds it in the cache when the clip gets its producer
+        qint64 bytesRead = 0;
+        FileHashCache::get()->fileHash(resourceInfo.absoluteFilePath(), &bytesRead);
+        addBytesRead(bytesRead);
+    }
     if (!m_isCanceled.loadAcquire()) {
         auto binClip = pCore->projectItemModel()->getClipByBinID(QString::number(m_owner.itemId));
         if (binClip) {
@@ -407,6 +407,7 @@ void ProxyTask::run()
             }
         } else if (binClip) {
             // Job successful
+            addBytesRead(QFileInfo(source).size());
             QMetaObject::invokeMethod(binClip.get(), "updateProxyProducer", Qt::QueuedConnection, Q_ARG(QString, dest));
         }
     } else {
@@ -17,6 +17,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <KMessageWidget>
 #include <QFuture>
 #include <QThread>
+#include <algorithm>
 
 TaskManager::TaskManager(QObject *parent)
     : QObject(parent)
@@ -24,8 +25,12 @@ TaskManager::TaskManager(QObject *parent)
     , m_tasksListLock(QReadWriteLock::Recursive)
     , m_blockUpdates(false)
 {
-    int maxThreads = qMin(4, QThread::idealThreadCount() - 1);
-    m_taskPool.setMaxThreadCount(qMax(maxThreads, 1));
+    int maxThreads = qMax(1, qMin(4, QThread::idealThreadCount() - 1));
+    // I/O bound tasks spend most of their time waiting, CPU bound tasks get a smaller budget on the same pool
+    m_budgets[IOBudget] = maxThreads;
+    m_budgets[CPUBudget] = qMax(1, maxThreads / 2);
+    m_budgets[TranscodeBudget] = KdenliveSettings::proxythreads();
+    m_taskPool.setMaxThreadCount(m_budgets[IOBudget] + m_budgets[CPUBudget]);
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
 }
 
@@ -41,7 +46,141 @@ bool TaskManager::isBlocked() const
 
 void TaskManager::updateConcurrency()
 {
+    QWriteLocker lk(&m_tasksListLock);
+    m_budgets[TranscodeBudget] = KdenliveSettings::proxythreads();
     m_transcodePool.setMaxThreadCount(KdenliveSettings::proxythreads());
+    dispatch();
+}
+
+void TaskManager::setVisibleClips(const QSet<int> &binIds)
+{
+    QWriteLocker lk(&m_tasksListLock);
+    m_visibleClips = binIds;
+}
+
+TaskManager::TaskBudget TaskManager::budgetForType(AbstractTask::JOBTYPE type)
+{
+    switch (type) {
+    case AbstractTask::TRANSCODEJOB:
+    case AbstractTask::PROXYJOB:
+        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
+        return TranscodeBudget;
+    case AbstractTask::LOADJOB:
+    case AbstractTask::THUMBJOB:
+    case AbstractTask::AUDIOTHUMBJOB:
+    case AbstractTask::CACHEJOB:
+        return IOBudget;
+    default:
+        return CPUBudget;
+    }
+}
+
+quint64 TaskManager::jobKey(int ownerId, AbstractTask::JOBTYPE type)
+{
+    return (quint64(quint32(ownerId)) << 32) | quint32(type);
+}
+
+void TaskManager::dispatch()
+{
+    if (m_blockUpdates) {
+        return;
+    }
+    for (int budget = 0; budget < BudgetCount; ++budget) {
+        while (m_runningCount[budget] < m_budgets[budget]) {
+            AbstractTask *task = takeNextTask(TaskBudget(budget));
+            if (task == nullptr) {
+                break;
+            }
+            m_runningCount[budget]++;
+            // The worker is released in taskDone()
+            pool(TaskBudget(budget)).start(task, task->m_priority);
+        }
+    }
+}
+
+AbstractTask *TaskManager::takeNextTask(TaskBudget budget)
+{
+    auto best = m_pendingQueues.end();
+    int bestPriority = 0;
+    for (auto it = m_pendingQueues.begin(); it != m_pendingQueues.end(); ++it) {
+        AbstractTask *task = it->second.front();
+        if (budgetForType(task->m_type) != budget) {
+            continue;
+        }
+        // The clip opened in the monitor, then the clips visible in the timeline, go first
+        int priority = task->m_priority;
+        if (task->m_owner.itemId == displayedClip) {
+            priority += 200;
+        } else if (m_visibleClips.contains(task->m_owner.itemId)) {
+            priority += 100;
+        }
+        if (best == m_pendingQueues.end() || priority > bestPriority ||
+            (priority == bestPriority && task->m_queueOrder < best->second.front()->m_queueOrder)) {
+            best = it;
+            bestPriority = priority;
+        }
+    }
+    if (best == m_pendingQueues.end()) {
+        return nullptr;
+    }
+    AbstractTask *task = best->second.front();
+    best->second.pop_front();
+    if (best->second.empty()) {
+        m_pendingQueues.erase(best);
+    }
+    return task;
+}
+
+QThreadPool &TaskManager::pool(TaskBudget budget)
+{
+    return budget == TranscodeBudget ? m_transcodePool : m_taskPool;
+}
+
+bool TaskManager::takeWaitingTask(AbstractTask *task)
+{
+    auto queue = m_pendingQueues.find(jobKey(task->m_owner.itemId, task->m_type));
+    if (queue != m_pendingQueues.end()) {
+        auto it = std::find(queue->second.begin(), queue->second.end(), task);
+        if (it != queue->second.end()) {
+            queue->second.erase(it);
+            if (queue->second.empty()) {
+                m_pendingQueues.erase(queue);
+            }
+            m_statistics.addDiscarded(task->m_type, task->m_enqueueTime, TaskStatistics::timestamp());
+            return true;
+        }
+    }
+    // The task may also wait in its thread pool until a finishing task releases its thread
+    const TaskBudget budget = budgetForType(task->m_type);
+    if (pool(budget).tryTake(task)) {
+        m_runningCount[budget]--;
+        m_statistics.addDiscarded(task->m_type, task->m_enqueueTime, TaskStatistics::timestamp());
+        return true;
+    }
+    return false;
+}
+
+void TaskManager::removeTask(AbstractTask *task)
+{
+    const int ownerId = task->m_owner.itemId;
+    auto owner = m_taskList.find(ownerId);
+    if (owner != m_taskList.end()) {
+        auto it = std::find(owner->second.begin(), owner->second.end(), task);
+        if (it != owner->second.end()) {
+            owner->second.erase(it);
+            m_taskCount--;
+        }
+        if (owner->second.empty()) {
+            m_taskList.erase(owner);
+        }
+    }
+    auto jobs = m_jobIndex.find(jobKey(ownerId, task->m_type));
+    if (jobs != m_jobIndex.end()) {
+        jobs->second.erase(std::remove(jobs->second.begin(), jobs->second.end(), task), jobs->second.end());
+        if (jobs->second.empty()) {
+            m_jobIndex.erase(jobs);
+        }
+    }
 }
 
 void TaskManager::discardJobsByType(AbstractTask::JOBTYPE jobType)
@@ -51,33 +190,24 @@ void TaskManager::discardJobsByType(AbstractTask::JOBTYPE jobType)
         return;
     }
     m_tasksListLock.lockForWrite();
-    m_blockUpdates = true;
-    int cnt = 0;
+    std::vector<AbstractTask *> tasks;
     for (const auto &task : m_taskList) {
-        int ix = task.second.size() - 1;
-        cnt++;
-        while (ix >= 0) {
-            AbstractTask *t = task.second.at(ix);
-            if (t->m_type != jobType) {
-                // Ignore
-                ix--;
-                continue;
-            }
-            if (m_taskPool.tryTake(t)) {
-                // Task was not started yet, we can simply delete
-                m_taskList[task.first].erase(std::remove(m_taskList[task.first].begin(), m_taskList[task.first].end(), t), m_taskList[task.first].end());
-                delete t;
-            } else {
-                t->cancelJob();
+        for (AbstractTask *t : task.second) {
+            if (t->m_type == jobType) {
+                tasks.push_back(t);
             }
-            ix--;
         }
     }
-    int count = 0;
-    for (const auto &task : m_taskList) {
-        count += task.second.size();
+    for (AbstractTask *t : tasks) {
+        if (takeWaitingTask(t)) {
+            // Task was not started yet, we can simply delete
+            removeTask(t);
+            delete t;
+        } else {
+            t->cancelJob();
+        }
     }
-    m_blockUpdates = false;
+    const int count = m_taskCount;
     m_tasksListLock.unlock();
     // Set jobs count
     Q_EMIT jobCount(count);
@@ -94,7 +224,7 @@ void TaskManager::discardJobs(const ObjectId &owner, AbstractTask::JOBTYPE type,
     if (m_taskList.find(owner.itemId) == m_taskList.end()) {
         return;
     }
-    std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
+    const std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
     int ix = taskList.size() - 1;
     while (ix >= 0) {
         AbstractTask *t = taskList.at(ix);
@@ -109,28 +239,16 @@ void TaskManager::discardJobs(const ObjectId &owner, AbstractTask::JOBTYPE type,
             ix--;
             continue;
         }
-        if (taskType != AbstractTask::TRANSCODEJOB && taskType != AbstractTask::PROXYJOB) {
-            if (m_taskPool.tryTake(t)) {
-                // Task was not started yet, we can simply delete
-                m_taskList[owner.itemId].erase(std::remove(m_taskList[owner.itemId].begin(), m_taskList[owner.itemId].end(), t),
-                                               m_taskList[owner.itemId].end());
-                delete t;
-                ix--;
-                continue;
-            }
-        } else {
-            if (m_transcodePool.tryTake(t)) {
-                // Task was not started yet, we can simply delete
-                m_taskList[owner.itemId].erase(std::remove(m_taskList[owner.itemId].begin(), m_taskList[owner.itemId].end(), t),
-                                               m_taskList[owner.itemId].end());
-                delete t;
-                ix--;
-                continue;
-            }
+        if (takeWaitingTask(t)) {
+            // Task was not started yet, we can simply delete
+            removeTask(t);
+            delete t;
+            ix--;
+            continue;
         }
         if (t->cancelJob(softDelete)) {
             // Block until the task is finished
-            m_taskList[owner.itemId].erase(std::remove(m_taskList[owner.itemId].begin(), m_taskList[owner.itemId].end(), t), m_taskList[owner.itemId].end());
+            removeTask(t);
             t->m_runMutex.lock();
             t->m_runMutex.unlock();
             t->deleteLater();
@@ -145,41 +263,28 @@ void TaskManager::discardJob(const ObjectId &owner, const QUuid &uuid)
         // We are already deleting all tasks
         return;
     }
+    QWriteLocker lk(&m_tasksListLock);
     // See if there is already a task for this MLT service and resource.
     if (m_taskList.find(owner.itemId) == m_taskList.end()) {
         return;
     }
-    QWriteLocker lk(&m_tasksListLock);
-    std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
+    const std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
     int ix = taskList.size() - 1;
     while (ix >= 0) {
         AbstractTask *t = taskList.at(ix);
-        AbstractTask::JOBTYPE taskType = t->m_type;
         if ((t->m_uuid != uuid) || t->m_progress == 100 || t->isCanceled()) {
             ix--;
             continue;
         }
-        if (taskType != AbstractTask::TRANSCODEJOB && taskType != AbstractTask::PROXYJOB) {
-            if (m_taskPool.tryTake(t)) {
-                // Task was not started yet, we can simply delete
-                m_taskList[owner.itemId].erase(std::remove(m_taskList[owner.itemId].begin(), m_taskList[owner.itemId].end(), t),
-                                               m_taskList[owner.itemId].end());
-                delete t;
-                ix--;
-                continue;
-            }
-        } else {
-            if (m_transcodePool.tryTake(t)) {
-                // Task was not started yet, we can simply delete
-                m_taskList[owner.itemId].erase(std::remove(m_taskList[owner.itemId].begin(), m_taskList[owner.itemId].end(), t),
-                                               m_taskList[owner.itemId].end());
-                delete t;
-                ix--;
-                continue;
-            }
+        if (takeWaitingTask(t)) {
+            // Task was not started yet, we can simply delete
+            removeTask(t);
+            delete t;
+            ix--;
+            continue;
         }
         if (t->cancelJob()) {
-            m_taskList[owner.itemId].erase(std::remove(m_taskList[owner.itemId].begin(), m_taskList[owner.itemId].end(), t), m_taskList[owner.itemId].end());
+            removeTask(t);
             // Block until the task is finished
             t->m_runMutex.lock();
             t->m_runMutex.unlock();
@@ -196,12 +301,13 @@ bool TaskManager::hasPendingJob(const ObjectId &owner, AbstractTask::JOBTYPE typ
         // Check for any kind of job for this clip
         return m_taskList.find(owner.itemId) != m_taskList.end();
     }
-    if (m_taskList.find(owner.itemId) == m_taskList.end()) {
+    auto jobs = m_jobIndex.find(jobKey(owner.itemId, type));
+    if (jobs == m_jobIndex.end()) {
         return false;
     }
-    std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
-    for (AbstractTask *t : taskList) {
-        if (type == t->m_type && t->m_progress < 100 && !t->m_isCanceled) {
+    // Usually a single task
+    for (AbstractTask *t : jobs->second) {
+        if (t->m_progress < 100 && !t->m_isCanceled) {
             return true;
         }
     }
@@ -211,12 +317,12 @@ bool TaskManager::hasPendingJob(const ObjectId &owner, AbstractTask::JOBTYPE typ
 TaskManagerStatus TaskManager::jobStatus(const ObjectId &owner) const
 {
     QReadLocker lk(&m_tasksListLock);
-    if (m_taskList.find(owner.itemId) == m_taskList.end()) {
+    auto tasks = m_taskList.find(owner.itemId);
+    if (tasks == m_taskList.end()) {
         // No job for this clip
         return TaskManagerStatus::NoJob;
     }
-    std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
-    for (AbstractTask *t : taskList) {
+    for (AbstractTask *t : tasks->second) {
         if (t->m_running) {
             return TaskManagerStatus::Running;
         }
@@ -227,21 +333,19 @@ TaskManagerStatus TaskManager::jobStatus(const ObjectId &owner) const
 void TaskManager::taskDone(int cid, AbstractTask *task)
 {
     // This will be executed in the QRunnable job thread
+    m_statistics.addTask(task->m_type, cid, task->m_enqueueTime, task->m_startTime, TaskStatistics::timestamp(), task->m_bytesRead.loadRelaxed(),
+                         task->m_framesDecoded.loadRelaxed(), task->isCanceled());
+    m_tasksListLock.lockForWrite();
+    // Release the worker
+    m_runningCount[budgetForType(task->m_type)]--;
     if (m_blockUpdates) {
         // We are closing, tasks will be handled on close
+        m_tasksListLock.unlock();
         return;
     }
-    m_tasksListLock.lockForWrite();
-    if (!m_taskList.empty() && m_taskList.find(cid) != m_taskList.end()) {
-        m_taskList[cid].erase(std::remove(m_taskList[cid].begin(), m_taskList[cid].end(), task), m_taskList[cid].end());
-        if (m_taskList[cid].size() == 0) {
-            m_taskList.erase(cid);
-        }
-    }
-    int count = 0;
-    for (const auto &task : m_taskList) {
-        count += task.second.size();
-    }
+    removeTask(task);
+    dispatch();
+    const int count = m_taskCount;
     m_tasksListLock.unlock();
     // Set jobs count
     Q_EMIT jobCount(count);
@@ -259,43 +363,26 @@ void TaskManager::slotCancelJobs(bool leaveBlocked, const QVector<AbstractTask::
     qDebug() << "ZZZZZZZZZZZZZZZZZZZZZZZ\n\nSTARTING TASKMANAGER CLOSURE, ACTIVE THREADS: " << m_taskPool.activeThreadCount() << "\nEXCEPTIONS: " << exceptions
              << "\n\nZZZZZZZZZZZZZZZZZZZZZZZ";
 
+    std::vector<AbstractTask *> tasks;
     for (const auto &task : m_taskList) {
-        int ix = task.second.size() - 1;
-        while (ix >= 0) {
-            AbstractTask *t = task.second.at(ix);
-            AbstractTask::JOBTYPE taskType = t->m_type;
-            if (exceptions.contains(taskType)) {
-                ix--;
-                continue;
-            }
-            if (taskType != AbstractTask::TRANSCODEJOB && taskType != AbstractTask::PROXYJOB) {
-                if (m_taskPool.tryTake(t)) {
-                    // Task was not started yet, we can simply delete
-                    qDebug() << "** DELETED  1 TASK from task pool: " << taskType;
-                    m_taskList[task.first].erase(std::remove(m_taskList[task.first].begin(), m_taskList[task.first].end(), t), m_taskList[task.first].end());
-                    delete t;
-                    ix--;
-                    continue;
-                }
-            } else {
-                if (m_transcodePool.tryTake(t)) {
-                    // Task was not started yet, we can simply delete
-                    m_taskList[task.first].erase(std::remove(m_taskList[task.first].begin(), m_taskList[task.first].end(), t), m_taskList[task.first].end());
-                    delete t;
-                    ix--;
-                    continue;
-                }
+        for (AbstractTask *t : task.second) {
+            if (!exceptions.contains(t->m_type)) {
+                tasks.push_back(t);
             }
-            if (m_taskList.find(task.first) != m_taskList.end()) {
-                // If so, then just add ourselves to be notified upon completion.
-                if (t->cancelJob()) {
-                    m_taskList[task.first].erase(std::remove(m_taskList[task.first].begin(), m_taskList[task.first].end(), t), m_taskList[task.first].end());
-                    t->m_runMutex.lock();
-                    t->m_runMutex.unlock();
-                    t->deleteLater();
-                }
-            }
-            ix--;
+        }
+    }
+    for (AbstractTask *t : tasks) {
+        if (takeWaitingTask(t)) {
+            // Task was not started yet, we can simply delete
+            removeTask(t);
+            delete t;
+            continue;
+        }
+        if (t->cancelJob()) {
+            removeTask(t);
+            t->m_runMutex.lock();
+            t->m_runMutex.unlock();
+            t->deleteLater();
         }
     }
     m_tasksListLock.unlock();
@@ -310,18 +397,24 @@ void TaskManager::slotCancelJobs(bool leaveBlocked, const QVector<AbstractTask::
         }
         QWriteLocker lock(&m_tasksListLock);
         m_taskList.clear();
+        m_jobIndex.clear();
+        m_pendingQueues.clear();
+        m_taskCount = 0;
         m_taskPool.clear();
     }
     if (!leaveBlocked) {
         // Set jobs count
         Q_EMIT jobCount(0);
-        m_blockUpdates = false;
+        unBlock();
     }
 }
 
 void TaskManager::unBlock()
 {
+    QWriteLocker lk(&m_tasksListLock);
     m_blockUpdates = false;
+    // Start the tasks that were kept while blocked
+    dispatch();
 }
 
 void TaskManager::startTask(int ownerId, AbstractTask *task)
@@ -332,25 +425,72 @@ void TaskManager::startTask(int ownerId, AbstractTask *task)
         return;
     }
     m_tasksListLock.lockForWrite();
-    if (m_taskList.find(ownerId) == m_taskList.end()) {
-        // First task for this clip
-        m_taskList[ownerId] = {task};
-    } else {
-        m_taskList[ownerId].emplace_back(task);
-    }
-    int count = 0;
-    for (const auto &task : m_taskList) {
-        count += task.second.size();
-    }
+    m_taskList[ownerId].emplace_back(task);
+    m_jobIndex[jobKey(ownerId, task->m_type)].push_back(task);
+    task->m_queueOrder = m_queueOrder++;
+    task->m_enqueueTime = TaskStatistics::timestamp();
+    m_pendingQueues[jobKey(ownerId, task->m_type)].push_back(task);
+    m_taskCount++;
     // Set jobs count
-    Q_EMIT jobCount(count);
-    if (task->m_type == AbstractTask::TRANSCODEJOB || task->m_type == AbstractTask::PROXYJOB) {
-        // We only want a limited concurrent jobs for those as for example GPU usually only accept 2 concurrent encoding jobs
-        m_transcodePool.start(task, task->m_priority);
-    } else {
-        m_taskPool.start(task, task->m_priority);
+    Q_EMIT jobCount(m_taskCount);
+    dispatch();
+    m_tasksListLock.unlock();
+}
+
+bool TaskManager::startHelper(const std::function<void()> &helper)
+{
+    // The calling task holds its run mutex, while discarding jobs holds the tasks lock and waits for that mutex:
+    // never wait for the lock here, the caller does the work itself when no helper starts
+    if (!m_tasksListLock.tryLockForWrite()) {
+        return false;
+    }
+    if (m_blockUpdates || m_runningCount[IOBudget] >= m_budgets[IOBudget]) {
+        m_tasksListLock.unlock();
+        return false;
     }
+    // Helpers decode media like the tasks starting them, they take a worker of the I/O budget
+    m_runningCount[IOBudget]++;
+    m_runningHelpers++;
+    m_taskPool.start([this, helper]() {
+        helper();
+        QWriteLocker lock(&m_tasksListLock);
+        m_runningCount[IOBudget]--;
+        m_runningHelpers--;
+        dispatch();
+    });
     m_tasksListLock.unlock();
+    return true;
+}
+
+QJsonObject TaskManager::statistics() const
+{
+    QJsonObject result = m_statistics.toJson();
+    QReadLocker lk(&m_tasksListLock);
+    std::array<int, BudgetCount> pending{};
+    for (const auto &queue : m_pendingQueues) {
+        pending[budgetForType(queue.second.front()->m_type)] += int(queue.second.size());
+    }
+    const std::array<QLatin1String, BudgetCount> names{QLatin1String("io"), QLatin1String("cpu"), QLatin1String("transcode")};
+    QJsonObject budgets;
+    for (int budget = 0; budget < BudgetCount; ++budget) {
+        QJsonObject state;
+        state.insert(QLatin1String("workers"), m_budgets[budget]);
+        state.insert(QLatin1String("running"), m_runningCount[budget]);
+        state.insert(QLatin1String("pending"), pending[budget]);
+        if (budget == IOBudget) {
+            state.insert(QLatin1String("helpers"), m_runningHelpers);
+        }
+        budgets.insert(names[budget], state);
+    }
+    result.insert(QLatin1String("budgets"), budgets);
+    result.insert(QLatin1String("idealThreadCount"), QThread::idealThreadCount());
+    result.insert(QLatin1String("timestampMs"), TaskStatistics::timestamp());
+    return result;
+}
+
+int TaskManager::maxConcurrency() const
+{
+    return m_taskPool.maxThreadCount();
 }
 
 int TaskManager::getJobProgressForClip(const ObjectId &owner)
@@ -365,7 +505,7 @@ int TaskManager::getJobProgressForClip(const ObjectId &owner)
         }
         return 100;
     }
-    std::vector<AbstractTask *> taskList = m_taskList.at(owner.itemId);
+    const std::vector<AbstractTask *> &taskList = m_taskList.at(owner.itemId);
     int cnt = taskList.size();
     if (cnt == 0) {
         return 100;
@@ -10,13 +10,19 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "abstracttask.h"
 #include "definitions.h"
+#include "taskstatistics.h"
 
 #include <QAbstractListModel>
 #include <QFutureWatcher>
+#include <QJsonObject>
 #include <QObject>
 #include <QReadWriteLock>
+#include <QSet>
 #include <QThreadPool>
 #include <QUuid>
+#include <array>
+#include <deque>
+#include <functional>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -29,6 +35,15 @@ Q_DECLARE_METATYPE(TaskManagerStatus)
 
 /** @class TaskManager
     @brief This class is responsible for clip jobs management.
+
+    Tasks wait in queues keyed by job type and owner, and are only pushed to a thread pool when a worker of their
+    budget is free: I/O bound tasks (loading, thumbnails, audio levels, cache), CPU bound tasks (analysis, filters,
+    conversions) and transcoding tasks (proxies, transcoding) have separate budgets. The next task is chosen when a
+    worker becomes free, so its priority can change while it waits: the tasks of the clip opened in the Clip Monitor
+    come first, then those of the clips visible in the timeline, then the others by job type and submission order.
+    Canceling a waiting task just removes it from its queue.
+    The helpers a running task starts to split its work, see startHelper(), also take workers of the I/O budget.
+    The time each task spent waiting and running is recorded in a TaskStatistics, see statistics().
  */
 class TaskManager : public QObject
 {
@@ -63,29 +78,73 @@ public:
     /** @brief Remove a finished task */
     void taskDone(int cid, AbstractTask *task);
 
+    /** @brief Run a helper function on the task pool, used by a running I/O bound task to split its work across threads.
+     *  Helpers are not tracked as jobs but use a worker of the I/O budget, the task must not wait for helpers that were not started yet.
+     *  @return false if the I/O budget has no free worker or the tasks list is locked, the helper is then not started
+     */
+    bool startHelper(const std::function<void()> &helper);
+
+    /** @brief The maximum number of tasks running concurrently on the task pool */
+    int maxConcurrency() const;
+
     /** @brief Update the number of concurrent jobs allowed */
     void updateConcurrency();
 
     /** @brief We are aborting all tasks and don't want them to send any updates */
     bool isBlocked() const;
 
-    /** @brief The clip currently opened in Clip Monitor (to display clip jobs) */
+    /** @brief The clip currently opened in Clip Monitor (to display clip jobs), its tasks are started first */
     int displayedClip;
 
+    /** @brief Set the bin clips visible in the timeline, their tasks are started before the other clips' */
+    void setVisibleClips(const QSet<int> &binIds);
+
     /** @brief Allow starting new tasks */
     void unBlock();
 
+    /** @brief The timing and I/O statistics of the finished tasks per job type, with the current state of the queues */
+    QJsonObject statistics() const;
+
 public Q_SLOTS:
     /** @brief Discard all running jobs. */
     void slotCancelJobs(bool leaveBlocked = false, const QVector<AbstractTask::JOBTYPE> exceptions = {});
 
 private:
+    /** @brief The worker budgets, each one limits the number of tasks of its kind running concurrently */
+    enum TaskBudget { IOBudget = 0, CPUBudget, TranscodeBudget, BudgetCount };
+    static TaskBudget budgetForType(AbstractTask::JOBTYPE type);
+    /** @brief The key of the queue of a job type for an owner */
+    static quint64 jobKey(int ownerId, AbstractTask::JOBTYPE type);
+
+    /** @brief Start the best pending tasks while their budget has free workers. The task list must be locked for writing. */
+    void dispatch();
+    /** @brief Remove the best pending task of a budget from its queue */
+    AbstractTask *takeNextTask(TaskBudget budget);
+    /** @brief Remove a task from its queue or thread pool if it was not started yet */
+    bool takeWaitingTask(AbstractTask *task);
+    /** @brief Forget a task, it is not deleted */
+    void removeTask(AbstractTask *task);
+    QThreadPool &pool(TaskBudget budget);
+
+    /** @brief Runs the I/O and CPU bound tasks, and the helpers */
     QThreadPool m_taskPool;
     QThreadPool m_transcodePool;
     /** @brief List of created tasks, in the form {owner clip id, {tasks}} */
     std::unordered_map<int, std::vector<AbstractTask*> > m_taskList;
+    /** @brief The created tasks by job type and owner, see jobKey() */
+    std::unordered_map<quint64, std::vector<AbstractTask *>> m_jobIndex;
+    /** @brief The tasks waiting for a worker by job type and owner, in submission order */
+    std::unordered_map<quint64, std::deque<AbstractTask *>> m_pendingQueues;
+    std::array<int, BudgetCount> m_budgets;
+    std::array<int, BudgetCount> m_runningCount{};
+    /** @brief The helpers running on workers of the I/O budget, they are included in its running count */
+    int m_runningHelpers{0};
+    QSet<int> m_visibleClips;
+    int m_taskCount{0};
+    quint64 m_queueOrder{0};
     mutable QReadWriteLock m_tasksListLock;
     bool m_blockUpdates;
+    TaskStatistics m_statistics;
 
 Q_SIGNALS:
     void jobCount(int);
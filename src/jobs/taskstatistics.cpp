@@ -0,0 +1,160 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "taskstatistics.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QMutexLocker>
+
+qint64 TaskStatistics::timestamp()
+{
+    static const QElapsedTimer clock = [] {
+        QElapsedTimer timer;
+        timer.start();
+        return timer;
+    }();
+    return clock.elapsed();
+}
+
+QString TaskStatistics::jobTypeName(AbstractTask::JOBTYPE type)
+{
+    switch (type) {
+    case AbstractTask::PROXYJOB:
+        return QStringLiteral("proxy");
+    case AbstractTask::CUTJOB:
+        return QStringLiteral("cut");
+    case AbstractTask::STABILIZEJOB:
+        return QStringLiteral("stabilize");
+    case AbstractTask::TRANSCODEJOB:
+        return QStringLiteral("transcode");
+    case AbstractTask::FILTERCLIPJOB:
+        return QStringLiteral("filterclip");
+    case AbstractTask::THUMBJOB:
+        return QStringLiteral("thumb");
+    case AbstractTask::ANALYSECLIPJOB:
+        return QStringLiteral("analyseclip");
+    case AbstractTask::LOADJOB:
+        return QStringLiteral("load");
+    case AbstractTask::AUDIOTHUMBJOB:
+        return QStringLiteral("audiothumb");
+    case AbstractTask::SPEEDJOB:
+        return QStringLiteral("speed");
+    case AbstractTask::CACHEJOB:
+        return QStringLiteral("cache");
+    case AbstractTask::MASKJOB:
+        return QStringLiteral("mask");
+    case AbstractTask::MELTJOB:
+        return QStringLiteral("melt");
+    default:
+        return QStringLiteral("none");
+    }
+}
+
+void TaskStatistics::Histogram::add(qint64 duration)
+{
+    duration = qMax(qint64(0), duration);
+    int bucket = 0;
+    while (bucket < bucketCount - 1 && (qint64(1) << bucket) <= duration) {
+        bucket++;
+    }
+    buckets[size_t(bucket)]++;
+    total += duration;
+    max = qMax(max, duration);
+}
+
+QJsonObject TaskStatistics::Histogram::toJson(int count) const
+{
+    QJsonArray histogram;
+    for (int i = 0; i < bucketCount; ++i) {
+        if (buckets[size_t(i)] == 0) {
+            continue;
+        }
+        QJsonObject bucket;
+        // The bucket upper bound, the last bucket has none
+        bucket.insert(QLatin1String("belowMs"), i < bucketCount - 1 ? QJsonValue(qint64(1) << i) : QJsonValue());
+        bucket.insert(QLatin1String("count"), qint64(buckets[size_t(i)]));
+        histogram.append(bucket);
+    }
+    QJsonObject result;
+    result.insert(QLatin1String("totalMs"), total);
+    result.insert(QLatin1String("averageMs"), count > 0 ? double(total) / count : 0.);
+    result.insert(QLatin1String("maxMs"), max);
+    result.insert(QLatin1String("histogram"), histogram);
+    return result;
+}
+
+void TaskStatistics::addTask(AbstractTask::JOBTYPE type, int ownerId, qint64 enqueued, qint64 started, qint64 finished, qint64 bytesRead,
+                             qint64 framesDecoded, bool canceled)
+{
+    if (type < 0 || size_t(type) >= m_types.size()) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    TypeStatistics &stats = m_types[size_t(type)];
+    stats.count++;
+    if (canceled) {
+        stats.canceled++;
+    }
+    stats.wait.add(started - enqueued);
+    stats.run.add(finished - started);
+    stats.bytesRead += bytesRead;
+    stats.framesDecoded += framesDecoded;
+    m_recent.push_back({type, ownerId, enqueued, started, finished, bytesRead, framesDecoded, canceled});
+    if (m_recent.size() > maxRecentTasks) {
+        m_recent.pop_front();
+    }
+}
+
+void TaskStatistics::addDiscarded(AbstractTask::JOBTYPE type, qint64 enqueued, qint64 discarded)
+{
+    if (type < 0 || size_t(type) >= m_types.size()) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    TypeStatistics &stats = m_types[size_t(type)];
+    stats.discarded++;
+    // The time spent in the queue still delayed the other tasks
+    stats.wait.add(discarded - enqueued);
+}
+
+QJsonObject TaskStatistics::toJson() const
+{
+    QMutexLocker lock(&m_mutex);
+    QJsonObject types;
+    for (size_t i = 0; i < m_types.size(); ++i) {
+        const TypeStatistics &stats = m_types[i];
+        if (stats.count == 0 && stats.discarded == 0) {
+            continue;
+        }
+        QJsonObject type;
+        type.insert(QLatin1String("count"), stats.count);
+        type.insert(QLatin1String("canceled"), stats.canceled);
+        type.insert(QLatin1String("discarded"), stats.discarded);
+        type.insert(QLatin1String("queueWait"), stats.wait.toJson(stats.count + stats.discarded));
+        type.insert(QLatin1String("runTime"), stats.run.toJson(stats.count));
+        type.insert(QLatin1String("bytesRead"), stats.bytesRead);
+        type.insert(QLatin1String("framesDecoded"), stats.framesDecoded);
+        types.insert(jobTypeName(AbstractTask::JOBTYPE(i)), type);
+    }
+    QJsonArray recent;
+    for (const TaskRecord &record : m_recent) {
+        QJsonObject task;
+        task.insert(QLatin1String("type"), jobTypeName(record.type));
+        task.insert(QLatin1String("owner"), record.ownerId);
+        task.insert(QLatin1String("enqueuedMs"), record.enqueued);
+        task.insert(QLatin1String("startedMs"), record.started);
+        task.insert(QLatin1String("finishedMs"), record.finished);
+        task.insert(QLatin1String("bytesRead"), record.bytesRead);
+        task.insert(QLatin1String("framesDecoded"), record.framesDecoded);
+        task.insert(QLatin1String("canceled"), record.canceled);
+        recent.append(task);
+    }
+    QJsonObject result;
+    result.insert(QLatin1String("jobTypes"), types);
+    result.insert(QLatin1String("recentTasks"), recent);
+    return result;
+}
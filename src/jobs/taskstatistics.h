@@ -0,0 +1,78 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "abstracttask.h"
+
+#include <QJsonObject>
+#include <QMutex>
+#include <array>
+#include <deque>
+
+/** @class TaskStatistics
+    @brief Collects timing and I/O statistics of the finished clip jobs, per job type.
+
+    For each task, the time spent waiting in the TaskManager queues and the time spent running are added to
+    histograms with power of two buckets (in milliseconds), along with the bytes read and frames decoded reported
+    by the task. The most recent tasks are also kept individually. The statistics can be saved as JSON from the
+    Bin jobs menu, to size the thread budgets and the proxy threads from real data.
+    This class is thread safe.
+ */
+class TaskStatistics
+{
+public:
+    /** @brief A monotonic time in milliseconds, used for the task timestamps */
+    static qint64 timestamp();
+    static QString jobTypeName(AbstractTask::JOBTYPE type);
+
+    /** @brief Record a task that ran
+     *  @param enqueued, started, finished the timestamps of the task
+     */
+    void addTask(AbstractTask::JOBTYPE type, int ownerId, qint64 enqueued, qint64 started, qint64 finished, qint64 bytesRead, qint64 framesDecoded,
+                 bool canceled);
+    /** @brief Record a task that was discarded before it started */
+    void addDiscarded(AbstractTask::JOBTYPE type, qint64 enqueued, qint64 discarded);
+    QJsonObject toJson() const;
+
+private:
+    /** @brief Bucket 0 counts durations under 1ms, bucket i durations in [2^(i-1), 2^i) ms, the last one is unbounded */
+    static constexpr int bucketCount = 24;
+    /** @brief The number of tasks kept in the recent list */
+    static constexpr size_t maxRecentTasks = 256;
+    struct Histogram
+    {
+        std::array<quint32, bucketCount> buckets{};
+        qint64 total{0};
+        qint64 max{0};
+        void add(qint64 duration);
+        QJsonObject toJson(int count) const;
+    };
+    struct TypeStatistics
+    {
+        int count{0};
+        int canceled{0};
+        int discarded{0};
+        Histogram wait;
+        Histogram run;
+        qint64 bytesRead{0};
+        qint64 framesDecoded{0};
+    };
+    struct TaskRecord
+    {
+        AbstractTask::JOBTYPE type;
+        int ownerId;
+        qint64 enqueued;
+        qint64 started;
+        qint64 finished;
+        qint64 bytesRead;
+        qint64 framesDecoded;
+        bool canceled;
+    };
+    mutable QMutex m_mutex;
+    std::array<TypeStatistics, AbstractTask::MELTJOB + 1> m_types;
+    std::deque<TaskRecord> m_recent;
+};
@@ -0,0 +1,243 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "thumbnailextractor.h"
+
+#include <QDebug>
+#include <cmath>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/display.h>
+#include <libswscale/swscale.h>
+}
+
+namespace {
+// When a requested frame is less than this many seconds after the last decoded one, keep decoding instead of seeking
+constexpr int maxForwardDecodeSeconds = 2;
+// Give up on a frame after decoding this many pictures
+constexpr int maxDecodedFrames = 1000;
+} // namespace
+
+ThumbnailExtractor::ThumbnailExtractor(const QString &path, int streamIndex, double fps)
+    : m_fps(fps)
+    , m_lastPts(AV_NOPTS_VALUE)
+{
+    if (fps <= 0.) {
+        return;
+    }
+    if (avformat_open_input(&m_format, path.toLocal8Bit().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "Could not open input file for thumbnails" << path;
+        return;
+    }
+    if (avformat_find_stream_info(m_format, nullptr) < 0) {
+        return;
+    }
+    if (streamIndex < 0) {
+        streamIndex = av_find_best_stream(m_format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    }
+    if (streamIndex < 0 || streamIndex >= int(m_format->nb_streams)) {
+        return;
+    }
+    const AVStream *stream = m_format->streams[streamIndex];
+    if (stream->codecpar->codec_type != AVMEDIA_TYPE_VIDEO || (stream->disposition & AV_DISPOSITION_ATTACHED_PIC) != 0) {
+        // Cover art is better handled by MLT
+        return;
+    }
+    // Rotated videos are better handled by MLT
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(60, 29, 100)
+    const AVPacketSideData *sideData =
+        av_packet_side_data_get(stream->codecpar->coded_side_data, stream->codecpar->nb_coded_side_data, AV_PKT_DATA_DISPLAYMATRIX);
+    const uint8_t *displayMatrix = sideData ? sideData->data : nullptr;
+#else
+    const uint8_t *displayMatrix = av_stream_get_side_data(stream, AV_PKT_DATA_DISPLAYMATRIX, nullptr);
+#endif
+    if ((displayMatrix != nullptr && qRound(av_display_rotation_get(reinterpret_cast<const int32_t *>(displayMatrix))) % 360 != 0) ||
+        av_dict_get(stream->metadata, "rotate", nullptr, 0) != nullptr) {
+        return;
+    }
+    m_streamIndex = streamIndex;
+    if (stream->start_time != AV_NOPTS_VALUE) {
+        m_startTime = stream->start_time;
+    }
+    for (unsigned int i = 0; i < m_format->nb_streams; ++i) {
+        if (int(i) != m_streamIndex) {
+            m_format->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (codec == nullptr) {
+        return;
+    }
+    m_codec = avcodec_alloc_context3(codec);
+    if (m_codec == nullptr || avcodec_parameters_to_context(m_codec, stream->codecpar) < 0) {
+        return;
+    }
+    // Thumbnails are generated by several tasks in parallel, don't let each of them use all the cores
+    m_codec->thread_count = 1;
+    // Decode at a reduced resolution when the codec can do it, thumbnails are much smaller than the source
+    m_codec->lowres = codec->max_lowres > 0 ? qMin(int(codec->max_lowres), 2) : 0;
+    m_codec->flags2 |= AV_CODEC_FLAG2_FAST;
+    if (avcodec_open2(m_codec, codec, nullptr) < 0) {
+        return;
+    }
+    m_packet = av_packet_alloc();
+    m_frame = av_frame_alloc();
+    m_valid = m_packet != nullptr && m_frame != nullptr;
+}
+
+ThumbnailExtractor::~ThumbnailExtractor()
+{
+    sws_freeContext(m_scaler);
+    av_frame_free(&m_frame);
+    av_packet_free(&m_packet);
+    avcodec_free_context(&m_codec);
+    avformat_close_input(&m_format);
+}
+
+bool ThumbnailExtractor::isValid() const
+{
+    return m_valid;
+}
+
+int ThumbnailExtractor::lastFrame() const
+{
+    return m_lastFrame;
+}
+
+qint64 ThumbnailExtractor::framesDecoded() const
+{
+    return m_framesDecoded;
+}
+
+qint64 ThumbnailExtractor::bytesRead() const
+{
+    return m_bytesRead;
+}
+
+bool ThumbnailExtractor::seek(qint64 timestamp)
+{
+    m_lastPts = AV_NOPTS_VALUE;
+    m_draining = false;
+    if (av_seek_frame(m_format, m_streamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+        return false;
+    }
+    avcodec_flush_buffers(m_codec);
+    return true;
+}
+
+bool ThumbnailExtractor::decodeNext()
+{
+    while (true) {
+        int ret = avcodec_receive_frame(m_codec, m_frame);
+        if (ret == 0) {
+            m_framesDecoded++;
+            return true;
+        }
+        if (ret != AVERROR(EAGAIN) || m_draining) {
+            return false;
+        }
+        ret = av_read_frame(m_format, m_packet);
+        if (ret < 0) {
+            // End of file, get the frames still buffered in the decoder
+            m_draining = true;
+            avcodec_send_packet(m_codec, nullptr);
+            continue;
+        }
+        m_bytesRead += m_packet->size;
+        if (m_packet->stream_index == m_streamIndex) {
+            ret = avcodec_send_packet(m_codec, m_packet);
+        }
+        av_packet_unref(m_packet);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            return false;
+        }
+    }
+}
+
+bool ThumbnailExtractor::extract(int frame, bool exact, QImage &destination)
+{
+    m_lastFrame = -1;
+    if (!m_valid || destination.isNull()) {
+        return false;
+    }
+    const AVStream *stream = m_format->streams[m_streamIndex];
+    const qint64 target = m_startTime + av_rescale_q(std::llround(frame / m_fps * AV_TIME_BASE), AV_TIME_BASE_Q, stream->time_base);
+    const qint64 frameDuration = qMax(qint64(1), av_rescale_q(std::llround(AV_TIME_BASE / m_fps), AV_TIME_BASE_Q, stream->time_base));
+
+    // Only keyframes are decoded when the exact frame is not needed
+    m_codec->skip_frame = exact ? AVDISCARD_DEFAULT : AVDISCARD_NONKEY;
+    const qint64 maxForward = av_rescale_q(maxForwardDecodeSeconds, AVRational{1, 1}, stream->time_base);
+    const bool continueForward =
+        exact && m_lastExact && m_lastPts != AV_NOPTS_VALUE && target > m_lastPts && target - m_lastPts <= maxForward && !m_draining;
+    m_lastExact = exact;
+    if (!continueForward && !seek(target)) {
+        return false;
+    }
+    for (int i = 0; i < maxDecodedFrames; ++i) {
+        if (!decodeNext()) {
+            return false;
+        }
+        const qint64 pts = m_frame->best_effort_timestamp;
+        m_lastPts = pts;
+        // The frame displayed at the target position, or the first frame after the seek if we are already past it
+        if (!exact || pts == AV_NOPTS_VALUE || pts + frameDuration > target) {
+            if (pts != AV_NOPTS_VALUE) {
+                m_lastFrame = int(std::llround(av_q2d(stream->time_base) * (pts - m_startTime) * m_fps));
+            } else if (exact) {
+                m_lastFrame = frame;
+            }
+            scaleInto(destination);
+            av_frame_unref(m_frame);
+            return true;
+        }
+        av_frame_unref(m_frame);
+    }
+    return false;
+}
+
+void ThumbnailExtractor::scaleInto(QImage &destination)
+{
+    destination.fill(Qt::black);
+    // Fit the picture in the destination, respecting its display aspect ratio
+    AVRational sar = m_frame->sample_aspect_ratio;
+    if (sar.num <= 0 || sar.den <= 0) {
+        sar = m_format->streams[m_streamIndex]->codecpar->sample_aspect_ratio;
+    }
+    const double pixelRatio = sar.num > 0 && sar.den > 0 ? av_q2d(sar) : 1.;
+    const double dar = m_frame->width * pixelRatio / m_frame->height;
+    int width = destination.width();
+    int height = destination.height();
+    if (dar > double(width) / height) {
+        height = qMax(1, int(std::lround(width / dar)));
+    } else {
+        width = qMax(1, int(std::lround(height * dar)));
+    }
+    m_scaler = sws_getCachedContext(m_scaler, m_frame->width, m_frame->height, AVPixelFormat(m_frame->format), width, height, AV_PIX_FMT_RGB32,
+                                    SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (m_scaler == nullptr) {
+        return;
+    }
+    // Convert with the colorimetry of the source like MLT does, guessing BT.709 for HD content when it is not specified
+    int colorspace = m_frame->colorspace;
+    if (colorspace == AVCOL_SPC_UNSPECIFIED || colorspace == AVCOL_SPC_RESERVED) {
+        // The decoded picture may be smaller than the source, see lowres
+        const AVCodecParameters *parameters = m_format->streams[m_streamIndex]->codecpar;
+        colorspace = parameters->width * parameters->height > 750000 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+    }
+    const AVPixelFormat format = AVPixelFormat(m_frame->format);
+    const bool fullRange = m_frame->color_range == AVCOL_RANGE_JPEG || format == AV_PIX_FMT_YUVJ420P || format == AV_PIX_FMT_YUVJ422P ||
+                           format == AV_PIX_FMT_YUVJ444P || format == AV_PIX_FMT_YUVJ440P || format == AV_PIX_FMT_YUVJ411P;
+    // Fails for RGB sources, which need no conversion details
+    sws_setColorspaceDetails(m_scaler, sws_getCoefficients(colorspace), fullRange ? 1 : 0, sws_getCoefficients(SWS_CS_DEFAULT), 1, 0, 1 << 16, 1 << 16);
+    // AV_PIX_FMT_RGB32 is native endian ARGB, the memory layout of QImage::Format_(A)RGB32
+    uint8_t *dst[4] = {destination.bits() + ((destination.height() - height) / 2) * destination.bytesPerLine() + ((destination.width() - width) / 2) * 4,
+                       nullptr, nullptr, nullptr};
+    const int dstStride[4] = {int(destination.bytesPerLine()), 0, 0, 0};
+    sws_scale(m_scaler, m_frame->data, m_frame->linesize, 0, m_frame->height, dst, dstStride);
+}
@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+/**
+ * @class ThumbnailExtractor
+ * @brief Decodes video thumbnails of a media file with libav, without going through MLT.
+ *
+ * When exact positions are not required, only the keyframes are decoded: each thumbnail snaps to the keyframe
+ * preceding the requested frame. Codecs supporting it decode at a reduced resolution, and the decoded picture is
+ * scaled once, directly into the destination image.
+ * Exact requests decode from the previous keyframe, continuing from the last decoded frame when moving forward.
+ */
+class ThumbnailExtractor
+{
+public:
+    /** @param streamIndex index of the video stream in the file, -1 to use the default video stream
+     *  @param fps frame rate used to convert frame numbers to timestamps
+     */
+    ThumbnailExtractor(const QString &path, int streamIndex, double fps);
+    ~ThumbnailExtractor();
+    ThumbnailExtractor(const ThumbnailExtractor &) = delete;
+    ThumbnailExtractor &operator=(const ThumbnailExtractor &) = delete;
+
+    bool isValid() const;
+    /** @brief Decodes a frame and scales it into destination, keeping its aspect ratio.
+     *  @param destination an ARGB32 or RGB32 image of the thumbnail size, its content is replaced
+     *  @param exact if false, the keyframe preceding frame is used
+     *  @return false if the frame could not be decoded, the MLT path should then be used
+     */
+    bool extract(int frame, bool exact, QImage &destination);
+    /** @brief The position of the picture returned by the last extract call, it differs from the requested frame when snapping to keyframes.
+     *  @return -1 if it is not known
+     */
+    int lastFrame() const;
+    /** @brief The number of pictures decoded so far, including the ones decoded to reach exact frames */
+    qint64 framesDecoded() const;
+    /** @brief The size of the packets read from the file so far */
+    qint64 bytesRead() const;
+
+private:
+    AVFormatContext *m_format{nullptr};
+    AVCodecContext *m_codec{nullptr};
+    AVPacket *m_packet{nullptr};
+    AVFrame *m_frame{nullptr};
+    SwsContext *m_scaler{nullptr};
+    int m_streamIndex{-1};
+    double m_fps;
+    qint64 m_startTime{0};
+    /** @brief Timestamp of the last decoded frame, to continue decoding forward without seeking */
+    qint64 m_lastPts;
+    int m_lastFrame{-1};
+    qint64 m_framesDecoded{0};
+    qint64 m_bytesRead{0};
+    bool m_lastExact{false};
+    bool m_draining{false};
+    bool m_valid{false};
+
+    /** @brief Receives the next decoded frame in m_frame */
+    bool decodeNext();
+    bool seek(qint64 timestamp);
+    void scaleInto(QImage &destination);
+};
@@ -17,6 +17,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "macros.hpp"
 #include "mainwindow.h"
 
+#include <QFileInfo>
 #include <QProcess>
 #include <QTemporaryFile>
 #include <QThread>
@@ -241,6 +242,9 @@ void TranscodeTask::run()
             QMetaObject::invokeMethod(pCore.get(), "displayBinLogMessage", Qt::QueuedConnection, Q_ARG(QString, i18n("Failed to create file.")),
                                       Q_ARG(int, int(KMessageWidget::Warning)), Q_ARG(QString, m_logDetails));
         } else {
+            if (binClip) {
+                addBytesRead(QFileInfo(binClip->url()).size());
+            }
             if (m_replaceProducer && binClip && binClip->clipType() != ClipType::Timeline) {
                 QMap<QString, QString> sourceProps;
                 QMap<QString, QString> newProps;
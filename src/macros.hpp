@@ -60,14 +60,8 @@ reading a Read-protected property. In that case, we try to write lock it first (
  * This should be used in the rare case where we don't need a lock mutex. In general, prefer the other version
  */
 #define UPDATE_UNDO_REDO_NOLOCK(operation, reverse, undo, redo)                                                                                                \
-    undo = [reverse, undo]() {                                                                                                                                 \
-        bool v = reverse();                                                                                                                                    \
-        return undo() && v;                                                                                                                                    \
-    };                                                                                                                                                         \
-    redo = [operation, redo]() {                                                                                                                               \
-        bool v = redo();                                                                                                                                       \
-        return operation() && v;                                                                                                                               \
-    };
+    OperationList::push(undo, reverse, OperationList::Kind::BeforeAlways);                                                                                     \
+    OperationList::push(redo, operation, OperationList::Kind::AfterAlways);
 /** @brief This macro takes as parameter one atomic operation and its reverse, and update
  *  the undo and redo functional stacks/queue accordingly
  *  It will also ensure that operation and reverse are dealing with mutexes
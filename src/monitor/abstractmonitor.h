@@ -7,6 +7,7 @@
 #pragma once
 
 #include "definitions.h"
+#include "scopes/colorscopes/scopeframe.h"
 
 #include <cstdint>
 
@@ -86,8 +87,10 @@ protected:
     MonitorManager *m_monitorManager;
 
 Q_SIGNALS:
-    /** @brief Send a frame for analysis or title background display. */
+    /** @brief Send a frame for title background display. Only emitted if connected, it may need an RGB conversion. */
     void frameUpdated(const QImage &);
+    /** @brief Send the displayed frame, in its native format, for analysis by the scopes. */
+    void scopeFrameUpdated(const ScopeFrame &);
     /** @brief This signal contains the audio of the current frame. */
     void audioSamplesSignal(const audioShortVector &, int, int, int);
     /** @brief Scopes are ready to receive a new frame. */
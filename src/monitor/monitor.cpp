@@ -63,6 +63,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QClipboard>
 #include <QDrag>
 #include <QFontDatabase>
+#include <QMetaMethod>
 #include <QMenu>
 #include <QMimeData>
 #include <QMouseEvent>
@@ -488,7 +489,7 @@ Monitor::Monitor(Kdenlive::MonitorId id, MonitorManager *manager, QWidget *paren
     setMinimumHeight(200);
 
     connect(this, &Monitor::scopesClear, m_glMonitor, &VideoWidget::releaseAnalyse, Qt::DirectConnection);
-    connect(m_glMonitor, &VideoWidget::analyseFrame, this, &Monitor::frameUpdated);
+    connect(m_glMonitor, &VideoWidget::analyseScopeFrame, this, &Monitor::slotAnalyseScopeFrame);
     m_timePos = new TimecodeDisplay(this);
     if (id == Kdenlive::ProjectMonitor) {
         connect(m_glMonitor->getControllerProxy(), &MonitorProxy::saveZone, this, &Monitor::zoneUpdated);
@@ -1339,7 +1340,7 @@ void Monitor::slotExtractCurrentFrame(QString frameName, bool addToProject, bool
                 existingProxies = pCore->currentDoc()->proxyClipsById(proxiedClips, false);
             }
         }
-        disconnect(m_glMonitor, &VideoWidget::analyseFrame, this, &Monitor::frameUpdated);
+        disconnect(m_glMonitor, &VideoWidget::analyseScopeFrame, this, &Monitor::slotAnalyseScopeFrame);
         bool analysisStatus = m_glMonitor->sendFrameForAnalysis;
         m_glMonitor->sendFrameForAnalysis = true;
         if (m_captureConnection) {
@@ -1364,7 +1365,7 @@ void Monitor::slotExtractCurrentFrame(QString frameName, bool addToProject, bool
                     pCore->currentDoc()->proxyClipsById(proxiedClips, true, existingProxies);
                 }
                 QObject::disconnect(m_captureConnection);
-                connect(m_glMonitor, &VideoWidget::analyseFrame, this, &Monitor::frameUpdated);
+                connect(m_glMonitor, &VideoWidget::analyseScopeFrame, this, &Monitor::slotAnalyseScopeFrame);
             });
         if (proxiedClips.isEmpty()) {
             // If there is a proxy, replacing it in timeline will trigger the monitor once replaced
@@ -1466,7 +1467,7 @@ void Monitor::slotExtractCurrentFrame(QString frameName, bool addToProject, bool
                     if (!proxiedClips.isEmpty()) {
                         existingProxies = pCore->currentDoc()->proxyClipsById(proxiedClips, false);
                     }
-                    disconnect(m_glMonitor, &VideoWidget::analyseFrame, this, &Monitor::frameUpdated);
+                    disconnect(m_glMonitor, &VideoWidget::analyseScopeFrame, this, &Monitor::slotAnalyseScopeFrame);
                     bool analysisStatus = m_glMonitor->sendFrameForAnalysis;
                     m_glMonitor->sendFrameForAnalysis = true;
                     if (m_captureConnection) {
@@ -1492,7 +1493,7 @@ void Monitor::slotExtractCurrentFrame(QString frameName, bool addToProject, bool
                                         pCore->currentDoc()->proxyClipsById(proxiedClips, true, existingProxies);
                                     }
                                     QObject::disconnect(m_captureConnection);
-                                    connect(m_glMonitor, &VideoWidget::analyseFrame, this, &Monitor::frameUpdated);
+                                    connect(m_glMonitor, &VideoWidget::analyseScopeFrame, this, &Monitor::slotAnalyseScopeFrame);
                                     KRecentDirs::add(QStringLiteral(":KdenliveFramesFolder"),
                                                      QUrl::fromLocalFile(selectedFile).adjusted(QUrl::RemoveFilename).toLocalFile());
                                     if (addToProject) {
@@ -2425,6 +2426,15 @@ void Monitor::onFrameDisplayed(const SharedFrame &frame)
     }
 }
 
+void Monitor::slotAnalyseScopeFrame(const ScopeFrame &frame)
+{
+    Q_EMIT scopeFrameUpdated(frame);
+    // Only convert the frame to RGB if someone needs it
+    if (isSignalConnected(QMetaMethod::fromSignal(&Monitor::frameUpdated))) {
+        Q_EMIT frameUpdated(frame.toImage());
+    }
+}
+
 void Monitor::checkDrops()
 {
     int dropped = m_glMonitor->droppedFrames();
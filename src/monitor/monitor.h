@@ -294,6 +294,8 @@ private Q_SLOTS:
     void slotEditMarker();
     void slotExtractCurrentZone();
     void onFrameDisplayed(const SharedFrame &frame);
+    /** @brief Forward a frame rendered for analysis to the scopes, and as an image to the title background if needed */
+    void slotAnalyseScopeFrame(const ScopeFrame &frame);
     void slotStartDrag();
     void setZoom(float zoomRatio);
     void slotAdjustEffectCompare();
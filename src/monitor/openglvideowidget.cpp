@@ -7,6 +7,8 @@
 #include "core.h"
 #include "profiles/profilemodel.hpp"
 
+#include <QMetaMethod>
+
 #if QT_CONFIG(opengles2)
 #include <QOpenGLFunctions_ES2>
 #else
@@ -282,29 +284,46 @@ void OpenGLVideoWidget::renderVideo()
     check_error(f);
 
     if (m_sendFrame && m_analyseSem.tryAcquire(1)) {
-        // Render RGB frame for analysis
-        if (!qFuzzyCompare(m_zoom, 1.0f)) {
-            // Disable monitor zoom to render frame
-            modelView = QMatrix4x4();
-            m_shader->setUniformValue(m_modelViewLocation, modelView);
+        // The scopes read CPU frames in their native format, no readback needed
+        m_mutex.lock();
+        const ScopeFrame scopeFrame(m_sharedFrame, m_colorSpace);
+        m_mutex.unlock();
+        if (scopeFrame.isValid()) {
+            Q_EMIT analyseScopeFrame(scopeFrame);
         }
-        if ((m_fbo == nullptr) || m_fbo->size() != m_profileSize) {
-            delete m_fbo;
-            QOpenGLFramebufferObjectFormat fmt;
-            fmt.setSamples(1);
-            m_fbo = new QOpenGLFramebufferObject(m_profileSize.width(), m_profileSize.height(), fmt); // GL_TEXTURE_2D);
+        const bool sendImage = isSignalConnected(QMetaMethod::fromSignal(&VideoWidget::analyseFrame));
+        if (!scopeFrame.isValid() || sendImage) {
+            // Render RGB frame for analysis
+            if (!qFuzzyCompare(m_zoom, 1.0f)) {
+                // Disable monitor zoom to render frame
+                modelView = QMatrix4x4();
+                m_shader->setUniformValue(m_modelViewLocation, modelView);
+            }
+            if ((m_fbo == nullptr) || m_fbo->size() != m_profileSize) {
+                delete m_fbo;
+                QOpenGLFramebufferObjectFormat fmt;
+                fmt.setSamples(1);
+                m_fbo = new QOpenGLFramebufferObject(m_profileSize.width(), m_profileSize.height(), fmt); // GL_TEXTURE_2D);
+            }
+            m_fbo->bind();
+            glViewport(0, 0, m_profileSize.width(), m_profileSize.height());
+
+            QMatrix4x4 projection2;
+            projection2.scale(2.0f / width, 2.0f / height);
+            m_shader->setUniformValue(m_projectionLocation, projection2);
+
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
+            check_error(f);
+            m_fbo->release();
+            const QImage image = m_fbo->toImage();
+            if (!scopeFrame.isValid()) {
+                // GPU frames are textures, the scopes get the rendered image
+                Q_EMIT analyseScopeFrame(ScopeFrame(image));
+            }
+            if (sendImage) {
+                Q_EMIT analyseFrame(image);
+            }
         }
-        m_fbo->bind();
-        glViewport(0, 0, m_profileSize.width(), m_profileSize.height());
-
-        QMatrix4x4 projection2;
-        projection2.scale(2.0f / width, 2.0f / height);
-        m_shader->setUniformValue(m_projectionLocation, projection2);
-
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
-        check_error(f);
-        m_fbo->release();
-        Q_EMIT analyseFrame(m_fbo->toImage());
         m_sendFrame = false;
     }
 
@@ -15,6 +15,7 @@
 #include "monitor/monitor.h"
 #include <QApplication>
 #include <QFontDatabase>
+#include <QMetaMethod>
 #include <QOpenGLContext>
 #if QT_CONFIG(opengles2)
 #include <QOpenGLFunctions_ES2>
@@ -102,6 +103,7 @@ VideoWidget::VideoWidget(int id, QObject *parent)
 #endif
     qRegisterMetaType<Mlt::Frame>("Mlt::Frame");
     qRegisterMetaType<SharedFrame>("SharedFrame");
+    qRegisterMetaType<ScopeFrame>("ScopeFrame");
     setAcceptDrops(true);
     setClearColor(KdenliveSettings::window_background());
 
@@ -166,8 +168,11 @@ void VideoWidget::renderVideo()
 {
 #if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
     if (m_sendFrame) {
-        QImage img = image();
-        Q_EMIT analyseFrame(img);
+        const ScopeFrame frame = scopeFrame();
+        Q_EMIT analyseScopeFrame(frame);
+        if (isSignalConnected(QMetaMethod::fromSignal(&VideoWidget::analyseFrame))) {
+            Q_EMIT analyseFrame(frame.toImage());
+        }
         m_sendFrame = false;
     }
 #endif
@@ -188,6 +193,11 @@ QImage VideoWidget::image() const
     return QImage();
 }
 
+ScopeFrame VideoWidget::scopeFrame() const
+{
+    return ScopeFrame(m_frameRenderer->getDisplayFrame(), m_colorSpace);
+}
+
 const QStringList VideoWidget::getGPUInfo()
 {
     return {};
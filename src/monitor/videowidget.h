@@ -21,6 +21,7 @@
 #include "bin/model/markerlistmodel.hpp"
 #include "definitions.h"
 #include "kdenlivesettings.h"
+#include "scopes/colorscopes/scopeframe.h"
 #include "scopes/sharedframe.h"
 
 #include <mlt++/MltEvent.h>
@@ -122,6 +123,8 @@ public:
     virtual const QStringList getGPUInfo();
     /** @brief Returns the current frame as image */
     QImage image() const;
+    /** @brief Returns a view on the current frame in its native format, for the scopes */
+    ScopeFrame scopeFrame() const;
 
 protected:
     void mouseReleaseEvent(QMouseEvent *event) override;
@@ -172,7 +175,10 @@ Q_SIGNALS:
     void switchFullScreen(bool minimizeOnly = false);
     void mouseSeek(int eventDelta, uint modifiers);
     void startDrag();
+    /** @brief The displayed frame as an image, only built if this signal is connected */
     void analyseFrame(const QImage &);
+    /** @brief The displayed frame without conversion, for the scopes */
+    void analyseScopeFrame(const ScopeFrame &);
     void showContextMenu(const QPoint &);
     void lockMonitor(bool);
     void passKeyEvent(QKeyEvent *);
@@ -14,6 +14,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "mainwindow.h"
 #include "projectsettings.h"
 #include "titler/titlewidget.h"
+#include "utils/multireplacer.h"
 #include "utils/qstringutils.h"
 #include "xml/xml.hpp"
 
@@ -1082,14 +1083,11 @@ QString ArchiveWidget::processMltFile(const QDomDocument &doc, const QString &de
 
     QString playList = doc.toString();
     if (isArchive) {
-        QString startString(QStringLiteral("\""));
-        startString.append(archive_url->url().adjusted(QUrl::StripTrailingSlash).toLocalFile());
-        QString endString(QStringLiteral("\""));
-        endString.append(basePath);
-        playList.replace(startString, endString);
-        startString = QLatin1Char('>') + archive_url->url().adjusted(QUrl::StripTrailingSlash).toLocalFile();
-        endString = QLatin1Char('>') + basePath;
-        playList.replace(startString, endString);
+        const QString archivePath = archive_url->url().adjusted(QUrl::StripTrailingSlash).toLocalFile();
+        QMap<QString, QString> replacements;
+        replacements.insert(QLatin1Char('"') + archivePath, QLatin1Char('"') + basePath);
+        replacements.insert(QLatin1Char('>') + archivePath, QLatin1Char('>') + basePath);
+        playList = MultiReplacer(replacements).apply(playList);
     }
     return playList;
 }
@@ -9,8 +9,10 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "bin/bin.h"
 #include "core.h"
 #include "doc/kdenlivedoc.h"
+#include "jobs/audiolevels/audiolevelscache.h"
 #include "kdenlivesettings.h"
 #include "mainwindow.h"
+#include "utils/thumbnailcache.hpp"
 
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -486,6 +488,8 @@ void TemporaryData::deleteAudio()
         return;
     }
     if (dir.dirName() == QLatin1String("audiothumbs")) {
+        // The audio levels are memory mapped, unmap them before deleting their files
+        AudioLevelsCache::releaseFolder(dir.absolutePath());
         dir.removeRecursively();
         dir.mkpath(QStringLiteral("."));
         updateDataInfo();
@@ -505,6 +509,8 @@ void TemporaryData::deleteThumbs()
         return;
     }
     if (dir.dirName() == QLatin1String("videothumbs")) {
+        // The thumbnail packs are memory mapped, close them before deleting their files
+        ThumbnailCache::get()->discardPersistentCache();
         dir.removeRecursively();
         dir.mkpath(QStringLiteral("."));
         updateDataInfo();
@@ -526,6 +532,8 @@ void TemporaryData::deleteCurrentCacheData(bool warn)
     if (dir.dirName() == m_doc->getDocumentProperty(QStringLiteral("documentid"))) {
         Q_EMIT disablePreview();
         Q_EMIT disableProxies();
+        ThumbnailCache::get()->discardPersistentCache();
+        AudioLevelsCache::releaseFolder(dir.absolutePath());
         dir.removeRecursively();
         m_doc->initCacheDirs();
         if (warn) {
@@ -22,6 +22,8 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include "project/dialogs/noteswidget.h"
 #include "project/dialogs/projectsettings.h"
 #include "timeline2/model/timelinefunctions.hpp"
+#include "utils/filehashcache.hpp"
+#include "utils/multireplacer.h"
 #include "utils/qstringutils.h"
 #include "utils/thumbnailcache.hpp"
 #include "xml/xml.hpp"
@@ -487,6 +489,8 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
         qDebug() << ":::::CLOSING PROJECT, DISCARDING TASKS...";
         pCore->taskManager.slotCancelJobs(true);
         qDebug() << ":::::CLOSING PROJECT, DISCARDING TASKS...DONE";
+        FileHashCache::get()->cancelPrefetch();
+        FileHashCache::get()->save();
         if (m_activeTimelineModel) {
             m_activeTimelineModel->m_closing = true;
         }
@@ -530,6 +534,7 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveOverExis
     // Disable autosave while saving
     m_autoSaveTimer.stop();
     m_autoSaveChangeCount = 0;
+    m_project->waitForAutoSave();
     pCore->monitorManager()->pauseActiveMonitor();
     QString oldProjectFolder =
         m_project->url().isEmpty() ? QString() : QFileInfo(m_project->url().toLocalFile()).absolutePath() + QStringLiteral("/cachefiles");
@@ -551,11 +556,7 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveOverExis
     checkProjectIntegrity();
     QString scene = projectSceneList(saveFolder).first;
     if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
-        while (i.hasNext()) {
-            i.next();
-            scene.replace(i.key(), i.value());
-        }
+        scene = MultiReplacer(m_replacementPattern).apply(scene);
     }
     m_project->updateWorkFilesAfterSave();
     if (!m_project->saveSceneList(outputFileName, scene, saveOverExistingFile)) {
@@ -573,6 +574,7 @@ bool ProjectManager::saveFileAs(const QString &outputFileName, bool saveOverExis
         p.second.erase(last, p.second.end());
     }
     ThumbnailCache::get()->saveCachedThumbs(thumbKeys);
+    FileHashCache::get()->save();
     if (!saveACopy) {
         m_project->setUrl(url);
         // setting up autosave file in ~/.kde/data/stalefiles/kdenlive/
@@ -1236,26 +1238,44 @@ void ProjectManager::slotAutoSave()
     m_lastSave.invalidate();
     prepareSave();
     QString saveFolder = m_project->url().adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile();
-    QString scene = projectSceneList(saveFolder).first;
-    if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
-        while (i.hasNext()) {
-            i.next();
-            scene.replace(i.key(), i.value());
-        }
-    }
-    if (!scene.contains(QLatin1String("<track "))) {
-        // In some unexplained cases, the MLT playlist is corrupted and all tracks are deleted. Don't save in that case.
-        pCore->displayMessage(i18n("Project was corrupted, cannot backup. Please close and reopen your project file to recover last backup"), ErrorMessage);
-        return;
-    }
-    m_project->slotAutoSave(scene);
+    // Only the MLT serialization needs the GUI thread, the replacement patterns and the write are processed in the background
+    m_project->slotAutoSave(projectSceneData(saveFolder), m_replacementPattern);
     m_autoSaveChangeCount = 0;
     m_lastSave.start();
 }
 
 std::pair<QString, QString> ProjectManager::projectSceneList(const QString &outputFolder, bool timelineProducerOnly, const QString &overlayData,
                                                              const QString &aspectRatio)
+{
+    std::pair<QString, QString> scene;
+    serializeProject([&](int duration) {
+        if (timelineProducerOnly) {
+            // Ensure the producer has the correct duration
+            m_activeTimelineModel->limitBlackTrack(true);
+        }
+        scene = pCore->projectItemModel()->sceneList(outputFolder, overlayData, m_activeTimelineModel->tractor(), duration, timelineProducerOnly, aspectRatio);
+        if (timelineProducerOnly) {
+            // Restore the producer's duration (with seeking offset)
+            m_activeTimelineModel->limitBlackTrack(false);
+        }
+    });
+    return scene;
+}
+
+const QMap<QString, QString> &ProjectManager::replacementPatterns() const
+{
+    return m_replacementPattern;
+}
+
+QByteArray ProjectManager::projectSceneData(const QString &outputFolder)
+{
+    QByteArray scene;
+    serializeProject(
+        [&](int duration) { scene = pCore->projectItemModel()->sceneListData(outputFolder, m_activeTimelineModel->tractor(), duration); });
+    return scene;
+}
+
+void ProjectManager::serializeProject(const std::function<void(int)> &serialize)
 {
     // Disable multitrack view and overlay
     bool isMultiTrack = pCore->monitorManager() && pCore->monitorManager()->isMultiTrack();
@@ -1276,16 +1296,7 @@ std::pair<QString, QString> ProjectManager::projectSceneList(const QString &outp
 
     // We must save from the primary timeline model
     int duration = pCore->window() ? pCore->window()->getCurrentTimeline()->controller()->duration() : m_activeTimelineModel->duration();
-    if (timelineProducerOnly) {
-        // Ensure the producer has the correct duration
-        m_activeTimelineModel->limitBlackTrack(true);
-    }
-    std::pair<QString, QString> scene =
-        pCore->projectItemModel()->sceneList(outputFolder, overlayData, m_activeTimelineModel->tractor(), duration, timelineProducerOnly, aspectRatio);
-    if (timelineProducerOnly) {
-        // Restore the producer's duration (with seeking offset)
-        m_activeTimelineModel->limitBlackTrack(false);
-    }
+    serialize(duration);
     if (pCore->mixer()) {
         pCore->mixer()->pauseMonitoring(false);
     }
@@ -1298,7 +1309,6 @@ std::pair<QString, QString> ProjectManager::projectSceneList(const QString &outp
     if (isTrimming) {
         pCore->window()->getCurrentTimeline()->controller()->requestStartTrimmingMode();
     }
-    return scene;
 }
 
 void ProjectManager::setDocumentNotes(QString &notes, QStringList deprecatedBinIds)
@@ -1794,11 +1804,7 @@ void ProjectManager::saveWithUpdatedProfile(const QString &updatedProfile)
         prepareSave();
         QString scene = projectSceneList(saveFolder).first;
         if (!m_replacementPattern.isEmpty()) {
-            QMapIterator<QString, QString> i(m_replacementPattern);
-            while (i.hasNext()) {
-                i.next();
-                scene.replace(i.key(), i.value());
-            }
+            scene = MultiReplacer(m_replacementPattern).apply(scene);
         }
         tmpFile.write(scene.toUtf8());
         if (tmpFile.error() != QFile::NoError) {
@@ -16,6 +16,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "timeline2/model/timelineitemmodel.hpp"
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -73,6 +74,8 @@ public:
      */
     std::pair<QString, QString> projectSceneList(const QString &outputFolder, bool timelineProducerOnly = false, const QString &overlayData = QString(),
                                                  const QString &aspectRation = QString());
+    /** @brief The path rewrites applied to the scene list when saving, while the project folder is being moved */
+    const QMap<QString, QString> &replacementPatterns() const;
     /** @brief returns a default hd profile depending on timezone*/
     static QString getDefaultProjectFormat();
     void saveZone(const QStringList &info, const QDir &dir);
@@ -273,6 +276,11 @@ private:
     bool checkForBackupFile(const QUrl &url, bool newFile = false);
     /** @brief Update the sequence producer stored in the project model. */
     void updateSequenceProducer(const QUuid &uuid, std::shared_ptr<Mlt::Producer> prod);
+    /** @brief Run a serialization of the project with the temporary timeline views (multitrack, preview, trimming) disabled.
+     *  @param serialize called with the timeline duration */
+    void serializeProject(const std::function<void(int)> &serialize);
+    /** @brief Returns the project scene list as UTF-8, without the conversions done by projectSceneList() */
+    QByteArray projectSceneData(const QString &outputFolder);
 
     std::shared_ptr<TimelineItemModel> m_activeTimelineModel;
     QElapsedTimer m_lastSave;
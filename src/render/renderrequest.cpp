@@ -10,6 +10,7 @@
 #include "kdenlivesettings.h"
 #include "project/projectmanager.h"
 #include "renderpresets/renderpresetrepository.hpp"
+#include "utils/multireplacer.h"
 #include "utils/qstringutils.h"
 #include "xml/xml.hpp"
 
@@ -161,7 +162,8 @@ std::vector<RenderRequest::RenderJob> RenderRequest::process()
         }
         file.close();
     } else {
-        doc.setContent(playlistContent.first);
+        const QMap<QString, QString> &replacements = pCore->projectManager()->replacementPatterns();
+        doc.setContent(replacements.isEmpty() ? playlistContent.first : MultiReplacer(replacements).apply(playlistContent.first));
     }
 
     if (m_delayedRendering) {
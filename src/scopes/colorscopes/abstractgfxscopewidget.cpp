@@ -23,10 +23,34 @@ AbstractGfxScopeWidget::AbstractGfxScopeWidget(bool trackMouse, QWidget *parent)
 
 AbstractGfxScopeWidget::~AbstractGfxScopeWidget() = default;
 
+ScopeAnalysis::Request AbstractGfxScopeWidget::currentAnalysisRequest()
+{
+    return analysisRequest(uint(m_accelFactorScope));
+}
+
 QImage AbstractGfxScopeWidget::renderScope(uint accelerationFactor)
 {
-    QMutexLocker lock(&m_mutex);
-    return renderGfxScope(accelerationFactor, m_scopeImage);
+    std::shared_ptr<ScopeAnalysis> analysis;
+    {
+        QMutexLocker lock(&m_mutex);
+        analysis = m_analysis;
+    }
+    if (!analysis) {
+        return QImage();
+    }
+    const ScopeAnalysis::Request request = analysisRequest(accelerationFactor);
+    if (!analysis->request().covers(request)) {
+        // The scope was resized or its settings changed since the frame was distributed, read the frame again for this scope only
+        const std::shared_ptr<ScopeAnalysis> previous = analysis;
+        analysis = std::make_shared<ScopeAnalysis>(previous->frame(), request);
+        QMutexLocker lock(&m_mutex);
+        if (m_analysis == previous) {
+            m_analysis = analysis;
+        }
+    }
+    // Does nothing if another scope already read the frame
+    analysis->run();
+    return renderGfxScope(accelerationFactor, *analysis);
 }
 
 void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
@@ -37,10 +61,12 @@ void AbstractGfxScopeWidget::mouseReleaseEvent(QMouseEvent *event)
 
 ///// Slots /////
 
-void AbstractGfxScopeWidget::slotRenderZoneUpdated(const QImage &frame)
+void AbstractGfxScopeWidget::slotRenderZoneUpdated(const std::shared_ptr<ScopeAnalysis> &analysis)
 {
-    QMutexLocker lock(&m_mutex);
-    m_scopeImage = frame;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_analysis = analysis;
+    }
     AbstractScopeWidget::slotRenderZoneUpdated();
 }
 
@@ -11,6 +11,9 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #include <QWidget>
 
 #include "../abstractscopewidget.h"
+#include "scopeanalysis.h"
+
+#include <memory>
 
 /**
 * @brief Abstract class for scopes analyzing image frames.
@@ -23,27 +26,35 @@ public:
     explicit AbstractGfxScopeWidget(bool trackMouse = false, QWidget *parent = nullptr);
     ~AbstractGfxScopeWidget() override; // Must be virtual because of inheritance, to avoid memory leaks
 
+    /** @brief What the scope needs to read from the next frame, with its current acceleration factor */
+    ScopeAnalysis::Request currentAnalysisRequest();
+
 protected:
     ///// Variables /////
 
+    /** @brief Describes what the scope needs to read from a frame. The frame is read once for all
+     *  scopes, with the merged requests, and renderGfxScope() receives the result. */
+    virtual ScopeAnalysis::Request analysisRequest(uint accelerationFactor) = 0;
     /** @brief Scope renderer. Must emit signalScopeRenderingFinished()
      *  when calculation has finished, to allow multi-threading.
-     *  accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible. */
-    virtual QImage renderGfxScope(uint accelerationFactor, const QImage &) = 0;
+     *  accelerationFactor hints how much faster than usual the calculation should be accomplished, if possible.
+     *  The analysis covers the request returned by analysisRequest(). */
+    virtual QImage renderGfxScope(uint accelerationFactor, const ScopeAnalysis &analysis) = 0;
 
     QImage renderScope(uint accelerationFactor) override;
 
     void mouseReleaseEvent(QMouseEvent *) override;
 
 private:
-    QImage m_scopeImage;
+    std::shared_ptr<ScopeAnalysis> m_analysis;
     QMutex m_mutex;
 
 public Q_SLOTS:
     /** @brief Must be called when the active monitor has shown a new frame.
+     * The analysis is shared with the other scopes receiving the frame.
      * This slot must be connected in the implementing class, it is *not*
      * done in this abstract class. */
-    void slotRenderZoneUpdated(const QImage &);
+    void slotRenderZoneUpdated(const std::shared_ptr<ScopeAnalysis> &analysis);
 
 protected Q_SLOTS:
     virtual void slotAutoRefreshToggled(bool autoRefresh);
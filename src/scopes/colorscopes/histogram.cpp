@@ -131,20 +131,29 @@ QImage Histogram::renderHUD(uint)
     Q_EMIT signalHUDRenderingFinished(0, 1);
     return QImage();
 }
-QImage Histogram::renderGfxScope(uint accelFactor, const QImage &qimage)
+int Histogram::componentFlags() const
 {
-    QElapsedTimer timer;
-    timer.start();
-    const int componentFlags =
-        (m_ui->cbY->isChecked() ? 1 : 0) * HistogramGenerator::ComponentY | (m_ui->cbS->isChecked() ? 1 : 0) * HistogramGenerator::ComponentSum |
-        (m_ui->cbR->isChecked() ? 1 : 0) * HistogramGenerator::ComponentR | (m_ui->cbG->isChecked() ? 1 : 0) * HistogramGenerator::ComponentG |
-        (m_ui->cbB->isChecked() ? 1 : 0) * HistogramGenerator::ComponentB;
+    return (m_ui->cbY->isChecked() ? 1 : 0) * HistogramGenerator::ComponentY | (m_ui->cbS->isChecked() ? 1 : 0) * HistogramGenerator::ComponentSum |
+           (m_ui->cbR->isChecked() ? 1 : 0) * HistogramGenerator::ComponentR | (m_ui->cbG->isChecked() ? 1 : 0) * HistogramGenerator::ComponentG |
+           (m_ui->cbB->isChecked() ? 1 : 0) * HistogramGenerator::ComponentB;
+}
 
+ScopeAnalysis::Request Histogram::analysisRequest(uint accelerationFactor)
+{
     ITURec rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
+    ScopeAnalysis::Request request;
+    HistogramGenerator::addToRequest(request, componentFlags(), rec, accelerationFactor);
+    return request;
+}
+
+QImage Histogram::renderGfxScope(uint accelFactor, const ScopeAnalysis &analysis)
+{
+    QElapsedTimer timer;
+    timer.start();
 
     qreal scalingFactor = devicePixelRatioF();
-    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), scalingFactor, qimage, componentFlags, rec, m_aUnscaled->isChecked(),
-                                                                m_ui->rbLogarithmic->isChecked(), accelFactor, palette());
+    QImage histogram = m_histogramGenerator->calculateHistogram(m_scopeRect.size(), scalingFactor, analysis, componentFlags(), m_aUnscaled->isChecked(),
+                                                                m_ui->rbLogarithmic->isChecked(), palette());
 
     Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelFactor);
     return histogram;
@@ -40,7 +40,10 @@ private:
     bool isScopeDependingOnInput() const override;
     bool isBackgroundDependingOnInput() const override;
     QImage renderHUD(uint accelerationFactor) override;
-    QImage renderGfxScope(uint accelerationFactor, const QImage &) override;
+    ScopeAnalysis::Request analysisRequest(uint accelerationFactor) override;
+    QImage renderGfxScope(uint accelerationFactor, const ScopeAnalysis &analysis) override;
+    /** @brief OR-ed HistogramGenerator::Components flags of the components to draw */
+    int componentFlags() const;
     QImage renderBackground(uint accelerationFactor) override;
     Ui::Histogram_UI *m_ui;
 };
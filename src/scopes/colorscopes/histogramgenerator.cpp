@@ -6,6 +6,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "histogramgenerator.h"
+#include "scopeframe.h"
 
 #include "klocalizedstring.h"
 #include <QDebug>
@@ -19,7 +20,36 @@ HistogramGenerator::HistogramGenerator() = default;
 QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, qreal scalingFactor, const QImage &image, const int &components, ITURec rec,
                                               bool unscaled, bool logScale, uint accelFactor, const QPalette &palette) const
 {
-    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    return calculateHistogram(paradeSize, scalingFactor, ScopeFrame(image), components, rec, unscaled, logScale, accelFactor, palette);
+}
+
+QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, qreal scalingFactor, const ScopeFrame &frame, const int &components, ITURec rec,
+                                              bool unscaled, bool logScale, uint accelFactor, const QPalette &palette) const
+{
+    ScopeAnalysis::Request request;
+    addToRequest(request, components, rec, accelFactor);
+    ScopeAnalysis analysis(frame, request);
+    analysis.run();
+    return calculateHistogram(paradeSize, scalingFactor, analysis, components, unscaled, logScale, palette);
+}
+
+void HistogramGenerator::addToRequest(ScopeAnalysis::Request &request, const int &components, ITURec rec, uint accelFactor)
+{
+    ScopeAnalysis::Request histogram;
+    // Y'CbCr frames are only converted to RGB if an RGB component is drawn
+    histogram.lumaHistogram = (components & HistogramGenerator::ComponentY) != 0;
+    histogram.histogramRec = rec;
+    histogram.rgbHistogram = (components & (HistogramGenerator::ComponentR | HistogramGenerator::ComponentG | HistogramGenerator::ComponentB |
+                                            HistogramGenerator::ComponentSum)) != 0;
+    histogram.accelFactor = accelFactor;
+    request.merge(histogram);
+}
+
+QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, qreal scalingFactor, const ScopeAnalysis &analysis, const int &components,
+                                              bool unscaled, bool logScale, const QPalette &palette) const
+{
+    const ScopeFrame &frame = analysis.frame();
+    if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || frame.width() <= 0 || frame.height() <= 0 || !analysis.isValid()) {
         return QImage();
     }
 
@@ -28,42 +58,25 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, qreal sca
     bool drawG = (components & HistogramGenerator::ComponentG) != 0;
     bool drawB = (components & HistogramGenerator::ComponentB) != 0;
     bool drawSum = (components & HistogramGenerator::ComponentSum) != 0;
+    if ((drawY && !analysis.request().lumaHistogram) || ((drawR || drawG || drawB || drawSum) && !analysis.request().rgbHistogram)) {
+        return QImage();
+    }
 
-    int r[256], g[256], b[256], y[256], s[766];
-    // Initialize the values to zero
-    std::fill(r, r + 256, 0);
-    std::fill(g, g + 256, 0);
-    std::fill(b, b + 256, 0);
-    std::fill(y, y + 256, 0);
+    const ScopeAnalysis::Bins &bins = analysis.bins();
+    const int *r = bins.red.data();
+    const int *g = bins.green.data();
+    const int *b = bins.blue.data();
+    const int *y = bins.luma.data();
+    int s[766];
     std::fill(s, s + 766, 0);
 
     const int ww = paradeSize.width();
     const int wh = paradeSize.height();
 
-    // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += accelFactor) {
-
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-
-            if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == ITURec::Rec_601) {
-                    y[int(REC_601_R * qRed(col) + REC_601_G * qGreen(col) + REC_601_B * qBlue(col))]++;
-                } else {
-                    y[int(REC_709_R * qRed(col) + REC_709_G * qGreen(col) + REC_709_B * qBlue(col))]++;
-                }
-            }
-
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
-            }
+    if (drawSum) {
+        // The sum histogram holds the samples of all three components
+        for (int i = 0; i < 256; ++i) {
+            s[i] = r[i] + g[i] + b[i];
         }
     }
 
@@ -79,8 +92,8 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, qreal sca
     // Height of a single histogram box without text
     const int partH = (wh - nParts * d) / nParts;
 
-    // Total number of bytes of the image
-    const int byteCount = int(image.sizeInBytes());
+    // Total number of bytes of the frame as a 32 bit image
+    const int byteCount = 4 * frame.width() * frame.height();
 
     // Factor for scaling the measured value to the histogram.
     // This factor is used for linear scaling and does not depend
@@ -8,6 +8,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #pragma once
 
 #include "colorconstants.h"
+#include "scopeanalysis.h"
 #include <QObject>
 #include <QPalette>
 
@@ -16,6 +17,7 @@ class QImage;
 class QPainter;
 class QRect;
 class QSize;
+class ScopeFrame;
 
 class HistogramGenerator : public QObject
 {
@@ -37,6 +39,14 @@ public:
      */
     QImage calculateHistogram(const QSize &paradeSize, qreal scalingFactor, const QImage &image, const int &components, const ITURec rec, bool unscaled,
                               bool logScale, uint accelFactor = 1, const QPalette &palette = QPalette()) const;
+    /** @brief Same as above, Y'CbCr frames are only converted to RGB if an RGB component is drawn */
+    QImage calculateHistogram(const QSize &paradeSize, qreal scalingFactor, const ScopeFrame &frame, const int &components, const ITURec rec, bool unscaled,
+                              bool logScale, uint accelFactor = 1, const QPalette &palette = QPalette()) const;
+    /** @brief Same as above, from the bins of an analysis that was run with the request of addToRequest() */
+    QImage calculateHistogram(const QSize &paradeSize, qreal scalingFactor, const ScopeAnalysis &analysis, const int &components, bool unscaled, bool logScale,
+                              const QPalette &palette = QPalette()) const;
+    /** @brief Adds what calculateHistogram() needs to an analysis request */
+    static void addToRequest(ScopeAnalysis::Request &request, const int &components, const ITURec rec, uint accelFactor);
 
     /**
      * Draws the histogram of a single component.
@@ -173,14 +173,21 @@ QImage RGBParade::renderHUD(uint)
     return hud;
 }
 
-QImage RGBParade::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+ScopeAnalysis::Request RGBParade::analysisRequest(uint accelerationFactor)
+{
+    ScopeAnalysis::Request request;
+    RGBParadeGenerator::addToRequest(request, m_scopeRect.size(), accelerationFactor);
+    return request;
+}
+
+QImage RGBParade::renderGfxScope(uint accelerationFactor, const ScopeAnalysis &analysis)
 {
     QElapsedTimer timer;
     timer.start();
 
     int paintmode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
-    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), devicePixelRatioF(), qimage, RGBParadeGenerator::PaintMode(paintmode),
-                                                             m_aAxis->isChecked(), m_aGradRef->isChecked(), accelerationFactor, palette());
+    QImage parade = m_rgbParadeGenerator->calculateRGBParade(m_scopeRect.size(), devicePixelRatioF(), analysis, RGBParadeGenerator::PaintMode(paintmode),
+                                                             m_aAxis->isChecked(), m_aGradRef->isChecked(), palette());
     Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelerationFactor);
     return parade;
 }
@@ -42,6 +42,7 @@ private:
     bool isBackgroundDependingOnInput() const override;
 
     QImage renderHUD(uint accelerationFactor) override;
-    QImage renderGfxScope(uint accelerationFactor, const QImage &) override;
+    ScopeAnalysis::Request analysisRequest(uint accelerationFactor) override;
+    QImage renderGfxScope(uint accelerationFactor, const ScopeAnalysis &analysis) override;
     QImage renderBackground(uint accelerationFactor) override;
 };
@@ -7,9 +7,11 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #include "rgbparadegenerator.h"
 #include "klocalizedstring.h"
+#include "scopeframe.h"
 #include <QColor>
 #include <QDebug>
 #include <QPainter>
+#include <algorithm>
 
 #define CHOP255(a) ((255) < (a) ? (255) : int(a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -18,21 +20,52 @@ const uchar RGBParadeGenerator::distRight(31);
 const uchar RGBParadeGenerator::distBottom(40);
 const uchar RGBParadeGenerator::distBorder(2);
 
-struct StructRGB
-{
-    uint r;
-    uint g;
-    uint b;
-};
-
 RGBParadeGenerator::RGBParadeGenerator() = default;
 
+namespace {
+// Space between the components of the parade
+constexpr uchar offset = 8;
+} // namespace
+
 QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, qreal scalingFactor, const QImage &image, const RGBParadeGenerator::PaintMode paintMode,
                                               bool drawAxis, bool drawGradientRef, uint accelFactor, const QPalette &palette)
+{
+    return calculateRGBParade(paradeSize, scalingFactor, ScopeFrame(image), paintMode, drawAxis, drawGradientRef, accelFactor, palette);
+}
+
+QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, qreal scalingFactor, const ScopeFrame &frame,
+                                              const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef, uint accelFactor,
+                                              const QPalette &palette)
 {
     Q_ASSERT(accelFactor >= 1);
+    ScopeAnalysis::Request request;
+    addToRequest(request, paradeSize, accelFactor);
+    ScopeAnalysis analysis(frame, request);
+    analysis.run();
+    return calculateRGBParade(paradeSize, scalingFactor, analysis, paintMode, drawAxis, drawGradientRef, palette);
+}
 
-    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+int RGBParadeGenerator::partWidth(const QSize &paradeSize)
+{
+    return (paradeSize.width() - 2 * offset - distRight - 2 * distBorder) / 3;
+}
+
+void RGBParadeGenerator::addToRequest(ScopeAnalysis::Request &request, const QSize &paradeSize, uint accelFactor)
+{
+    ScopeAnalysis::Request parade;
+    if (paradeSize.height() > 0) {
+        parade.paradeColumns = std::max(0, partWidth(paradeSize));
+    }
+    parade.accelFactor = accelFactor;
+    request.merge(parade);
+}
+
+QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, qreal scalingFactor, const ScopeAnalysis &analysis,
+                                              const RGBParadeGenerator::PaintMode paintMode, bool drawAxis, bool drawGradientRef, const QPalette &palette)
+{
+    const ScopeFrame &frame = analysis.frame();
+    if (paradeSize.width() <= 0 || paradeSize.height() <= 0 || frame.width() <= 0 || frame.height() <= 0 || !analysis.isValid() ||
+        partWidth(paradeSize) <= 0 || analysis.request().paradeColumns != partWidth(paradeSize)) {
         return QImage();
     }
     QImage parade(paradeSize * scalingFactor, QImage::Format_ARGB32);
@@ -48,62 +81,28 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, qreal sca
 
     const uint ww = uint(paradeSize.width());
     const uint wh = uint(paradeSize.height());
-    const uint iw = uint(image.width());
-    const uint ih = uint(image.height());
+    const uint iw = uint(frame.width());
+    const uint ih = uint(frame.height());
 
-    const uchar offset = 8;
-    const uint partW = (ww - 2 * offset - distRight - 2 * distBorder) / 3;
+    const uint partW = uint(partWidth(paradeSize));
     const uint partH = wh - distBottom - 2 * distBorder;
 
     // Statistics
-    uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0;
+    const ScopeAnalysis::Bins &analysisBins = analysis.bins();
+    const uchar minR = analysisBins.paradeMin[0], minG = analysisBins.paradeMin[1], minB = analysisBins.paradeMin[2];
+    const uchar maxR = analysisBins.paradeMax[0], maxG = analysisBins.paradeMax[1], maxB = analysisBins.paradeMax[2];
 
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = float((iw * ih) / accelFactor) / (partW * 255);
+    const float pixelDepth = float((iw * ih) / uint(analysis.step())) / (partW * 255);
     const float gain = 255 / (8 * pixelDepth);
     //        qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
     QImage unscaled(int(ww) - distRight, 256, QImage::Format_ARGB32);
     unscaled.fill(qRgba(0, 0, 0, 0));
 
-    const float wPrediv = float(partW - 1) / (iw - 1);
-
-    std::vector<std::vector<StructRGB>> paradeVals(partW, std::vector<StructRGB>(256, {0, 0, 0}));
-
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const auto x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-        auto r = uchar(qRed(pixel));
-        auto g = uchar(qGreen(pixel));
-        auto b = uchar(qBlue(pixel));
-
-        double dx = x * double(wPrediv);
-
-        paradeVals[size_t(dx)][r].r++;
-        paradeVals[size_t(dx)][g].g++;
-        paradeVals[size_t(dx)][b].b++;
-
-        if (r < minR) {
-            minR = r;
-        }
-        if (g < minG) {
-            minG = g;
-        }
-        if (b < minB) {
-            minB = b;
-        }
-        if (r > maxR) {
-            maxR = r;
-        }
-        if (g > maxG) {
-            maxG = g;
-        }
-        if (b > maxB) {
-            maxB = b;
-        }
-    }
+    // Bins are stored row by row (one row per value) with the r, g and b counts of each column
+    const uint *bins = analysisBins.parade.data();
 
     const int offset1 = int(partW + offset);
     const int offset2 = int(2 * partW + 2 * offset);
@@ -120,32 +119,25 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, qreal sca
     davinci.fillRect(QRect(offset1 + distBorder, distBorder, partW, partH), darkParadeBackground);
     davinci.fillRect(QRect(offset2 + distBorder, distBorder, partW, partH), darkParadeBackground);
 
-    switch (paintMode) {
-    case PaintMode_RGB:
-        for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
-        }
-        break;
-    default:
+    const QRgb colorR = paintMode == PaintMode_RGB ? qRgb(255, 10, 10) : qRgb(255, 255, 255);
+    const QRgb colorG = paintMode == PaintMode_RGB ? qRgb(10, 255, 10) : qRgb(255, 255, 255);
+    const QRgb colorB = paintMode == PaintMode_RGB ? qRgb(10, 10, 255) : qRgb(255, 255, 255);
+    const auto withAlpha = [gain](QRgb color, uint count) { return (color & RGB_MASK) | (uint(CHOP255(gain * float(count))) << 24); };
+    // Higher values are at the top
+    for (int j = 0; j < 256; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(unscaled.scanLine(255 - j));
+        const uint *row = bins + size_t(j) * partW * 3;
         for (int i = 0; i < int(partW); ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].r))));
-                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].g))));
-                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * float(paradeVals[size_t(i)][size_t(j)].b))));
-            }
+            line[i] = withAlpha(colorR, row[3 * i]);
+            line[i + offset1] = withAlpha(colorG, row[3 * i + 1]);
+            line[i + offset2] = withAlpha(colorB, row[3 * i + 2]);
         }
-        break;
     }
 
     // Scale the image to the target height. Scaling is not accomplished before because
     // there are only 255 different values which would lead to gaps if the height is not exactly 255.
     // Don't use bilinear transformation because the fast transformation meets the goal better.
-    davinci.drawImage(distBorder, distBorder,
-                      unscaled.mirrored(false, true).scaled(unscaled.width(), int(partH), Qt::IgnoreAspectRatio, Qt::FastTransformation));
+    davinci.drawImage(distBorder, distBorder, unscaled.scaled(unscaled.width(), int(partH), Qt::IgnoreAspectRatio, Qt::FastTransformation));
 
     if (drawAxis) {
         davinci.setPen(QPen(QColor(150, 255, 200, 32), 1));
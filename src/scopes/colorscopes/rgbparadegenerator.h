@@ -7,12 +7,14 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #pragma once
 
+#include "scopeanalysis.h"
 #include <QObject>
 #include <QPalette>
 
 class QColor;
 class QImage;
 class QSize;
+class ScopeFrame;
 class RGBParadeGenerator : public QObject
 {
     Q_OBJECT
@@ -22,8 +24,19 @@ public:
     RGBParadeGenerator();
     QImage calculateRGBParade(const QSize &paradeSize, qreal scalingFactor, const QImage &image, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
                               bool drawGradientRef, uint accelFactor = 1, const QPalette &palette = QPalette());
+    QImage calculateRGBParade(const QSize &paradeSize, qreal scalingFactor, const ScopeFrame &frame, const RGBParadeGenerator::PaintMode paintMode,
+                              bool drawAxis, bool drawGradientRef, uint accelFactor = 1, const QPalette &palette = QPalette());
+    /** @brief Same as above, from the bins of an analysis that was run with the request of addToRequest() */
+    QImage calculateRGBParade(const QSize &paradeSize, qreal scalingFactor, const ScopeAnalysis &analysis, const RGBParadeGenerator::PaintMode paintMode,
+                              bool drawAxis, bool drawGradientRef, const QPalette &palette = QPalette());
+    /** @brief Adds what calculateRGBParade() needs to an analysis request */
+    static void addToRequest(ScopeAnalysis::Request &request, const QSize &paradeSize, uint accelFactor);
 
     static const uchar distRight;
     static const uchar distBottom;
     static const uchar distBorder;
+
+private:
+    /** @brief Width of each component of the parade */
+    static int partWidth(const QSize &paradeSize);
 };
@@ -0,0 +1,349 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopeanalysis.h"
+#include "scopekernels.h"
+#include "vectorscopegenerator.h"
+
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <memory>
+
+namespace {
+// Smallest number of rows read by a thread, smaller bands are not worth the merge
+constexpr int minTileRows = 32;
+
+struct Tile
+{
+    int firstRow;
+    int lastRow;
+    ScopeAnalysis::Bins *bins;
+};
+
+void addCounts(std::vector<uint> &target, const std::vector<uint> &source)
+{
+    for (size_t i = 0; i < target.size(); ++i) {
+        target[i] += source[i];
+    }
+}
+
+void addCounts(std::array<int, 256> &target, const std::array<int, 256> &source)
+{
+    for (size_t i = 0; i < target.size(); ++i) {
+        target[i] += source[i];
+    }
+}
+} // namespace
+
+void ScopeAnalysis::Request::merge(const Request &other)
+{
+    if (waveformBins.isEmpty() && !other.waveformBins.isEmpty()) {
+        waveformBins = other.waveformBins;
+        waveformRec = other.waveformRec;
+    }
+    if (paradeColumns == 0) {
+        paradeColumns = other.paradeColumns;
+    }
+    if (!lumaHistogram && other.lumaHistogram) {
+        lumaHistogram = true;
+        histogramRec = other.histogramRec;
+    }
+    rgbHistogram = rgbHistogram || other.rgbHistogram;
+    if (vectorscopeSize.isEmpty() && !other.vectorscopeSize.isEmpty()) {
+        vectorscopeSize = other.vectorscopeSize;
+        vectorscopeYPbPr = other.vectorscopeYPbPr;
+        vectorscopeColors = other.vectorscopeColors;
+        vectorscopeChroma = other.vectorscopeChroma;
+    }
+    if (accelFactor == 0 || (other.accelFactor > 0 && other.accelFactor < accelFactor)) {
+        accelFactor = other.accelFactor;
+    }
+}
+
+bool ScopeAnalysis::Request::covers(const Request &other) const
+{
+    if (!other.waveformBins.isEmpty() && (other.waveformBins != waveformBins || other.waveformRec != waveformRec)) {
+        return false;
+    }
+    if (other.paradeColumns != 0 && other.paradeColumns != paradeColumns) {
+        return false;
+    }
+    if (other.lumaHistogram && (!lumaHistogram || other.histogramRec != histogramRec)) {
+        return false;
+    }
+    if (other.rgbHistogram && !rgbHistogram) {
+        return false;
+    }
+    if (!other.vectorscopeSize.isEmpty() &&
+        (other.vectorscopeSize != vectorscopeSize || other.vectorscopeYPbPr != vectorscopeYPbPr ||
+         (other.vectorscopeColors && !vectorscopeColors) || (other.vectorscopeChroma && !vectorscopeChroma))) {
+        return false;
+    }
+    return true;
+}
+
+ScopeAnalysis::ScopeAnalysis(const ScopeFrame &frame, const Request &request)
+    : m_frame(frame)
+    , m_request(request)
+    , m_step(int(std::max(request.accelFactor, 1u)))
+{
+}
+
+const ScopeFrame &ScopeAnalysis::frame() const
+{
+    return m_frame;
+}
+
+const ScopeAnalysis::Request &ScopeAnalysis::request() const
+{
+    return m_request;
+}
+
+bool ScopeAnalysis::isValid() const
+{
+    return m_valid;
+}
+
+int ScopeAnalysis::step() const
+{
+    return m_step;
+}
+
+const ScopeAnalysis::Bins &ScopeAnalysis::bins() const
+{
+    return m_bins;
+}
+
+void ScopeAnalysis::run()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_done) {
+        return;
+    }
+    m_done = true;
+    const int width = m_frame.width();
+    const int height = m_frame.height();
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    const Request &request = m_request;
+    const bool waveform = !request.waveformBins.isEmpty();
+    const int vectorscopeSide = std::min(request.vectorscopeSize.width(), request.vectorscopeSize.height());
+    const bool vectorscope = vectorscopeSide > 0;
+    // The chroma samples of Rec. 601 Y'CbCr frames are the YPbPr color differences, no need for RGB,
+    // unless the color of the pixels is needed.
+    const bool nativeChroma = vectorscope && !request.vectorscopeColors && m_frame.hasNativeChroma(ITURec::Rec_601);
+    const bool needsRgb = request.paradeColumns > 0 || request.rgbHistogram || (vectorscope && !nativeChroma);
+
+    // Everything that is shared by the threads: readers and the mapping of image columns to scope columns
+    ScopeKernels::PixelLayout layout;
+    QImage rgb;
+    if (needsRgb) {
+        rgb = ScopeKernels::scanlineImage(m_frame.toImage(), layout);
+        if (rgb.size() != QSize(width, height)) {
+            return;
+        }
+    }
+    std::unique_ptr<ScopeKernels::LumaReader> waveformReader;
+    std::unique_ptr<ScopeKernels::LumaReader> histogramReader;
+    if (waveform) {
+        waveformReader = std::make_unique<ScopeKernels::LumaReader>(m_frame, request.waveformRec);
+        if (!waveformReader->isValid()) {
+            return;
+        }
+    }
+    // The histogram reuses the waveform luma if it uses the same recommendation
+    const bool histogramLuma = request.lumaHistogram && !(waveform && request.histogramRec == request.waveformRec);
+    if (histogramLuma) {
+        histogramReader = std::make_unique<ScopeKernels::LumaReader>(m_frame, request.histogramRec);
+        if (!histogramReader->isValid()) {
+            return;
+        }
+    }
+
+    // Subtract 1 from sizes because we start counting from 0.
+    // Not doing it would result in attempts to paint outside of the image.
+    // Luma is in 8.8 fixed point.
+    const uint waveformW = uint(request.waveformBins.width());
+    const uint waveformH = uint(request.waveformBins.height());
+    const float hPrediv = waveform ? (waveformH - 1) / 255.f / 256.f : 0.f;
+    std::vector<uint> waveformColumns;
+    if (waveform) {
+        const float wPrediv = width > 1 ? (waveformW - 1) / float(width - 1) : 0.f;
+        waveformColumns.resize(size_t(width));
+        for (int x = 0; x < width; ++x) {
+            waveformColumns[size_t(x)] = uint(x * wPrediv);
+        }
+    }
+    const uint paradeW = uint(request.paradeColumns);
+    std::vector<uint> paradeColumns;
+    if (paradeW > 0) {
+        const float wPrediv = width > 1 ? float(paradeW - 1) / (width - 1) : 0.f;
+        paradeColumns.resize(size_t(width));
+        for (int x = 0; x < width; ++x) {
+            paradeColumns[size_t(x)] = uint(x * double(wPrediv));
+        }
+    }
+    const bool yuvColorSpace = !request.vectorscopeYPbPr;
+    // Ratio between the YUV and YPbPr color differences
+    const double uScale = yuvColorSpace ? 0.001713 / 0.0019608 : 1.;
+    const double vScale = yuvColorSpace ? 0.002411 / 0.001961 : 1.;
+    const bool fullRange = m_frame.isFullRange();
+
+    // Split the frame in bands of rows, each with its own bins
+    const int tileCount = std::max(1, std::min(QThread::idealThreadCount(), height / minTileRows));
+    std::vector<Bins> tileBins(size_t(tileCount - 1));
+    std::vector<Tile> tiles;
+    for (int i = 0; i < tileCount; ++i) {
+        Bins *bins = i == 0 ? &m_bins : &tileBins[size_t(i - 1)];
+        if (waveform) {
+            bins->waveform.assign(size_t(waveformW) * waveformH, 0);
+        }
+        if (paradeW > 0) {
+            bins->parade.assign(size_t(paradeW) * 256 * 3, 0);
+        }
+        if (vectorscope) {
+            const size_t size = size_t(vectorscopeSide) * size_t(vectorscopeSide);
+            bins->vectorscope.assign(size, 0);
+            if (request.vectorscopeColors) {
+                bins->vectorscopeColors.assign(size, 0);
+            }
+            if (request.vectorscopeChroma) {
+                bins->vectorscopeChroma.assign(size, QPointF());
+            }
+        }
+        tiles.push_back({int(qint64(height) * i / tileCount), int(qint64(height) * (i + 1) / tileCount), bins});
+    }
+
+    const int step = m_step;
+    const auto readTile = [&](const Tile &tile) {
+        Bins &bins = *tile.bins;
+        std::vector<quint16> waveformLuma(waveform ? size_t(width) : 0);
+        std::vector<quint16> histogramLumaValues(histogramLuma ? size_t(width) : 0);
+        for (int y = tile.firstRow; y < tile.lastRow; ++y) {
+            const int first = ScopeKernels::firstSampleInRow(y, width, step);
+            if (waveform) {
+                const int count = waveformReader->row(y, first, step, waveformLuma.data());
+                uint *waveformBins = bins.waveform.data();
+                for (int k = 0, x = first; k < count; ++k, x += step) {
+                    waveformBins[size_t(waveformLuma[size_t(k)] * hPrediv) * waveformW + waveformColumns[size_t(x)]]++;
+                }
+                if (request.lumaHistogram && !histogramLuma) {
+                    for (int k = 0; k < count; ++k) {
+                        bins.luma[waveformLuma[size_t(k)] >> 8]++;
+                    }
+                }
+            }
+            if (histogramLuma) {
+                const int count = histogramReader->row(y, first, step, histogramLumaValues.data());
+                for (int k = 0; k < count; ++k) {
+                    bins.luma[histogramLumaValues[size_t(k)] >> 8]++;
+                }
+            }
+            if (!needsRgb && !nativeChroma) {
+                continue;
+            }
+            const uchar *line = needsRgb ? rgb.constScanLine(y) : nullptr;
+            const uchar *cbLine = nativeChroma ? m_frame.cbLine(y) : nullptr;
+            const uchar *crLine = nativeChroma ? m_frame.crLine(y) : nullptr;
+            for (int x = first; x < width; x += step) {
+                QRgb pixel = 0;
+                if (needsRgb) {
+                    const uchar *p = line + 4 * x;
+                    const uchar r = p[layout.r];
+                    const uchar g = p[layout.g];
+                    const uchar b = p[layout.b];
+                    if (paradeW > 0) {
+                        uint *column = bins.parade.data() + paradeColumns[size_t(x)] * 3;
+                        column[r * paradeW * 3]++;
+                        column[g * paradeW * 3 + 1]++;
+                        column[b * paradeW * 3 + 2]++;
+                        bins.paradeMin[0] = std::min(bins.paradeMin[0], r);
+                        bins.paradeMin[1] = std::min(bins.paradeMin[1], g);
+                        bins.paradeMin[2] = std::min(bins.paradeMin[2], b);
+                        bins.paradeMax[0] = std::max(bins.paradeMax[0], r);
+                        bins.paradeMax[1] = std::max(bins.paradeMax[1], g);
+                        bins.paradeMax[2] = std::max(bins.paradeMax[2], b);
+                    }
+                    if (request.rgbHistogram) {
+                        bins.red[r]++;
+                        bins.green[g]++;
+                        bins.blue[b]++;
+                    }
+                    pixel = qRgba(r, g, b, layout.opaque ? 255 : p[layout.a]);
+                }
+                if (!vectorscope) {
+                    continue;
+                }
+                double u, v;
+                if (nativeChroma) {
+                    const int sample = (x / 2) * m_frame.chromaStep();
+                    u = uScale * ScopeKernels::chromaValue(cbLine[sample], fullRange);
+                    v = vScale * ScopeKernels::chromaValue(crLine[sample], fullRange);
+                } else {
+                    const int r = qRed(pixel);
+                    const int g = qGreen(pixel);
+                    const int b = qBlue(pixel);
+                    if (yuvColorSpace) {
+                        u = -0.0005781 * r - 0.001135 * g + 0.001713 * b;
+                        v = 0.002411 * r - 0.002019 * g - 0.0003921 * b;
+                    } else {
+                        u = -0.0006671 * r - 0.001299 * g + 0.0019608 * b;
+                        v = 0.001961 * r - 0.001642 * g - 0.0003189 * b;
+                    }
+                }
+                const QPoint pt =
+                    VectorscopeGenerator::mapToCircle(request.vectorscopeSize, QPointF(VectorscopeGenerator::scaling * u, VectorscopeGenerator::scaling * v));
+                if (pt.x() >= vectorscopeSide || pt.x() < 0 || pt.y() >= vectorscopeSide || pt.y() < 0) {
+                    // Point lies outside, don't plot it
+                    continue;
+                }
+                const size_t bin = size_t(pt.y()) * size_t(vectorscopeSide) + size_t(pt.x());
+                bins.vectorscope[bin]++;
+                if (request.vectorscopeColors) {
+                    bins.vectorscopeColors[bin] = pixel;
+                }
+                if (request.vectorscopeChroma) {
+                    bins.vectorscopeChroma[bin] = QPointF(u, v);
+                }
+            }
+        }
+    };
+    if (tiles.size() == 1) {
+        readTile(tiles.front());
+    } else {
+        QtConcurrent::blockingMap(tiles, readTile);
+    }
+
+    // Merge the bands in order, so that the last pixel of a vectorscope bin is the same as in a sequential read
+    for (const Bins &bins : tileBins) {
+        addCounts(m_bins.waveform, bins.waveform);
+        addCounts(m_bins.parade, bins.parade);
+        for (size_t c = 0; c < 3; ++c) {
+            m_bins.paradeMin[c] = std::min(m_bins.paradeMin[c], bins.paradeMin[c]);
+            m_bins.paradeMax[c] = std::max(m_bins.paradeMax[c], bins.paradeMax[c]);
+        }
+        addCounts(m_bins.luma, bins.luma);
+        addCounts(m_bins.red, bins.red);
+        addCounts(m_bins.green, bins.green);
+        addCounts(m_bins.blue, bins.blue);
+        for (size_t i = 0; i < bins.vectorscope.size(); ++i) {
+            if (bins.vectorscope[i] == 0) {
+                continue;
+            }
+            m_bins.vectorscope[i] += bins.vectorscope[i];
+            if (request.vectorscopeColors) {
+                m_bins.vectorscopeColors[i] = bins.vectorscopeColors[i];
+            }
+            if (request.vectorscopeChroma) {
+                m_bins.vectorscopeChroma[i] = bins.vectorscopeChroma[i];
+            }
+        }
+    }
+    m_valid = true;
+}
@@ -0,0 +1,100 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+#include "scopeframe.h"
+
+#include <QMutex>
+#include <QPointF>
+#include <QRgb>
+#include <QSize>
+#include <array>
+#include <vector>
+
+/**
+ * @class ScopeAnalysis
+ * @brief Accumulates the data needed by the color scopes in a single pass over a frame.
+ *
+ * Each scope describes what it needs in a Request. The requests of all the scopes receiving a frame
+ * are merged, and the frame is read once, in bands of rows processed in parallel. The scopes then only
+ * render their image from the accumulated bins.
+ * An analysis is shared between the scope threads, the first one calling run() does the work.
+ */
+class ScopeAnalysis
+{
+public:
+    struct Request
+    {
+        /** @brief Number of columns and luma rows of the waveform bins, empty if no waveform is needed */
+        QSize waveformBins;
+        ITURec waveformRec{ITURec::Rec_709};
+        /** @brief Number of columns of each component of the RGB parade, 0 if no parade is needed */
+        int paradeColumns{0};
+        bool lumaHistogram{false};
+        ITURec histogramRec{ITURec::Rec_709};
+        bool rgbHistogram{false};
+        /** @brief Size of the vectorscope, empty if no vectorscope is needed */
+        QSize vectorscopeSize;
+        /** @brief Compute the YPbPr color differences instead of the YUV ones */
+        bool vectorscopeYPbPr{false};
+        /** @brief Keep the color of the last pixel falling in each vectorscope bin */
+        bool vectorscopeColors{false};
+        /** @brief Keep the color difference of the last pixel falling in each vectorscope bin */
+        bool vectorscopeChroma{false};
+        /** @brief Only one in accelFactor pixels is read, 0 if not set by any scope */
+        uint accelFactor{0};
+
+        /** @brief Adds the needs of another scope, the smallest acceleration factor is kept */
+        void merge(const Request &other);
+        /** @brief True if the bins of this request contain everything needed by other */
+        bool covers(const Request &other) const;
+    };
+
+    /** @brief The accumulated data, see Request for the meaning of each part */
+    struct Bins
+    {
+        /** @brief One row per luma level, from the lowest level */
+        std::vector<uint> waveform;
+        /** @brief One row per value, holding the r, g and b counts of each column */
+        std::vector<uint> parade;
+        std::array<uchar, 3> paradeMin{{255, 255, 255}};
+        std::array<uchar, 3> paradeMax{{0, 0, 0}};
+        std::array<int, 256> luma{};
+        std::array<int, 256> red{};
+        std::array<int, 256> green{};
+        std::array<int, 256> blue{};
+        /** @brief Square of the smallest side of the vectorscope, row by row */
+        std::vector<uint> vectorscope;
+        std::vector<QRgb> vectorscopeColors;
+        std::vector<QPointF> vectorscopeChroma;
+    };
+
+    ScopeAnalysis(const ScopeFrame &frame, const Request &request);
+    ScopeAnalysis(const ScopeAnalysis &) = delete;
+    ScopeAnalysis &operator=(const ScopeAnalysis &) = delete;
+
+    const ScopeFrame &frame() const;
+    const Request &request() const;
+
+    /** @brief Reads the frame if it was not done yet. Thread safe, other callers wait for the result. */
+    void run();
+    /** @brief False if the frame could not be read. Only meaningful after run(). */
+    bool isValid() const;
+    /** @brief One in step() pixels was read */
+    int step() const;
+    const Bins &bins() const;
+
+private:
+    ScopeFrame m_frame;
+    Request m_request;
+    int m_step;
+    Bins m_bins;
+    bool m_valid{false};
+    bool m_done{false};
+    QMutex m_mutex;
+};
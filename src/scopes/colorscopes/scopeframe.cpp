@@ -0,0 +1,148 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopeframe.h"
+
+namespace {
+void releaseFrame(void *info)
+{
+    delete static_cast<SharedFrame *>(info);
+}
+} // namespace
+
+ScopeFrame::ScopeFrame() = default;
+
+ScopeFrame::ScopeFrame(const QImage &image)
+    : m_image(image)
+    , m_format(image.isNull() ? Format::Invalid : Format::Image)
+    , m_width(image.width())
+    , m_height(image.height())
+{
+}
+
+ScopeFrame::ScopeFrame(const SharedFrame &frame, int colorspace)
+    : m_frame(frame)
+    , m_colorspace(colorspace)
+{
+    if (!frame.is_valid()) {
+        return;
+    }
+    const mlt_image_format format = frame.get_image_format();
+    m_width = frame.get_image_width();
+    m_height = frame.get_image_height();
+    m_fullRange = frame.get_int("full_range") == 1;
+    switch (format) {
+    case mlt_image_yuv422:
+        m_format = Format::Yuv422;
+        break;
+    case mlt_image_yuv420p:
+        m_format = Format::Yuv420p;
+        break;
+    case mlt_image_rgb:
+    case mlt_image_rgba:
+        // Only read as RGB
+        m_format = m_width > 0 && m_height > 0 ? Format::Image : Format::Invalid;
+        return;
+    default:
+        // GPU textures (glsl, opengl_texture) can't be read outside of the rendering thread's GL context
+        return;
+    }
+    const uint8_t *data = frame.get_image(format);
+    uint8_t *planes[4];
+    int strides[4];
+    if (data == nullptr || m_width <= 0 || m_height <= 0 ||
+        mlt_image_format_planes(format, m_width, m_height, const_cast<uint8_t *>(data), planes, strides) != 0) {
+        m_format = Format::Invalid;
+        return;
+    }
+    for (int i = 0; i < 3; ++i) {
+        m_planes[i] = planes[i];
+        m_strides[i] = strides[i];
+    }
+}
+
+bool ScopeFrame::isValid() const
+{
+    return m_format != Format::Invalid;
+}
+
+ScopeFrame::Format ScopeFrame::format() const
+{
+    return m_format;
+}
+
+int ScopeFrame::width() const
+{
+    return m_width;
+}
+
+int ScopeFrame::height() const
+{
+    return m_height;
+}
+
+bool ScopeFrame::hasNativeLuma(ITURec rec) const
+{
+    if (m_format != Format::Yuv422 && m_format != Format::Yuv420p) {
+        return false;
+    }
+    return (rec == ITURec::Rec_601 && m_colorspace == 601) || (rec == ITURec::Rec_709 && m_colorspace == 709);
+}
+
+bool ScopeFrame::hasNativeChroma(ITURec rec) const
+{
+    return hasNativeLuma(rec);
+}
+
+bool ScopeFrame::isFullRange() const
+{
+    return m_fullRange;
+}
+
+const uchar *ScopeFrame::lumaLine(int y) const
+{
+    return m_planes[0] + y * m_strides[0];
+}
+
+int ScopeFrame::lumaStep() const
+{
+    // Packed 4:2:2 is Y0 Cb Y1 Cr
+    return m_format == Format::Yuv422 ? 2 : 1;
+}
+
+const uchar *ScopeFrame::cbLine(int y) const
+{
+    if (m_format == Format::Yuv422) {
+        return m_planes[0] + y * m_strides[0] + 1;
+    }
+    return m_planes[1] + (y / 2) * m_strides[1];
+}
+
+const uchar *ScopeFrame::crLine(int y) const
+{
+    if (m_format == Format::Yuv422) {
+        return m_planes[0] + y * m_strides[0] + 3;
+    }
+    return m_planes[2] + (y / 2) * m_strides[2];
+}
+
+int ScopeFrame::chromaStep() const
+{
+    return m_format == Format::Yuv422 ? 4 : 1;
+}
+
+QImage ScopeFrame::toImage() const
+{
+    if (!m_frame.is_valid()) {
+        return m_image;
+    }
+    // The converted image is cached in the shared frame, keep a reference on it for the lifetime of the image
+    const uint8_t *image = m_frame.get_image(mlt_image_rgba);
+    if (image == nullptr) {
+        return QImage();
+    }
+    return QImage(image, m_width, m_height, qsizetype(m_width) * 4, QImage::Format_RGBA8888, releaseFrame, new SharedFrame(m_frame));
+}
@@ -0,0 +1,70 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+#include "monitor/scopes/sharedframe.h"
+#include <QImage>
+#include <QMetaType>
+
+/**
+ * @class ScopeFrame
+ * @brief A frame handed to the color scopes.
+ *
+ * It is either a view on the frame displayed by the monitor, in its native format, or a QImage.
+ * Copying a ScopeFrame only copies references, the image data is shared with the monitor.
+ * Y'CbCr frames can be read directly by the scopes working on luma and chroma, the others
+ * ask for an RGB image with toImage(), which is converted once and shared by all scopes.
+ * Monitor frames in other formats, like GPU textures, are invalid: the monitor must read them back into a QImage.
+ */
+class ScopeFrame
+{
+public:
+    enum class Format { Invalid, Image, Yuv422, Yuv420p };
+
+    ScopeFrame();
+    explicit ScopeFrame(const QImage &image);
+    /** @param colorspace The Y'CbCr matrix of the frame, 601 or 709 */
+    ScopeFrame(const SharedFrame &frame, int colorspace);
+
+    bool isValid() const;
+    Format format() const;
+    int width() const;
+    int height() const;
+
+    /** @brief True if the luma computed with rec can be read directly from the Y' samples */
+    bool hasNativeLuma(ITURec rec) const;
+    /** @brief True if the chroma computed with rec can be read directly from the Cb/Cr samples */
+    bool hasNativeChroma(ITURec rec) const;
+    /** @brief True if the Y'CbCr samples use the full 0-255 range instead of 16-235 (16-240 for chroma) */
+    bool isFullRange() const;
+
+    /** @brief Y' samples of a row, lumaStep() bytes apart */
+    const uchar *lumaLine(int y) const;
+    int lumaStep() const;
+    /** @brief Cb and Cr samples of a row, horizontally subsampled by 2 and chromaStep() bytes apart.
+     *  The samples of pixel x are at (x / 2) * chromaStep(). */
+    const uchar *cbLine(int y) const;
+    const uchar *crLine(int y) const;
+    int chromaStep() const;
+
+    /** @brief The frame as an RGB image. For monitor frames it is converted on first use and shared with the frame, not copied. */
+    QImage toImage() const;
+
+private:
+    SharedFrame m_frame;
+    QImage m_image;
+    Format m_format{Format::Invalid};
+    int m_width{0};
+    int m_height{0};
+    int m_colorspace{601};
+    bool m_fullRange{false};
+    const uchar *m_planes[3]{nullptr, nullptr, nullptr};
+    int m_strides[3]{0, 0, 0};
+};
+
+Q_DECLARE_METATYPE(ScopeFrame)
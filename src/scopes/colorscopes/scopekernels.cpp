@@ -0,0 +1,175 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "scopekernels.h"
+#include "scopeframe.h"
+
+#include <array>
+
+#ifdef KDENLIVE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace ScopeKernels {
+
+namespace {
+
+// Luma factors in 1.15 fixed point, rounded so that they add up to exactly 1
+constexpr int REC_601_FIXED[3] = {9798, 19235, 3735};
+constexpr int REC_709_FIXED[3] = {6963, 23442, 2363};
+// From 15 to 8 fractional bits
+constexpr int lumaShift = 7;
+
+// Luma weights for each byte of a pixel, the unused byte has a weight of 0
+void byteWeights(const PixelLayout &layout, ITURec rec, int weights[4])
+{
+    const int *factors = rec == ITURec::Rec_601 ? REC_601_FIXED : REC_709_FIXED;
+    weights[0] = weights[1] = weights[2] = weights[3] = 0;
+    weights[layout.r] = factors[0];
+    weights[layout.g] = factors[1];
+    weights[layout.b] = factors[2];
+}
+
+int lumaScalar(const uchar *line, int width, int first, int step, const int weights[4], quint16 *out)
+{
+    int n = 0;
+    for (int x = first; x < width; x += step) {
+        const uchar *p = line + 4 * x;
+        out[n++] = quint16((weights[0] * p[0] + weights[1] * p[1] + weights[2] * p[2] + weights[3] * p[3]) >> lumaShift);
+    }
+    return n;
+}
+
+#ifdef KDENLIVE_SIMD_SSE2
+int lumaSSE2(const uchar *line, int width, int first, int step, const int weights[4], quint16 *out)
+{
+    if (step != 1) {
+        // Sparse samples cannot be loaded as a vector
+        return lumaScalar(line, width, first, step, weights, out);
+    }
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_setr_epi16(short(weights[0]), short(weights[1]), short(weights[2]), short(weights[3]), short(weights[0]), short(weights[1]),
+                                     short(weights[2]), short(weights[3]));
+    // There is no unsigned 32 to 16 bit pack in SSE2, shift the values to the signed range and back
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(short(0x8000));
+    int x = first;
+    int n = 0;
+    for (; x + 4 <= width; x += 4, n += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(line + 4 * x));
+        // Two pixels per register as 16 bit values, multiplied and summed pairwise: (b0, b1) and (b2, b3) of each pixel
+        const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), w);
+        const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), w);
+        const __m128 even = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 odd = _mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i luma = _mm_add_epi32(_mm_castps_si128(even), _mm_castps_si128(odd));
+        luma = _mm_sub_epi32(_mm_srli_epi32(luma, lumaShift), bias32);
+        const __m128i packed = _mm_xor_si128(_mm_packs_epi32(luma, luma), bias16);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + n), packed);
+    }
+    return n + lumaScalar(line, width, x, 1, weights, out + n);
+}
+#endif
+
+} // namespace
+
+Kernel bestKernel()
+{
+    return SimdKernels::bestKernel(Kernel::SSE2);
+}
+
+QImage scanlineImage(const QImage &image, PixelLayout &layout)
+{
+    switch (image.format()) {
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888:
+        layout = {0, 1, 2, 3, image.format() == QImage::Format_RGBX8888};
+        return image;
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32:
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        layout = {2, 1, 0, 3, image.format() == QImage::Format_RGB32};
+#else
+        layout = {1, 2, 3, 0, image.format() == QImage::Format_RGB32};
+#endif
+        return image;
+    default:
+        if (image.isNull()) {
+            layout = {0, 1, 2, 3, true};
+            return image;
+        }
+        return scanlineImage(image.convertToFormat(QImage::Format_ARGB32), layout);
+    }
+}
+
+int lumaRow(Kernel kernel, const uchar *line, int width, int first, int step, const PixelLayout &layout, ITURec rec, quint16 *out)
+{
+    Q_ASSERT(step >= 1);
+    Q_ASSERT(isSupported(kernel));
+    int weights[4];
+    byteWeights(layout, rec, weights);
+    switch (kernel) {
+#ifdef KDENLIVE_SIMD_SSE2
+    case Kernel::SSE2:
+        return lumaSSE2(line, width, first, step, weights, out);
+#endif
+    default:
+        return lumaScalar(line, width, first, step, weights, out);
+    }
+}
+
+int lumaRow(const uchar *line, int width, int first, int step, const PixelLayout &layout, ITURec rec, quint16 *out)
+{
+    return lumaRow(bestKernel(), line, width, first, step, layout, rec, out);
+}
+
+int lumaRowYuv(const uchar *line, int sampleStep, int width, int first, int step, bool fullRange, quint16 *out)
+{
+    Q_ASSERT(step >= 1);
+    static const std::array<quint16, 256> limitedRange = []() {
+        std::array<quint16, 256> table;
+        for (int i = 0; i < 256; ++i) {
+            table[size_t(i)] = quint16(qBound(0, ((i - 16) * 255 * 256 + 219 / 2) / 219, 255 * 256));
+        }
+        return table;
+    }();
+    int n = 0;
+    if (fullRange) {
+        for (int x = first; x < width; x += step) {
+            out[n++] = quint16(line[x * sampleStep] << 8);
+        }
+    } else {
+        for (int x = first; x < width; x += step) {
+            out[n++] = limitedRange[line[x * sampleStep]];
+        }
+    }
+    return n;
+}
+
+LumaReader::LumaReader(const ScopeFrame &frame, ITURec rec)
+    : m_frame(frame)
+    , m_rec(rec)
+    , m_native(frame.hasNativeLuma(rec))
+{
+    if (!m_native) {
+        m_image = scanlineImage(frame.toImage(), m_layout);
+    }
+}
+
+bool LumaReader::isValid() const
+{
+    return m_native || (!m_image.isNull() && m_image.size() == QSize(m_frame.width(), m_frame.height()));
+}
+
+int LumaReader::row(int y, int first, int step, quint16 *out) const
+{
+    if (m_native) {
+        return lumaRowYuv(m_frame.lumaLine(y), m_frame.lumaStep(), m_frame.width(), first, step, m_frame.isFullRange(), out);
+    }
+    return lumaRow(m_image.constScanLine(y), m_image.width(), first, step, m_layout, m_rec, out);
+}
+
+} // namespace ScopeKernels
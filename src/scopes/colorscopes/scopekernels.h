@@ -0,0 +1,114 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include "colorconstants.h"
+#include "utils/simdkernels.h"
+#include <QImage>
+#include <QRgb>
+
+class ScopeFrame;
+
+/**
+ * @brief Per-pixel building blocks shared by the color scope generators.
+ *
+ * Scopes read the frame scanline by scanline instead of going through QImage::pixel(),
+ * and compute luma in 8.8 fixed point (0 to 255 * 256) so that it can be vectorized.
+ * All kernels produce identical results.
+ */
+namespace ScopeKernels {
+
+// An SSE2 kernel is implemented
+using SimdKernels::isSupported;
+using SimdKernels::Kernel;
+using SimdKernels::kernelName;
+
+/** @brief Returns the fastest supported kernel */
+Kernel bestKernel();
+
+/** @brief Byte offsets of the components of a 32 bit pixel as stored in memory */
+struct PixelLayout
+{
+    int r;
+    int g;
+    int b;
+    int a;
+    /** @brief The alpha byte is unused and must be read as 255 */
+    bool opaque;
+};
+
+/**
+ * @brief Returns an image with 32 bit pixels that can be read through its scanlines.
+ * The image is shared (not copied) if it already is in a supported format, otherwise it is converted.
+ * @param layout Filled with the pixel layout of the returned image
+ */
+QImage scanlineImage(const QImage &image, PixelLayout &layout);
+
+/** @brief Returns the pixel as a QRgb, like QImage::pixel() would */
+inline QRgb pixelAt(const uchar *line, int x, const PixelLayout &layout)
+{
+    const uchar *p = line + 4 * x;
+    return qRgba(p[layout.r], p[layout.g], p[layout.b], layout.opaque ? 255 : p[layout.a]);
+}
+
+/**
+ * @brief Returns the first pixel of row y that is sampled when taking every step-th pixel of an image
+ * of the given width in row-major order, starting with the top left pixel.
+ */
+inline int firstSampleInRow(int y, int width, int step)
+{
+    const int remainder = int((qint64(y) * width) % step);
+    return remainder == 0 ? 0 : step - remainder;
+}
+
+/**
+ * @brief Computes the luma of pixels first, first + step, … of a scanline.
+ * @param out Receives the luma values in 8.8 fixed point, must hold (width - first + step - 1) / step values
+ * @return the number of values written
+ */
+int lumaRow(Kernel kernel, const uchar *line, int width, int first, int step, const PixelLayout &layout, ITURec rec, quint16 *out);
+
+/** @brief Same as above, with the best kernel */
+int lumaRow(const uchar *line, int width, int first, int step, const PixelLayout &layout, ITURec rec, quint16 *out);
+
+/**
+ * @brief Reads the Y' samples of pixels first, first + step, … of a row of Y'CbCr data.
+ * Limited range samples (16-235) are expanded to the full range, so that the result matches the luma of the RGB conversion.
+ * @param sampleStep Number of bytes between the samples of two neighbouring pixels
+ * @param out Receives the luma values in 8.8 fixed point, see lumaRow()
+ * @return the number of values written
+ */
+int lumaRowYuv(const uchar *line, int sampleStep, int width, int first, int step, bool fullRange, quint16 *out);
+
+/** @brief Converts a Cb or Cr sample to a color difference on [-0.5, 0.5] */
+inline double chromaValue(uchar sample, bool fullRange)
+{
+    return (sample - 128) / (fullRange ? 255. : 224.);
+}
+
+/**
+ * @brief Reads the luma of the rows of a frame, from its Y' samples when they match the requested
+ * recommendation, from its RGB image otherwise.
+ */
+class LumaReader
+{
+public:
+    LumaReader(const ScopeFrame &frame, ITURec rec);
+    /** @brief False if the frame could not be read */
+    bool isValid() const;
+    /** @brief Computes the luma of pixels first, first + step, … of row y, see lumaRow() */
+    int row(int y, int first, int step, quint16 *out) const;
+
+private:
+    const ScopeFrame &m_frame;
+    ITURec m_rec;
+    bool m_native;
+    QImage m_image;
+    PixelLayout m_layout;
+};
+
+} // namespace ScopeKernels
@@ -274,7 +274,19 @@ QImage Vectorscope::renderHUD(uint)
     return hud;
 }
 
-QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage)
+ScopeAnalysis::Request Vectorscope::analysisRequest(uint accelerationFactor)
+{
+    ScopeAnalysis::Request request;
+    if (m_cw > 0) {
+        VectorscopeGenerator::ColorSpace colorSpace =
+            m_aColorSpace_YPbPr->isChecked() ? VectorscopeGenerator::ColorSpace_YPbPr : VectorscopeGenerator::ColorSpace_YUV;
+        VectorscopeGenerator::PaintMode paintMode = VectorscopeGenerator::PaintMode(m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt());
+        VectorscopeGenerator::addToRequest(request, m_scopeRect.size() * devicePixelRatioF(), paintMode, colorSpace, accelerationFactor);
+    }
+    return request;
+}
+
+QImage Vectorscope::renderGfxScope(uint accelerationFactor, const ScopeAnalysis &analysis)
 {
     QElapsedTimer timer;
     timer.start();
@@ -288,8 +300,8 @@ QImage Vectorscope::renderGfxScope(uint accelerationFactor, const QImage &qimage
             m_aColorSpace_YPbPr->isChecked() ? VectorscopeGenerator::ColorSpace_YPbPr : VectorscopeGenerator::ColorSpace_YUV;
         VectorscopeGenerator::PaintMode paintMode = VectorscopeGenerator::PaintMode(m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt());
         qreal dpr = devicePixelRatioF();
-        scope = m_vectorscopeGenerator->calculateVectorscope(m_scopeRect.size() * dpr, dpr, qimage, m_gain, paintMode, colorSpace, m_aAxisEnabled->isChecked(),
-                                                             accelerationFactor);
+        scope =
+            m_vectorscopeGenerator->calculateVectorscope(m_scopeRect.size() * dpr, dpr, analysis, m_gain, paintMode, colorSpace, m_aAxisEnabled->isChecked());
     }
     Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), accelerationFactor);
     return scope;
@@ -61,12 +61,11 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "scopeframe.h"
 #include <cmath>
 
 // The maximum distance from the center for any RGB color is 0.63, so
 // no need to make the circle bigger than required.
-const double SCALING = 1 / .7;
-
 const double VectorscopeGenerator::scaling = 1 / .7;
 
 /**
@@ -99,20 +98,57 @@ const double VectorscopeGenerator::scaling = 1 / .7;
   x does not need to be inverted.
 
  */
-QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF &point) const
+QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF &point)
 {
     return {int((targetSize.width() - 1) * (point.x() + 1) / 2), int((targetSize.height() - 1) * (1 - (point.y() + 1) / 2))};
 }
 
 QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, qreal scalingFactor, const QImage &image, const float &gain,
-                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
-                                                  uint accelFactor) const
+                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace,
+                                                  bool drawAxis, uint accelFactor) const
+{
+    return calculateVectorscope(vectorscopeSize, scalingFactor, ScopeFrame(image), gain, paintMode, colorSpace, drawAxis, accelFactor);
+}
+
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, qreal scalingFactor, const ScopeFrame &frame, const float &gain,
+                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace,
+                                                  bool drawAxis, uint accelFactor) const
+{
+    if (accelFactor < 1) { accelFactor = 1; }
+    ScopeAnalysis::Request request;
+    addToRequest(request, vectorscopeSize, paintMode, colorSpace, accelFactor);
+    ScopeAnalysis analysis(frame, request);
+    analysis.run();
+    return calculateVectorscope(vectorscopeSize, scalingFactor, analysis, gain, paintMode, colorSpace, drawAxis);
+}
+
+void VectorscopeGenerator::addToRequest(ScopeAnalysis::Request &request, const QSize &vectorscopeSize, const VectorscopeGenerator::PaintMode &paintMode,
+                                        const VectorscopeGenerator::ColorSpace &colorSpace, uint accelFactor)
+{
+    ScopeAnalysis::Request vectorscope;
+    vectorscope.vectorscopeSize = vectorscopeSize;
+    vectorscope.vectorscopeYPbPr = colorSpace == VectorscopeGenerator::ColorSpace_YPbPr;
+    // Only the original color paint mode needs the RGB values
+    vectorscope.vectorscopeColors = paintMode == PaintMode_Original;
+    vectorscope.vectorscopeChroma = paintMode == PaintMode_YUV || paintMode == PaintMode_Chroma;
+    vectorscope.accelFactor = accelFactor;
+    request.merge(vectorscope);
+}
+
+QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, qreal scalingFactor, const ScopeAnalysis &analysis, const float &gain,
+                                                  const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace,
+                                                  bool) const
 {
-    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    const ScopeFrame &frame = analysis.frame();
+    if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || frame.width() <= 0 || frame.height() <= 0) {
         // Invalid size
         return QImage();
     }
-    if (accelFactor < 1) { accelFactor = 1; }
+    ScopeAnalysis::Request request;
+    addToRequest(request, vectorscopeSize, paintMode, colorSpace, 1);
+    if (!analysis.isValid() || !analysis.request().covers(request)) {
+        return QImage();
+    }
 
     // Prepare the vectorscope data
     const int cw = (vectorscopeSize.width() < vectorscopeSize.height()) ? vectorscopeSize.width() : vectorscopeSize.height();
@@ -124,46 +160,32 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
 
     double dy, dr, dg, db, dmax;
     double /*y,*/ u, v;
-    QPoint pt;
     QRgb px;
 
-    // Just an average for the number of image pixels per scope pixel.
-    // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see:
-    // https://doc.qt.io/qt-5/qimage.html#bytesPerLine
-    double avgPxPerPx =
-        double(image.depth()) / 8 * (image.bytesPerLine() * image.height()) / baseScope.size().width() / baseScope.size().height() / accelFactor;
-
-    const auto totalPixels = image.width() * image.height();
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const QRgb pixel = image.pixel(i % image.width(), i / image.width());
-        const int r = qRed(pixel);
-        const int g = qGreen(pixel);
-        const int b = qBlue(pixel);
-
-        switch (colorSpace) {
-        case VectorscopeGenerator::ColorSpace_YUV:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = -0.0005781 * r - 0.001135 * g + 0.001713 * b;
-            v = 0.002411 * r - 0.002019 * g - 0.0003921 * b;
-            break;
-        case VectorscopeGenerator::ColorSpace_YPbPr:
-        default:
-            //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = -0.0006671 * r - 0.001299 * g + 0.0019608 * b;
-            v = 0.001961 * r - 0.001642 * g - 0.0003189 * b;
-            break;
-        }
-
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING * u, SCALING * v));
-
-        if (pt.x() >= baseScope.width() || pt.x() < 0 || pt.y() >= baseScope.height() || pt.y() < 0) {
-            // Point lies outside, don't plot it
-        } else {
+    // Just an average for the number of image pixels per scope pixel,
+    // computed from the number of bytes of the frame as a 32 bit image.
+    double avgPxPerPx = 4. * (4. * frame.width() * frame.height()) / baseScope.size().width() / baseScope.size().height() / analysis.step();
+
+    // The bins hold the number of pixels at each point of the scope, and the color of the last one
+    const ScopeAnalysis::Bins &bins = analysis.bins();
+    uchar *scopeBits = baseScope.bits();
+    const qsizetype scopeBytesPerLine = baseScope.bytesPerLine();
+    for (int row = 0; row < cw; ++row) {
+        auto *line = reinterpret_cast<QRgb *>(scopeBits + row * scopeBytesPerLine);
+        for (int column = 0; column < cw; ++column) {
+            const size_t bin = size_t(row) * size_t(cw) + size_t(column);
+            const uint count = bins.vectorscope[bin];
+            if (count == 0) {
+                continue;
+            }
+            QRgb &target = line[column];
             // Draw the pixel using the chosen draw mode.
             switch (paintMode) {
             case PaintMode_YUV:
                 // see yuvColorWheel
                 dy = 128; // Default Y value. Lower = darker.
+                u = bins.vectorscopeChroma[bin].x();
+                v = bins.vectorscopeChroma[bin].y();
 
                 // Calculate the RGB values from YUV/YPbPr
                 switch (colorSpace) {
@@ -199,11 +221,13 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
                     db = 255;
                 }
 
-                baseScope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
+                target = qRgba(int(dr), int(dg), int(db), 255);
                 break;
 
             case PaintMode_Chroma:
                 dy = 200; // Default Y value. Lower = darker.
+                u = bins.vectorscopeChroma[bin].x();
+                v = bins.vectorscopeChroma[bin].y();
 
                 // Calculate the RGB values from YUV/YPbPr
                 switch (colorSpace) {
@@ -234,26 +258,42 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
                 dg *= dmax;
                 db *= dmax;
 
-                baseScope.setPixel(pt, qRgba(int(dr), int(dg), int(db), 255));
+                target = qRgba(int(dr), int(dg), int(db), 255);
                 break;
             case PaintMode_Original:
-                baseScope.setPixel(pt, pixel);
+                target = bins.vectorscopeColors[bin];
                 break;
+            // The following modes brighten the point once for each pixel falling on it,
+            // stop as soon as it does not change anymore.
             case PaintMode_Green:
-                px = baseScope.pixel(pt);
-                baseScope.setPixel(pt, qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
-                                             qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx))));
+                for (uint i = 0; i < count; ++i) {
+                    px = target;
+                    target = qRgba(qRed(px) + int((255 - qRed(px)) / (3 * avgPxPerPx)), qGreen(px) + int(20 * (255 - qGreen(px)) / (avgPxPerPx)),
+                                   qBlue(px) + int((255 - qBlue(px)) / (avgPxPerPx)), qAlpha(px) + int((255 - qAlpha(px)) / (avgPxPerPx)));
+                    if (target == px) {
+                        break;
+                    }
+                }
                 break;
             case PaintMode_Green2:
-                px = baseScope.pixel(pt);
-                baseScope.setPixel(pt,
-                                   qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255,
-                                         qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))), qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx)))));
+                for (uint i = 0; i < count; ++i) {
+                    px = target;
+                    target = qRgba(qRed(px) + int(ceil((255 - qRed(px)) / (4 * avgPxPerPx))), 255, qBlue(px) + int(ceil((255 - qBlue(px)) / (avgPxPerPx))),
+                                   qAlpha(px) + int(ceil((255 - qAlpha(px)) / (avgPxPerPx))));
+                    if (target == px) {
+                        break;
+                    }
+                }
                 break;
             case PaintMode_Black:
             default:
-                px = baseScope.pixel(pt);
-                baseScope.setPixel(pt, qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20));
+                for (uint i = 0; i < count; ++i) {
+                    px = target;
+                    target = qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20);
+                    if (target == px) {
+                        break;
+                    }
+                }
                 break;
             }
         }
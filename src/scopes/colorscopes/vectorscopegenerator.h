@@ -7,6 +7,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 #pragma once
 
+#include "scopeanalysis.h"
 #include <QImage>
 #include <QObject>
 
@@ -14,6 +15,7 @@ class QImage;
 class QPoint;
 class QPointF;
 class QSize;
+class ScopeFrame;
 
 class VectorscopeGenerator : public QObject
 {
@@ -26,8 +28,18 @@ public:
     QImage calculateVectorscope(const QSize &vectorscopeSize, qreal scalingFactor, const QImage &image, const float &gain,
                                 const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
                                 uint accelFactor = 1) const;
-
-    QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
+    /** @brief Same as above, reading the chroma directly from the Cb/Cr samples of Rec. 601 Y'CbCr frames */
+    QImage calculateVectorscope(const QSize &vectorscopeSize, qreal scalingFactor, const ScopeFrame &frame, const float &gain,
+                                const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
+                                uint accelFactor = 1) const;
+    /** @brief Same as above, from the bins of an analysis that was run with the request of addToRequest() */
+    QImage calculateVectorscope(const QSize &vectorscopeSize, qreal scalingFactor, const ScopeAnalysis &analysis, const float &gain,
+                                const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool) const;
+    /** @brief Adds what calculateVectorscope() needs to an analysis request */
+    static void addToRequest(ScopeAnalysis::Request &request, const QSize &vectorscopeSize, const VectorscopeGenerator::PaintMode &paintMode,
+                             const VectorscopeGenerator::ColorSpace &colorSpace, uint accelFactor);
+
+    static QPoint mapToCircle(const QSize &targetSize, const QPointF &point);
     static const double scaling;
 
 Q_SIGNALS:
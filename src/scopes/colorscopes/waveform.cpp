@@ -221,16 +221,31 @@ QImage Waveform::renderHUD(uint)
     return hud;
 }
 
-QImage Waveform::renderGfxScope(uint accelFactor, const QImage &qimage)
+QSize Waveform::waveformSize()
+{
+    return scopeRect().size() - QSize(m_textWidth + 2 * offset, 0) - QSize(0, m_paddingBottom);
+}
+
+ITURec Waveform::rec() const
+{
+    return m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
+}
+
+ScopeAnalysis::Request Waveform::analysisRequest(uint accelFactor)
+{
+    ScopeAnalysis::Request request;
+    WaveformGenerator::addToRequest(request, waveformSize(), devicePixelRatioF(), rec(), accelFactor);
+    return request;
+}
+
+QImage Waveform::renderGfxScope(uint, const ScopeAnalysis &analysis)
 {
     QElapsedTimer timer;
     timer.start();
 
     const int paintmode = m_ui->paintMode->itemData(m_ui->paintMode->currentIndex()).toInt();
-    ITURec rec = m_aRec601->isChecked() ? ITURec::Rec_601 : ITURec::Rec_709;
     qreal scalingFactor = devicePixelRatioF();
-    QImage wave = m_waveformGenerator->calculateWaveform((scopeRect().size() - QSize(m_textWidth + 2 * offset, 0) - QSize(0, m_paddingBottom)), scalingFactor,
-                                                         qimage, WaveformGenerator::PaintMode(paintmode), true, rec, accelFactor);
+    QImage wave = m_waveformGenerator->calculateWaveform(waveformSize(), scalingFactor, analysis, WaveformGenerator::PaintMode(paintmode), true);
 
     Q_EMIT signalScopeRenderingFinished(uint(timer.elapsed()), 1);
     return wave;
@@ -46,10 +46,15 @@ private:
 
     QImage m_waveform;
 
+    /** @brief Size of the image computed by the generator */
+    QSize waveformSize();
+    ITURec rec() const;
+
     /// Implemented methods ///
     QRect scopeRect() override;
     QImage renderHUD(uint) override;
-    QImage renderGfxScope(uint, const QImage &) override;
+    ScopeAnalysis::Request analysisRequest(uint accelFactor) override;
+    QImage renderGfxScope(uint, const ScopeAnalysis &analysis) override;
     QImage renderBackground(uint) override;
     bool isHUDDependingOnInput() const override;
     bool isScopeDependingOnInput() const override;
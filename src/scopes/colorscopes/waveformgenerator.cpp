@@ -6,6 +6,7 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 */
 
 #include "waveformgenerator.h"
+#include "scopeframe.h"
 
 #include <cmath>
 
@@ -21,15 +22,116 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 
 const uchar WaveformGenerator::distBorder(2);
 
+namespace {
+// Largest tone mapping table, higher bin counts are mapped directly
+constexpr uint maxToneTableSize = 1 << 16;
+
+// Scaled bin value from which the color of a paint mode does not change anymore
+float saturationValue(WaveformGenerator::PaintMode paintMode)
+{
+    switch (paintMode) {
+    case WaveformGenerator::PaintMode_Green:
+        // 52 * log(0.1 * value) reaches 255
+        return 1400.f;
+    case WaveformGenerator::PaintMode_Yellow:
+        return 256.f;
+    default:
+        return 128.f;
+    }
+}
+
+QRgb toneColor(WaveformGenerator::PaintMode paintMode, float gain, uint count, QRgb background)
+{
+    switch (paintMode) {
+    case WaveformGenerator::PaintMode_Green: {
+        // Logarithmic scale. Needs fine tuning by hand, but looks great.
+        float value = gain * float(count);
+        float logValue = value > 0.0f ? logf(value) : 0.0f;
+
+        float rValue = 0.1f * value;
+        float gValue = value;
+        float bValue = 0.25f * value;
+
+        float logR = rValue > 0.0f ? logf(rValue) : 0.0f;
+        float logG = gValue > 0.0f ? logf(gValue) : 0.0f;
+        float logB = bValue > 0.0f ? logf(bValue) : 0.0f;
+
+        int alpha = CHOP255(64 * logValue);
+        int inv_alpha = 255 - alpha;
+        return qRgba(CHOP255((qRed(background) * inv_alpha + 52 * logR * alpha) / 255), CHOP255((qGreen(background) * inv_alpha + 52 * logG * alpha) / 255),
+                     CHOP255((qBlue(background) * inv_alpha + 52 * logB * alpha) / 255), 255);
+    }
+    case WaveformGenerator::PaintMode_Yellow: {
+        int alpha = CHOP255(gain * float(count));
+        int inv_alpha = 255 - alpha;
+        return qRgba(CHOP255((qRed(background) * inv_alpha + 255 * alpha) / 255), CHOP255((qGreen(background) * inv_alpha + 242 * alpha) / 255),
+                     CHOP255((qBlue(background) * inv_alpha + 0 * alpha) / 255), 255);
+    }
+    default: { // White mode
+        int alpha = CHOP255(2.f * gain * float(count));
+        int inv_alpha = 255 - alpha;
+        return qRgba(CHOP255((qRed(background) * inv_alpha + 255 * alpha) / 255), CHOP255((qGreen(background) * inv_alpha + 255 * alpha) / 255),
+                     CHOP255((qBlue(background) * inv_alpha + 255 * alpha) / 255), 255);
+    }
+    }
+}
+} // namespace
+
 WaveformGenerator::WaveformGenerator() = default;
 
 WaveformGenerator::~WaveformGenerator() = default;
 
+void WaveformGenerator::updateToneTable(PaintMode paintMode, float gain, QRgb background)
+{
+    if (!m_toneTable.empty() && m_toneMode == paintMode && m_toneGain == gain && m_toneBackground == background) {
+        return;
+    }
+    m_toneMode = paintMode;
+    m_toneGain = gain;
+    m_toneBackground = background;
+    const float saturatedCount = saturationValue(paintMode) / gain + 2;
+    const uint size = saturatedCount < float(maxToneTableSize) ? uint(saturatedCount) : maxToneTableSize;
+    m_toneTable.resize(size);
+    for (uint count = 0; count < size; ++count) {
+        m_toneTable[count] = toneColor(paintMode, gain, count, background);
+    }
+}
+
 QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, qreal scalingFactor, const QImage &image, const WaveformGenerator::PaintMode paintMode,
                                             bool drawAxis, ITURec rec, uint accelFactor)
+{
+    return calculateWaveform(waveformSize, scalingFactor, ScopeFrame(image), paintMode, drawAxis, rec, accelFactor);
+}
+
+QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, qreal scalingFactor, const ScopeFrame &frame,
+                                            const WaveformGenerator::PaintMode paintMode, bool drawAxis, ITURec rec, uint accelFactor)
 {
     Q_ASSERT(accelFactor >= 1);
+    ScopeAnalysis::Request request;
+    addToRequest(request, waveformSize, scalingFactor, rec, accelFactor);
+    ScopeAnalysis analysis(frame, request);
+    analysis.run();
+    return calculateWaveform(waveformSize, scalingFactor, analysis, paintMode, drawAxis);
+}
 
+void WaveformGenerator::addToRequest(ScopeAnalysis::Request &request, const QSize &waveformSize, qreal scalingFactor, ITURec rec, uint accelFactor)
+{
+    // The bins cover the scope area, excluding borders
+    const QSize scaledWaveformSize = waveformSize * scalingFactor;
+    const int scopeW = int(scaledWaveformSize.width() - 2 * (distBorder * scalingFactor));
+    const int scopeH = int(scaledWaveformSize.height() - 2 * (distBorder * scalingFactor));
+    ScopeAnalysis::Request waveform;
+    if (scaledWaveformSize.width() > 0 && scaledWaveformSize.height() > 0 && scopeW > 0 && scopeH > 0) {
+        waveform.waveformBins = QSize(scopeW, scopeH);
+    }
+    waveform.waveformRec = rec;
+    waveform.accelFactor = accelFactor;
+    request.merge(waveform);
+}
+
+QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, qreal scalingFactor, const ScopeAnalysis &analysis,
+                                            const WaveformGenerator::PaintMode paintMode, bool drawAxis)
+{
     // QTime time;
     // time.start();
 
@@ -37,60 +139,39 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, qreal sca
     QImage wave(scaledWaveformSize, QImage::Format_ARGB32);
     wave.setDevicePixelRatio(scalingFactor);
 
-    if (scaledWaveformSize.width() <= 0 || scaledWaveformSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
+    const ScopeFrame &frame = analysis.frame();
+    if (scaledWaveformSize.width() <= 0 || scaledWaveformSize.height() <= 0 || frame.width() <= 0 || frame.height() <= 0 || !analysis.isValid()) {
         return QImage();
     }
 
-    QPainter davinci;
-    bool ok = davinci.begin(&wave);
-    if (!ok) {
-        qDebug() << "Could not initialise QPainter for Waveform.";
-        return wave;
-    }
-
     const uint ww = uint(scaledWaveformSize.width());
     const uint wh = uint(scaledWaveformSize.height());
-    const uint iw = uint(image.width());
-    const auto totalPixels = image.width() * image.height();
+    const auto totalPixels = frame.width() * frame.height();
 
     // Calculate the actual scope area dimensions (excluding borders)
     const uint scopeW = ww - 2 * (distBorder * scalingFactor);
     const uint scopeH = wh - 2 * (distBorder * scalingFactor);
     const uint scopeWLogicalPixels = waveformSize.width() - 2 * distBorder;
     const uint scopeHLogicalPixels = waveformSize.height() - 2 * distBorder;
+    if (analysis.request().waveformBins != QSize(int(scopeW), int(scopeH))) {
+        return QImage();
+    }
 
-    std::vector<std::vector<uint>> waveValues(size_t(scopeW), std::vector<uint>(size_t(scopeH), 0));
+    QPainter davinci;
+    bool ok = davinci.begin(&wave);
+    if (!ok) {
+        qDebug() << "Could not initialise QPainter for Waveform.";
+        return wave;
+    }
+
+    // Bins are stored row by row, one row per luma level
+    const uint *bins = analysis.bins().waveform.data();
 
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = float(totalPixels / accelFactor) / (scopeW * scopeH);
+    const float pixelDepth = float(totalPixels / analysis.step()) / (scopeW * scopeH);
     const float gain = 255.f / (8 * pixelDepth);
 
-    // Subtract 1 from sizes because we start counting from 0.
-    // Not doing it would result in attempts to paint outside of the image.
-    const float hPrediv = (scopeH - 1) / 255.f;
-    const float wPrediv = (scopeW - 1) / float(iw - 1);
-
-    for (int i = 0; i < totalPixels; i += accelFactor) {
-        const int x = i % image.width();
-        const QRgb pixel = image.pixel(x, i / image.width());
-
-        float dY, dx, dy;
-
-        if (rec == ITURec::Rec_601) {
-            // CIE 601 Luminance
-            dY = REC_601_R * qRed(pixel) + REC_601_G * qGreen(pixel) + REC_601_B * qBlue(pixel);
-        } else {
-            // CIE 709 Luminance
-            dY = REC_709_R * qRed(pixel) + REC_709_G * qGreen(pixel) + REC_709_B * qBlue(pixel);
-        }
-        // dY is on [0,255] now.
-
-        dy = dY * hPrediv;
-        dx = x * wPrediv;
-        waveValues[size_t(dx)][size_t(dy)]++;
-    }
-
     // Fill background of the parade with "dark2" color from AbstractScopeWidget instead of themes base color as the different paint modes are optimized
     // for a dark background.
     QColor darkBackground(25, 25, 23, 255);
@@ -104,55 +185,17 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, qreal sca
 
     QRgb darkBackgroundRgb = darkBackground.rgb();
 
-    switch (paintMode) {
-    case PaintMode_Green:
-        for (int i = 0; i < int(scopeW); ++i) {
-            for (int j = 0; j < int(scopeH); ++j) {
-                // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                float value = gain * float(waveValues[size_t(i)][size_t(j)]);
-                float logValue = value > 0.0f ? logf(value) : 0.0f;
-
-                float rValue = 0.1f * value;
-                float gValue = value;
-                float bValue = 0.25f * value;
-
-                float logR = rValue > 0.0f ? logf(rValue) : 0.0f;
-                float logG = gValue > 0.0f ? logf(gValue) : 0.0f;
-                float logB = bValue > 0.0f ? logf(bValue) : 0.0f;
-
-                int alpha = CHOP255(64 * logValue);
-                int inv_alpha = 255 - alpha;
-                wave.setPixel(i + distBorder, int(scopeH + distBorder) - j - 1,
-                              qRgba(CHOP255((qRed(darkBackgroundRgb) * inv_alpha + 52 * logR * alpha) / 255),
-                                    CHOP255((qGreen(darkBackgroundRgb) * inv_alpha + 52 * logG * alpha) / 255),
-                                    CHOP255((qBlue(darkBackgroundRgb) * inv_alpha + 52 * logB * alpha) / 255), 255));
-            }
-        }
-        break;
-    case PaintMode_Yellow:
-        for (int i = 0; i < int(scopeW); ++i) {
-            for (int j = 0; j < int(scopeH); ++j) {
-                int alpha = CHOP255(gain * float(waveValues[size_t(i)][size_t(j)]));
-                int inv_alpha = 255 - alpha;
-                wave.setPixel(i + distBorder, int(scopeH + distBorder) - j - 1,
-                              qRgba(CHOP255((qRed(darkBackgroundRgb) * inv_alpha + 255 * alpha) / 255),
-                                    CHOP255((qGreen(darkBackgroundRgb) * inv_alpha + 242 * alpha) / 255),
-                                    CHOP255((qBlue(darkBackgroundRgb) * inv_alpha + 0 * alpha) / 255), 255));
-            }
-        }
-        break;
-    default: // White mode
-        for (int i = 0; i < int(scopeW); ++i) {
-            for (int j = 0; j < int(scopeH); ++j) {
-                int alpha = CHOP255(2.f * gain * float(waveValues[size_t(i)][size_t(j)]));
-                int inv_alpha = 255 - alpha;
-                wave.setPixel(i + distBorder, int(scopeH + distBorder) - j - 1,
-                              qRgba(CHOP255((qRed(darkBackgroundRgb) * inv_alpha + 255 * alpha) / 255),
-                                    CHOP255((qGreen(darkBackgroundRgb) * inv_alpha + 255 * alpha) / 255),
-                                    CHOP255((qBlue(darkBackgroundRgb) * inv_alpha + 255 * alpha) / 255), 255));
-            }
+    // Bin counts are mapped to colors through a table, only counts beyond it need computing
+    updateToneTable(paintMode, gain, darkBackgroundRgb);
+    const QRgb *toneTable = m_toneTable.data();
+    const uint toneTableSize = uint(m_toneTable.size());
+    for (uint j = 0; j < scopeH; ++j) {
+        auto *line = reinterpret_cast<QRgb *>(wave.scanLine(int(scopeH + distBorder - j - 1))) + distBorder;
+        const uint *row = bins + size_t(j) * scopeW;
+        for (uint i = 0; i < scopeW; ++i) {
+            const uint count = row[i];
+            line[i] = count < toneTableSize ? toneTable[count] : toneColor(paintMode, gain, count, darkBackgroundRgb);
         }
-        break;
     }
 
     if (drawAxis) {
@@ -8,11 +8,15 @@ SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
 #pragma once
 
 #include "colorconstants.h"
+#include "scopeanalysis.h"
 #include <QObject>
 #include <QPalette>
+#include <QRgb>
+#include <vector>
 
 class QImage;
 class QSize;
+class ScopeFrame;
 
 class WaveformGenerator : public QObject
 {
@@ -26,5 +30,21 @@ public:
 
     QImage calculateWaveform(const QSize &waveformSize, qreal scalingFactor, const QImage &image, const WaveformGenerator::PaintMode paintMode, bool drawAxis,
                              const ITURec rec, uint accelFactor = 1);
+    /** @brief Same as above, reading the luma directly from the Y' samples of Y'CbCr frames when they match rec */
+    QImage calculateWaveform(const QSize &waveformSize, qreal scalingFactor, const ScopeFrame &frame, const WaveformGenerator::PaintMode paintMode,
+                             bool drawAxis, const ITURec rec, uint accelFactor = 1);
+    /** @brief Same as above, from the bins of an analysis that was run with the request of addToRequest() */
+    QImage calculateWaveform(const QSize &waveformSize, qreal scalingFactor, const ScopeAnalysis &analysis, const WaveformGenerator::PaintMode paintMode,
+                             bool drawAxis);
+    /** @brief Adds what calculateWaveform() needs to an analysis request */
+    static void addToRequest(ScopeAnalysis::Request &request, const QSize &waveformSize, qreal scalingFactor, const ITURec rec, uint accelFactor);
     static const uchar distBorder;
+
+private:
+    /** @brief Colors of the first bin counts for the current paint mode and gain */
+    std::vector<QRgb> m_toneTable;
+    PaintMode m_toneMode{PaintMode_Green};
+    float m_toneGain{0};
+    QRgb m_toneBackground{0};
+    void updateToneTable(PaintMode paintMode, float gain, QRgb background);
 };
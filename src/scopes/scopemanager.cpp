@@ -121,28 +121,39 @@ void ScopeManager::slotDistributeAudio(const audioShortVector &sampleData, int f
         }
     }
 }
-void ScopeManager::slotDistributeFrame(const QImage &image)
+void ScopeManager::slotDistributeFrame(const ScopeFrame &frame)
 {
 #ifdef DEBUG_SM
     qCDebug(KDENLIVE_LOG) << "ScopeManager: Starting to distribute frame.";
 #endif
+    // Collect the scopes receiving this frame so that it is only read once for all of them
+    QList<GfxScopeData *> recipients;
+    ScopeAnalysis::Request request;
     for (auto &m_colorScope : m_colorScopes) {
-        if (!m_colorScope.scope->visibleRegion().isEmpty()) {
-            if (m_colorScope.scope->autoRefreshEnabled()) {
-                m_colorScope.scope->slotRenderZoneUpdated(image);
+        if (!m_colorScope.scope->visibleRegion().isEmpty() && (m_colorScope.scope->autoRefreshEnabled() || m_colorScope.singleFrameRequested)) {
+            recipients << &m_colorScope;
+            request.merge(m_colorScope.scope->currentAnalysisRequest());
+        }
+    }
+    if (recipients.isEmpty()) {
+        return;
+    }
+    auto analysis = std::make_shared<ScopeAnalysis>(frame, request);
+    for (GfxScopeData *m_colorScope : std::as_const(recipients)) {
+        if (m_colorScope->scope->autoRefreshEnabled()) {
+            m_colorScope->scope->slotRenderZoneUpdated(analysis);
 #ifdef DEBUG_SM
-                qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed frame to " << m_colorScopes[i].scope->widgetName();
+            qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed frame to " << m_colorScope->scope->widgetName();
 #endif
-            } else if (m_colorScope.singleFrameRequested) {
-                // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
-                // Force the scope to update.
-                m_colorScope.singleFrameRequested = false;
-                m_colorScope.scope->slotRenderZoneUpdated(image);
-                m_colorScope.scope->forceUpdateScope();
+        } else {
+            // Special case: Auto refresh is disabled, but user requested an update (e.g. by clicking).
+            // Force the scope to update.
+            m_colorScope->singleFrameRequested = false;
+            m_colorScope->scope->slotRenderZoneUpdated(analysis);
+            m_colorScope->scope->forceUpdateScope();
 #ifdef DEBUG_SM
-                qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed forced frame to " << m_colorScopes[i].scope->widgetName();
+            qCDebug(KDENLIVE_LOG) << "ScopeManager: Distributed forced frame to " << m_colorScope->scope->widgetName();
 #endif
-            }
         }
     }
     // checkActiveColourScopes();
@@ -201,7 +212,7 @@ void ScopeManager::slotUpdateActiveRenderer()
 
     // Connect new renderer
     if (m_lastConnectedRenderer != nullptr) {
-        connect(m_lastConnectedRenderer, &Monitor::frameUpdated, this, &ScopeManager::slotDistributeFrame, Qt::UniqueConnection);
+        connect(m_lastConnectedRenderer, &Monitor::scopeFrameUpdated, this, &ScopeManager::slotDistributeFrame, Qt::UniqueConnection);
         connect(m_lastConnectedRenderer, &Monitor::audioSamplesSignal, this, &ScopeManager::slotDistributeAudio, Qt::UniqueConnection);
 
 #ifdef DEBUG_SM
@@ -7630,9 +7630,14 @@ void TimelineModel::loadPreview(const QString &chunks, const QString &dirty, boo
     }
     if (!hasTimelinePreview()) {
         initializePreviewManager();
+        if (!hasTimelinePreview()) {
+            return;
+        }
     }
-    QVariantList renderedChunks;
-    QVariantList dirtyChunks;
+    // Ranges saved with another chunk size are realigned by the preview manager
+    const int chunkSize = m_timelinePreview->m_renderedChunks.step();
+    QList<int> renderedChunks;
+    QList<int> dirtyChunks;
     QStringList chunksList = chunks.split(QLatin1Char(','), Qt::SkipEmptyParts);
     QStringList dirtyList = dirty.split(QLatin1Char(','), Qt::SkipEmptyParts);
     for (const QString &frame : std::as_const(chunksList)) {
@@ -7640,7 +7645,7 @@ void TimelineModel::loadPreview(const QString &chunks, const QString &dirty, boo
             // Range, process
             int start = frame.section(QLatin1Char('-'), 0, 0).toInt();
             int end = frame.section(QLatin1Char('-'), 1, 1).toInt();
-            for (int i = start; i <= end; i += 25) {
+            for (int i = start; i <= end; i += chunkSize) {
                 renderedChunks << i;
             }
         } else {
@@ -7652,7 +7657,7 @@ void TimelineModel::loadPreview(const QString &chunks, const QString &dirty, boo
             // Range, process
             int start = frame.section(QLatin1Char('-'), 0, 0).toInt();
             int end = frame.section(QLatin1Char('-'), 1, 1).toInt();
-            for (int i = start; i <= end; i += 25) {
+            for (int i = start; i <= end; i += chunkSize) {
                 dirtyChunks << i;
             }
         } else {
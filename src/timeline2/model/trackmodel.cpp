@@ -19,9 +19,29 @@
 #include "timelinemodel.hpp"
 #include <QDebug>
 #include <QModelIndex>
+#include <algorithm>
 #include <memory>
 #include <mlt++/MltTransition.h>
 
+namespace {
+// Rows are kept sorted by id. New items usually have the highest id, so they are appended.
+void addRow(std::vector<int> &rows, int id)
+{
+    auto it = std::lower_bound(rows.begin(), rows.end(), id);
+    if (it == rows.end() || *it != id) {
+        rows.insert(it, id);
+    }
+}
+
+void removeRow(std::vector<int> &rows, int id)
+{
+    auto it = std::lower_bound(rows.begin(), rows.end(), id);
+    if (it != rows.end() && *it == id) {
+        rows.erase(it);
+    }
+}
+} // namespace
+
 TrackModel::TrackModel(const std::weak_ptr<TimelineModel> &parent, int id, const QString &trackName, bool audioTrack)
     : m_parent(parent)
     , m_id(id == -1 ? TimelineModel::getNextId() : id)
@@ -115,6 +135,8 @@ TrackModel::~TrackModel()
         m_sameCompositions.clear();
         m_allClips.clear();
         m_allCompositions.clear();
+        m_clipRows.clear();
+        m_compositionRows.clear();
         m_track->remove_track(1);
         m_track->remove_track(0);
     }
@@ -196,6 +218,7 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
         if (auto ptr = m_parent.lock()) {
             std::shared_ptr<ClipModel> clip = ptr->getClipPtr(clipId);
             m_allClips[clip->getId()] = clip; // store clip
+            addRow(m_clipRows, clipId);
             // update clip position and track
             clip->setPosition(position);
             if (finalMove) {
@@ -443,6 +466,7 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
             m_allClips[clipId]->setCurrentTrackId(-1);
             // m_allClips[clipId]->setSubPlaylistIndex(-1);
             m_allClips.erase(clipId);
+            removeRow(m_clipRows, clipId);
             delete prod;
             field->unblock();
             m_playlists[target_track].unlock();
@@ -906,12 +930,10 @@ int TrackModel::getCompositionByPosition(int position)
 int TrackModel::getClipByRow(int row) const
 {
     READ_LOCK();
-    if (row >= static_cast<int>(m_allClips.size())) {
+    if (row < 0 || row >= static_cast<int>(m_clipRows.size())) {
         return -1;
     }
-    auto it = m_allClips.cbegin();
-    std::advance(it, row);
-    return (*it).first;
+    return m_clipRows[size_t(row)];
 }
 
 std::unordered_set<int> TrackModel::getClipsInRange(int position, int end)
@@ -935,7 +957,7 @@ int TrackModel::getRowfromClip(int clipId) const
 {
     READ_LOCK();
     Q_ASSERT(m_allClips.count(clipId) > 0);
-    return int(std::distance(m_allClips.begin(), m_allClips.find(clipId)));
+    return int(std::lower_bound(m_clipRows.cbegin(), m_clipRows.cend(), clipId) - m_clipRows.cbegin());
 }
 
 std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end)
@@ -961,7 +983,7 @@ int TrackModel::getRowfromComposition(int tid) const
 {
     READ_LOCK();
     Q_ASSERT(m_allCompositions.count(tid) > 0);
-    return int(m_allClips.size()) + int(std::distance(m_allCompositions.begin(), m_allCompositions.find(tid)));
+    return int(m_clipRows.size()) + int(std::lower_bound(m_compositionRows.cbegin(), m_compositionRows.cend(), tid) - m_compositionRows.cbegin());
 }
 
 QVariant TrackModel::getProperty(const QString &name) const
@@ -1005,6 +1027,18 @@ bool TrackModel::checkConsistency()
         }
         return true;
     };
+    // The row indexes must list the ids of the maps, in the same order
+    if (m_clipRows.size() != m_allClips.size() || !std::equal(m_clipRows.cbegin(), m_clipRows.cend(), m_allClips.cbegin(),
+                                                               [](int id, const auto &clip) { return id == clip.first; })) {
+        qDebug() << "Error: the clip rows don't match the clips of the track";
+        return false;
+    }
+    if (m_compositionRows.size() != m_allCompositions.size() ||
+        !std::equal(m_compositionRows.cbegin(), m_compositionRows.cend(), m_allCompositions.cbegin(),
+                    [](int id, const auto &compo) { return id == compo.first; })) {
+        qDebug() << "Error: the composition rows don't match the compositions of the track";
+        return false;
+    }
     std::vector<std::pair<int, int>> clips; // clips stored by (position, id)
     for (const auto &c : m_allClips) {
         Q_ASSERT(c.second);
@@ -1481,6 +1515,7 @@ Fun TrackModel::requestCompositionDeletion_lambda(int compoId, bool updateView,
         }
         m_allCompositions[compoId]->setCurrentTrackId(-1);
         m_allCompositions.erase(compoId);
+        removeRow(m_compositionRows, compoId);
         m_compoPos.erase(old_in);
         ptr->m_snaps->removePoint(old_in);
         ptr->m_snaps->removePoint(old_out);
@@ -1498,9 +1533,7 @@ int TrackModel::getCompositionByRow(int row) const
         return -1;
     }
     Q_ASSERT(row <= int(m_allClips.size() + m_allCompositions.size()));
-    auto it = m_allCompositions.cbegin();
-    std::advance(it, row - int(m_allClips.size()));
-    return (*it).first;
+    return m_compositionRows[size_t(row) - m_clipRows.size()];
 }
 
 int TrackModel::getCompositionsCount() const
@@ -1524,6 +1557,7 @@ Fun TrackModel::requestCompositionInsertion_lambda(int compoId, int position, bo
             if (auto ptr = m_parent.lock()) {
                 std::shared_ptr<CompositionModel> composition = ptr->getCompositionPtr(compoId);
                 m_allCompositions[composition->getId()] = composition; // store clip
+                addRow(m_compositionRows, compoId);
                 // update clip position and track
                 composition->setCurrentTrackId(getId());
                 int new_in = position;
@@ -366,6 +366,9 @@ private:
     std::map<int, std::shared_ptr<ClipModel>> m_allClips;
     /** This is important to keep an ordered structure to store the compositions, since we use their ids order as row order*/
     std::map<int, std::shared_ptr<CompositionModel>> m_allCompositions;
+    /** @brief The sorted ids of m_allClips and m_allCompositions, so that rows and ids are converted without walking the maps */
+    std::vector<int> m_clipRows;
+    std::vector<int> m_compositionRows;
 
     /** We store the positions of the compositions. In Melt, the compositions are not inserted at the track level, but we keep
      *  those positions here to check for moves and resize
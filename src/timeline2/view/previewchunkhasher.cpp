@@ -0,0 +1,305 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "previewchunkhasher.h"
+
+#include <mlt++/MltChain.h>
+#include <mlt++/MltFilter.h>
+#include <mlt++/MltLink.h>
+#include <mlt++/MltPlaylist.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltTractor.h>
+#include <mlt++/MltTransition.h>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+void addInt(QCryptographicHash &hash, qint64 value)
+{
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(&value), sizeof(value)));
+}
+} // namespace
+
+PreviewChunkHasher::PreviewChunkHasher(Mlt::Tractor *tractor, const QByteArray &seed)
+    : m_tractor(tractor)
+    , m_seed(seed)
+{
+}
+
+QString PreviewChunkHasher::chunkKey(int start, int end)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(m_seed);
+    addTractor(hash, *m_tractor, start, end, true);
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+void PreviewChunkHasher::addTractor(QCryptographicHash &hash, Mlt::Tractor &tractor, int start, int end, bool isTimeline)
+{
+    for (int i = 0; i < tractor.filter_count(); ++i) {
+        QScopedPointer<Mlt::Filter> filter(tractor.filter(i));
+        if (filter && filter->is_valid()) {
+            addTimelineService(hash, *filter.data(), filter->get_in(), filter->get_out(), start, end, false);
+        }
+    }
+    const int count = tractor.count();
+    for (int i = 0; i < count; ++i) {
+        QScopedPointer<Mlt::Producer> track(tractor.track(i));
+        if (!track || !track->is_valid()) {
+            continue;
+        }
+        if (isTimeline) {
+            const QByteArray playlistId(track->get("kdenlive:playlistid"));
+            if (playlistId == "timeline_preview" || playlistId == "timeline_overlay") {
+                continue;
+            }
+        }
+        const int hide = track->get_int("hide");
+        if (hide & 1) {
+            // Hidden or audio track, the preview has no audio
+            continue;
+        }
+        addInt(hash, i);
+        addInt(hash, hide);
+        addRange(hash, *track.data(), start, end);
+    }
+    // Compositions, and filters planted on the tractor
+    QScopedPointer<Mlt::Service> service(tractor.producer());
+    while (service && service->is_valid()) {
+        if (service->type() == mlt_service_transition_type) {
+            Mlt::Transition transition(mlt_transition(service->get_service()));
+            addTimelineService(hash, transition, transition.get_in(), transition.get_out(), start, end, true);
+        } else if (service->type() == mlt_service_filter_type) {
+            Mlt::Filter filter(mlt_filter(service->get_service()));
+            addTimelineService(hash, filter, filter.get_in(), filter.get_out(), start, end, false);
+        } else {
+            // Reached the tracks
+            break;
+        }
+        service.reset(service->producer());
+    }
+}
+
+void PreviewChunkHasher::addPlaylist(QCryptographicHash &hash, Mlt::Playlist &playlist, int start, int end)
+{
+    for (int i = 0; i < playlist.filter_count(); ++i) {
+        QScopedPointer<Mlt::Filter> filter(playlist.filter(i));
+        if (filter && filter->is_valid()) {
+            addTimelineService(hash, *filter.data(), filter->get_in(), filter->get_out(), start, end, false);
+        }
+    }
+    const int count = playlist.count();
+    for (int i = qMax(0, playlist.get_clip_index_at(start)); i < count; ++i) {
+        const int clipStart = playlist.clip_start(i);
+        if (clipStart > end) {
+            break;
+        }
+        if (playlist.is_blank(i)) {
+            continue;
+        }
+        QScopedPointer<Mlt::Producer> clip(playlist.get_clip(i));
+        if (clip && clip->is_valid()) {
+            addClip(hash, *clip.data(), clipStart, start, end);
+        }
+    }
+}
+
+void PreviewChunkHasher::addRange(QCryptographicHash &hash, Mlt::Producer &producer, int start, int end)
+{
+    switch (producer.type()) {
+    case mlt_service_playlist_type: {
+        Mlt::Playlist playlist(producer);
+        addPlaylist(hash, playlist, start, end);
+        break;
+    }
+    case mlt_service_tractor_type: {
+        Mlt::Tractor tractor(producer);
+        addTractor(hash, tractor, start, end, false);
+        break;
+    }
+    default:
+        // A producer used as a track, like the black background
+        addClip(hash, producer, 0, start, end);
+        break;
+    }
+}
+
+void PreviewChunkHasher::addClip(QCryptographicHash &hash, Mlt::Producer &clip, int position, int start, int end)
+{
+    const Hashed clipData = clipHash(clip);
+    if (clipData.isStill) {
+        // Only the frames covered by the clip matter
+        addInt(hash, qMax(position, start) - start);
+        addInt(hash, qMin(position + clip.get_playtime() - 1, end) - start);
+    } else {
+        addInt(hash, position - start);
+    }
+    hash.addData(clipData.hash);
+}
+
+void PreviewChunkHasher::addTimelineService(QCryptographicHash &hash, Mlt::Service &service, int in, int out, int start, int end, bool isTransition)
+{
+    // An out point of 0 means the service has no end
+    const bool unbounded = out <= 0;
+    if (in > end || (!unbounded && out < start)) {
+        return;
+    }
+    const bool animated = addProperties(hash, service, true);
+    // Transitions progress from their in to their out point, except the internal ones compositing the tracks
+    const bool timeInvariant = isTransition ? service.get_int("internal_added") > 0 : !animated;
+    if (timeInvariant) {
+        // Only the frames covered by the service matter
+        addInt(hash, qMax(in, start) - start);
+        addInt(hash, unbounded ? end - start : qMin(out, end) - start);
+    } else {
+        addInt(hash, in - start);
+        addInt(hash, unbounded ? -1 : out - start);
+    }
+}
+
+PreviewChunkHasher::Hashed PreviewChunkHasher::clipHash(Mlt::Producer &clip)
+{
+    void *key = clip.get_service();
+    auto it = m_cache.constFind(key);
+    if (it != m_cache.constEnd()) {
+        return *it;
+    }
+    if (!clip.is_cut()) {
+        return producerHash(clip);
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    const Hashed parent = producerHash(clip.parent());
+    hash.addData(parent.hash);
+    bool animated = addProperties(hash, clip, true);
+    animated = addFilters(hash, clip) || animated;
+    Hashed result{QByteArray(), parent.isStill && !animated};
+    if (!result.isStill) {
+        addInt(hash, clip.get_in());
+        addInt(hash, clip.get_out());
+    }
+    result.hash = hash.result();
+    m_cache.insert(key, result);
+    return result;
+}
+
+PreviewChunkHasher::Hashed PreviewChunkHasher::producerHash(Mlt::Producer &producer)
+{
+    void *key = producer.get_service();
+    auto it = m_cache.constFind(key);
+    if (it != m_cache.constEnd()) {
+        return *it;
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    bool isStill = false;
+    switch (producer.type()) {
+    case mlt_service_playlist_type: {
+        // Playlist or sequence clip, use all its frames
+        Mlt::Playlist playlist(producer);
+        addPlaylist(hash, playlist, 0, producer.get_length() - 1);
+        break;
+    }
+    case mlt_service_tractor_type: {
+        Mlt::Tractor tractor(producer);
+        addTractor(hash, tractor, 0, producer.get_length() - 1, false);
+        break;
+    }
+    default: {
+        bool animated = addProperties(hash, producer, false);
+        animated = addFilters(hash, producer) || animated;
+        addSource(hash, producer);
+        if (producer.type() == mlt_service_chain_type) {
+            Mlt::Chain chain(producer);
+            for (int i = 0; i < chain.link_count(); ++i) {
+                QScopedPointer<Mlt::Link> link(chain.link(i));
+                if (link && link->is_valid()) {
+                    addProperties(hash, *link.data(), false);
+                    animated = true;
+                }
+            }
+        }
+        // Colors, and single images (not sequences)
+        const QByteArray service(producer.get("mlt_service"));
+        const QByteArray resource(producer.get("resource"));
+        const bool stillService = service == "color" || service == "colour" ||
+                                  ((service == "qimage" || service == "pixbuf") && !resource.contains('%') && !resource.contains(".all."));
+        isStill = stillService && !animated;
+        break;
+    }
+    }
+    const Hashed result{hash.result(), isStill};
+    m_cache.insert(key, result);
+    return result;
+}
+
+bool PreviewChunkHasher::addProperties(QCryptographicHash &hash, Mlt::Properties &properties, bool skipRange)
+{
+    bool animated = false;
+    std::vector<std::pair<const char *, const char *>> values;
+    const int count = properties.count();
+    values.reserve(size_t(count));
+    for (int i = 0; i < count; ++i) {
+        const char *name = properties.get_name(i);
+        if (name == nullptr || name[0] == '_' || strncmp(name, "kdenlive:", 9) == 0 || strncmp(name, "meta.", 5) == 0) {
+            continue;
+        }
+        if (skipRange && (strcmp(name, "in") == 0 || strcmp(name, "out") == 0 || strcmp(name, "length") == 0)) {
+            continue;
+        }
+        const char *value = properties.get(i);
+        if (value == nullptr) {
+            continue;
+        }
+        // Keyframes (frame=value), or text keywords like #timecode# which change with the position
+        const char *keyword = strchr(value, '#');
+        if (strchr(value, '=') != nullptr || (keyword != nullptr && strchr(keyword + 1, '#') != nullptr)) {
+            animated = true;
+        }
+        values.emplace_back(name, value);
+    }
+    std::sort(values.begin(), values.end(), [](const std::pair<const char *, const char *> &a, const std::pair<const char *, const char *> &b) {
+        return strcmp(a.first, b.first) < 0;
+    });
+    for (const auto &[name, value] : values) {
+        // Include the terminating zeros to separate the strings
+        hash.addData(QByteArrayView(name, qsizetype(strlen(name) + 1)));
+        hash.addData(QByteArrayView(value, qsizetype(strlen(value) + 1)));
+    }
+    return animated;
+}
+
+void PreviewChunkHasher::addSource(QCryptographicHash &hash, Mlt::Producer &producer)
+{
+    // The properties stay the same when the file is replaced on disk and the clip reloaded
+    const char *fileHash = producer.get("kdenlive:file_hash");
+    if (fileHash != nullptr) {
+        hash.addData(QByteArrayView(fileHash, qsizetype(strlen(fileHash) + 1)));
+    }
+    const QFileInfo info(QString::fromUtf8(producer.get("resource")));
+    if (info.isFile()) {
+        addInt(hash, info.size());
+        addInt(hash, info.lastModified().toMSecsSinceEpoch());
+    }
+}
+
+bool PreviewChunkHasher::addFilters(QCryptographicHash &hash, Mlt::Service &service)
+{
+    bool animated = false;
+    for (int i = 0; i < service.filter_count(); ++i) {
+        QScopedPointer<Mlt::Filter> filter(service.filter(i));
+        if (filter && filter->is_valid()) {
+            addInt(hash, filter->get_in());
+            addInt(hash, filter->get_out());
+            animated = addProperties(hash, *filter.data(), true) || animated;
+        }
+    }
+    return animated;
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+
+namespace Mlt {
+class Playlist;
+class Producer;
+class Properties;
+class Service;
+class Tractor;
+} // namespace Mlt
+
+/** @class PreviewChunkHasher
+    @brief Computes a key identifying what the timeline renders in a frame range, used to name timeline preview chunks.
+
+    The key is a hash of the MLT services producing the range: the clips of each video track with their offset
+    from the range start, in and out points, producer and effects, and the compositions and track effects overlapping
+    the range. Two ranges with the same key render the same frames, so a chunk can be reused after an undo, when an
+    unchanged block of clips is moved by a multiple of the chunk size, or in a duplicated sequence.
+    Compositions and animated track effects change with their position, so their offset from the range start is part of
+    the key, while the internal track compositing, static effects and still clips (colors, images without animated
+    effects, like the black background track) only count for the frames they cover.
+    Hidden and audio tracks are ignored, as are the properties only used by the interface (kdenlive:, _ and meta. prefixes),
+    except the file hash which with the size and modification time of the file identifies the media.
+    The timeline must not change while a hasher is used, the hashes of the services are cached by address.
+ */
+class PreviewChunkHasher
+{
+public:
+    /** @param seed data added to all keys, for example the rendering parameters */
+    PreviewChunkHasher(Mlt::Tractor *tractor, const QByteArray &seed);
+
+    /** @brief Returns the key of the frames from @param start to @param end included, as a hex string */
+    QString chunkKey(int start, int end);
+
+private:
+    struct Hashed
+    {
+        QByteArray hash;
+        /** @brief True if all the frames are the same */
+        bool isStill;
+    };
+    Mlt::Tractor *m_tractor;
+    QByteArray m_seed;
+    /** @brief The hashes of the clips and producers, by service address */
+    QHash<void *, Hashed> m_cache;
+
+    void addTractor(QCryptographicHash &hash, Mlt::Tractor &tractor, int start, int end, bool isTimeline);
+    void addPlaylist(QCryptographicHash &hash, Mlt::Playlist &playlist, int start, int end);
+    void addRange(QCryptographicHash &hash, Mlt::Producer &producer, int start, int end);
+    /** @brief Add a composition or effect placed on the timeline, if it overlaps the range */
+    static void addTimelineService(QCryptographicHash &hash, Mlt::Service &service, int in, int out, int start, int end, bool isTransition);
+    /** @brief Add a clip placed on a track, starting at @param position */
+    void addClip(QCryptographicHash &hash, Mlt::Producer &clip, int position, int start, int end);
+    /** @brief The hash of a clip in a playlist: its in and out points, effects and producer */
+    Hashed clipHash(Mlt::Producer &clip);
+    /** @brief The hash of a producer with all its frames */
+    Hashed producerHash(Mlt::Producer &producer);
+    /** @brief Add the properties that change the rendering, sorted by name
+     *  @returns true if a property is animated
+     */
+    static bool addProperties(QCryptographicHash &hash, Mlt::Properties &properties, bool skipRange);
+    /** @brief Add what identifies the media of a producer: its file hash, and the size and modification time of its file */
+    static void addSource(QCryptographicHash &hash, Mlt::Producer &producer);
+    /** @returns true if a filter is animated */
+    static bool addFilters(QCryptographicHash &hash, Mlt::Service &service);
+};
@@ -14,32 +14,35 @@
 #include "mainwindow.h"
 #include "monitor/monitor.h"
 #include "profiles/profilemodel.hpp"
+#include "timeline2/view/previewchunkhasher.h"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinewidget.h"
 #include "xml/xml.hpp"
 
 #include <KLocalizedString>
 #include <KMessageBox>
-#include <QCollator>
 #include <QCryptographicHash>
 #include <QMutexLocker>
 #include <QSaveFile>
+#include <QSet>
 #include <QStandardPaths>
+#include <QThread>
 
 PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *parent)
     : QObject(parent)
-    , workingPreview(-1)
     , m_tractor(tractor)
     , m_uuid(uuid)
     , m_previewTrack(nullptr)
     , m_overlayTrack(nullptr)
     , m_warnOnCrash(true)
     , m_previewTrackIndex(-1)
+    , m_renderFailed(false)
     , m_initialized(false)
+    , m_renderedChunks(KdenliveSettings::timelinechunks())
+    , m_dirtyChunks(KdenliveSettings::timelinechunks())
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
-    QObject::connect(&m_previewProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &PreviewManager::processEnded);
 
     if (KdenliveSettings::kdenliverendererpath().isEmpty() || !QFileInfo::exists(KdenliveSettings::kdenliverendererpath())) {
         KdenliveSettings::setKdenliverendererpath(QString());
@@ -50,17 +53,13 @@ PreviewManager::PreviewManager(Mlt::Tractor *tractor, QUuid uuid, QObject *paren
         }
     }
 
-    connect(this, &PreviewManager::abortPreview, &m_previewProcess, &QProcess::kill, Qt::DirectConnection);
-    connect(&m_previewProcess, &QProcess::readyReadStandardError, this, &PreviewManager::receivedStderr);
+    connect(this, &PreviewManager::abortPreview, this, &PreviewManager::killWorkers, Qt::DirectConnection);
 }
 
 PreviewManager::~PreviewManager()
 {
     if (m_initialized) {
         abortRendering();
-        if (m_undoDir.dirName() == QLatin1String("undo")) {
-            m_undoDir.removeRecursively();
-        }
         if ((pCore->currentDoc()->url().isEmpty() && m_cacheDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot).isEmpty()) ||
             m_cacheDir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
             if (m_cacheDir.dirName() == QLatin1String("preview")) {
@@ -91,14 +90,13 @@ bool PreviewManager::initialize()
         return false;
     }
     if (m_uuid == doc->uuid()) {
-        if (m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir() ||
-            (!m_cacheDir.exists(QStringLiteral("undo")) && !m_cacheDir.mkdir(QStringLiteral("undo"))) || !m_cacheDir.absolutePath().contains(documentId)) {
+        if (m_cacheDir.dirName() != QLatin1String("preview") || m_cacheDir == QDir() || !m_cacheDir.absolutePath().contains(documentId)) {
             pCore->displayMessage(i18n("Something is wrong with cache folder %1", m_cacheDir.absolutePath()), ErrorMessage);
             return false;
         }
     } else {
         if (m_cacheDir.dirName().toLatin1() != QCryptographicHash::hash(m_uuid.toByteArray(), QCryptographicHash::Md5).toHex() || m_cacheDir == QDir() ||
-            (!m_cacheDir.exists(QStringLiteral("undo")) && !m_cacheDir.mkdir(QStringLiteral("undo"))) || !m_cacheDir.absolutePath().contains(documentId)) {
+            !m_cacheDir.absolutePath().contains(documentId)) {
             pCore->displayMessage(i18n("Something is wrong with cache folder %1", m_cacheDir.absolutePath()), ErrorMessage);
             return false;
         }
@@ -107,16 +105,19 @@ bool PreviewManager::initialize()
         pCore->displayMessage(i18n("Invalid timeline preview parameters"), ErrorMessage);
         return false;
     }
-    m_undoDir = QDir(m_cacheDir.absoluteFilePath(QStringLiteral("undo")));
 
-    // Make sure our cache dirs are inside the temporary folder
-    if (!m_cacheDir.makeAbsolute() || !m_undoDir.makeAbsolute() || !m_undoDir.mkpath(QStringLiteral("."))) {
+    // Make sure our cache dir is inside the temporary folder
+    if (!m_cacheDir.makeAbsolute()) {
         pCore->displayMessage(i18n("Something is wrong with cache folders"), ErrorMessage);
         return false;
     }
+    // Previous versions archived the invalidated chunks by undo step, the chunk files are now reused by content
+    QDir legacyUndoDir = m_cacheDir;
+    if (legacyUndoDir.cd(QStringLiteral("undo"))) {
+        legacyUndoDir.removeRecursively();
+    }
 
     connect(this, &PreviewManager::cleanupOldPreviews, this, &PreviewManager::doCleanupOldPreviews);
-    connect(doc, &KdenliveDoc::removeInvalidUndo, this, &PreviewManager::slotRemoveInvalidUndo, Qt::DirectConnection);
     m_previewTimer.setSingleShot(true);
     m_previewTimer.setInterval(3000);
     connect(&m_previewTimer, &QTimer::timeout, this, &PreviewManager::startPreviewRender);
@@ -141,52 +142,66 @@ bool PreviewManager::buildPreviewTrack()
     return true;
 }
 
-void PreviewManager::loadChunks(QVariantList previewChunks, QVariantList dirtyChunks, Mlt::Playlist &playlist)
+void PreviewManager::loadChunks(QList<int> previewChunks, QList<int> dirtyChunks, Mlt::Playlist &playlist)
 {
     if (previewChunks.isEmpty()) {
-        previewChunks = m_renderedChunks;
+        previewChunks = m_renderedChunks.toList();
     }
     if (dirtyChunks.isEmpty()) {
-        dirtyChunks = m_dirtyChunks;
+        dirtyChunks = m_dirtyChunks.toList();
     }
 
-    QStringList existingChuncks;
+    QSet<QString> existingChuncks;
     if (!previewChunks.isEmpty()) {
-        existingChuncks = m_cacheDir.entryList(QDir::Files);
+        const QStringList files = m_cacheDir.entryList(QDir::Files);
+        existingChuncks = QSet<QString>(files.cbegin(), files.cend());
     }
+    const QSet<int> savedChunks(previewChunks.cbegin(), previewChunks.cend());
+    // The chunks may have been saved with another chunk size, mark the chunks covering their frames as dirty
+    const int chunkSize = m_renderedChunks.step();
+    QList<int> invalidChunks;
+    const auto invalidate = [&invalidChunks, chunkSize](int start, int end) {
+        for (int frame = start - start % chunkSize; frame <= end; frame += chunkSize) {
+            invalidChunks << frame;
+        }
+    };
 
     int max = playlist.count();
     std::shared_ptr<Mlt::Producer> clip;
     m_tractor->lock();
-    if (max == 0) {
-        // Empty timeline preview, mark all as dirty
-        for (auto &prev : previewChunks) {
-            dirtyChunks << prev;
-        }
-    }
     for (int i = 0; i < max; i++) {
         if (playlist.is_blank(i)) {
             continue;
         }
         int position = playlist.clip_start(i);
-        if (previewChunks.contains(QString::number(position))) {
-            if (existingChuncks.contains(QStringLiteral("%1.%2").arg(position).arg(m_extension))) {
-                clip.reset(playlist.get_clip(i));
-                m_renderedChunks << position;
+        if (savedChunks.contains(position)) {
+            clip.reset(playlist.get_clip(i));
+            const QFileInfo chunkFile(QString::fromUtf8(clip->get("resource")));
+            if (m_renderedChunks.isAligned(position) && clip->get_playtime() == chunkSize && existingChuncks.contains(chunkFile.fileName())) {
+                m_chunkKeys.insert(position, chunkFile.completeBaseName());
+                m_renderedChunks.insert(position);
                 m_previewTrack->insert_at(position, clip.get(), 1);
             } else {
-                dirtyChunks << position;
+                invalidate(position, position + clip->get_playtime() - 1);
             }
         }
     }
     m_previewTrack->consolidate_blanks();
     m_tractor->unlock();
-    if (!dirtyChunks.isEmpty()) {
-        std::sort(dirtyChunks.begin(), dirtyChunks.end(), chunkSort);
+    // Saved chunks missing from the preview track
+    for (int i : std::as_const(previewChunks)) {
+        if (!m_renderedChunks.contains(i)) {
+            invalidate(i, i);
+        }
+    }
+    for (int i : std::as_const(dirtyChunks)) {
+        invalidate(i, i);
+    }
+    if (!invalidChunks.isEmpty()) {
         QMutexLocker lock(&m_dirtyMutex);
-        for (const auto &i : std::as_const(dirtyChunks)) {
-            if (!m_dirtyChunks.contains(i)) {
-                m_dirtyChunks << i;
+        for (int i : std::as_const(invalidChunks)) {
+            if (!m_renderedChunks.contains(i)) {
+                m_dirtyChunks.insert(i);
             }
         }
         Q_EMIT dirtyChunksChanged();
@@ -204,6 +219,7 @@ void PreviewManager::deletePreviewTrack()
     m_previewTrack = nullptr;
     m_dirtyChunks.clear();
     m_renderedChunks.clear();
+    m_chunkKeys.clear();
     Q_EMIT dirtyChunksChanged();
     Q_EMIT renderedChunksChanged();
     m_tractor->unlock();
@@ -325,117 +341,111 @@ void PreviewManager::invalidatePreviews()
         m_previewTimer.stop();
         timer = true;
     }
-    KdenliveDoc *doc = pCore->currentDoc();
-    int stackIx = doc->commandStack()->index();
-    int stackMax = doc->commandStack()->count();
-    if (stackIx == stackMax && !m_undoDir.exists(QString::number(stackIx - 1))) {
-        // We just added a new command in stack, archive existing chunks
-        int ix = stackIx - 1;
-        m_undoDir.mkdir(QString::number(ix));
-        bool foundPreviews = false;
-        for (const auto &i : m_dirtyChunks) {
-            QString current = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-            if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(ix).arg(current))) {
-                foundPreviews = true;
-            }
-        }
-        if (!foundPreviews) {
-            // No preview files found, remove undo folder
-            m_undoDir.rmdir(QString::number(ix));
-        } else {
-            // new chunks archived, cleanup old ones
-            Q_EMIT cleanupOldPreviews();
-        }
-        if (!m_dirtyChunksToRemove.isEmpty()) {
-            for (int ix : std::as_const(m_dirtyChunksToRemove)) {
-                m_dirtyChunks.removeAll(ix);
-            }
-            m_dirtyChunksToRemove.clear();
-            Q_EMIT dirtyChunksChanged();
-        }
-    } else {
-        // Restore existing chunks, delete others
-        // Check if we just undo the last stack action, then backup, otherwise delete
-        bool lastUndo = false;
-        if (stackIx + 1 == stackMax) {
-            if (!m_undoDir.exists(QString::number(stackMax))) {
-                lastUndo = true;
-                bool foundPreviews = false;
-                m_undoDir.mkdir(QString::number(stackMax));
-                for (const auto &i : m_dirtyChunks) {
-                    QString current = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-                    if (m_cacheDir.rename(current, QStringLiteral("undo/%1/%2").arg(stackMax).arg(current))) {
-                        foundPreviews = true;
-                    }
-                }
-                if (!foundPreviews) {
-                    m_undoDir.rmdir(QString::number(stackMax));
-                }
-            }
-        }
-        bool moveFile = true;
-        QDir tmpDir = m_undoDir;
-        if (!tmpDir.cd(QString::number(stackIx))) {
-            moveFile = false;
-        }
-        QVariantList foundChunks;
-        for (const auto &i : m_dirtyChunks) {
-            QString cacheFileName = QStringLiteral("%1.%2").arg(i.toInt()).arg(m_extension);
-            if (!lastUndo) {
-                m_cacheDir.remove(cacheFileName);
-            }
-            if (moveFile) {
-                if (QFile::copy(tmpDir.absoluteFilePath(cacheFileName), m_cacheDir.absoluteFilePath(cacheFileName))) {
-                    foundChunks << i;
-                } else {
-                    qDebug() << "// ERROR PROCESSE CHUNK: " << i << ", " << cacheFileName;
-                }
-            }
-        }
-        if (!m_dirtyChunksToRemove.isEmpty()) {
-            for (int ix : std::as_const(m_dirtyChunksToRemove)) {
-                m_dirtyChunks.removeAll(ix);
-            }
-            m_dirtyChunksToRemove.clear();
-            Q_EMIT dirtyChunksChanged();
-        }
-        if (!foundChunks.isEmpty()) {
-            std::sort(foundChunks.begin(), foundChunks.end(), chunkSort);
-            m_dirtyMutex.lock();
-            for (auto &ck : foundChunks) {
-                m_dirtyChunks.removeAll(ck);
-                m_renderedChunks << ck;
-            }
-            m_dirtyMutex.unlock();
-            Q_EMIT dirtyChunksChanged();
-            Q_EMIT renderedChunksChanged();
-            reloadChunks(foundChunks);
+    if (!m_dirtyChunksToRemove.isEmpty()) {
+        QMutexLocker dirtyLock(&m_dirtyMutex);
+        for (int ix : std::as_const(m_dirtyChunksToRemove)) {
+            m_dirtyChunks.remove(ix);
         }
+        m_dirtyChunksToRemove.clear();
+        dirtyLock.unlock();
+        Q_EMIT dirtyChunksChanged();
     }
+    // The files of the invalidated chunks stay in the cache folder, an undo or a later change can bring their content back
+    reuseRenderedChunks();
+    Q_EMIT cleanupOldPreviews();
+    KdenliveDoc *doc = pCore->currentDoc();
     doc->setModified(true);
     if (timer) {
         m_previewTimer.start();
     }
 }
 
-void PreviewManager::doCleanupOldPreviews()
+void PreviewManager::reuseRenderedChunks()
 {
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
+    if (m_previewTrack == nullptr || m_dirtyChunks.isEmpty()) {
+        return;
+    }
+    const QHash<int, QString> keys = computeChunkKeys(m_dirtyChunks.toList());
+    const QStringList files = m_cacheDir.entryList({QStringLiteral("*.%1").arg(m_extension)}, QDir::Files);
+    QSet<QString> existing(files.cbegin(), files.cend());
+    // A file being written is not complete yet
+    for (const auto &worker : m_workers) {
+        if (worker->chunk >= 0 && worker->process.state() != QProcess::NotRunning) {
+            existing.remove(chunkFileName(worker->chunk));
+        }
+    }
+    QList<int> foundChunks;
+    for (auto it = keys.cbegin(); it != keys.cend(); ++it) {
+        if (existing.contains(QStringLiteral("%1.%2").arg(it.value(), m_extension))) {
+            m_chunkKeys.insert(it.key(), it.value());
+            foundChunks << it.key();
+        }
+    }
+    if (foundChunks.isEmpty()) {
         return;
     }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    std::sort(foundChunks.begin(), foundChunks.end());
+    m_dirtyMutex.lock();
+    for (int ck : std::as_const(foundChunks)) {
+        m_dirtyChunks.remove(ck);
+        m_renderedChunks.insert(ck);
+    }
+    m_dirtyMutex.unlock();
+    Q_EMIT dirtyChunksChanged();
+    Q_EMIT renderedChunksChanged();
+    reloadChunks(foundChunks);
+}
 
-    // Use QCollator to do a natural sorting so that 10 is after 2
-    QCollator collator;
-    collator.setNumericMode(true);
-    std::sort(dirs.begin(), dirs.end(), [&collator](const QString &file1, const QString &file2) { return collator.compare(file1, file2) < 0; });
-    bool ok;
-    while (dirs.count() > 5) {
-        QDir tmp = m_undoDir;
-        QString dirName = dirs.takeFirst();
-        dirName.toInt(&ok);
-        if (ok && tmp.cd(dirName)) {
-            tmp.removeRecursively();
+QHash<int, QString> PreviewManager::computeChunkKeys(const QList<int> &chunks) const
+{
+    const int chunkSize = m_renderedChunks.step();
+    // The same timeline gives other files with other rendering parameters, or when rendering the original clips instead of the proxies
+    const bool useOriginals = !KdenliveSettings::proxypreview() && pCore->currentDoc()->useProxy();
+    const QByteArray seed = QStringLiteral("%1\n%2\n%3\n%4\n%5")
+                                .arg(m_extension, m_consumerParams.join(QLatin1Char(' ')), pCore->getCurrentProfilePath(), QString::number(chunkSize),
+                                     useOriginals ? QStringLiteral("originals") : QStringLiteral("proxies"))
+                                .toUtf8();
+    QHash<int, QString> keys;
+    keys.reserve(chunks.count());
+    m_tractor->lock();
+    PreviewChunkHasher hasher(m_tractor, seed);
+    for (int frame : chunks) {
+        keys.insert(frame, hasher.chunkKey(frame, frame + chunkSize - 1));
+    }
+    m_tractor->unlock();
+    return keys;
+}
+
+QString PreviewManager::chunkFileName(int frame) const
+{
+    return QStringLiteral("%1.%2").arg(m_chunkKeys.value(frame, QString::number(frame)), m_extension);
+}
+
+void PreviewManager::doCleanupOldPreviews()
+{
+    // Keep the files used by the timeline or being rendered, and the most recent others
+    QSet<QString> used;
+    const QList<int> renderedChunks = m_renderedChunks.toList();
+    for (int chunk : renderedChunks) {
+        used.insert(chunkFileName(chunk));
+    }
+    for (const auto &worker : m_workers) {
+        if (worker->chunk >= 0) {
+            used.insert(chunkFileName(worker->chunk));
+        }
+    }
+    for (int chunk : std::as_const(m_chunkQueue)) {
+        used.insert(chunkFileName(chunk));
+    }
+    const int maxUnused = qMax(100, m_renderedChunks.count());
+    int unused = 0;
+    const QStringList files = m_cacheDir.entryList({QStringLiteral("*.%1").arg(m_extension)}, QDir::Files, QDir::Time);
+    for (const QString &file : files) {
+        if (used.contains(file)) {
+            continue;
+        }
+        if (++unused > maxUnused) {
+            m_cacheDir.remove(file);
         }
     }
 }
@@ -446,21 +456,16 @@ void PreviewManager::clearPreviewRange(bool resetZones)
     abortRendering();
 
     // Mark all chunks as dirty
-    QList<int> toRemove;
     QMutexLocker lock(&m_dirtyMutex);
-    for (auto &frame : m_renderedChunks) {
-        toRemove << frame.toInt();
-    }
+    QList<int> toRemove = m_renderedChunks.toList();
     if (!toRemove.isEmpty() && !resetZones) {
         loadParams();
         return;
     }
-    for (auto &frame : m_dirtyChunks) {
-        toRemove << frame.toInt();
-    }
+    toRemove << m_dirtyChunks.toList();
     Fun undo = [this, dirty = toRemove]() {
         for (int ix : std::as_const(dirty)) {
-            m_dirtyChunks << ix;
+            m_dirtyChunks.insert(ix);
         }
         m_previewGatherTimer.start();
         return true;
@@ -470,10 +475,11 @@ void PreviewManager::clearPreviewRange(bool resetZones)
         bool hasPreview = m_previewTrack != nullptr;
         for (auto &frame : dirty) {
             if (m_renderedChunks.contains(frame)) {
-                m_renderedChunks.removeAll(frame);
-                m_dirtyChunks << frame;
+                m_renderedChunks.remove(frame);
+                m_chunkKeys.remove(frame);
+                m_dirtyChunks.insert(frame);
             } else if (resetZones) {
-                m_dirtyChunks.removeAll(frame);
+                m_dirtyChunks.remove(frame);
             }
             if (!hasPreview) {
                 continue;
@@ -508,7 +514,7 @@ void PreviewManager::clearPreviewRange(bool resetZones)
 
 void PreviewManager::addPreviewRange(const QPoint zone, bool add)
 {
-    int chunkSize = KdenliveSettings::timelinechunks();
+    int chunkSize = m_renderedChunks.step();
     int startChunk = zone.x() / chunkSize;
     int endChunk = int(rintl(zone.y() / chunkSize));
     QList<int> toRemove;
@@ -517,7 +523,7 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         int frame = i * chunkSize;
         if (add) {
             if (!m_renderedChunks.contains(frame) && !m_dirtyChunks.contains(frame)) {
-                m_dirtyChunks << frame;
+                m_dirtyChunks.insert(frame);
             }
         } else {
             toRemove << frame;
@@ -525,7 +531,7 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
     }
     if (add) {
         Q_EMIT dirtyChunksChanged();
-        if (m_previewProcess.state() == QProcess::NotRunning && KdenliveSettings::autopreview()) {
+        if (!renderProcessRunning() && KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     } else {
@@ -534,10 +540,10 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
             // Nothing to do, abort
             return;
         }
-        bool isRendering = m_previewProcess.state() != QProcess::NotRunning;
+        bool isRendering = renderProcessRunning();
         Fun undo = [this, dirty = toRemove]() {
             for (int ix : std::as_const(dirty)) {
-                m_dirtyChunks << ix;
+                m_dirtyChunks.insert(ix);
             }
             m_previewGatherTimer.start();
             return true;
@@ -547,10 +553,11 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
             bool hasPreview = m_previewTrack != nullptr;
             for (auto &frame : dirty) {
                 if (m_renderedChunks.contains(frame)) {
-                    m_renderedChunks.removeAll(frame);
-                    m_dirtyChunks << frame;
+                    m_renderedChunks.remove(frame);
+                    m_chunkKeys.remove(frame);
+                    m_dirtyChunks.insert(frame);
                 } else {
-                    m_dirtyChunks.removeAll(frame);
+                    m_dirtyChunks.remove(frame);
                 }
                 if (!hasPreview) {
                     continue;
@@ -583,16 +590,18 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
 
 void PreviewManager::abortRendering()
 {
-    if (m_previewProcess.state() == QProcess::NotRunning) {
+    if (!renderProcessRunning()) {
         return;
     }
     // Don't display error message on voluntary abort
     m_warnOnCrash = false;
     Q_EMIT abortPreview();
-    m_previewProcess.waitForFinished();
-    if (m_previewProcess.state() != QProcess::NotRunning) {
-        m_previewProcess.kill();
-        m_previewProcess.waitForFinished();
+    for (const auto &worker : m_workers) {
+        worker->process.waitForFinished();
+        if (worker->process.state() != QProcess::NotRunning) {
+            worker->process.kill();
+            worker->process.waitForFinished();
+        }
     }
     // Re-init time estimation
     Q_EMIT previewRender(-1, QString(), 1000);
@@ -630,26 +639,106 @@ void PreviewManager::startPreviewRender()
     }
 }
 
-void PreviewManager::receivedStderr()
+void PreviewManager::receivedStderr(PreviewWorker *worker)
 {
-    QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    QStringList resultList = QString::fromLocal8Bit(worker->process.readAllStandardError()).split(QLatin1Char('\n'), Qt::SkipEmptyParts);
     for (auto &result : resultList) {
         if (result.startsWith(QLatin1String("START:"))) {
-            if (m_previewProcess.state() == QProcess::Running) {
-                workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
+            if (worker->process.state() == QProcess::Running) {
+                worker->chunk = result.section(QLatin1String("START:"), 1).simplified().toInt();
                 Q_EMIT workingPreviewChanged();
             }
         } else if (result.startsWith(QLatin1String("DONE:"))) {
             int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
+            // The file is complete, it must not be removed if the process fails later
+            worker->chunk = -1;
+            const QString filePath = m_cacheDir.absoluteFilePath(chunkFileName(chunk));
+            const QList<int> sharedChunks = m_sharedChunks.take(m_chunkKeys.value(chunk));
             m_processedChunks++;
-            QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
-            Q_EMIT previewRender(chunk, m_cacheDir.absoluteFilePath(fileName), 1000 * m_processedChunks / m_chunksToRender);
+            Q_EMIT previewRender(chunk, filePath, 1000 * m_processedChunks / m_chunksToRender);
+            // Chunks rendering the same frames use the same file
+            for (int shared : sharedChunks) {
+                m_processedChunks++;
+                Q_EMIT previewRender(shared, filePath, 1000 * m_processedChunks / m_chunksToRender);
+            }
+            // The chunk may have been found corrupted, which aborts the rendering
+            if (worker->process.state() == QProcess::Running && !m_renderFailed) {
+                sendNextChunk(worker);
+            }
         } else {
             m_errorLog.append(result);
         }
     }
 }
 
+int PreviewManager::workerCount()
+{
+    if (KdenliveSettings::previewprocesses() > 0) {
+        return KdenliveSettings::previewprocesses();
+    }
+    // Each process already uses several threads for decoding, effects and encoding
+    return qBound(1, QThread::idealThreadCount() / 4, 8);
+}
+
+bool PreviewManager::renderProcessRunning() const
+{
+    for (const auto &worker : m_workers) {
+        if (worker->process.state() != QProcess::NotRunning) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QList<int> PreviewManager::workingPreviews() const
+{
+    QList<int> chunks;
+    for (const auto &worker : m_workers) {
+        if (worker->chunk >= 0 && worker->process.state() != QProcess::NotRunning) {
+            chunks << worker->chunk;
+        }
+    }
+    return chunks;
+}
+
+bool PreviewManager::isRenderingChunk(int start, int end) const
+{
+    for (const auto &worker : m_workers) {
+        if (worker->chunk >= start && worker->chunk <= end && worker->process.state() != QProcess::NotRunning) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PreviewManager::killWorkers()
+{
+    for (const auto &worker : m_workers) {
+        worker->process.kill();
+    }
+}
+
+void PreviewManager::sendNextChunk(PreviewWorker *worker)
+{
+    if (m_chunkQueue.isEmpty()) {
+        // Nothing left, the process exits once its input is closed
+        worker->chunk = -1;
+        worker->process.closeWriteChannel();
+        return;
+    }
+    // Render first what the user is watching
+    const int position = pCore->getMonitorPosition();
+    int best = 0;
+    for (int i = 1; i < m_chunkQueue.count(); ++i) {
+        if (qAbs(m_chunkQueue.at(i) - position) < qAbs(m_chunkQueue.at(best) - position)) {
+            best = i;
+        }
+    }
+    worker->chunk = m_chunkQueue.takeAt(best);
+    worker->process.write(QByteArray::number(worker->chunk) + ' ' + m_chunkKeys.value(worker->chunk).toLatin1() + '\n');
+    Q_EMIT workingPreviewChanged();
+}
+
 void PreviewManager::doPreviewRender(const QString &scene)
 {
     // initialize progress bar
@@ -657,49 +746,119 @@ void PreviewManager::doPreviewRender(const QString &scene)
         return;
     }
     QMutexLocker lock(&m_dirtyMutex);
-    Q_ASSERT(m_previewProcess.state() == QProcess::NotRunning);
-    std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end(), chunkSort);
-    const QStringList dirtyChunks = getCompressedList(m_dirtyChunks);
-    m_chunksToRender = m_dirtyChunks.count();
+    Q_ASSERT(!renderProcessRunning());
+    const QList<int> chunks = m_dirtyChunks.toList();
+    lock.unlock();
+    const QHash<int, QString> keys = computeChunkKeys(chunks);
+    const QStringList files = m_cacheDir.entryList({QStringLiteral("*.%1").arg(m_extension)}, QDir::Files);
+    const QSet<QString> existing(files.cbegin(), files.cend());
+    m_chunkQueue.clear();
+    m_sharedChunks.clear();
+    QList<int> existingChunks;
+    for (int chunk : std::as_const(chunks)) {
+        const QString key = keys.value(chunk);
+        m_chunkKeys.insert(chunk, key);
+        if (existing.contains(chunkFileName(chunk))) {
+            // Already rendered for another position or before an undo
+            existingChunks << chunk;
+            continue;
+        }
+        auto shared = m_sharedChunks.find(key);
+        if (shared != m_sharedChunks.end()) {
+            // Same frames as a queued chunk, render them once
+            shared->append(chunk);
+            continue;
+        }
+        m_sharedChunks.insert(key, {});
+        m_chunkQueue << chunk;
+    }
+    m_chunksToRender = chunks.count();
     m_processedChunks = 0;
-    int chunkSize = KdenliveSettings::timelinechunks();
+    m_renderFailed = false;
+    pCore->currentDoc()->previewProgress(0);
+    for (int chunk : std::as_const(existingChunks)) {
+        m_processedChunks++;
+        Q_EMIT previewRender(chunk, m_cacheDir.absoluteFilePath(chunkFileName(chunk)), 1000 * m_processedChunks / m_chunksToRender);
+    }
+    if (m_chunkQueue.isEmpty()) {
+        QFile::remove(scene);
+        pCore->currentDoc()->previewProgress(1000);
+        return;
+    }
+    int chunkSize = m_renderedChunks.step();
+    // Chunks are sent on stdin, see sendNextChunk()
     QStringList args{QStringLiteral("preview-chunks"),
                      scene,
                      m_cacheDir.absolutePath(),
-                     dirtyChunks.join(QLatin1Char(',')),
+                     QStringLiteral("-"),
                      QString::number(chunkSize - 1),
                      pCore->getCurrentProfilePath(),
                      m_extension,
                      m_consumerParams.join(QLatin1Char(' '))};
-    pCore->currentDoc()->previewProgress(0);
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     if (!KdenliveSettings::hwDecoding().isEmpty()) {
         env.insert(QLatin1String("MLT_AVFORMAT_HWACCEL"), KdenliveSettings::hwDecoding());
-        m_previewProcess.setProcessEnvironment(env);
     }
-    m_previewProcess.start(KdenliveSettings::kdenliverendererpath(), args);
-    if (m_previewProcess.waitForStarted()) {
-        qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED: " << args;
+    m_workers.clear();
+    const int count = qMin(workerCount(), int(m_chunkQueue.count()));
+    int started = 0;
+    for (int i = 0; i < count; ++i) {
+        m_workers.push_back(std::make_unique<PreviewWorker>());
+        PreviewWorker *worker = m_workers.back().get();
+        connect(&worker->process, &QProcess::readyReadStandardError, this, [this, worker]() { receivedStderr(worker); });
+        connect(&worker->process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, worker](int exitCode, QProcess::ExitStatus status) { processEnded(worker, exitCode, status); });
+        worker->process.setProcessEnvironment(env);
+        worker->process.start(KdenliveSettings::kdenliverendererpath(), args);
+        if (worker->process.waitForStarted()) {
+            qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED: " << args;
+            started++;
+            sendNextChunk(worker);
+        } else {
+            // The chunks stay queued for the other processes
+            qCWarning(KDENLIVE_LOG) << "Timeline preview process failed to start:" << worker->process.errorString();
+            m_errorLog.append(worker->process.errorString() + QLatin1Char('\n'));
+        }
+    }
+    if (started == 0) {
+        // Nothing is rendering, the chunks stay dirty
+        m_renderFailed = true;
+        m_chunkQueue.clear();
+        QFile::remove(scene);
+        Q_EMIT previewRender(0, m_errorLog, -1);
     }
 }
 
-void PreviewManager::processEnded(int exitCode, QProcess::ExitStatus status)
+void PreviewManager::processEnded(PreviewWorker *worker, int exitCode, QProcess::ExitStatus status)
 {
-    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
-    QFile::remove(sceneList);
-    if (pCore->window() && (status == QProcess::QProcess::CrashExit || exitCode != 0)) {
-        Q_EMIT previewRender(0, m_errorLog, -1);
-        if (workingPreview >= 0) {
-            const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
+    if (status == QProcess::QProcess::CrashExit || exitCode != 0) {
+        if (worker->chunk >= 0) {
+            // Remove the incomplete file, it would be reused for the same content
+            const QString fileName = chunkFileName(worker->chunk);
             if (m_cacheDir.exists(fileName)) {
                 m_cacheDir.remove(fileName);
             }
         }
-    } else {
+    }
+    if (pCore->window() && (status == QProcess::QProcess::CrashExit || exitCode != 0)) {
+        if (!m_renderFailed) {
+            // Stop the other processes, the error is reported once
+            m_renderFailed = true;
+            Q_EMIT previewRender(0, m_errorLog, -1);
+            killWorkers();
+        }
+    }
+    worker->chunk = -1;
+    if (renderProcessRunning()) {
+        return;
+    }
+    // Last process
+    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
+    QFile::remove(sceneList);
+    if (!m_renderFailed) {
         // Normal exit and exit code 0: everything okay
         pCore->currentDoc()->previewProgress(1000);
     }
-    workingPreview = -1;
     m_warnOnCrash = true;
     Q_EMIT workingPreviewChanged();
 }
@@ -715,76 +874,40 @@ void PreviewManager::slotProcessDirtyChunks()
     }
 }
 
-void PreviewManager::slotRemoveInvalidUndo(int ix)
-{
-    QMutexLocker lock(&m_previewMutex);
-    if (m_undoDir.dirName() != QLatin1String("undo")) {
-        // Make sure we delete correct folder
-        return;
-    }
-    QStringList dirs = m_undoDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    bool ok;
-    for (const QString &dir : std::as_const(dirs)) {
-        if (dir.toInt(&ok) >= ix && ok) {
-            QDir tmp = m_undoDir;
-            if (tmp.cd(dir)) {
-                tmp.removeRecursively();
-            }
-        }
-    }
-}
-
 void PreviewManager::invalidatePreview(int startFrame, int endFrame)
 {
     if (m_previewTrack == nullptr) {
         return;
     }
-    int chunkSize = KdenliveSettings::timelinechunks();
+    int chunkSize = m_renderedChunks.step();
     int start = startFrame - startFrame % chunkSize;
     int end = endFrame - endFrame % chunkSize;
     bool timerWasRunning = m_previewGatherTimer.isActive();
     m_previewGatherTimer.stop();
-    bool previewWasRunning = m_previewProcess.state() == QProcess::Running;
-    bool alreadyRendered = false;
-    bool wasInDirtyZone = false;
-    if (!m_renderedChunks.isEmpty()) {
-        // Check if the invalidated zone was already rendered
-        std::sort(m_renderedChunks.begin(), m_renderedChunks.end(), chunkSort);
-        if (start <= m_renderedChunks.last().toInt() && end >= m_renderedChunks.first().toInt()) {
-            alreadyRendered = true;
-        } else if (workingPreview >= start && workingPreview <= end) {
-            alreadyRendered = true;
-        }
-    }
-    if (!alreadyRendered && !m_dirtyChunks.isEmpty()) {
-        // Check if the invalidate zone is in the current todo list (dirtychunks)
-        std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end(), chunkSort);
-        if (start <= m_dirtyChunks.last().toInt() && end >= m_dirtyChunks.first().toInt()) {
-            wasInDirtyZone = true;
-        }
-    }
+    bool previewWasRunning = renderProcessRunning();
+    // Check if the invalidated zone was already rendered
+    bool alreadyRendered = m_renderedChunks.intersects(start, end) || isRenderingChunk(start, end);
+    // Check if the invalidate zone is in the current todo list (dirtychunks)
+    bool wasInDirtyZone = !alreadyRendered && m_dirtyChunks.intersects(start, end);
     if (alreadyRendered) {
         if (previewWasRunning) {
             abortRendering();
         }
         m_tractor->lock();
         bool chunksChanged = false;
-        for (int i = start; i <= end; i += chunkSize) {
-            if (m_renderedChunks.contains(i)) {
-                int ix = m_previewTrack->get_clip_index_at(i);
-                if (m_previewTrack->is_blank(ix)) {
-                    continue;
-                }
-                Mlt::Producer *prod = m_previewTrack->replace_with_blank(ix);
-                delete prod;
-                QVariant val(i);
-                m_renderedChunks.removeAll(val);
-                if (!m_dirtyChunks.contains(val)) {
-                    QMutexLocker lock(&m_dirtyMutex);
-                    m_dirtyChunks << val;
-                    chunksChanged = true;
-                }
+        const QList<int> invalidChunks = m_renderedChunks.values(start, end);
+        for (int i : invalidChunks) {
+            int ix = m_previewTrack->get_clip_index_at(i);
+            if (m_previewTrack->is_blank(ix)) {
+                continue;
             }
+            Mlt::Producer *prod = m_previewTrack->replace_with_blank(ix);
+            delete prod;
+            m_renderedChunks.remove(i);
+            m_chunkKeys.remove(i);
+            QMutexLocker lock(&m_dirtyMutex);
+            m_dirtyChunks.insert(i);
+            chunksChanged = true;
         }
         m_tractor->unlock();
         if (chunksChanged) {
@@ -804,21 +927,21 @@ void PreviewManager::invalidatePreview(int startFrame, int endFrame)
     m_previewGatherTimer.start();
 }
 
-void PreviewManager::reloadChunks(const QVariantList &chunks)
+void PreviewManager::reloadChunks(const QList<int> &chunks)
 {
     if (m_previewTrack == nullptr || chunks.isEmpty()) {
         return;
     }
     m_tractor->lock();
-    for (const auto &ix : chunks) {
-        if (m_previewTrack->is_blank_at(ix.toInt())) {
-            QString fileName = m_cacheDir.absoluteFilePath(QStringLiteral("%1.%2").arg(ix.toInt()).arg(m_extension));
+    for (int ix : chunks) {
+        if (m_previewTrack->is_blank_at(ix)) {
+            QString fileName = m_cacheDir.absoluteFilePath(chunkFileName(ix));
             fileName.prepend(QStringLiteral("avformat:"));
             Mlt::Producer prod(pCore->getProjectProfile(), fileName.toUtf8().constData());
             if (prod.is_valid()) {
                 // m_ruler->updatePreview(ix, true);
                 prod.set("mlt_service", "avformat-novalidate");
-                m_previewTrack->insert_at(ix.toInt(), &prod, 1);
+                m_previewTrack->insert_at(ix, &prod, 1);
             }
         }
     }
@@ -850,11 +973,12 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
     }
     if (m_previewTrack->is_blank_at(frame)) {
         Mlt::Producer prod(pCore->getProjectProfile(), QStringLiteral("avformat:%1").arg(file).toUtf8().constData());
-        if (prod.is_valid() && prod.get_length() == KdenliveSettings::timelinechunks()) {
+        if (prod.is_valid() && prod.get_length() == m_renderedChunks.step()) {
             m_dirtyMutex.lock();
-            m_dirtyChunks.removeAll(QVariant(frame));
+            m_dirtyChunks.remove(frame);
             m_dirtyMutex.unlock();
-            m_renderedChunks << frame;
+            m_renderedChunks.insert(frame);
+            m_chunkKeys.insert(frame, QFileInfo(file).completeBaseName());
             Q_EMIT renderedChunksChanged();
             prod.set("mlt_service", "avformat-novalidate");
             m_tractor->lock();
@@ -875,18 +999,15 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
 void PreviewManager::corruptedChunk(int frame, const QString &fileName)
 {
     Q_EMIT abortPreview();
-    m_previewProcess.waitForFinished();
-    if (workingPreview >= 0) {
-        workingPreview = -1;
-        Q_EMIT workingPreviewChanged();
+    for (const auto &worker : m_workers) {
+        worker->process.waitForFinished();
+        worker->chunk = -1;
     }
+    Q_EMIT workingPreviewChanged();
     Q_EMIT previewRender(0, m_errorLog, -1);
     m_cacheDir.remove(fileName);
-    if (!m_dirtyChunks.contains(frame)) {
-        QMutexLocker lock(&m_dirtyMutex);
-        m_dirtyChunks << frame;
-        std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end(), chunkSort);
-    }
+    QMutexLocker lock(&m_dirtyMutex);
+    m_dirtyChunks.insert(frame);
 }
 
 int PreviewManager::setOverlayTrack(Mlt::Playlist *overlay)
@@ -907,50 +1028,12 @@ void PreviewManager::removeOverlayTrack()
 QPair<QStringList, QStringList> PreviewManager::previewChunks()
 {
     QMutexLocker lock(&m_dirtyMutex);
-    std::sort(m_renderedChunks.begin(), m_renderedChunks.end(), chunkSort);
-    const QStringList renderedChunks = getCompressedList(m_renderedChunks);
-    std::sort(m_dirtyChunks.begin(), m_dirtyChunks.end(), chunkSort);
-    const QStringList dirtyChunks = getCompressedList(m_dirtyChunks);
+    const QStringList renderedChunks = m_renderedChunks.toCompressedList();
+    const QStringList dirtyChunks = m_dirtyChunks.toCompressedList();
     lock.unlock();
     return {renderedChunks, dirtyChunks};
 }
 
-const QStringList PreviewManager::getCompressedList(const QVariantList items) const
-{
-    QStringList resultString;
-    int lastFrame = -1;
-    QString currentString;
-    for (const QVariant &frame : items) {
-        int current = frame.toInt();
-        if (current - KdenliveSettings::timelinechunks() == lastFrame) {
-            lastFrame = current;
-            if (frame == items.last()) {
-                currentString.append(QStringLiteral("-%1").arg(lastFrame));
-                resultString << currentString;
-                currentString.clear();
-            }
-            continue;
-        }
-        if (currentString.isEmpty()) {
-            currentString = frame.toString();
-        } else if (currentString == QString::number(lastFrame)) {
-            // Only one chunk, store it
-            resultString << currentString;
-            currentString = frame.toString();
-        } else {
-            // Range, store
-            currentString.append(QStringLiteral("-%1").arg(lastFrame));
-            resultString << currentString;
-            currentString = frame.toString();
-        }
-        lastFrame = current;
-    }
-    if (!currentString.isEmpty()) {
-        resultString << currentString;
-    }
-    return resultString;
-}
-
 bool PreviewManager::hasOverlayTrack() const
 {
     return m_overlayTrack != nullptr;
@@ -976,5 +1059,5 @@ int PreviewManager::addedTracks() const
 
 bool PreviewManager::isRunning() const
 {
-    return workingPreview >= 0 || m_previewProcess.state() != QProcess::NotRunning;
+    return renderProcessRunning();
 }
@@ -7,14 +7,19 @@
 #pragma once
 
 #include "definitions.h"
+#include "utils/chunkset.h"
 
 #include <QDir>
+#include <QHash>
 #include <QFuture>
 #include <QMutex>
 #include <QProcess>
 #include <QTimer>
 #include <QUuid>
 
+#include <memory>
+#include <vector>
+
 class TimelineController;
 
 namespace Mlt {
@@ -30,6 +35,10 @@ class Producer;
     This allow us to get a preview with a smooth playback of our project.
     Only the preview zone is rendered. Once defined, a preview zone shows as a red line below
     the timeline ruler. As chunks are rendered, the zone turns to green.
+    Chunks are rendered by several kdenlive_render processes. Each process is sent one chunk at a time on its
+    standard input, the chunk closest to the playhead, and gets the next one when it is done.
+    Chunk files are named after a hash of what they render (see PreviewChunkHasher), so the files of invalidated chunks
+    are kept and reused when the same content comes back, after an undo or when a block of clips moves back.
  */
 class PreviewManager : public QObject
 {
@@ -64,12 +73,12 @@ public:
     /** @brief: Returns directory currently used to store the preview files. */
     const QDir getCacheDir() const;
     /** @brief: Load existing ruler chunks. */
-    void loadChunks(QVariantList previewChunks, QVariantList dirtyChunks, Mlt::Playlist &playlist);
+    void loadChunks(QList<int> previewChunks, QList<int> dirtyChunks, Mlt::Playlist &playlist);
     int setOverlayTrack(Mlt::Playlist *overlay);
     /** @brief Remove the effect compare overlay track */
     void removeOverlayTrack();
-    /** @brief The current preview chunk being processed, -1 if none */
-    int workingPreview;
+    /** @brief The chunks being processed by the preview processes */
+    QList<int> workingPreviews() const;
     /** @brief Returns the list of existing chunks */
     QPair<QStringList, QStringList> previewChunks();
     bool hasOverlayTrack() const;
@@ -87,12 +96,25 @@ private:
     Mlt::Playlist *m_overlayTrack;
     bool m_warnOnCrash;
     int m_previewTrackIndex;
-    /** @brief: The kdenlive timeline preview process. */
-    QProcess m_previewProcess;
+    /** @brief: A kdenlive timeline preview process. */
+    struct PreviewWorker
+    {
+        QProcess process;
+        /** @brief: The chunk the process is rendering, -1 if it is done with the last one it was sent */
+        int chunk{-1};
+    };
+    /** @brief: The base name of the file of each chunk, chunks rendered by older versions are named after their frame. */
+    QHash<int, QString> m_chunkKeys;
+    /** @brief: The chunks of the current rendering with the same key as a queued chunk, by key. They get its file. */
+    QHash<QString, QList<int>> m_sharedChunks;
+    /** @brief: The kdenlive timeline preview processes of the current rendering. */
+    std::vector<std::unique_ptr<PreviewWorker>> m_workers;
+    /** @brief: The chunks of the current rendering not yet sent to a process. */
+    QList<int> m_chunkQueue;
+    /** @brief: True when a process of the current rendering failed, the error is only reported once. */
+    bool m_renderFailed;
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
-    /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
-    QDir m_undoDir;
     QMutex m_previewMutex;
     QStringList m_consumerParams;
     QString m_extension;
@@ -110,29 +132,36 @@ private:
     /** @brief: The render process output, useful in case of failure */
     QString m_errorLog;
     /** @brief: After an undo/redo, if we have preview history, use it. */
-    void reloadChunks(const QVariantList &chunks);
+    void reloadChunks(const QList<int> &chunks);
+    /** @brief: Returns the key of each chunk, which names its file. */
+    QHash<int, QString> computeChunkKeys(const QList<int> &chunks) const;
+    /** @brief: Returns the name of the file of a chunk in the cache folder. */
+    QString chunkFileName(int frame) const;
+    /** @brief: Move the dirty chunks whose file already exists to the rendered chunks. */
+    void reuseRenderedChunks();
     /** @brief: A chunk failed to render, abort. */
-    void corruptedChunk(int workingPreview, const QString &fileName);
-    /** @brief: Get a compressed list of chunks, like: "0-500,525,575". */
-    const QStringList getCompressedList(const QVariantList items) const;
-
-    /** @brief Compare two chunks for usage by std::sort
-     * @returns true if @param c1 is less than @param c2
-     */
-    static bool chunkSort(const QVariant &c1, const QVariant &c2) { return c1.toInt() < c2.toInt(); };
+    void corruptedChunk(int frame, const QString &fileName);
+    /** @brief: Send the waiting chunk closest to the playhead to a process, or let it exit if there is none. */
+    void sendNextChunk(PreviewWorker *worker);
+    /** @brief: The number of processes used to render the chunks. */
+    static int workerCount();
+    /** @brief: Returns true if a preview process is running. */
+    bool renderProcessRunning() const;
+    /** @brief: Returns true if a process is rendering a chunk between @param start and @param end. */
+    bool isRenderingChunk(int start, int end) const;
+    /** @brief: Kill the preview processes. */
+    void killWorkers();
+    /** @brief: Process preview rendering output. */
+    void receivedStderr(PreviewWorker *worker);
+    void processEnded(PreviewWorker *worker, int exitCode, QProcess::ExitStatus status);
 
 private Q_SLOTS:
-    /** @brief: To avoid filling the hard drive, remove preview undo history after 5 steps. */
+    /** @brief: To avoid filling the hard drive, remove the oldest preview files no longer used by the timeline. */
     void doCleanupOldPreviews();
     /** @brief: Start the real rendering process. */
     void doPreviewRender(const QString &scene); // std::shared_ptr<Mlt::Producer> sourceProd);
-    /** @brief: If user does an undo, then makes a new timeline operation, delete undo history of more recent stack . */
-    void slotRemoveInvalidUndo(int ix);
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
-    /** @brief: Process preview rendering output. */
-    void receivedStderr();
-    void processEnded(int exitCode, QProcess::ExitStatus status);
 
 public Q_SLOTS:
     /** @brief: Prepare and start rendering. */
@@ -143,8 +172,10 @@ public Q_SLOTS:
     void invalidatePreview(int startFrame, int endFrame);
 
 protected:
-    QVariantList m_renderedChunks;
-    QVariantList m_dirtyChunks;
+    /** @brief: The chunks shown on the preview track, by first frame. Converted to a QVariantList only for QML. */
+    ChunkSet m_renderedChunks;
+    /** @brief: The chunks of the preview zones waiting to be rendered. */
+    ChunkSet m_dirtyChunks;
     QList<int> m_dirtyChunksToRemove;
     mutable QMutex m_dirtyMutex;
     /** @brief: Re-enable timeline preview track. */
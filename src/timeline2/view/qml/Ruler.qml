@@ -20,7 +20,6 @@ Item {
     // The space we want between each ticks in the ruler
     property real tickSpacing: timeline.scaleFactor
     property alias rulerZone : zone
-    property int workingPreview : timeline.workingPreview
     property int timecodeOffset : timeline.timecodeOffset
     property int labelMod: 1
     property bool useTimelineRuler : timeline.useRuler
@@ -88,15 +87,17 @@ Item {
             color: 'darkgreen'
         }
     }
-    Rectangle {
-        id: working
-        x: rulerRoot.workingPreview * timeline.scaleFactor
-        anchors.bottom: parent.bottom
-        anchors.bottomMargin: zoneHeight
-        width: 25 * timeline.scaleFactor
-        height: previewHeight
-        color: 'orange'
-        visible: rulerRoot.workingPreview > -1
+    Repeater {
+        model: timeline.workingPreviews
+        anchors.fill: parent
+        delegate: Rectangle {
+            x: modelData * timeline.scaleFactor
+            anchors.bottom: parent.bottom
+            anchors.bottomMargin: zoneHeight
+            width: 25 * timeline.scaleFactor
+            height: previewHeight
+            color: 'orange'
+        }
     }
 
     // Guides
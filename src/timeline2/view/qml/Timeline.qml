@@ -552,6 +552,14 @@ function getTrackColor(audio, header) {
             timeline.autofitTrackHeight(scrollView.height - subtitleTrack.height, root.collapsedHeight)
         }
     }
+    Timer {
+        id: visibleRangeTimer
+        interval: 200; running: false; repeat: false
+        onTriggered: timeline.setVisibleRange(root.scrollMin, root.scrollMax)
+    }
+    onScrollMinChanged: visibleRangeTimer.restart()
+    onScrollMaxChanged: visibleRangeTimer.restart()
+
     Timer {
         id: trackHeightTimer
         interval: 300; running: false; repeat: false
@@ -8,30 +8,173 @@
 
 #include "timelinewaveform.h"
 #include "bin/projectitemmodel.h"
+#include "bin/projectclip.h"
 #include "core.h"
+#include "jobs/audiolevels/audiolevelscache.h"
 #include "jobs/audiolevels/audiolevelstask.h"
 #include "jobs/audiolevels/generators.h"
 #include "kdenlivesettings.h"
 
+#include <QFontMetrics>
+#include <QGuiApplication>
 #include <QPainter>
 #include <QPainterPath>
+#include <QQuickWindow>
+#include <QSGClipNode>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QSGSimpleRectNode>
+#include <QSGSimpleTextureNode>
+#include <QSGTransformNode>
 #include <doc/kdenlivedoc.h>
 
+namespace {
+const QStringList channelNames{"L", "R", "C", "LFE", "BL", "BR"};
+
+/** @brief The nodes of a waveform item: its channels, clipped to the item */
+class WaveformNode : public QSGClipNode
+{
+public:
+    struct Channel
+    {
+        QSGSimpleRectNode *background;
+        QSGSimpleRectNode *midLine;
+        /** @brief Places the unit height wave geometry in the channel, and scrolls it */
+        QSGTransformNode *transform;
+        QSGGeometryNode *wave;
+        QSGSimpleTextureNode *label{nullptr};
+        QColor labelColor;
+    };
+
+    WaveformNode()
+        : m_clipGeometry(QSGGeometry::defaultAttributes_Point2D(), 4)
+    {
+        setGeometry(&m_clipGeometry);
+        setIsRectangular(true);
+    }
+
+    void setRect(const QRectF &rect)
+    {
+        if (rect == clipRect()) {
+            return;
+        }
+        QSGGeometry::updateRectGeometry(&m_clipGeometry, rect);
+        setClipRect(rect);
+        markDirty(QSGNode::DirtyGeometry);
+    }
+
+    void setChannelCount(int count)
+    {
+        if (int(channels.size()) == count) {
+            return;
+        }
+        removeAllChildNodes();
+        for (Channel &channel : channels) {
+            delete channel.background;
+            delete channel.midLine;
+            delete channel.transform;
+            delete channel.label;
+        }
+        channels.clear();
+        for (int i = 0; i < count; ++i) {
+            Channel channel;
+            channel.background = new QSGSimpleRectNode();
+            channel.midLine = new QSGSimpleRectNode();
+            channel.transform = new QSGTransformNode();
+            channel.wave = new QSGGeometryNode();
+            channel.wave->setMaterial(new QSGFlatColorMaterial());
+            channel.wave->setFlag(QSGNode::OwnsMaterial);
+            channel.wave->setFlag(QSGNode::OwnsGeometry);
+            channel.transform->appendChildNode(channel.wave);
+            appendChildNode(channel.background);
+            appendChildNode(channel.midLine);
+            appendChildNode(channel.transform);
+            channels.push_back(channel);
+        }
+        levelsVersion = -1;
+    }
+
+    std::vector<Channel> channels;
+    /** @brief The version of the levels the wave geometry was built from */
+    int levelsVersion{-1};
+
+private:
+    QSGGeometry m_clipGeometry;
+};
+
+/** @brief Builds the wave geometry of a channel, in pixels horizontally and in a unit height centered on 0 vertically */
+QSGGeometry *buildWaveGeometry(const QVector<int16_t> &levels, int ch, int channels, double pointsPerPixel)
+{
+    const int points = levels.size() / channels;
+    const float unit = 1.f / std::numeric_limits<int16_t>::max() / 2.f;
+    if (pointsPerPixel > 1) {
+        // One vertical line per pixel
+        int lines = 0;
+        for (int i = 0; i < points; ++i) {
+            if (levels[i * channels + ch] > 0) {
+                lines++;
+            }
+        }
+        auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 2 * lines);
+        geometry->setDrawingMode(QSGGeometry::DrawLines);
+        geometry->setLineWidth(1);
+        QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+        for (int i = 0; i < points; ++i) {
+            const int16_t level = levels[i * channels + ch];
+            if (level > 0) {
+                const float x = i + 0.5f;
+                vertices[0].set(x, -level * unit);
+                vertices[1].set(x, level * unit);
+                vertices += 2;
+            }
+        }
+        return geometry;
+    }
+    // A filled shape, mirrored around the middle line, extended to the end of the last point
+    auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), points > 0 ? 2 * (points + 1) : 0);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
+    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+    for (int i = 0; i <= points && points > 0; ++i) {
+        const int16_t level = levels[qMin(i, points - 1) * channels + ch];
+        const float x = float(i / pointsPerPixel);
+        vertices[0].set(x, -level * unit);
+        vertices[1].set(x, level * unit);
+        vertices += 2;
+    }
+    return geometry;
+}
+
+QSGTexture *createLabelTexture(QQuickWindow *window, const QString &text, const QColor &color)
+{
+    const QFontMetrics metrics(QGuiApplication::font());
+    const qreal ratio = window->effectiveDevicePixelRatio();
+    QImage image(QSize(metrics.horizontalAdvance(text) + 1, metrics.height()) * ratio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(ratio);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setFont(QGuiApplication::font());
+    painter.setPen(color);
+    painter.drawText(0, metrics.ascent(), text);
+    painter.end();
+    return window->createTextureFromImage(image);
+}
+} // namespace
+
 TimelineWaveform::TimelineWaveform(QQuickItem *parent)
-    : QQuickPaintedItem(parent)
+    : QQuickItem(parent)
     , m_speed(1.)
 {
-    setAntialiasing(false);
-    setOpaquePainting(m_opaquePaint);
+    setFlag(QQuickItem::ItemHasContents, true);
     setEnabled(false);
-    // setRenderTarget(QQuickPaintedItem::FramebufferObject);
-    // setMipmap(true);
-    // setTextureSize(QSize(1, 1));
     connect(this, &TimelineWaveform::needRecompute, [this] {
         m_needRecompute = true;
         update();
     });
-    connect(this, &TimelineWaveform::needRedraw, &QQuickItem::update);
+    // Only recomputed if the range leaves the computed levels, otherwise the geometry is translated
+    connect(this, &TimelineWaveform::rangeChanged, this, &QQuickItem::update);
+    connect(this, &TimelineWaveform::needRedraw, this, &QQuickItem::update);
+    connect(this, &QQuickItem::widthChanged, this, &QQuickItem::update);
+    connect(this, &QQuickItem::heightChanged, this, &QQuickItem::update);
     connect(this, &TimelineWaveform::normalizeChanged, [this] {
         if (m_normalize) {
             m_normalizeFactor = static_cast<double>(std::numeric_limits<int16_t>::max()) / pCore->projectItemModel()->getAudioMaxLevel(m_binId, m_stream);
@@ -42,6 +185,16 @@ TimelineWaveform::TimelineWaveform(QQuickItem *parent)
     });
 }
 
+int TimelineWaveform::displayedChannels() const
+{
+    return m_separateChannels ? m_channels : 1;
+}
+
+double TimelineWaveform::scrollOffset() const
+{
+    return (m_inPoint - m_computedIn) / m_pointsPerPixel * AUDIOLEVELS_POINTS_PER_FRAME;
+}
+
 void TimelineWaveform::drawWaveformLines(QPainter *painter, const int ch, const int channels, const qreal yMiddle, const qreal channelHeight)
 {
     for (int i = 0; i * channels + ch < m_audioLevels.size(); i++) {
@@ -59,51 +212,74 @@ void TimelineWaveform::drawWaveformPath(QPainter *painter, const int ch, const i
     path.moveTo(0, yMiddle);
 
     const double extraSpace = 1 / m_pointsPerPixel * AUDIOLEVELS_POINTS_PER_FRAME;
+    const double right = scrollOffset() + width() + extraSpace;
 
     for (int i = 0; i * channels + ch < m_audioLevels.size(); i++) {
         const auto x = i / m_pointsPerPixel;
         const auto level = m_audioLevels[i * channels + ch];
         const auto lineHeight = channelHeight * level * m_normalizeFactor / std::numeric_limits<int16_t>::max();
         path.lineTo(x, yMiddle + lineHeight / 2);
-        if (x >= width() + extraSpace) {
+        if (x >= right) {
             break;
         }
     }
 
     // extend and close the shape
-    const auto level = m_audioLevels[(m_audioLevels.size() - 1) / channels + ch];
+    const auto level = m_audioLevels[(m_audioLevels.size() / channels - 1) * channels + ch];
     const auto lineHeight = channelHeight * level * m_normalizeFactor / std::numeric_limits<int16_t>::max();
-    path.lineTo(width() + extraSpace, yMiddle + lineHeight / 2);
-    path.lineTo(width() + extraSpace, yMiddle);
+    path.lineTo(right, yMiddle + lineHeight / 2);
+    path.lineTo(right, yMiddle);
 
     painter->drawPath(path);                          // draw top waveform
     const QTransform tr(1, 0, 0, -1, 0, 2 * yMiddle); // mirror it
     painter->drawPath(tr.map(path));                  // draw bottom waveform
 }
 
-void TimelineWaveform::compute()
+void TimelineWaveform::ensureLevels(int margin)
+{
+    const auto inPoint = static_cast<int>(m_inPoint);
+    const auto outPoint = static_cast<int>(m_outPoint);
+    if (!m_needRecompute && inPoint >= m_computedIn && outPoint <= m_computedOut) {
+        return;
+    }
+    // Also compute the neighbourhood of the displayed range, so that scrolling does not need to recompute
+    compute(std::max(0, inPoint - margin), outPoint + margin);
+}
+
+void TimelineWaveform::compute(int inPoint, int outPoint)
 {
     QVector<int16_t> levels;
+    // Once generated, the levels are read from the mapped cache file, only the displayed range is copied
+    std::shared_ptr<const AudioLevelsCache> cache;
     if (m_binId.isEmpty()) {
         return;
     }
     if (m_stream >= 0) {
-        levels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId, m_stream);
-        if (levels.isEmpty()) {
-            return;
+        if (auto binClip = pCore->projectItemModel()->getClipByBinID(m_binId)) {
+            cache = binClip->audioLevelsCache(m_stream);
+        }
+        if (cache && cache->channels() != m_channels) {
+            cache.reset();
+        }
+        if (!cache) {
+            levels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId, m_stream);
+            if (levels.isEmpty()) {
+                return;
+            }
         }
     }
 
-    const auto inPoint = static_cast<int>(m_inPoint);
-    auto outPoint = static_cast<int>(m_outPoint);
-    const auto clipLength = levels.size() / AUDIOLEVELS_POINTS_PER_FRAME / m_channels;
+    const qint64 totalPoints = cache ? cache->pointCount(0) : levels.size() / m_channels;
+    const auto clipLength = int(totalPoints / AUDIOLEVELS_POINTS_PER_FRAME);
 
     if (inPoint < 0 || outPoint < 0 || outPoint <= inPoint || inPoint >= clipLength) {
         return;
     }
 
     if (outPoint > clipLength) {
-        qWarning() << "Waveform render outPoint=" << outPoint << " is higher than clipLength=" << clipLength << ", truncating.";
+        if (static_cast<int>(m_outPoint) > clipLength) {
+            qWarning() << "Waveform render outPoint=" << outPoint << " is higher than clipLength=" << clipLength << ", truncating.";
+        }
         outPoint = clipLength;
     }
 
@@ -112,18 +288,48 @@ void TimelineWaveform::compute()
     const int inputPoints = AUDIOLEVELS_POINTS_PER_FRAME * length;
     const bool reverse = m_speed < 0;
     m_pointsPerPixel = static_cast<double>(AUDIOLEVELS_POINTS_PER_FRAME) / timescale;
-    if (reverse) {
-        std::reverse(levels.begin(), levels.end());
+    // When zoomed out, read a decimated level of the cache file instead of scanning all the peaks
+    const bool resample = m_pointsPerPixel > 1;
+    const bool useDecimated = resample && cache && !reverse && m_pointsPerPixel >= AudioLevelsCache::pyramidFactor;
+    const int level = useDecimated ? cache->levelForPointsPerPixel(m_pointsPerPixel) : 0;
+    QVector<int16_t> decimated;
+    if (level > 0) {
+        const qint64 decimation = cache->decimation(level);
+        const qint64 firstPoint = qint64(inPoint) * AUDIOLEVELS_POINTS_PER_FRAME / decimation;
+        const qint64 lastPoint = (qint64(outPoint) * AUDIOLEVELS_POINTS_PER_FRAME + decimation - 1) / decimation;
+        decimated = cache->maxLevels(level, firstPoint, lastPoint - firstPoint);
+    }
+    // Index of the first displayed value in levels
+    qint64 levelsOffset = qint64(inPoint) * AUDIOLEVELS_POINTS_PER_FRAME * m_channels;
+    if (decimated.isEmpty()) {
+        if (cache) {
+            // Only read the displayed points, the reversed range starts from the end of the clip
+            const qint64 firstPoint =
+                reverse ? totalPoints - qint64(outPoint) * AUDIOLEVELS_POINTS_PER_FRAME : qint64(inPoint) * AUDIOLEVELS_POINTS_PER_FRAME;
+            levels = cache->maxLevels(0, firstPoint, inputPoints);
+            if (levels.size() != inputPoints * m_channels) {
+                // The cache file was released
+                return;
+            }
+            levelsOffset = 0;
+        }
+        if (reverse) {
+            std::reverse(levels.begin(), levels.end());
+        }
     }
 
-    if (m_pointsPerPixel > 1) {
+    if (resample) {
         // Resample the levels and store them
         const int outputPoints = std::round(length * timescale);
         m_audioLevels.resize(outputPoints * m_channels);
-        computePeaks(&levels[inPoint * AUDIOLEVELS_POINTS_PER_FRAME * m_channels], m_audioLevels.data(), m_channels, inputPoints, outputPoints);
+        if (!decimated.isEmpty()) {
+            computePeaks(decimated.constData(), m_audioLevels.data(), m_channels, decimated.size() / m_channels, outputPoints);
+        } else {
+            computePeaks(&levels[levelsOffset], m_audioLevels.data(), m_channels, inputPoints, outputPoints);
+        }
     } else {
         // Just extract the part to be displayed
-        m_audioLevels = levels.mid(inPoint * AUDIOLEVELS_POINTS_PER_FRAME * m_channels, inputPoints * m_channels);
+        m_audioLevels = levels.mid(levelsOffset, inputPoints * m_channels);
     }
 
     if (!m_separateChannels) {
@@ -140,24 +346,102 @@ void TimelineWaveform::compute()
         m_audioLevels.resize(points);
     }
 
+    m_computedIn = inPoint;
+    // A range ending after the clip is covered by the levels up to the clip end
+    m_computedOut = outPoint == clipLength ? std::numeric_limits<int>::max() : outPoint;
+    m_levelsVersion++;
     m_needRecompute = false;
 }
-void TimelineWaveform::paint(QPainter *painter)
+
+QSGNode *TimelineWaveform::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
 {
-    if (m_needRecompute) {
-        compute();
+    Q_UNUSED(data)
+    const auto inPoint = static_cast<int>(m_inPoint);
+    ensureLevels(std::max(0, static_cast<int>(m_outPoint) - inPoint));
+    if (m_audioLevels.isEmpty() || width() <= 0 || height() <= 0) {
+        delete oldNode;
+        return nullptr;
+    }
+    auto *node = static_cast<WaveformNode *>(oldNode);
+    if (node == nullptr) {
+        node = new WaveformNode();
     }
+    node->setRect(boundingRect());
+    const int channels = displayedChannels();
+    node->setChannelCount(channels);
+    const bool rebuildGeometry = node->levelsVersion != m_levelsVersion;
+    node->levelsVersion = m_levelsVersion;
+    const bool drawNames = m_drawChannelNames && channels > 1 && m_channels > 1 && m_channels < 7;
+    const double channelHeight = height() / channels;
+    const double scroll = scrollOffset();
+
+    for (int ch = 0; ch < channels; ch++) {
+        WaveformNode::Channel &channel = node->channels[size_t(ch)];
+        const auto yOrigin = ch * channelHeight;
+        const auto fgColor = ch % 2 == 0 ? m_fgColorEven : m_fgColorOdd;
+        const auto bgColor = ch % 2 == 0 ? m_bgColorEven : m_bgColorOdd;
+        const auto yMiddle = yOrigin + channelHeight / 2;
+
+        channel.background->setRect(0, yOrigin, width(), channelHeight);
+        channel.background->setColor(bgColor);
+        channel.midLine->setRect(0, std::floor(yMiddle), width(), 1);
+        channel.midLine->setColor(fgColor);
+
+        if (rebuildGeometry) {
+            channel.wave->setGeometry(buildWaveGeometry(m_audioLevels, ch, channels, m_pointsPerPixel));
+            channel.wave->markDirty(QSGNode::DirtyGeometry);
+        }
+        auto *material = static_cast<QSGFlatColorMaterial *>(channel.wave->material());
+        if (material->color() != fgColor) {
+            material->setColor(fgColor);
+            channel.wave->markDirty(QSGNode::DirtyMaterial);
+        }
+        QMatrix4x4 matrix;
+        matrix.translate(float(-scroll), float(yMiddle));
+        matrix.scale(1.f, float(channelHeight * m_normalizeFactor));
+        if (matrix != channel.transform->matrix()) {
+            channel.transform->setMatrix(matrix);
+        }
+
+        // channel names
+        if (!drawNames) {
+            if (channel.label) {
+                node->removeChildNode(channel.label);
+                delete channel.label;
+                channel.label = nullptr;
+            }
+            continue;
+        }
+        if (channel.label == nullptr) {
+            channel.label = new QSGSimpleTextureNode();
+            channel.label->setOwnsTexture(true);
+            node->insertChildNodeAfter(channel.label, channel.transform);
+        }
+        if (channel.label->texture() == nullptr || channel.labelColor != fgColor) {
+            channel.label->setTexture(createLabelTexture(window(), channelNames[ch], fgColor));
+            channel.labelColor = fgColor;
+        }
+        // Text drawn with its baseline at the bottom of the channel
+        const QFontMetrics metrics(QGuiApplication::font());
+        const QSizeF labelSize = QSizeF(channel.label->texture()->textureSize()) / window()->effectiveDevicePixelRatio();
+        channel.label->setRect(QRectF(QPointF(2, yOrigin + channelHeight - metrics.ascent()), labelSize));
+    }
+    return node;
+}
+
+void TimelineWaveform::paint(QPainter *painter)
+{
+    ensureLevels(0);
 
     if (m_audioLevels.isEmpty()) {
         return;
     }
 
-    const auto channels = m_separateChannels ? m_channels : 1;
-    const QStringList channelNames{"L", "R", "C", "LFE", "BL", "BR"};
+    const auto channels = displayedChannels();
 
-    // if the inpoint is not an integer, start drawing a bit further back so that the visible window is correct
-    const double frac = (m_inPoint - std::floor(m_inPoint)) / m_pointsPerPixel * AUDIOLEVELS_POINTS_PER_FRAME;
-    painter->translate(-frac, 0);
+    // start drawing a bit further back so that the visible window is correct
+    const double scroll = scrollOffset();
+    painter->translate(-scroll, 0);
 
     for (int ch = 0; ch < channels; ch++) {
         const auto channelHeight = height() / channels;
@@ -169,12 +453,12 @@ void TimelineWaveform::paint(QPainter *painter)
         // draw background
         painter->setBrush(bgColor);
         painter->setPen(Qt::NoPen);
-        painter->drawRect(0, yOrigin, width() + frac, channelHeight);
+        painter->drawRect(scroll, yOrigin, width(), channelHeight);
 
         // draw middle line
         painter->setBrush(Qt::NoBrush);
         painter->setPen(fgColor);
-        painter->drawLine(0, yMiddle, width() + frac, yMiddle);
+        painter->drawLine(scroll, yMiddle, scroll + width(), yMiddle);
 
         // draw the waveform
         if (m_pointsPerPixel > 1) {
@@ -190,7 +474,7 @@ void TimelineWaveform::paint(QPainter *painter)
         // draw channel names
         if (m_drawChannelNames && channels > 1 && m_channels > 1 && m_channels < 7) {
             painter->setPen(fgColor);
-            painter->drawText(2, yOrigin + channelHeight, channelNames[ch]);
+            painter->drawText(scroll + 2, yOrigin + channelHeight, channelNames[ch]);
         }
     }
 }
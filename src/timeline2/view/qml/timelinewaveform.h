@@ -7,9 +7,18 @@
 */
 
 #pragma once
-#include <QtQuick/QQuickPaintedItem>
+#include <QtQuick/QQuickItem>
 
-class TimelineWaveform : public QQuickPaintedItem
+class QPainter;
+
+/** @class TimelineWaveform
+    @brief Draws the audio levels of a clip stream through the scene graph.
+
+    The levels of a zoom level are computed for the displayed range plus a margin on each side, and turned into
+    vertex geometry once. Scrolling inside the computed range only translates that geometry. The geometry of a channel
+    is built in a unit height, so that resizing, normalizing or changing the colors does not rebuild it.
+ */
+class TimelineWaveform : public QQuickItem
 {
     Q_OBJECT
     QML_ELEMENT
@@ -20,8 +29,8 @@ class TimelineWaveform : public QQuickPaintedItem
     Q_PROPERTY(QColor fgColorOdd MEMBER m_fgColorOdd NOTIFY needRedraw)
     Q_PROPERTY(int channels MEMBER m_channels NOTIFY needRecompute)
     Q_PROPERTY(QString binId MEMBER m_binId NOTIFY needRecompute)
-    Q_PROPERTY(double waveInPoint MEMBER m_inPoint NOTIFY needRecompute)
-    Q_PROPERTY(double waveOutPoint MEMBER m_outPoint NOTIFY needRecompute)
+    Q_PROPERTY(double waveInPoint MEMBER m_inPoint NOTIFY rangeChanged)
+    Q_PROPERTY(double waveOutPoint MEMBER m_outPoint NOTIFY rangeChanged)
     Q_PROPERTY(int audioStream MEMBER m_stream NOTIFY needRecompute)
     Q_PROPERTY(double scaleFactor MEMBER m_scale NOTIFY needRecompute)
     Q_PROPERTY(double speed MEMBER m_speed NOTIFY needRecompute)
@@ -32,14 +41,20 @@ class TimelineWaveform : public QQuickPaintedItem
 
 public:
     TimelineWaveform(QQuickItem *parent = nullptr);
-    void paint(QPainter *painter) override;
+    /** @brief Draws the waveform with a painter, used to render it outside of a scene */
+    void paint(QPainter *painter);
 
 Q_SIGNALS:
     void needRecompute();
     void needRedraw();
+    void rangeChanged();
     void normalizeChanged();
 
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+
 private:
+    /** @brief The levels of the computed range, one point per pixel when zoomed out */
     QVector<int16_t> m_audioLevels;
     double m_inPoint{0};
     double m_outPoint{0};
@@ -59,8 +74,20 @@ private:
     bool m_needRecompute{true};
     bool m_drawChannelNames{false};
     double m_pointsPerPixel{1};
+    /** @brief The frames covered by m_audioLevels */
+    int m_computedIn{0};
+    int m_computedOut{0};
+    /** @brief Incremented each time m_audioLevels changes, the paint node rebuilds its geometry when it differs */
+    int m_levelsVersion{0};
 
+    /** @brief Recomputes the levels if needed, so that they cover the displayed range
+     *  @param margin the number of frames computed before and after the displayed range, if they need to be recomputed
+     */
+    void ensureLevels(int margin);
+    void compute(int inPoint, int outPoint);
+    /** @brief The horizontal position of the displayed range in the computed levels, in pixels */
+    double scrollOffset() const;
+    int displayedChannels() const;
     void drawWaveformLines(QPainter *painter, int ch, int channels, qreal yMiddle, qreal channelHeight);
     void drawWaveformPath(QPainter *painter, int ch, int channels, qreal yMiddle, qreal channelHeight);
-    void compute();
 };
@@ -12,62 +12,147 @@
 #include "doc/kthumb.h"
 #include "utils/thumbnailcache.hpp"
 
-#include <QCryptographicHash>
 #include <QDebug>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
 #include <mlt++/MltFilter.h>
 #include <mlt++/MltProfile.h>
 
+class ThumbnailResponse : public QQuickImageResponse
+{
+public:
+    QQuickTextureFactory *textureFactory() const override { return QQuickTextureFactory::textureFactoryForImage(m_image); }
+    void cancel() override { m_canceled = true; }
+    bool isCanceled() const { return m_canceled; }
+    /** @brief Sets the result and emits finished(). Must be called exactly once, even if canceled, the response is deleted afterwards. */
+    void deliver(const QImage &image)
+    {
+        m_image = image;
+        Q_EMIT finished();
+    }
+
+private:
+    QImage m_image;
+    std::atomic<bool> m_canceled{false};
+};
+
 ThumbnailProvider::ThumbnailProvider()
-    : QQuickImageProvider(QQmlImageProviderBase::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading)
+    : QQuickAsyncImageProvider()
 {
+    // Each clip is decoded by a single worker, a few clips can be decoded concurrently
+    m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
 }
 
-ThumbnailProvider::~ThumbnailProvider() = default;
+ThumbnailProvider::~ThumbnailProvider()
+{
+    m_pool.waitForDone();
+}
 
-QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+QQuickImageResponse *ThumbnailProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
-    QImage result;
+    Q_UNUSED(requestedSize)
+    auto *response = new ThumbnailResponse();
     // id is binID/#frameNumber
-    QString binId = id.section('/', 0, 0);
+    const QString binId = id.section('/', 0, 0);
     bool ok;
-    int frameNumber = id.section('#', -1).toInt(&ok);
-    if (ok) {
-        std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
-        if (binClip) {
-            int duration = binClip->frameDuration();
-            if (frameNumber > duration) {
+    const int frameNumber = id.section('#', -1).toInt(&ok);
+    if (!ok) {
+        // Finish once the caller had the opportunity to connect to the response
+        QMetaObject::invokeMethod(response, [response]() { response->deliver(QImage()); }, Qt::QueuedConnection);
+        return response;
+    }
+    QMutexLocker lock(&m_mutex);
+    auto queue = m_queues.find(binId);
+    if (queue != m_queues.end()) {
+        // The clip worker is running, it will pick this request in its next pass
+        queue->push_back({frameNumber, response});
+        return response;
+    }
+    m_queues.insert(binId, {{frameNumber, response}});
+    lock.unlock();
+    m_pool.start([this, binId]() { processClip(binId); });
+    return response;
+}
+
+void ThumbnailProvider::processClip(const QString &binId)
+{
+    std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
+    // The producer is kept for all the passes of this worker
+    std::unique_ptr<Mlt::Producer> producer;
+    while (true) {
+        std::vector<Request> batch;
+        {
+            QMutexLocker lock(&m_mutex);
+            auto queue = m_queues.find(binId);
+            if (queue == m_queues.end() || queue->empty()) {
+                m_queues.remove(binId);
+                return;
+            }
+            batch.swap(*queue);
+        }
+        if (!binClip) {
+            for (const Request &request : batch) {
+                request.response->deliver(QImage());
+            }
+            continue;
+        }
+        const QString hash = binClip->hashForThumbs();
+        const int duration = binClip->frameDuration();
+        for (Request &request : batch) {
+            if (duration > 0 && request.frame > duration) {
                 // for endless loopable clips, we rewrite the position
-                frameNumber = frameNumber - ((frameNumber / duration) * duration);
+                request.frame = request.frame - ((request.frame / duration) * duration);
             }
-            result = ThumbnailCache::get()->getThumbnail(binClip->hashForThumbs(), binId, frameNumber);
-            if (!result.isNull()) {
-
-                *size = result.size();
-                return result;
+        }
+        // Seek forward only, requests for the same frame share a single decode
+        std::stable_sort(batch.begin(), batch.end(), [](const Request &a, const Request &b) { return a.frame < b.frame; });
+        int lastFrame = -1;
+        QImage lastImage;
+        bool producerFailed = false;
+        for (const Request &request : batch) {
+            if (request.response->isCanceled()) {
+                request.response->deliver(QImage());
+                continue;
+            }
+            if (request.frame == lastFrame) {
+                request.response->deliver(lastImage);
+                continue;
             }
-            std::unique_ptr<Mlt::Producer> prod = binClip->getThumbProducer();
-            if (prod && prod->is_valid()) {
-                if (binClip->clipType() != ClipType::Timeline && binClip->clipType() != ClipType::Playlist) {
-                    Mlt::Profile *prodProfile = &pCore->thumbProfile();
-                    Mlt::Filter scaler(*prodProfile, "swscale");
-                    Mlt::Filter padder(*prodProfile, "resize");
-                    Mlt::Filter converter(*prodProfile, "avcolor_space");
-                    prod->attach(scaler);
-                    prod->attach(padder);
-                    prod->attach(converter);
+            QImage result = ThumbnailCache::get()->getThumbnail(hash, binId, request.frame);
+            if (result.isNull() && !producerFailed) {
+                if (producer == nullptr) {
+                    producer = binClip->getThumbProducer();
+                    if (producer && producer->is_valid()) {
+                        if (binClip->clipType() != ClipType::Timeline && binClip->clipType() != ClipType::Playlist) {
+                            Mlt::Profile *prodProfile = &pCore->thumbProfile();
+                            Mlt::Filter scaler(*prodProfile, "swscale");
+                            Mlt::Filter padder(*prodProfile, "resize");
+                            Mlt::Filter converter(*prodProfile, "avcolor_space");
+                            producer->attach(scaler);
+                            producer->attach(padder);
+                            producer->attach(converter);
+                        }
+                    } else {
+                        // Thumb producer not available, answer the remaining requests with empty images
+                        producer.reset();
+                        producerFailed = true;
+                    }
+                }
+                if (producer) {
+                    result = makeThumbnail(producer.get(), request.frame);
+                    ThumbnailCache::get()->storeThumbnail(binId, request.frame, result, false);
                 }
-                result = makeThumbnail(std::move(prod), frameNumber, requestedSize);
-                ThumbnailCache::get()->storeThumbnail(binId, frameNumber, result, false);
             }
+            lastFrame = request.frame;
+            lastImage = result;
+            request.response->deliver(result);
         }
     }
-    if (size) *size = result.size();
-    return result;
 }
 
-QImage ThumbnailProvider::makeThumbnail(std::unique_ptr<Mlt::Producer> producer, int frameNumber, const QSize &requestedSize)
+QImage ThumbnailProvider::makeThumbnail(Mlt::Producer *producer, int frameNumber)
 {
-    Q_UNUSED(requestedSize)
     producer->seek(frameNumber);
     std::unique_ptr<Mlt::Frame> frame(producer->get_frame());
     if (frame == nullptr || !frame->is_valid()) {
@@ -7,21 +7,42 @@
 
 #pragma once
 
-#include <KImageCache>
-#include <QCache>
+#include <QHash>
+#include <QMutex>
 #include <QQuickImageProvider>
+#include <QThreadPool>
 #include <memory>
 #include <mlt++/MltProducer.h>
 #include <mlt++/MltProfile.h>
+#include <vector>
 
-class ThumbnailProvider : public QQuickImageProvider
+class ThumbnailResponse;
+
+/** @class ThumbnailProvider
+    @brief Provides the clip thumbnails displayed in QML, as image://thumbnail/binId/#frame
+
+    Requests are answered asynchronously. The requests for a clip are queued and decoded by a single worker,
+    which reuses its thumb producer and decodes each batch of pending requests in increasing frame order.
+    Requests canceled by QML (for example when the item scrolled out of view) are answered without decoding.
+ */
+class ThumbnailProvider : public QQuickAsyncImageProvider
 {
 public:
     explicit ThumbnailProvider();
     ~ThumbnailProvider() override;
-    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
 
 private:
-    Mlt::Profile m_profile;
-    QImage makeThumbnail(std::unique_ptr<Mlt::Producer> producer, int frameNumber, const QSize &requestedSize);
+    struct Request
+    {
+        int frame;
+        ThumbnailResponse *response;
+    };
+    /** @brief Pending requests of each clip, by bin id. A clip is in this map while its worker is running. */
+    QHash<QString, std::vector<Request>> m_queues;
+    QMutex m_mutex;
+    QThreadPool m_pool;
+    /** @brief Answers the queued requests of a clip until there are none left */
+    void processClip(const QString &binId);
+    QImage makeThumbnail(Mlt::Producer *producer, int frameNumber);
 };
@@ -2650,7 +2650,7 @@ void TimelineController::disablePreview(bool disable)
                 m_model->m_tractor->unlock();
             }
             Mlt::Playlist playlist;
-            m_model->previewManager()->loadChunks(QVariantList(), QVariantList(), playlist);
+            m_model->previewManager()->loadChunks({}, {}, playlist);
             m_usePreview = true;
         }
     }
@@ -2658,17 +2658,24 @@ void TimelineController::disablePreview(bool disable)
 
 QVariantList TimelineController::dirtyChunks() const
 {
-    return m_model->hasTimelinePreview() ? m_model->previewManager()->m_dirtyChunks : QVariantList();
+    return m_model->hasTimelinePreview() ? m_model->previewManager()->m_dirtyChunks.toVariantList() : QVariantList();
 }
 
 QVariantList TimelineController::renderedChunks() const
 {
-    return m_model->hasTimelinePreview() ? m_model->previewManager()->m_renderedChunks : QVariantList();
+    return m_model->hasTimelinePreview() ? m_model->previewManager()->m_renderedChunks.toVariantList() : QVariantList();
 }
 
-int TimelineController::workingPreview() const
+QVariantList TimelineController::workingPreviews() const
 {
-    return m_model->hasTimelinePreview() ? m_model->previewManager()->workingPreview : -1;
+    QVariantList chunks;
+    if (m_model->hasTimelinePreview()) {
+        const QList<int> working = m_model->previewManager()->workingPreviews();
+        for (int chunk : working) {
+            chunks << chunk;
+        }
+    }
+    return chunks;
 }
 
 bool TimelineController::useRuler() const
@@ -5269,6 +5276,19 @@ void TimelineController::showToolTip(const QString &info) const
     pCore->displayMessage(info, TooltipMessage);
 }
 
+void TimelineController::setVisibleRange(int startFrame, int endFrame)
+{
+    QSet<int> binIds;
+    const std::unordered_set<int> tracks = m_model->getAllTracksIds();
+    for (int trackId : tracks) {
+        const std::unordered_set<int> clips = m_model->getTrackById_const(trackId)->getClipsInRange(startFrame, endFrame);
+        for (int clipId : clips) {
+            binIds.insert(m_model->getClipBinId(clipId).toInt());
+        }
+    }
+    pCore->taskManager.setVisibleClips(binIds);
+}
+
 void TimelineController::showKeyBinding(const QString &info) const
 {
     pCore->window()->showKeyBinding(info);
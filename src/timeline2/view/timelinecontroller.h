@@ -39,7 +39,7 @@ class TimelineController : public QObject
     Q_PROPERTY(QVariantList dirtyChunks READ dirtyChunks NOTIFY dirtyChunksChanged)
     Q_PROPERTY(QVariantList renderedChunks READ renderedChunks NOTIFY renderedChunksChanged)
     Q_PROPERTY(QVariantList masterEffectZones MEMBER m_masterEffectZones NOTIFY masterZonesChanged)
-    Q_PROPERTY(int workingPreview READ workingPreview NOTIFY workingPreviewChanged)
+    Q_PROPERTY(QVariantList workingPreviews READ workingPreviews NOTIFY workingPreviewChanged)
     Q_PROPERTY(bool useRuler READ useRuler NOTIFY useRulerChanged)
     Q_PROPERTY(int activeTrack READ activeTrack WRITE setActiveTrack NOTIFY activeTrackChanged)
     Q_PROPERTY(QString audioZoomText READ audioZoomText NOTIFY audioZoomTextChanged)
@@ -197,6 +197,8 @@ public:
     Q_INVOKABLE QColor groupColor() const;
     Q_INVOKABLE int doubleClickInterval() const { return QApplication::doubleClickInterval(); }
     Q_INVOKABLE void showToolTip(const QString &info = QString()) const;
+    /** @brief The timeline view scrolled, the jobs of the clips displayed between these frames are started first */
+    Q_INVOKABLE void setVisibleRange(int startFrame, int endFrame);
     Q_INVOKABLE void showKeyBinding(const QString &info = QString()) const;
     Q_INVOKABLE void showTimelineToolInfo(bool show) const;
     /** @brief The model list for this timeline's subtitles */
@@ -587,7 +589,7 @@ public:
     QVariantList renderedChunks() const;
     /** @brief returns the frame currently processed by timeline preview, -1 if none
      */
-    int workingPreview() const;
+    QVariantList workingPreviews() const;
 
     /** @brief Return true if we want to use timeline ruler zone for editing */
     bool useRuler() const;
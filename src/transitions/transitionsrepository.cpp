@@ -47,13 +47,8 @@ Mlt::Properties *TransitionsRepository::getMetadata(const QString &assetId) cons
     return pCore->getMltRepository()->metadata(mlt_service_transition_type, assetId.toLatin1().data());
 }
 
-void TransitionsRepository::parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
+void TransitionsRepository::parseCustomAssetDocument(QDomDocument &doc, const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
 {
-    QDomDocument doc;
-    if (!Xml::docContentFromFile(doc, file_name, false)) {
-        return;
-    }
-
     QDomElement base = doc.documentElement();
     QDomNodeList transitions = doc.elementsByTagName(QStringLiteral("transition"));
 
@@ -103,6 +98,11 @@ std::unique_ptr<TransitionsRepository> &TransitionsRepository::get()
     return instance;
 }
 
+QString TransitionsRepository::cacheName() const
+{
+    return QStringLiteral("transitions");
+}
+
 QStringList TransitionsRepository::assetDirs() const
 {
     return QStandardPaths::locateAll(QStandardPaths::AppDataLocation, QStringLiteral("transitions"), QStandardPaths::LocateDirectory);
@@ -10,6 +10,72 @@
 #include <QDebug>
 #include <QTime>
 #include <utility>
+
+OperationList::OperationList(Fun root)
+    : m_root(std::move(root))
+{
+}
+
+size_t OperationList::size() const
+{
+    return m_entries.size();
+}
+
+// static
+void OperationList::push(Fun &lambda, Fun operation, Kind kind)
+{
+    auto *list = lambda.target<OperationList>();
+    if (list == nullptr) {
+        lambda = OperationList(std::move(lambda));
+        list = lambda.target<OperationList>();
+    }
+    list->m_entries.push_back({std::move(operation), kind});
+}
+
+bool OperationList::operator()() const
+{
+    // Entry i wraps the root and the entries before it. The operations added before the others run first,
+    // starting from the last added one. The result of the always run ones is combined once everything they wrap is done.
+    std::vector<std::pair<size_t, bool>> pending;
+    size_t first = 0;
+    bool result = false;
+    bool stopped = false;
+    for (size_t i = m_entries.size(); i-- > 0;) {
+        const Entry &entry = m_entries[i];
+        if (entry.kind == Kind::Before) {
+            if (!entry.operation()) {
+                // Nothing wrapped by this entry runs
+                stopped = true;
+                first = i + 1;
+                break;
+            }
+        } else if (entry.kind == Kind::BeforeAlways) {
+            pending.emplace_back(i, entry.operation());
+        }
+    }
+    if (!stopped) {
+        result = m_root();
+    }
+    for (size_t i = first; i < m_entries.size(); ++i) {
+        const Entry &entry = m_entries[i];
+        switch (entry.kind) {
+        case Kind::After:
+            result = result && entry.operation();
+            break;
+        case Kind::AfterAlways:
+            result = entry.operation() && result;
+            break;
+        case Kind::BeforeAlways:
+            Q_ASSERT(!pending.empty() && pending.back().first == i);
+            result = result && pending.back().second;
+            pending.pop_back();
+            break;
+        case Kind::Before:
+            break;
+        }
+    }
+    return result;
+}
 FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_undo(std::move(undo))
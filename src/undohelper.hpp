@@ -6,24 +6,55 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 
 using Fun = std::function<bool(void)>;
 
-/** @brief this macro executes an operation after a given lambda
+/** @class OperationList
+    @brief A flat list of undo/redo operations, callable as a Fun.
+    The macros below append to it in place instead of wrapping the previous function in a new closure, so that
+    building a function from thousands of operations does not allocate one closure per operation (and copy the
+    whole chain each time) and running it does not recurse once per operation.
+    It runs the operations in the same order and with the same success semantics as the equivalent nested closures.
  */
-#define PUSH_LAMBDA(operation, lambda)                                                                                                                         \
-    lambda = [lambda, operation]() {                                                                                                                           \
-        bool v = lambda();                                                                                                                                     \
-        return v && operation();                                                                                                                               \
+class OperationList
+{
+public:
+    enum class Kind {
+        /** @brief Run after the others if they succeeded */
+        After,
+        /** @brief Always run after the others */
+        AfterAlways,
+        /** @brief Run before the others, which only run if it succeeded */
+        Before,
+        /** @brief Run before the others, which always run */
+        BeforeAlways
     };
 
+    explicit OperationList(Fun root);
+    bool operator()() const;
+    size_t size() const;
+
+    /** @brief Adds an operation to a function, turning it into an OperationList if it is not one yet */
+    static void push(Fun &lambda, Fun operation, Kind kind);
+
+private:
+    struct Entry
+    {
+        Fun operation;
+        Kind kind;
+    };
+    Fun m_root;
+    std::vector<Entry> m_entries;
+};
+
+/** @brief this macro executes an operation after a given lambda
+ */
+#define PUSH_LAMBDA(operation, lambda) OperationList::push(lambda, operation, OperationList::Kind::After);
+
 /** @brief this macro executes an operation before a given lambda
  */
-#define PUSH_FRONT_LAMBDA(operation, lambda)                                                                                                                   \
-    lambda = [lambda, operation]() {                                                                                                                           \
-        bool v = operation();                                                                                                                                  \
-        return v && lambda();                                                                                                                                  \
-    };
+#define PUSH_FRONT_LAMBDA(operation, lambda) OperationList::push(lambda, operation, OperationList::Kind::Before);
 
 #include <QUndoCommand>
 
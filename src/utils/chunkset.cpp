@@ -0,0 +1,192 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "chunkset.h"
+
+#include <iterator>
+
+ChunkSet::ChunkSet(int step)
+    : m_step(qMax(1, step))
+{
+}
+
+int ChunkSet::step() const
+{
+    return m_step;
+}
+
+bool ChunkSet::isEmpty() const
+{
+    return m_ranges.empty();
+}
+
+int ChunkSet::count() const
+{
+    return m_count;
+}
+
+int ChunkSet::first() const
+{
+    return m_ranges.cbegin()->first;
+}
+
+int ChunkSet::last() const
+{
+    return m_ranges.crbegin()->second;
+}
+
+bool ChunkSet::isAligned(int frame) const
+{
+    return frame % m_step == 0;
+}
+
+bool ChunkSet::contains(int frame) const
+{
+    if (!isAligned(frame)) {
+        return false;
+    }
+    auto it = m_ranges.upper_bound(frame);
+    if (it == m_ranges.cbegin()) {
+        return false;
+    }
+    --it;
+    return frame <= it->second;
+}
+
+bool ChunkSet::insert(int frame)
+{
+    if (!isAligned(frame)) {
+        return false;
+    }
+    auto next = m_ranges.upper_bound(frame);
+    if (next != m_ranges.begin()) {
+        auto previous = std::prev(next);
+        if (frame <= previous->second) {
+            return false;
+        }
+        if (previous->second + m_step == frame) {
+            // Extend the previous range, and join it with the next one if they touch
+            previous->second = frame;
+            if (next != m_ranges.end() && next->first == frame + m_step) {
+                previous->second = next->second;
+                m_ranges.erase(next);
+            }
+            ++m_count;
+            return true;
+        }
+    }
+    if (next != m_ranges.end() && next->first == frame + m_step) {
+        const int rangeEnd = next->second;
+        m_ranges.erase(next);
+        m_ranges.emplace(frame, rangeEnd);
+    } else {
+        m_ranges.emplace(frame, frame);
+    }
+    ++m_count;
+    return true;
+}
+
+bool ChunkSet::remove(int frame)
+{
+    if (!isAligned(frame)) {
+        return false;
+    }
+    auto it = m_ranges.upper_bound(frame);
+    if (it == m_ranges.begin()) {
+        return false;
+    }
+    --it;
+    if (frame > it->second) {
+        return false;
+    }
+    const int rangeStart = it->first;
+    const int rangeEnd = it->second;
+    if (rangeStart == frame) {
+        m_ranges.erase(it);
+    } else {
+        it->second = frame - m_step;
+    }
+    if (rangeEnd != frame) {
+        // Keep the chunks after the removed one
+        m_ranges.emplace(frame + m_step, rangeEnd);
+    }
+    --m_count;
+    return true;
+}
+
+void ChunkSet::clear()
+{
+    m_ranges.clear();
+    m_count = 0;
+}
+
+bool ChunkSet::intersects(int start, int end) const
+{
+    // The ranges do not overlap, so the last one starting before the end reaches the farthest
+    auto it = m_ranges.upper_bound(end);
+    if (it == m_ranges.cbegin()) {
+        return false;
+    }
+    --it;
+    if (it->second < start) {
+        return false;
+    }
+    // The interval may only hold frames between two chunks of the range
+    const int from = qMax(it->first, start);
+    return (from + m_step - 1) / m_step * m_step <= qMin(it->second, end);
+}
+
+QList<int> ChunkSet::values(int start, int end) const
+{
+    QList<int> result;
+    auto it = m_ranges.upper_bound(start);
+    if (it != m_ranges.cbegin() && std::prev(it)->second >= start) {
+        --it;
+    }
+    for (; it != m_ranges.cend() && it->first <= end; ++it) {
+        int frame = it->first;
+        if (frame < start) {
+            // Align on the chunks of the range
+            frame += (start - frame + m_step - 1) / m_step * m_step;
+        }
+        for (; frame <= it->second && frame <= end; frame += m_step) {
+            result << frame;
+        }
+    }
+    return result;
+}
+
+QList<int> ChunkSet::toList() const
+{
+    QList<int> result;
+    result.reserve(m_count);
+    for (const auto &[rangeStart, rangeEnd] : m_ranges) {
+        for (int frame = rangeStart; frame <= rangeEnd; frame += m_step) {
+            result << frame;
+        }
+    }
+    return result;
+}
+
+QVariantList ChunkSet::toVariantList() const
+{
+    QVariantList result;
+    result.reserve(m_count);
+    for (const auto &[rangeStart, rangeEnd] : m_ranges) {
+        for (int frame = rangeStart; frame <= rangeEnd; frame += m_step) {
+            result << frame;
+        }
+    }
+    return result;
+}
+
+QStringList ChunkSet::toCompressedList() const
+{
+    QStringList result;
+    for (const auto &[rangeStart, rangeEnd] : m_ranges) {
+        result << (rangeStart == rangeEnd ? QString::number(rangeStart) : QStringLiteral("%1-%2").arg(rangeStart).arg(rangeEnd));
+    }
+    return result;
+}
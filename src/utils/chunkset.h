@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QList>
+#include <QStringList>
+#include <QVariantList>
+#include <map>
+
+/** @class ChunkSet
+    @brief A set of timeline chunks, stored as ranges of consecutive chunks.
+
+    The chunks are identified by their first frame, a multiple of the chunk size. Other frames are never in the set,
+    they can't be inserted and contains() returns false for them. A preview zone is mostly made of a few
+    long ranges, so insert, remove, contains and range queries are logarithmic in the number of ranges and the set stays
+    small on long timelines.
+ */
+class ChunkSet
+{
+public:
+    /** @param step the chunk size in frames, consecutive chunks are this far apart */
+    explicit ChunkSet(int step);
+
+    int step() const;
+    bool isEmpty() const;
+    int count() const;
+    /** @brief Returns the first chunk, the set must not be empty */
+    int first() const;
+    /** @brief Returns the last chunk, the set must not be empty */
+    int last() const;
+    /** @brief Returns true if @param frame is the first frame of a chunk */
+    bool isAligned(int frame) const;
+    bool contains(int frame) const;
+    /** @returns false if the chunk was already in the set, or if @param frame is not aligned on the chunk size */
+    bool insert(int frame);
+    /** @returns false if the chunk was not in the set */
+    bool remove(int frame);
+    void clear();
+    /** @brief Returns true if a chunk of the set is between @param start and @param end included */
+    bool intersects(int start, int end) const;
+    /** @brief Returns the chunks between @param start and @param end included, sorted */
+    QList<int> values(int start, int end) const;
+    /** @brief Returns all the chunks, sorted */
+    QList<int> toList() const;
+    /** @brief Returns all the chunks, sorted, for QML */
+    QVariantList toVariantList() const;
+    /** @brief Returns the ranges of chunks, like: "0-500", "525", "575" */
+    QStringList toCompressedList() const;
+
+private:
+    int m_step;
+    int m_count{0};
+    /** @brief The first and last chunk of each range of consecutive chunks, by first chunk */
+    std::map<int, int> m_ranges;
+};
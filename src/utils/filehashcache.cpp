@@ -0,0 +1,240 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "filehashcache.hpp"
+#include "kdenlive_debug.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace {
+constexpr quint32 cacheMagic = 0x4b464843; // KFHC
+constexpr qint32 cacheVersion = 1;
+/** @brief Beyond this count, the least recently used hashes are not saved */
+constexpr int maxSavedEntries = 50000;
+/** @brief Files larger than twice this size are identified by their first and last part */
+constexpr qint64 hashedPartSize = 1000000;
+} // namespace
+
+std::unique_ptr<FileHashCache> FileHashCache::instance;
+std::once_flag FileHashCache::m_onceFlag;
+
+std::unique_ptr<FileHashCache> &FileHashCache::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new FileHashCache()); });
+    return instance;
+}
+
+FileHashCache::FileHashCache()
+{
+    // Hashing is mostly waiting for the disk, a few files are read concurrently
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+}
+
+FileHashCache::~FileHashCache()
+{
+    cancelPrefetch();
+}
+
+QString FileHashCache::cachePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/filehashes.cache");
+}
+
+bool FileHashCache::fileStamp(const QString &path, Entry &entry)
+{
+    const QFileInfo info(path);
+    if (!info.isFile()) {
+        return false;
+    }
+    entry.size = info.size();
+    entry.modified = info.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+    // A file replaced by another one with the same size and date, for example by a copy keeping the dates, has another inode
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+        entry.inode = quint64(st.st_ino);
+    }
+#endif
+    return true;
+}
+
+QByteArray FileHashCache::computeHash(const QString &path, qint64 size, qint64 &bytesRead)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    char buffer[64 * 1024];
+    auto addData = [&file, &hash, &buffer, &bytesRead](qint64 length) {
+        while (length > 0) {
+            const qint64 read = file.read(buffer, std::min<qint64>(length, qint64(sizeof(buffer))));
+            if (read <= 0) {
+                break;
+            }
+            hash.addData(QByteArrayView(buffer, read));
+            bytesRead += read;
+            length -= read;
+        }
+    };
+    if (size > 2 * hashedPartSize) {
+        addData(hashedPartSize);
+        if (file.seek(size - hashedPartSize)) {
+            addData(hashedPartSize);
+        }
+    } else {
+        addData(std::numeric_limits<qint64>::max());
+    }
+    return hash.result();
+}
+
+void FileHashCache::ensureLoaded()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    quint32 magic;
+    qint32 version;
+    qint32 count;
+    stream >> magic >> version >> count;
+    if (magic != cacheMagic || version != cacheVersion || count < 0) {
+        return;
+    }
+    m_entries.reserve(count);
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Entry entry;
+        stream >> path >> entry.size >> entry.modified >> entry.inode >> entry.hash >> entry.used;
+        if (stream.status() == QDataStream::Ok) {
+            m_entries.insert(path, entry);
+        }
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(KDENLIVE_LOG) << "File hash cache is corrupted, discarding it";
+        m_entries.clear();
+    }
+}
+
+QPair<QByteArray, qint64> FileHashCache::fileHash(const QString &path, qint64 *bytesRead)
+{
+    if (bytesRead) {
+        *bytesRead = 0;
+    }
+    Entry stamp;
+    if (!fileStamp(path, stamp)) {
+        return {QByteArray(), 0};
+    }
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    QMutexLocker lock(&m_mutex);
+    ensureLoaded();
+    while (true) {
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && it->size == stamp.size && it->modified == stamp.modified && it->inode == stamp.inode) {
+            it->used = now;
+            return {it->hash, it->size};
+        }
+        if (!m_pending.contains(path)) {
+            break;
+        }
+        // Another thread is hashing this file, for example a prefetch, use its result
+        m_hashed.wait(&m_mutex);
+    }
+    m_pending.insert(path);
+    lock.unlock();
+    // Read the file without holding the lock, so that other files can be hashed meanwhile
+    qint64 read = 0;
+    stamp.hash = computeHash(path, stamp.size, read);
+    if (bytesRead) {
+        *bytesRead = read;
+    }
+    stamp.used = now;
+    lock.relock();
+    m_pending.remove(path);
+    if (!stamp.hash.isEmpty()) {
+        m_entries.insert(path, stamp);
+        m_modified = true;
+    }
+    m_hashed.wakeAll();
+    if (stamp.hash.isEmpty()) {
+        return {QByteArray(), 0};
+    }
+    return {stamp.hash, stamp.size};
+}
+
+void FileHashCache::prefetch(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        m_pool.start([this, path]() { fileHash(path); });
+    }
+}
+
+void FileHashCache::cancelPrefetch()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void FileHashCache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_modified) {
+        return;
+    }
+    std::vector<QHash<QString, Entry>::const_iterator> entries;
+    entries.reserve(size_t(m_entries.size()));
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        entries.push_back(it);
+    }
+    if (entries.size() > size_t(maxSavedEntries)) {
+        // Keep the most recently used hashes
+        std::nth_element(entries.begin(), entries.begin() + maxSavedEntries, entries.end(),
+                         [](const QHash<QString, Entry>::const_iterator &a, const QHash<QString, Entry>::const_iterator &b) { return a->used > b->used; });
+        entries.resize(size_t(maxSavedEntries));
+    }
+    QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+    QSaveFile file(cachePath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(KDENLIVE_LOG) << "Cannot write file hash cache" << cachePath();
+        return;
+    }
+    QDataStream stream(&file);
+    stream << cacheMagic << cacheVersion << qint32(entries.size());
+    for (const auto &it : entries) {
+        stream << it.key() << it->size << it->modified << it->inode << it->hash << it->used;
+    }
+    if (file.commit()) {
+        m_modified = false;
+    }
+}
+
+void FileHashCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_loaded = true;
+    m_modified = false;
+}
@@ -0,0 +1,90 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <memory>
+#include <mutex>
+
+/** @class FileHashCache
+    @brief Caches the hash of media files, which identifies a clip (kdenlive:file_hash), between runs.
+
+    The hash is the MD5 of the first and last megabyte of the file, or of the whole file if it is smaller than 2 MB.
+    It is read through a fixed size buffer. A hash is reused as long as the file keeps the same path, size,
+    modification time and inode, so reopening a project or reloading its clips does not read the files again.
+    The cache is stored in the cache folder and written by save().
+ * Note that this class is a Singleton
+ */
+class FileHashCache
+{
+
+public:
+    friend class KdenliveTests;
+    // Returns the instance of the Singleton
+    static std::unique_ptr<FileHashCache> &get();
+    ~FileHashCache();
+
+    /** @brief Returns the hash of a file and its size, from the cache if the file did not change
+     *  @returns an empty hash if the file cannot be read
+     *  This method is thread safe, a file being hashed by another thread is waited for instead of being read again
+     *  @param bytesRead if set, receives the number of bytes read from the file, 0 when the hash was cached
+     */
+    QPair<QByteArray, qint64> fileHash(const QString &path, qint64 *bytesRead = nullptr);
+
+    /** @brief Hashes the files that are not in the cache in background threads, so that they are ready when the clips are loaded */
+    void prefetch(const QStringList &paths);
+
+    /** @brief Drops the files waiting to be prefetched and waits for the ones being hashed, called when the project is closed */
+    void cancelPrefetch();
+
+    /** @brief Writes the cache to disk if it changed */
+    void save();
+
+    /** @brief Drops the cached hashes, the cache file is kept */
+    void clear();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    FileHashCache();
+    static std::unique_ptr<FileHashCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the singleton in a thread safe way
+
+private:
+    struct Entry
+    {
+        qint64 size{0};
+        qint64 modified{0};
+        quint64 inode{0};
+        QByteArray hash;
+        /** @brief Last time the entry was used, in seconds since epoch, to discard the oldest entries */
+        qint64 used{0};
+    };
+    /** @brief Reads the size, modification time and inode of a file
+     *  @returns false if the file does not exist
+     */
+    static bool fileStamp(const QString &path, Entry &entry);
+    static QByteArray computeHash(const QString &path, qint64 size, qint64 &bytesRead);
+    QString cachePath() const;
+    /** @brief Reads the cache file on first use */
+    void ensureLoaded();
+
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    /** @brief The files being hashed, other threads requesting them wait on m_hashed */
+    QSet<QString> m_pending;
+    QWaitCondition m_hashed;
+    bool m_loaded{false};
+    bool m_modified{false};
+    QThreadPool m_pool;
+};
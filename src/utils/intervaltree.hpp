@@ -0,0 +1,231 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+/** @class IntervalTree
+    @brief A set of closed intervals [start, end] tagged with a value, answering overlap queries in O(log n + k).
+    It is a balanced (AVL) binary search tree ordered by (start, value), where each node also stores the largest end
+    of its subtree, so that the subtrees that cannot overlap a query are skipped. An interval is identified by its
+    start and value, changing its end is done by removing and inserting it again.
+    Positions only need operator<, values need operator< and must be unique for a given start.
+ */
+template <typename Position, typename Value> class IntervalTree
+{
+public:
+    void insert(Position start, Position end, Value value)
+    {
+        auto node = std::make_unique<Node>(start, end, value);
+        insert(m_root, std::move(node));
+        m_size++;
+    }
+
+    /** @brief Removes the interval with this start and value
+     *  @return false if there is no such interval
+     */
+    bool remove(Position start, Value value)
+    {
+        if (remove(m_root, start, value)) {
+            m_size--;
+            return true;
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        m_root.reset();
+        m_size = 0;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /** @brief Calls callback(start, end, value) for each interval intersecting [from, to], in increasing start order */
+    template <typename Callback> void forEachOverlapping(Position from, Position to, Callback &&callback) const
+    {
+        overlapping(m_root.get(), from, to, callback);
+    }
+
+    /** @brief Finds the smallest value of the intervals starting at this position
+     *  @return false if no interval starts there
+     */
+    bool findStart(Position start, Value &value) const
+    {
+        bool found = false;
+        const Node *node = m_root.get();
+        while (node != nullptr) {
+            if (start < node->start) {
+                node = node->left.get();
+            } else if (node->start < start) {
+                node = node->right.get();
+            } else {
+                // Smaller values with the same start are on the left
+                value = node->value;
+                found = true;
+                node = node->left.get();
+            }
+        }
+        return found;
+    }
+
+private:
+    struct Node
+    {
+        Node(Position s, Position e, Value v)
+            : start(s)
+            , end(e)
+            , maxEnd(e)
+            , value(v)
+        {
+        }
+        Position start;
+        Position end;
+        /** @brief The largest end in this subtree */
+        Position maxEnd;
+        Value value;
+        int height{1};
+        std::unique_ptr<Node> left;
+        std::unique_ptr<Node> right;
+    };
+    std::unique_ptr<Node> m_root;
+    size_t m_size{0};
+
+    static bool lessThan(Position start, const Value &value, const Node *node)
+    {
+        return start < node->start || (!(node->start < start) && value < node->value);
+    }
+    static bool greaterThan(Position start, const Value &value, const Node *node)
+    {
+        return node->start < start || (!(start < node->start) && node->value < value);
+    }
+    static int height(const std::unique_ptr<Node> &node) { return node ? node->height : 0; }
+
+    static void update(Node *node)
+    {
+        node->height = 1 + std::max(height(node->left), height(node->right));
+        node->maxEnd = node->end;
+        if (node->left && node->maxEnd < node->left->maxEnd) {
+            node->maxEnd = node->left->maxEnd;
+        }
+        if (node->right && node->maxEnd < node->right->maxEnd) {
+            node->maxEnd = node->right->maxEnd;
+        }
+    }
+
+    static void rotateRight(std::unique_ptr<Node> &node)
+    {
+        std::unique_ptr<Node> left = std::move(node->left);
+        node->left = std::move(left->right);
+        update(node.get());
+        left->right = std::move(node);
+        node = std::move(left);
+        update(node.get());
+    }
+
+    static void rotateLeft(std::unique_ptr<Node> &node)
+    {
+        std::unique_ptr<Node> right = std::move(node->right);
+        node->right = std::move(right->left);
+        update(node.get());
+        right->left = std::move(node);
+        node = std::move(right);
+        update(node.get());
+    }
+
+    static void balance(std::unique_ptr<Node> &node)
+    {
+        update(node.get());
+        const int factor = height(node->left) - height(node->right);
+        if (factor > 1) {
+            if (height(node->left->left) < height(node->left->right)) {
+                rotateLeft(node->left);
+            }
+            rotateRight(node);
+        } else if (factor < -1) {
+            if (height(node->right->right) < height(node->right->left)) {
+                rotateRight(node->right);
+            }
+            rotateLeft(node);
+        }
+    }
+
+    static void insert(std::unique_ptr<Node> &node, std::unique_ptr<Node> item)
+    {
+        if (!node) {
+            node = std::move(item);
+            return;
+        }
+        if (lessThan(item->start, item->value, node.get())) {
+            insert(node->left, std::move(item));
+        } else {
+            insert(node->right, std::move(item));
+        }
+        balance(node);
+    }
+
+    /** @brief Detaches the leftmost node of a subtree */
+    static std::unique_ptr<Node> takeMin(std::unique_ptr<Node> &node)
+    {
+        if (!node->left) {
+            std::unique_ptr<Node> min = std::move(node);
+            node = std::move(min->right);
+            return min;
+        }
+        std::unique_ptr<Node> min = takeMin(node->left);
+        balance(node);
+        return min;
+    }
+
+    static bool remove(std::unique_ptr<Node> &node, Position start, const Value &value)
+    {
+        if (!node) {
+            return false;
+        }
+        bool removed;
+        if (lessThan(start, value, node.get())) {
+            removed = remove(node->left, start, value);
+        } else if (greaterThan(start, value, node.get())) {
+            removed = remove(node->right, start, value);
+        } else {
+            removed = true;
+            if (!node->left) {
+                node = std::move(node->right);
+            } else if (!node->right) {
+                node = std::move(node->left);
+            } else {
+                // Replace the node with the next one
+                std::unique_ptr<Node> next = takeMin(node->right);
+                next->left = std::move(node->left);
+                next->right = std::move(node->right);
+                node = std::move(next);
+            }
+        }
+        if (removed && node) {
+            balance(node);
+        }
+        return removed;
+    }
+
+    template <typename Callback> static void overlapping(const Node *node, Position from, Position to, Callback &callback)
+    {
+        if (node == nullptr || node->maxEnd < from) {
+            return;
+        }
+        overlapping(node->left.get(), from, to, callback);
+        if (to < node->start) {
+            // This node and its right subtree start after the range
+            return;
+        }
+        if (!(node->end < from)) {
+            callback(node->start, node->end, node->value);
+        }
+        overlapping(node->right.get(), from, to, callback);
+    }
+};
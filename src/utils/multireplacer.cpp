@@ -0,0 +1,193 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "multireplacer.h"
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+struct MultiReplacer::Automaton
+{
+    struct State
+    {
+        /** @brief Transitions of the trie, sorted by code unit */
+        std::vector<std::pair<char16_t, int>> next;
+        /** @brief The state of the longest proper suffix that is also a prefix of a pattern */
+        int fail{0};
+        int depth{0};
+        /** @brief The longest pattern ending in this state, -1 if none */
+        int match{-1};
+    };
+    struct Match
+    {
+        qsizetype start;
+        int pattern;
+    };
+    std::vector<State> states{State()};
+    std::vector<int> lengths;
+
+    int child(int state, char16_t unit) const
+    {
+        const auto &next = states[size_t(state)].next;
+        auto it = std::lower_bound(next.cbegin(), next.cend(), unit, [](const std::pair<char16_t, int> &a, char16_t b) { return a.first < b; });
+        return (it != next.cend() && it->first == unit) ? it->second : -1;
+    }
+
+    template <typename Unit> void add(const Unit *pattern, int length)
+    {
+        int state = 0;
+        for (int i = 0; i < length; ++i) {
+            const char16_t unit = pattern[i];
+            int target = child(state, unit);
+            if (target < 0) {
+                target = int(states.size());
+                State created;
+                created.depth = states[size_t(state)].depth + 1;
+                states.push_back(created);
+                auto &next = states[size_t(state)].next;
+                next.insert(std::upper_bound(next.begin(), next.end(), std::make_pair(unit, -1)), {unit, target});
+            }
+            state = target;
+        }
+        states[size_t(state)].match = int(lengths.size());
+        lengths.push_back(length);
+    }
+
+    /** @brief Computes the failure links, once all the patterns are added */
+    void build()
+    {
+        std::queue<int> pending;
+        pending.push(0);
+        while (!pending.empty()) {
+            const int state = pending.front();
+            pending.pop();
+            for (const auto &[unit, target] : states[size_t(state)].next) {
+                int fail = 0;
+                if (state != 0) {
+                    fail = states[size_t(state)].fail;
+                    while (fail != 0 && child(fail, unit) < 0) {
+                        fail = states[size_t(fail)].fail;
+                    }
+                    fail = std::max(child(fail, unit), 0);
+                }
+                State &next = states[size_t(target)];
+                next.fail = fail;
+                if (next.match < 0) {
+                    // Shallower states are already processed
+                    next.match = states[size_t(fail)].match;
+                }
+                pending.push(target);
+            }
+        }
+    }
+
+    int step(int state, char16_t unit) const
+    {
+        while (true) {
+            const int target = child(state, unit);
+            if (target >= 0) {
+                return target;
+            }
+            if (state == 0) {
+                return 0;
+            }
+            state = states[size_t(state)].fail;
+        }
+    }
+
+    /** @brief Returns the leftmost longest non overlapping matches, in order */
+    template <typename Unit> std::vector<Match> find(const Unit *text, qsizetype size) const
+    {
+        std::vector<Match> matches;
+        // The leftmost longest match found so far, kept until no longer match can start before it
+        Match candidate{-1, -1};
+        int state = 0;
+        qsizetype pos = 0;
+        while (pos < size) {
+            state = step(state, text[pos]);
+            ++pos;
+            const int pattern = states[size_t(state)].match;
+            if (pattern >= 0) {
+                const qsizetype start = pos - lengths[size_t(pattern)];
+                if (candidate.pattern < 0 || start < candidate.start ||
+                    (start == candidate.start && lengths[size_t(pattern)] > lengths[size_t(candidate.pattern)])) {
+                    candidate = {start, pattern};
+                }
+            }
+            if (candidate.pattern >= 0 && (pos == size || pos - states[size_t(state)].depth > candidate.start)) {
+                // Every pattern still in progress starts after the candidate, restart after it
+                matches.push_back(candidate);
+                pos = candidate.start + lengths[size_t(candidate.pattern)];
+                candidate = {-1, -1};
+                state = 0;
+            }
+        }
+        return matches;
+    }
+
+    /** @brief Builds the replaced text with a single allocation */
+    template <typename String> String replace(const String &text, const std::vector<Match> &matches, const QList<String> &replacements) const
+    {
+        if (matches.empty()) {
+            return text;
+        }
+        qsizetype size = text.size();
+        for (const Match &match : matches) {
+            size += replacements.at(match.pattern).size() - lengths[size_t(match.pattern)];
+        }
+        String result;
+        result.reserve(size);
+        qsizetype copied = 0;
+        for (const Match &match : matches) {
+            result.append(text.constData() + copied, match.start - copied);
+            result.append(replacements.at(match.pattern));
+            copied = match.start + lengths[size_t(match.pattern)];
+        }
+        result.append(text.constData() + copied, text.size() - copied);
+        return result;
+    }
+};
+
+MultiReplacer::MultiReplacer(const QMap<QString, QString> &replacements)
+    : m_utf16(std::make_unique<Automaton>())
+    , m_utf8(std::make_unique<Automaton>())
+{
+    for (auto i = replacements.cbegin(); i != replacements.cend(); ++i) {
+        if (i.key().isEmpty()) {
+            continue;
+        }
+        m_utf16->add(reinterpret_cast<const char16_t *>(i.key().constData()), int(i.key().size()));
+        m_replacements << i.value();
+        const QByteArray utf8 = i.key().toUtf8();
+        m_utf8->add(reinterpret_cast<const unsigned char *>(utf8.constData()), int(utf8.size()));
+        m_utf8Replacements << i.value().toUtf8();
+    }
+    m_utf16->build();
+    m_utf8->build();
+}
+
+MultiReplacer::~MultiReplacer() = default;
+
+bool MultiReplacer::isEmpty() const
+{
+    return m_replacements.isEmpty();
+}
+
+QString MultiReplacer::apply(const QString &text) const
+{
+    if (isEmpty()) {
+        return text;
+    }
+    return m_utf16->replace(text, m_utf16->find(reinterpret_cast<const char16_t *>(text.constData()), text.size()), m_replacements);
+}
+
+QByteArray MultiReplacer::apply(const QByteArray &text) const
+{
+    if (isEmpty()) {
+        return text;
+    }
+    return m_utf8->replace(text, m_utf8->find(reinterpret_cast<const unsigned char *>(text.constData()), text.size()), m_utf8Replacements);
+}
@@ -0,0 +1,43 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+/** @class MultiReplacer
+    @brief Replaces several patterns in a text in a single pass, with an Aho–Corasick automaton.
+
+    Used to rewrite paths in the project xml, which can be several megabytes long, without one pass per pattern.
+    At each position, the longest pattern starting there is replaced, and the scan continues after it. The result is
+    the same as replacing the patterns one after the other as long as no pattern contains another one and no
+    replacement creates a new occurrence of a pattern, which is the case of the folder rewrites it is used for.
+ */
+class MultiReplacer
+{
+public:
+    /** @param replacements the replacement of each pattern, empty patterns are ignored */
+    explicit MultiReplacer(const QMap<QString, QString> &replacements);
+    ~MultiReplacer();
+
+    bool isEmpty() const;
+    /** @brief Returns a copy of @param text with the patterns replaced */
+    QString apply(const QString &text) const;
+    /** @brief Returns a copy of the UTF-8 @param text with the patterns replaced */
+    QByteArray apply(const QByteArray &text) const;
+
+private:
+    struct Automaton;
+    /** @brief Built on UTF-16 code units to process QString */
+    std::unique_ptr<Automaton> m_utf16;
+    /** @brief Built on the UTF-8 bytes of the patterns to process QByteArray */
+    std::unique_ptr<Automaton> m_utf8;
+    QStringList m_replacements;
+    QList<QByteArray> m_utf8Replacements;
+};
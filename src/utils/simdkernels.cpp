@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "simdkernels.h"
+
+#include <algorithm>
+
+namespace SimdKernels {
+
+namespace {
+Kernel detectKernel()
+{
+#ifdef KDENLIVE_SIMD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return Kernel::AVX2;
+    }
+#endif
+#ifdef KDENLIVE_SIMD_SSE2
+    return Kernel::SSE2;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+Kernel detectedKernel()
+{
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+} // namespace
+
+bool isSupported(Kernel kernel)
+{
+    return kernel <= detectedKernel();
+}
+
+Kernel bestKernel(Kernel fastestImplemented)
+{
+    return std::min(detectedKernel(), fastestImplemented);
+}
+
+const char *kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case Kernel::Scalar:
+        return "scalar";
+    case Kernel::SSE2:
+        return "sse2";
+    case Kernel::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+} // namespace SimdKernels
@@ -0,0 +1,37 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+// Instruction sets the vectorized kernels can be compiled with, the intrinsics headers are included by the kernels
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KDENLIVE_SIMD_SSE2
+#endif
+
+// AVX2 functions are compiled with a target attribute and only used if the CPU supports them
+#if defined(KDENLIVE_SIMD_SSE2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define KDENLIVE_SIMD_AVX2
+#endif
+
+/**
+ * @brief Runtime selection of the vectorized kernels used by the audio peaks, the color scopes and the thumbnails.
+ *
+ * Each of these modules implements some of the kernels and falls back to its scalar kernel for the others.
+ * All kernels of a module produce identical results.
+ */
+namespace SimdKernels {
+
+enum class Kernel { Scalar, SSE2, AVX2 };
+
+/** @brief Returns true if the given kernel is compiled in and supported by the CPU */
+bool isSupported(Kernel kernel);
+
+/** @brief Returns the fastest kernel supported by the CPU, detected once at runtime, up to the fastest one implemented by the caller */
+Kernel bestKernel(Kernel fastestImplemented = Kernel::AVX2);
+
+/** @brief Human readable name of a kernel, used for logging and benchmarks */
+const char *kernelName(Kernel kernel);
+
+} // namespace SimdKernels
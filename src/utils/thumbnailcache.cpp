@@ -9,6 +9,7 @@
 #include "core.h"
 #include "doc/kdenlivedoc.h"
 #include "project/projectmanager.h"
+#include "thumbnailpack.hpp"
 #include <QDir>
 #include <QMutexLocker>
 #include <list>
@@ -24,9 +25,9 @@ public:
     {
     }
 
-    bool contains(const QString &key) const { return m_cache.count(key) > 0; }
+    bool contains(quint64 key) const { return m_cache.count(key) > 0; }
 
-    void remove(const QString &key)
+    void remove(quint64 key)
     {
         if (!contains(key)) {
             return;
@@ -39,7 +40,7 @@ public:
         m_data.erase(it);
     }
 
-    void insert(const QString &key, const QImage &img, int cost)
+    void insert(quint64 key, const QImage &img, int cost)
     {
         if (cost > m_maxCost) {
             return;
@@ -53,13 +54,13 @@ public:
         }
     }
 
-    QImage get(const QString &key)
+    QImage get(quint64 key)
     {
         if (!contains(key)) {
             return QImage();
         }
         // when a get operation occurs, we put the corresponding list item in front to remember last access
-        std::pair<QString, std::pair<QImage, int>> data;
+        std::pair<quint64, std::pair<QImage, int>> data;
         auto it = m_cache.at(key);
         std::swap(data, (*it));                                         // take data out without copy
         QImage result = data.second.first;                              // a copy occurs here
@@ -94,15 +95,17 @@ protected:
     // The data is stored as (key,(image, cost)) in a std::list that serves as a
     // FIFO queue. If m_maxCost is exceeded, elements are removed from the
     // end of the list until the sum of the costs in the list is less than m_maxCost.
-    std::list<std::pair<QString, std::pair<QImage, int>>> m_data;
+    std::list<std::pair<quint64, std::pair<QImage, int>>> m_data;
     // m_cache keeps a mapping from the key to an iterator that represents the
     // item's location in m_data, like a pointer.
-    std::unordered_map<QString, decltype(m_data.begin())> m_cache;
+    std::unordered_map<quint64, decltype(m_data.begin())> m_cache;
 };
 
 ThumbnailCache::ThumbnailCache()
-    : m_volatileCache(new Cache_t(10000000))
 {
+    for (auto &s : m_shards) {
+        s.cache.reset(new Cache_t(10000000 / ShardCount));
+    }
 }
 
 std::unique_ptr<ThumbnailCache> &ThumbnailCache::get()
@@ -111,40 +114,57 @@ std::unique_ptr<ThumbnailCache> &ThumbnailCache::get()
     return instance;
 }
 
+ThumbnailCache::Shard &ThumbnailCache::shard(quint64 key) const
+{
+    // Fibonacci hashing spreads consecutive frames of a clip over all shards
+    return m_shards[(key * 0x9E3779B97F4A7C15ull) >> 60];
+}
+
 bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
-    auto key = pos < 0 ? getAudioKey(binId, &ok).constFirst() : getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
+    if (pos < 0) {
+        if (volatileOnly) {
+            return false;
+        }
+        const QStringList keys = getAudioKey(binId, &ok);
+        if (!ok || keys.isEmpty()) {
+            return false;
+        }
+        QDir thumbFolder = getDir(true, &ok);
+        return ok && thumbFolder.exists(keys.constFirst());
+    }
+    const quint64 key = volatileKey(binId, pos);
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache->contains(key)) {
         return true;
     }
-    if (!ok || volatileOnly) {
+    locker.unlock();
+    if (volatileOnly) {
         return false;
     }
-    locker.unlock();
-    QDir thumbFolder = getDir(pos < 0, &ok);
-    return ok && thumbFolder.exists(key);
+    const QString hash = getHash(binId, &ok);
+    if (!ok) {
+        return false;
+    }
+    auto thumbPack = pack(hash);
+    return thumbPack && thumbPack->contains(pos);
 }
 
 QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
-    bool ok = false;
-    auto key = getAudioKey(binId, &ok).constFirst();
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
+    if (volatileOnly) {
+        return QImage();
     }
-    if (!ok || volatileOnly) {
+    bool ok = false;
+    const QStringList keys = getAudioKey(binId, &ok);
+    if (!ok || keys.isEmpty()) {
         return QImage();
     }
     QDir thumbFolder = getDir(true, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        if (std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), -1) != m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(-1);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(key));
+    if (ok && thumbFolder.exists(keys.constFirst())) {
+        return QImage(thumbFolder.absoluteFilePath(keys.constFirst()));
     }
     return QImage();
 }
@@ -170,49 +190,39 @@ QImage ThumbnailCache::getThumbnail(QString hash, const QString &binId, int pos,
     if (hash.isEmpty()) {
         return QImage();
     }
-    hash.append(QStringLiteral("#%1.jpg").arg(pos));
-    QMutexLocker locker(&m_mutex);
-    if (m_volatileCache->contains(hash)) {
-        return m_volatileCache->get(hash);
+    const quint64 key = volatileKey(binId, pos);
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache->contains(key)) {
+        return s.cache->get(key);
     }
+    locker.unlock();
     if (volatileOnly) {
         return QImage();
     }
-    bool ok = false;
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(hash)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(hash));
-    }
-    locker.unlock();
-    return QImage();
+    auto thumbPack = pack(hash);
+    return thumbPack ? thumbPack->get(pos) : QImage();
 }
 
 QImage ThumbnailCache::getThumbnail(const QString &binId, int pos, bool volatileOnly) const
 {
-    QMutexLocker locker(&m_mutex);
-    bool ok = false;
-    auto key = getKey(binId, pos, &ok);
-    if (ok && m_volatileCache->contains(key)) {
-        return m_volatileCache->get(key);
+    const quint64 key = volatileKey(binId, pos);
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
+    if (s.cache->contains(key)) {
+        return s.cache->get(key);
     }
-    if (!ok || volatileOnly) {
+    locker.unlock();
+    if (volatileOnly) {
         return QImage();
     }
-    QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-            std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-            m_storedOnDisk[binId].push_back(pos);
-        }
-        locker.unlock();
-        return QImage(thumbFolder.absoluteFilePath(key));
+    bool ok = false;
+    const QString hash = getHash(binId, &ok);
+    if (!ok) {
+        return QImage();
     }
-    return QImage();
+    auto thumbPack = pack(hash);
+    return thumbPack ? thumbPack->get(pos) : QImage();
 }
 
 void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage &img, bool persistent)
@@ -220,153 +230,193 @@ void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage
     if (pCore->projectItemModel()->closing) {
         return;
     }
-    QMutexLocker locker(&m_mutex);
     bool ok = false;
-    const QString key = getKey(binId, pos, &ok);
+    const QString hash = getHash(binId, &ok);
     if (!ok) {
         return;
     }
+    const quint64 key = volatileKey(binId, pos);
+    Shard &s = shard(key);
+    QMutexLocker locker(&s.mutex);
     // if volatile cache also contains this entry, update it
-    if (m_volatileCache->contains(key)) {
-        m_volatileCache->remove(key);
-    } else {
+    bool alreadyStored = s.cache->contains(key);
+    if (alreadyStored) {
+        s.cache->remove(key);
+    }
+    s.cache->insert(key, img, (int)img.sizeInBytes());
+    locker.unlock();
+    if (!alreadyStored) {
+        QMutexLocker storedLocker(&m_mutex);
         m_storedVolatile[binId].push_back(pos);
     }
-    m_volatileCache->insert(key, img, (int)img.sizeInBytes());
     if (persistent) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            if (m_storedOnDisk.find(binId) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[binId].begin(), m_storedOnDisk[binId].end(), pos) == m_storedOnDisk[binId].end()) {
-                m_storedOnDisk[binId].push_back(pos);
-            }
-            locker.unlock();
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: " << thumbFolder.absoluteFilePath(key);
-            }
+        auto thumbPack = pack(hash);
+        if (!thumbPack || !thumbPack->insert(pos, img)) {
+            qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB for clip: " << binId << ", frame: " << pos;
         }
     }
 }
 
 bool ThumbnailCache::checkIntegrity() const
 {
-    return m_volatileCache->checkIntegrity();
+    for (auto &s : m_shards) {
+        QMutexLocker locker(&s.mutex);
+        if (!s.cache->checkIntegrity()) {
+            return false;
+        }
+    }
+    return true;
 }
 
 void ThumbnailCache::saveCachedThumbs(const std::unordered_map<QString, std::vector<int>> &keys)
 {
-    bool ok;
-    QDir thumbFolder = getDir(false, &ok);
-    if (!ok) {
-        return;
-    }
-    QMutexLocker locker(&m_mutex);
     for (auto &key : keys) {
         bool ok;
+        const QString hash = getHash(key.first, &ok);
+        if (!ok) {
+            continue;
+        }
+        auto thumbPack = pack(hash);
+        if (!thumbPack) {
+            return;
+        }
+        // Collect all missing thumbs of the clip to write them in one pass
+        std::vector<std::pair<int, QImage>> images;
         for (const auto &pos : key.second) {
-            if (m_storedOnDisk.find(key.first) == m_storedOnDisk.end() ||
-                std::find(m_storedOnDisk[key.first].begin(), m_storedOnDisk[key.first].end(), pos) == m_storedOnDisk[key.first].end()) {
-                const QString thumbKey = getKey(key.first, pos, &ok);
-                if (!ok) {
-                    continue;
-                }
-                if (!thumbFolder.exists(thumbKey) && m_volatileCache->contains(thumbKey)) {
-                    QImage img = m_volatileCache->get(thumbKey);
-                    if (!img.save(thumbFolder.absoluteFilePath(thumbKey))) {
-                        qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
-                        break;
-                    } else {
-                        m_storedOnDisk[key.first].push_back(pos);
-                    }
-                }
+            if (thumbPack->contains(pos)) {
+                continue;
+            }
+            const quint64 thumbKey = volatileKey(key.first, pos);
+            Shard &s = shard(thumbKey);
+            QMutexLocker locker(&s.mutex);
+            if (s.cache->contains(thumbKey)) {
+                images.emplace_back(pos, s.cache->get(thumbKey));
             }
         }
+        if (!thumbPack->insert(images) || !thumbPack->flush()) {
+            qDebug() << "// Error writing thumbnails for clip " << key.first;
+            break;
+        }
     }
 }
 
 void ThumbnailCache::invalidateThumbsForClip(const QString &binId, std::set<int> frames)
 {
     QMutexLocker locker(&m_mutex);
-    bool ok = false;
     if (m_storedVolatile.find(binId) != m_storedVolatile.end()) {
+        auto &cachedFrames = m_storedVolatile.at(binId);
+        auto removeFrame = [this, &binId](int pos) {
+            const quint64 key = volatileKey(binId, pos);
+            Shard &s = shard(key);
+            QMutexLocker shardLocker(&s.mutex);
+            s.cache->remove(key);
+        };
         if (frames.size() > 0) {
             // Remove only specified frames
-            auto cachedFrames = m_storedVolatile.at(binId);
             for (auto &f : frames) {
                 auto it = std::find(cachedFrames.begin(), cachedFrames.end(), f);
                 if (it != cachedFrames.end()) {
-                    auto key = getKey(binId, f, &ok);
-                    if (ok) {
-                        m_volatileCache->remove(key);
-                        cachedFrames.erase(it);
-                    }
+                    removeFrame(f);
+                    cachedFrames.erase(it);
                 }
             }
-            m_storedVolatile[binId] = cachedFrames;
         } else {
             // Remove all thumbs
-            for (int pos : m_storedVolatile.at(binId)) {
-                auto key = getKey(binId, pos, &ok);
-                if (ok) {
-                    m_volatileCache->remove(key);
-                }
+            for (int pos : cachedFrames) {
+                removeFrame(pos);
             }
             m_storedVolatile.erase(binId);
         }
     }
+    // Release mutex before touching files
+    locker.unlock();
     // Video thumbs
-    QStringList files;
-    if (m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
-        // Remove persistent cache
-        if (frames.size() > 0) {
-            // Remove only specified frames
-            auto cachedFrames = m_storedOnDisk.at(binId);
-            for (auto &f : frames) {
-                auto it = std::find(cachedFrames.begin(), cachedFrames.end(), f);
-                if (it != cachedFrames.end()) {
-                    auto key = getKey(binId, f, &ok);
-                    if (ok) {
-                        files << key;
-                        cachedFrames.erase(it);
-                    }
-                }
-                m_storedOnDisk[binId] = cachedFrames;
-            }
-        } else {
-            // Remove all thumbs
-            for (const auto &pos : m_storedOnDisk.at(binId)) {
-                if (pos >= 0) {
-                    auto key = getKey(binId, pos, &ok);
-                    if (ok) {
-                        files << key;
-                    }
-                }
-            }
-            m_storedOnDisk.erase(binId);
-        }
+    bool ok = false;
+    const QString hash = getHash(binId, &ok);
+    if (!ok) {
+        return;
     }
-    // Release mutex before deleting files
-    locker.unlock();
-    if (!files.isEmpty()) {
-        QDir thumbFolder = getDir(false, &ok);
-        if (ok) {
-            while (!files.isEmpty()) {
-                thumbFolder.remove(files.takeFirst());
-            }
-        }
+    auto thumbPack = pack(hash);
+    if (!thumbPack) {
+        return;
+    }
+    if (frames.size() > 0) {
+        thumbPack->remove(frames);
+    } else {
+        thumbPack->clear();
     }
 }
 
 void ThumbnailCache::clearCache()
 {
+    for (auto &s : m_shards) {
+        QMutexLocker locker(&s.mutex);
+        s.cache->clear();
+    }
     QMutexLocker locker(&m_mutex);
-    m_volatileCache->clear();
     m_storedVolatile.clear();
-    m_storedOnDisk.clear();
+    locker.unlock();
+    // The project cache folder might change, drop opened packs
+    QMutexLocker packLocker(&m_packMutex);
+    m_packs.clear();
+    m_legacyChecked.clear();
+}
+
+void ThumbnailCache::discardPersistentCache()
+{
+    QMutexLocker packLocker(&m_packMutex);
+    for (auto &thumbPack : m_packs) {
+        thumbPack.second->clear();
+    }
+    m_packs.clear();
+}
+
+std::shared_ptr<ThumbnailPack> ThumbnailCache::pack(const QString &hash) const
+{
+    QMutexLocker locker(&m_packMutex);
+    auto it = m_packs.find(hash);
+    if (it != m_packs.end()) {
+        return it->second;
+    }
+    bool ok = false;
+    QDir thumbFolder = getDir(false, &ok);
+    if (!ok) {
+        return nullptr;
+    }
+    auto thumbPack = std::make_shared<ThumbnailPack>(thumbFolder.absoluteFilePath(ThumbnailPack::fileName(hash)));
+    m_packs[hash] = thumbPack;
+    return thumbPack;
+}
+
+void ThumbnailCache::importLegacyThumbnails(const QString &hash)
+{
+    if (hash.isEmpty()) {
+        return;
+    }
+    QMutexLocker locker(&m_packMutex);
+    if (m_legacyChecked.contains(hash)) {
+        return;
+    }
+    m_legacyChecked.insert(hash);
+    locker.unlock();
+    bool ok = false;
+    QDir thumbFolder = getDir(false, &ok);
+    auto thumbPack = ok ? pack(hash) : nullptr;
+    if (!thumbPack) {
+        return;
+    }
+    // Move thumbnails stored by previous versions as separate files into the pack
+    thumbPack->importLegacyFiles(thumbFolder.absolutePath(), hash);
+}
+
+// static
+quint64 ThumbnailCache::volatileKey(const QString &binId, int pos)
+{
+    return (quint64(quint32(binId.toInt())) << 32) | quint32(pos);
 }
 
 // static
-QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
+QString ThumbnailCache::getHash(const QString &binId, bool *ok)
 {
     if (binId.isEmpty()) {
         *ok = false;
@@ -377,7 +427,9 @@ QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
     if (!*ok) {
         return QString();
     }
-    return binClip->hashForThumbs() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".jpg");
+    const QString hash = binClip->hashForThumbs();
+    *ok = !hash.isEmpty();
+    return hash;
 }
 
 // static
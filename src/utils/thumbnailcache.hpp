@@ -9,7 +9,9 @@
 #include <QDir>
 #include <QImage>
 #include <QMutex>
+#include <QSet>
 #include <QUrl>
+#include <array>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -20,11 +22,16 @@
     @brief This class class is an interface to the caches that store thumbnails.
     In Kdenlive, we use two such caches, a persistent that is stored on disk to allow thumbnails to be reused when reopening.
     The other one is a volatile LRU cache that lives in memory.
+    The persistent cache stores all thumbnails of a clip in a single memory mapped pack file (see ThumbnailPack).
+    The volatile cache is split in several shards, each protected by its own mutex and keyed by (binId, frame)
+    integers so that concurrent lookups from the jobs and the timeline don't block each other.
     Note that for the volatile cache uses a custom implementation.
     QCache is not suitable since it operates on pointers and since the object is removed from the cache when accessed.
     KImageCache is not suitable since it lacks a way to remove objects from the cache.
  * Note that this class is a Singleton
  */
+class ThumbnailPack;
+
 class ThumbnailCache
 {
 
@@ -66,6 +73,15 @@ public:
     /** @brief Reset cache (discarding all thumbs stored in memory) */
     void clearCache();
 
+    /** @brief Discard the persistent thumbnails not yet written and close the pack files, before their folder is deleted */
+    void discardPersistentCache();
+
+    /** @brief Move the thumbnails stored as separate files by previous versions into the pack of a clip.
+       The folder is only scanned once per clip, call it from a job loading the clip rather than on the lookup path.
+       @param hash is the hash identifying the thumbnails of the clip, see ProjectClip::hashForThumbs()
+    */
+    void importLegacyThumbnails(const QString &hash);
+
     /** @brief Ensure the cache is not corrupted */
     bool checkIntegrity() const;
 
@@ -73,9 +89,11 @@ protected:
     // Constructor is protected because class is a Singleton
     ThumbnailCache();
 
-    // Return the key associated to a thumbnail
-    static QString getKey(const QString &binId, int pos, bool *ok);
+    // Return the hash used to identify the thumbnails of a clip on disk
+    static QString getHash(const QString &binId, bool *ok);
     static QStringList getAudioKey(const QString &binId, bool *ok);
+    // Return the key identifying a thumbnail in the volatile cache
+    static quint64 volatileKey(const QString &binId, int pos);
 
     // Return the dir where the persistent cache lives
     static const QDir getDir(bool audio, bool *ok);
@@ -84,11 +102,25 @@ protected:
     static std::once_flag m_onceFlag; // flag to create the repository only once;
 
     class Cache_t;
-    std::unique_ptr<Cache_t> m_volatileCache;
+    static constexpr int ShardCount = 16;
+    struct Shard
+    {
+        std::unique_ptr<Cache_t> cache;
+        QMutex mutex;
+    };
+    mutable std::array<Shard, ShardCount> m_shards;
+    Shard &shard(quint64 key) const;
+
+    // Protects m_storedVolatile
     mutable QMutex m_mutex;
-
-    // the following maps keeps track of the positions that we store for each clip in volatile caches.
-    // Note that we don't track deletions due to items dropped from the cache. So the maps can contain more items that are currently stored.
+    // the following map keeps track of the positions that we store for each clip in volatile caches.
+    // Note that we don't track deletions due to items dropped from the cache. So the map can contain more items that are currently stored.
     std::unordered_map<QString, std::vector<int>> m_storedVolatile;
-    mutable std::unordered_map<QString, std::vector<int>> m_storedOnDisk;
+
+    // Return the pack file storing the persistent thumbnails of a clip, creating it if needed
+    std::shared_ptr<ThumbnailPack> pack(const QString &hash) const;
+    mutable QMutex m_packMutex;
+    mutable std::unordered_map<QString, std::shared_ptr<ThumbnailPack>> m_packs;
+    // Hashes of the clips whose legacy thumbnail files were already imported, protected by m_packMutex
+    QSet<QString> m_legacyChecked;
 };
@@ -0,0 +1,432 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#include "thumbnailpack.hpp"
+#include <QBuffer>
+#include <QDebug>
+#include <QDir>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QtEndian>
+#include <algorithm>
+#include <map>
+
+namespace {
+constexpr char packMagic[4] = {'K', 'D', 'T', 'P'};
+constexpr quint32 packVersion = 1;
+// magic, version, entry count, reserved, index offset
+constexpr qint64 headerSize = 4 + 4 + 4 + 4 + 8;
+// frame, size, offset
+constexpr qint64 entrySize = 4 + 4 + 8;
+// Don't bother compacting packs wasting less than this
+constexpr qint64 minWasteForCompaction = 512 * 1024;
+// Thumbnails kept in memory before they are appended to the pack with a new index
+constexpr size_t maxPendingCount = 64;
+constexpr qint64 maxPendingBytes = 4 * 1024 * 1024;
+
+QByteArray encodeHeader(quint32 count, quint64 indexOffset)
+{
+    QByteArray header(headerSize, '\0');
+    char *data = header.data();
+    memcpy(data, packMagic, 4);
+    qToLittleEndian<quint32>(packVersion, data + 4);
+    qToLittleEndian<quint32>(count, data + 8);
+    qToLittleEndian<quint64>(indexOffset, data + 16);
+    return header;
+}
+} // namespace
+
+ThumbnailPack::ThumbnailPack(QString path)
+    : m_path(std::move(path))
+{
+    QWriteLocker locker(&m_lock);
+    openMap();
+}
+
+ThumbnailPack::~ThumbnailPack()
+{
+    QWriteLocker locker(&m_lock);
+    writePending();
+    closeMap();
+}
+
+// static
+QString ThumbnailPack::fileName(const QString &hash)
+{
+    return hash + QStringLiteral(".kthumbs");
+}
+
+bool ThumbnailPack::openMap()
+{
+    closeMap();
+    m_file.setFileName(m_path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    qint64 size = m_file.size();
+    if (size < headerSize) {
+        m_file.close();
+        return false;
+    }
+    m_map = m_file.map(0, size);
+    // The mapping stays valid after the file is closed
+    m_file.close();
+    if (m_map == nullptr) {
+        return false;
+    }
+    m_mapSize = size;
+    bool valid = memcmp(m_map, packMagic, 4) == 0 && qFromLittleEndian<quint32>(m_map + 4) == packVersion;
+    if (valid) {
+        quint64 count = qFromLittleEndian<quint32>(m_map + 8);
+        quint64 indexOffset = qFromLittleEndian<quint64>(m_map + 16);
+        valid = indexOffset >= quint64(headerSize) && indexOffset + count * entrySize <= quint64(size);
+    }
+    if (!valid) {
+        qWarning() << "Discarding invalid thumbnail pack" << m_path;
+        closeMap();
+        QFile::remove(m_path);
+        return false;
+    }
+    return true;
+}
+
+void ThumbnailPack::closeMap()
+{
+    if (m_map != nullptr) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_mapSize = 0;
+}
+
+quint32 ThumbnailPack::entryCount() const
+{
+    if (m_map == nullptr) {
+        return 0;
+    }
+    return qFromLittleEndian<quint32>(m_map + 8);
+}
+
+ThumbnailPack::IndexEntry ThumbnailPack::entryAt(quint32 index) const
+{
+    const uchar *entry = m_map + qFromLittleEndian<quint64>(m_map + 16) + index * entrySize;
+    return {qFromLittleEndian<qint32>(entry), qFromLittleEndian<quint32>(entry + 4), qFromLittleEndian<quint64>(entry + 8)};
+}
+
+int ThumbnailPack::findEntry(int pos) const
+{
+    quint32 low = 0;
+    quint32 high = entryCount();
+    while (low < high) {
+        quint32 mid = low + (high - low) / 2;
+        int midPos = entryAt(mid).pos;
+        if (midPos == pos) {
+            return int(mid);
+        }
+        if (midPos < pos) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return -1;
+}
+
+std::vector<ThumbnailPack::IndexEntry> ThumbnailPack::readIndex() const
+{
+    std::vector<IndexEntry> index;
+    quint32 count = entryCount();
+    index.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        index.push_back(entryAt(i));
+    }
+    return index;
+}
+
+bool ThumbnailPack::contains(int pos) const
+{
+    QReadLocker locker(&m_lock);
+    return m_pending.count(pos) > 0 || findEntry(pos) > -1;
+}
+
+int ThumbnailPack::count() const
+{
+    return int(frames().size());
+}
+
+QImage ThumbnailPack::get(int pos) const
+{
+    QReadLocker locker(&m_lock);
+    auto pending = m_pending.find(pos);
+    if (pending != m_pending.end()) {
+        return QImage::fromData(pending->second, "JPG");
+    }
+    int ix = findEntry(pos);
+    if (ix < 0) {
+        return QImage();
+    }
+    IndexEntry entry = entryAt(quint32(ix));
+    if (entry.offset + entry.size > quint64(m_mapSize)) {
+        return QImage();
+    }
+    return QImage::fromData(m_map + entry.offset, int(entry.size), "JPG");
+}
+
+std::vector<int> ThumbnailPack::frames() const
+{
+    QReadLocker locker(&m_lock);
+    std::vector<int> result;
+    quint32 count = entryCount();
+    result.reserve(count + m_pending.size());
+    for (quint32 i = 0; i < count; ++i) {
+        result.push_back(entryAt(i).pos);
+    }
+    if (!m_pending.empty()) {
+        for (const auto &pending : m_pending) {
+            result.push_back(pending.first);
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+    }
+    return result;
+}
+
+bool ThumbnailPack::insert(int pos, const QImage &img)
+{
+    return insert({{pos, img}});
+}
+
+bool ThumbnailPack::insert(const std::vector<std::pair<int, QImage>> &images)
+{
+    // Encode outside of the lock, this is the expensive part
+    std::vector<std::pair<int, QByteArray>> encoded;
+    encoded.reserve(images.size());
+    for (const auto &image : images) {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if (!image.second.save(&buffer, "JPG")) {
+            qDebug() << "// Error encoding thumbnail for frame" << image.first;
+            continue;
+        }
+        encoded.emplace_back(image.first, std::move(data));
+    }
+    return insertData(encoded);
+}
+
+bool ThumbnailPack::insertData(const std::vector<std::pair<int, QByteArray>> &encoded)
+{
+    if (encoded.empty()) {
+        return true;
+    }
+    QWriteLocker locker(&m_lock);
+    for (const auto &data : encoded) {
+        auto it = m_pending.find(data.first);
+        if (it != m_pending.end()) {
+            m_pendingBytes -= it->second.size();
+        }
+        m_pending[data.first] = data.second;
+        m_pendingBytes += data.second.size();
+    }
+    if (m_pending.size() < maxPendingCount && m_pendingBytes < maxPendingBytes) {
+        return true;
+    }
+    return writePending();
+}
+
+bool ThumbnailPack::flush()
+{
+    QWriteLocker locker(&m_lock);
+    return writePending();
+}
+
+bool ThumbnailPack::writePending()
+{
+    if (m_pending.empty()) {
+        return true;
+    }
+    std::map<int, IndexEntry> index;
+    for (const auto &entry : readIndex()) {
+        index[entry.pos] = entry;
+    }
+    closeMap();
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "// Error opening thumbnail pack" << m_path;
+        openMap();
+        return false;
+    }
+    if (index.empty()) {
+        file.resize(0);
+        file.write(encodeHeader(0, headerSize));
+    }
+    // New data is appended after the current index so that the previous state remains
+    // readable until the header is updated
+    qint64 offset = std::max(file.size(), headerSize);
+    file.seek(offset);
+    for (const auto &data : m_pending) {
+        if (file.write(data.second) != data.second.size()) {
+            qDebug() << "// Error writing thumbnail pack" << m_path;
+            file.close();
+            openMap();
+            return false;
+        }
+        index[data.first] = {data.first, quint32(data.second.size()), quint64(offset)};
+        offset += data.second.size();
+    }
+    std::vector<IndexEntry> sortedIndex;
+    sortedIndex.reserve(index.size());
+    for (const auto &entry : index) {
+        sortedIndex.push_back(entry.second);
+    }
+    bool result = writeIndex(file, offset, sortedIndex);
+    file.close();
+    openMap();
+    if (result) {
+        m_pending.clear();
+        m_pendingBytes = 0;
+        compact(sortedIndex);
+    }
+    return result;
+}
+
+bool ThumbnailPack::remove(const std::set<int> &frames)
+{
+    QWriteLocker locker(&m_lock);
+    for (int pos : frames) {
+        auto pending = m_pending.find(pos);
+        if (pending != m_pending.end()) {
+            m_pendingBytes -= pending->second.size();
+            m_pending.erase(pending);
+        }
+    }
+    if (m_map == nullptr) {
+        return true;
+    }
+    std::vector<IndexEntry> index = readIndex();
+    size_t previousCount = index.size();
+    index.erase(std::remove_if(index.begin(), index.end(), [&frames](const IndexEntry &entry) { return frames.count(entry.pos) > 0; }), index.end());
+    if (index.size() == previousCount) {
+        return true;
+    }
+    closeMap();
+    if (index.empty()) {
+        return QFile::remove(m_path);
+    }
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        openMap();
+        return false;
+    }
+    bool result = writeIndex(file, file.size(), index);
+    file.close();
+    openMap();
+    if (result) {
+        compact(index);
+    }
+    return result;
+}
+
+void ThumbnailPack::clear()
+{
+    QWriteLocker locker(&m_lock);
+    m_pending.clear();
+    m_pendingBytes = 0;
+    closeMap();
+    QFile::remove(m_path);
+}
+
+// static
+bool ThumbnailPack::writeIndex(QFile &file, qint64 indexOffset, const std::vector<IndexEntry> &index)
+{
+    QByteArray indexData(qsizetype(index.size() * entrySize), '\0');
+    char *data = indexData.data();
+    for (const auto &entry : index) {
+        qToLittleEndian<qint32>(entry.pos, data);
+        qToLittleEndian<quint32>(entry.size, data + 4);
+        qToLittleEndian<quint64>(entry.offset, data + 8);
+        data += entrySize;
+    }
+    if (!file.seek(indexOffset) || file.write(indexData) != indexData.size()) {
+        return false;
+    }
+    if (!file.resize(indexOffset + indexData.size())) {
+        return false;
+    }
+    // Header is written last, it switches the pack to the new index
+    file.flush();
+    return file.seek(0) && file.write(encodeHeader(quint32(index.size()), quint64(indexOffset))) == headerSize;
+}
+
+bool ThumbnailPack::compact(const std::vector<IndexEntry> &index)
+{
+    if (m_map == nullptr) {
+        return false;
+    }
+    qint64 liveSize = 0;
+    for (const auto &entry : index) {
+        liveSize += entry.size;
+    }
+    qint64 waste = m_mapSize - headerSize - qint64(index.size()) * entrySize - liveSize;
+    if (waste < minWasteForCompaction || waste < liveSize / 2) {
+        return true;
+    }
+    const QString tmpPath = m_path + QStringLiteral(".tmp");
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(encodeHeader(0, headerSize));
+    std::vector<IndexEntry> newIndex;
+    newIndex.reserve(index.size());
+    qint64 offset = headerSize;
+    for (const auto &entry : index) {
+        file.write(reinterpret_cast<const char *>(m_map + entry.offset), entry.size);
+        newIndex.push_back({entry.pos, entry.size, quint64(offset)});
+        offset += entry.size;
+    }
+    bool result = writeIndex(file, offset, newIndex);
+    file.close();
+    if (!result) {
+        QFile::remove(tmpPath);
+        return false;
+    }
+    closeMap();
+    QFile::remove(m_path);
+    result = QFile::rename(tmpPath, m_path);
+    openMap();
+    return result;
+}
+
+int ThumbnailPack::importLegacyFiles(const QString &folder, const QString &hash)
+{
+    QDir dir(folder);
+    const QStringList files = dir.entryList({hash + QStringLiteral("#*.jpg")}, QDir::Files);
+    if (files.isEmpty()) {
+        return 0;
+    }
+    std::vector<std::pair<int, QByteArray>> encoded;
+    encoded.reserve(size_t(files.size()));
+    for (const QString &f : files) {
+        // File names are <hash>#<frame>.jpg
+        bool ok;
+        int pos = f.mid(hash.size() + 1).chopped(4).toInt(&ok);
+        if (!ok) {
+            continue;
+        }
+        QFile thumbFile(dir.absoluteFilePath(f));
+        if (thumbFile.open(QIODevice::ReadOnly)) {
+            encoded.emplace_back(pos, thumbFile.readAll());
+        }
+    }
+    // The legacy files are only deleted once their content is in the pack file
+    if (!insertData(encoded) || !flush()) {
+        return 0;
+    }
+    for (const QString &f : files) {
+        dir.remove(f);
+    }
+    return int(encoded.size());
+}
@@ -0,0 +1,88 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+
+#pragma once
+
+#include <QFile>
+#include <QImage>
+#include <QReadWriteLock>
+#include <QString>
+#include <map>
+#include <set>
+#include <vector>
+
+/** @class ThumbnailPack
+    @brief Persistent storage for all the thumbnails of a clip in a single memory mapped file.
+    The file starts with a fixed header (magic, version, entry count and index offset), followed by
+    the JPEG encoded images. The index, an array of (frame, size, offset) entries sorted by frame,
+    is stored after the image data and is searched directly in the mapped memory, so that
+    a lookup does not require any system call once the pack is opened.
+    New thumbnails are kept in memory and appended in batches, with a single index rewrite per batch, or when the pack
+    is flushed or closed. Removing frames only rewrites the index, the pack is compacted when too much space is wasted.
+ */
+class ThumbnailPack
+{
+public:
+    explicit ThumbnailPack(QString path);
+    ~ThumbnailPack();
+
+    /** @brief Returns the file name of the pack for a clip with the given thumbnail hash */
+    static QString fileName(const QString &hash);
+
+    /** @brief Returns true if the pack contains a thumbnail for this frame */
+    bool contains(int pos) const;
+    /** @brief Decodes the thumbnail stored for this frame, or returns a null image */
+    QImage get(int pos) const;
+    /** @brief Returns the list of frames stored in the pack, in ascending order */
+    std::vector<int> frames() const;
+    int count() const;
+
+    /** @brief Append thumbnails to the pack, replacing existing entries for the same frames */
+    bool insert(const std::vector<std::pair<int, QImage>> &images);
+    bool insert(int pos, const QImage &img);
+    /** @brief Remove the given frames from the pack */
+    bool remove(const std::set<int> &frames);
+    /** @brief Delete the pack file */
+    void clear();
+    /** @brief Write the thumbnails waiting in memory to the pack file */
+    bool flush();
+
+    /** @brief Import loose thumbnails from the legacy cache layout (<hash>#<frame>.jpg) and delete them */
+    int importLegacyFiles(const QString &folder, const QString &hash);
+
+private:
+    struct IndexEntry
+    {
+        qint32 pos;
+        quint32 size;
+        quint64 offset;
+    };
+    QString m_path;
+    QFile m_file;
+    uchar *m_map{nullptr};
+    qint64 m_mapSize{0};
+    mutable QReadWriteLock m_lock;
+    /** @brief Encoded thumbnails not yet written to the file, by frame */
+    std::map<int, QByteArray> m_pending;
+    qint64 m_pendingBytes{0};
+
+    /** @brief Map the pack file and validate its header, caller must hold the write lock */
+    bool openMap();
+    void closeMap();
+    /** @brief Add already encoded thumbnails to the pack, they are written once enough of them are waiting */
+    bool insertData(const std::vector<std::pair<int, QByteArray>> &encoded);
+    /** @brief Append the waiting thumbnails to the file and write the new index, caller must hold the write lock */
+    bool writePending();
+    /** @brief Binary search in the mapped index, returns -1 if not found */
+    int findEntry(int pos) const;
+    quint32 entryCount() const;
+    IndexEntry entryAt(quint32 index) const;
+    /** @brief Read the complete index from the mapped file */
+    std::vector<IndexEntry> readIndex() const;
+    /** @brief Write a new index at indexOffset and update the header, caller must hold the write lock */
+    static bool writeIndex(QFile &file, qint64 indexOffset, const std::vector<IndexEntry> &index);
+    /** @brief Rewrite the pack with only live entries */
+    bool compact(const std::vector<IndexEntry> &index);
+};
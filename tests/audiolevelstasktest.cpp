@@ -7,8 +7,13 @@
 #include "catch.hpp"
 #include "test_utils.hpp"
 
+#include "jobs/audiolevels/audiolevelscache.h"
 #include "jobs/audiolevels/audiolevelstask.h"
 #include "jobs/audiolevels/generators.h"
+#include "jobs/audiolevels/peaks.h"
+#include <QDir>
+#include <QTemporaryDir>
+#include <random>
 
 void computePeaksTestHelper(const QVector<int16_t> &input, const QVector<int16_t> &expectedOutput, const size_t channels)
 {
@@ -19,6 +24,38 @@ void computePeaksTestHelper(const QVector<int16_t> &input, const QVector<int16_t
     REQUIRE(output == expectedOutput);
 }
 
+// Per channel implementation used before the single pass SIMD kernels, kept as a benchmark baseline
+void computePeaksPerChannel(const int16_t *in, int16_t *out, const size_t nChannels, const size_t nSamplesIn, const size_t nSamplesOut)
+{
+    const float scale = static_cast<float>(nSamplesIn) / nSamplesOut;
+    for (size_t ch = 0; ch < nChannels; ++ch) {
+        const auto *pIn = in + ch;
+        auto *pOut = out + ch;
+        for (size_t outIdx = 0; outIdx < nSamplesOut; ++outIdx) {
+            const size_t start = outIdx * scale;
+            size_t end = (outIdx + 1) * scale;
+            if (end > nSamplesIn) end = nSamplesIn;
+            int16_t maxValue = std::abs(pIn[start * nChannels]);
+            for (size_t inIdx = start; inIdx < end; ++inIdx) {
+                maxValue = std::max(maxValue, static_cast<int16_t>(std::abs(pIn[inIdx * nChannels])));
+            }
+            pOut[outIdx * nChannels] = maxValue;
+        }
+    }
+}
+
+// Interleaved s16 noise, similar to what is decoded from tests/small.mkv
+QVector<int16_t> randomSamples(size_t nChannels, size_t nSamples)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(-32767, 32767);
+    QVector<int16_t> samples(nChannels * nSamples);
+    for (auto &sample : samples) {
+        sample = static_cast<int16_t>(distribution(generator));
+    }
+    return samples;
+}
+
 void dummyClbk(const int progress, const QVector<int16_t> &levels)
 {
     REQUIRE(progress <= 100);
@@ -114,6 +151,62 @@ TEST_CASE("computePeaks large input")
     computePeaksTestHelper(input, expectedOutput, 1);
 }
 
+TEST_CASE("computePeaks saturates the absolute value")
+{
+    const QVector<int16_t> input = {-32768, 1, 2, -32767};
+    const QVector<int16_t> expectedOutput = {32767, 32767};
+    computePeaksTestHelper(input, expectedOutput, 2);
+}
+
+TEST_CASE("computePeaks kernels give identical results")
+{
+    for (const auto kernel : {AudioPeaks::Kernel::Scalar, AudioPeaks::Kernel::SSE2, AudioPeaks::Kernel::AVX2}) {
+        if (!AudioPeaks::isSupported(kernel)) {
+            continue;
+        }
+        INFO("Kernel: " << AudioPeaks::kernelName(kernel));
+        for (size_t channels : {1, 2, 3, 6, 8, 12}) {
+            INFO("Channels: " << channels);
+            for (size_t nSamplesIn : {1, 7, 100, 1920}) {
+                const QVector<int16_t> input = randomSamples(channels, nSamplesIn);
+                for (size_t nSamplesOut : {1, 5, 50}) {
+                    QVector<int16_t> expected(int(channels * nSamplesOut));
+                    QVector<int16_t> output(int(channels * nSamplesOut));
+                    computePeaksPerChannel(input.constData(), expected.data(), channels, nSamplesIn, nSamplesOut);
+                    AudioPeaks::computePeaks(kernel, input.constData(), output.data(), channels, nSamplesIn, nSamplesOut);
+                    REQUIRE(output == expected);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("computePeaks benchmark", "[.benchmark]")
+{
+    // One minute of 48kHz audio reduced to 25fps levels
+    const size_t nSamplesIn = 48000 * 60;
+    const size_t nSamplesOut = 25 * 60 * AUDIOLEVELS_POINTS_PER_FRAME;
+    for (size_t channels : {2, 8}) {
+        const QVector<int16_t> input = randomSamples(channels, nSamplesIn);
+        QVector<int16_t> output(int(channels * nSamplesOut));
+        BENCHMARK(QStringLiteral("per channel, %1 channels").arg(channels).toStdString())
+        {
+            computePeaksPerChannel(input.constData(), output.data(), channels, nSamplesIn, nSamplesOut);
+            return output.constFirst();
+        };
+        for (const auto kernel : {AudioPeaks::Kernel::Scalar, AudioPeaks::Kernel::SSE2, AudioPeaks::Kernel::AVX2}) {
+            if (!AudioPeaks::isSupported(kernel)) {
+                continue;
+            }
+            BENCHMARK(QStringLiteral("%1, %2 channels").arg(AudioPeaks::kernelName(kernel)).arg(channels).toStdString())
+            {
+                AudioPeaks::computePeaks(kernel, input.constData(), output.data(), channels, nSamplesIn, nSamplesOut);
+                return output.constFirst();
+            };
+        }
+    }
+}
+
 TEST_CASE("generateLibav bad stream index")
 {
     const auto output = generateLibav(9999, sourcesPath + "/dataset/mono.flac", 10, 30, &dummyClbk, 0);
@@ -224,14 +317,159 @@ TEST_CASE("both methods on multiple audio streams")
     }
 }
 
+TEST_CASE("generateLibavRange matches sequential decoding")
+{
+    pCore->setCurrentProfile(QStringLiteral("dv_pal"));
+    const auto profileFps = pCore->getCurrentFps();
+    const auto full = generateMLT(0, "avformat", sourcesPath + "/dataset/stereo.flac", 2, &dummyClbk, 0);
+    const size_t lengthInFrames = full.size() / 2 / AUDIOLEVELS_POINTS_PER_FRAME;
+    REQUIRE(lengthInFrames > 4);
+    const size_t firstFrame = lengthInFrames / 2;
+    const auto range = generateLibavRange(0, sourcesPath + "/dataset/stereo.flac", lengthInFrames, profileFps, firstFrame, 3, &dummyClbk, 0);
+    REQUIRE(range.size() == 3 * 2 * AUDIOLEVELS_POINTS_PER_FRAME);
+    REQUIRE(range == full.mid(firstFrame * 2 * AUDIOLEVELS_POINTS_PER_FRAME, range.size()));
+}
+
+TEST_CASE("generateLibavParallel matches sequential decoding")
+{
+    pCore->setCurrentProfile(QStringLiteral("dv_pal"));
+    const auto profileFps = pCore->getCurrentFps();
+    const auto a = generateMLT(0, "avformat", sourcesPath + "/dataset/stereo.flac", 2, &dummyClbk, 0);
+    const size_t lengthInFrames = a.size() / 2 / AUDIOLEVELS_POINTS_PER_FRAME;
+    const auto b = generateLibavParallel(0, sourcesPath + "/dataset/stereo.flac", lengthInFrames, profileFps, 3, &dummyClbk, 0);
+    const auto c = generateLibav(0, sourcesPath + "/dataset/stereo.flac", lengthInFrames, profileFps, &dummyClbk, 0);
+    REQUIRE(!b.isEmpty());
+    REQUIRE(b.size() == a.size());
+    REQUIRE(b == c);
+}
+
+TEST_CASE("generateLibavParallel publishes partial levels")
+{
+    pCore->setCurrentProfile(QStringLiteral("dv_pal"));
+    const auto profileFps = pCore->getCurrentFps();
+    const auto a = generateMLT(0, "avformat", sourcesPath + "/dataset/stereo.flac", 2, &dummyClbk, 0);
+    const size_t lengthInFrames = a.size() / 2 / AUDIOLEVELS_POINTS_PER_FRAME;
+    // Many more ranges than workers, so that this thread finishes its first range long before the helpers decoded all others
+    const size_t rangeCount = std::min(lengthInFrames, size_t(4 * (pCore->taskManager.maxConcurrency() + 1)));
+    REQUIRE(rangeCount > 1);
+    int lastProgress = -1;
+    int partialCalls = 0;
+    const auto clbk = [&](const int progress, const QVector<int16_t> &levels) {
+        REQUIRE(progress >= lastProgress);
+        REQUIRE(progress <= 100);
+        lastProgress = progress;
+        // Partial levels already have the final size, missing ranges are silent
+        REQUIRE(levels.size() == a.size());
+        if (progress < 100) {
+            partialCalls++;
+        }
+    };
+    const auto b = generateLibavParallel(0, sourcesPath + "/dataset/stereo.flac", lengthInFrames, profileFps, rangeCount, clbk, 0);
+    REQUIRE(!b.isEmpty());
+    REQUIRE(partialCalls > 0);
+    REQUIRE(lastProgress == 100);
+}
+
+TEST_CASE("generateLibavParallel canceled")
+{
+    const auto output = generateLibavParallel(0, sourcesPath + "/dataset/mono.flac", 10, 30, 2, &dummyClbk, 1);
+    REQUIRE(output.isEmpty());
+}
+
 TEST_CASE("(de)serialize audio levels")
 {
     const auto input = QVector<int16_t>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
     auto tmp = QTemporaryFile();
     REQUIRE(tmp.open());
-    AudioLevelsTask::saveLevelsToCache(tmp.fileName(), input);
+    AudioLevelsTask::saveLevelsToCache(tmp.fileName(), input, 2);
     const auto deserialized = AudioLevelsTask::getLevelsFromCache(tmp.fileName());
-    REQUIRE(deserialized == input);
+    REQUIRE(deserialized);
+    REQUIRE(deserialized->peaks() == input);
+    AudioLevelsCache::release(tmp.fileName());
+    // Users still holding a released cache read no values
+    REQUIRE(deserialized->peaks().isEmpty());
+}
+
+TEST_CASE("convert legacy audio levels cache")
+{
+    const auto input = QVector<int16_t>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    auto tmp = QTemporaryFile();
+    REQUIRE(tmp.open());
+    {
+        QDataStream out(&tmp);
+        out << input;
+    }
+    tmp.close();
+    // The channel count is needed to convert the file
+    REQUIRE(AudioLevelsTask::getLevelsFromCache(tmp.fileName()) == nullptr);
+    const auto converted = AudioLevelsTask::getLevelsFromCache(tmp.fileName(), 2);
+    REQUIRE(converted);
+    REQUIRE(converted->channels() == 2);
+    REQUIRE(converted->peaks() == input);
+    // Opened again from the converted file
+    REQUIRE(AudioLevelsTask::getLevelsFromCache(tmp.fileName()) == converted);
+    AudioLevelsCache::release(tmp.fileName());
+}
+
+TEST_CASE("audio levels cache pyramid")
+{
+    // 2 channels, the first one holds the point index, the second one its opposite
+    const qint64 points = 1000;
+    QVector<int16_t> input;
+    for (int i = 0; i < points; ++i) {
+        input << int16_t(i) << int16_t(points - i);
+    }
+    auto tmp = QTemporaryFile();
+    REQUIRE(tmp.open());
+    REQUIRE(AudioLevelsCache::write(tmp.fileName(), input, 2));
+    const auto cache = AudioLevelsCache::open(tmp.fileName());
+    REQUIRE(cache);
+    REQUIRE(cache->channels() == 2);
+    REQUIRE(cache->levelCount() > 2);
+    REQUIRE(cache->pointCount(0) == points);
+    REQUIRE(cache->peaks() == input);
+    REQUIRE(cache->decimation(1) == AudioLevelsCache::pyramidFactor);
+    REQUIRE(cache->pointCount(1) == (points + AudioLevelsCache::pyramidFactor - 1) / AudioLevelsCache::pyramidFactor);
+    REQUIRE(cache->levelForPointsPerPixel(1) == 0);
+    REQUIRE(cache->levelForPointsPerPixel(AudioLevelsCache::pyramidFactor) == 1);
+
+    // Second point of level 1 covers input points [8, 16[
+    const auto minMax = cache->minMaxLevels(1, 1, 1);
+    REQUIRE(minMax == QVector<int16_t>{8, 15, int16_t(points - 15), int16_t(points - 8)});
+    REQUIRE(cache->maxLevels(1, 1, 1) == QVector<int16_t>{15, int16_t(points - 8)});
+    // Level 2 points cover 64 input points
+    REQUIRE(cache->maxLevels(2, 0, 2) == QVector<int16_t>{63, int16_t(points), 127, int16_t(points - 64)});
+    // Out of range requests are clamped
+    REQUIRE(cache->maxLevels(1, cache->pointCount(1) - 1, 10).size() == 2);
+    AudioLevelsCache::release(tmp.fileName());
+}
+
+TEST_CASE("audio levels cache release")
+{
+    const auto input = QVector<int16_t>{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("levels.bin"));
+    REQUIRE(AudioLevelsCache::write(path, input, 2));
+    SECTION("Closed with its last user")
+    {
+        auto cache = AudioLevelsCache::open(path);
+        REQUIRE(cache);
+        REQUIRE(AudioLevelsCache::open(path) == cache);
+        std::weak_ptr<const AudioLevelsCache> weak = cache;
+        cache.reset();
+        REQUIRE(weak.expired());
+        REQUIRE(AudioLevelsCache::open(path)->peaks() == input);
+    }
+    SECTION("Released with its folder")
+    {
+        const auto cache = AudioLevelsCache::open(path);
+        REQUIRE(cache);
+        AudioLevelsCache::releaseFolder(dir.path());
+        REQUIRE(cache->peaks().isEmpty());
+        REQUIRE(QDir(dir.path()).removeRecursively());
+        REQUIRE(AudioLevelsCache::open(path) == nullptr);
+    }
 }
 
 TEST_CASE("MLT noise generator")
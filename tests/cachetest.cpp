@@ -10,12 +10,20 @@
 #include "doc/kdenlivedoc.h"
 #include <cmath>
 #include <iostream>
+#include <random>
 #include <tuple>
 #include <unordered_set>
 
 #include "core.h"
 #include "definitions.h"
+#include "doc/kthumb.h"
+#include "jobs/thumbnailextractor.h"
+#include "utils/filehashcache.hpp"
 #include "utils/thumbnailcache.hpp"
+#include "utils/thumbnailpack.hpp"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTemporaryDir>
 
 TEST_CASE("Cache insert-remove", "[Cache]")
 {
@@ -90,3 +98,274 @@ TEST_CASE("getAudioKey() should dereference `ok` param", "ThumbnailCache") {
     }
     pCore->projectManager()->closeCurrentDocument(false, false);
 }
+
+TEST_CASE("Thumbnail pack file", "[Cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(ThumbnailPack::fileName(QStringLiteral("abcd")));
+    QImage red(64, 36, QImage::Format_RGB32);
+    red.fill(Qt::red);
+    QImage blue(64, 36, QImage::Format_RGB32);
+    blue.fill(Qt::blue);
+
+    SECTION("Insert, read back and remove")
+    {
+        ThumbnailPack pack(path);
+        REQUIRE(pack.count() == 0);
+        REQUIRE(pack.get(10).isNull());
+        REQUIRE(pack.insert({{20, red}, {10, blue}, {30, red}}));
+        REQUIRE(pack.count() == 3);
+        REQUIRE(pack.frames() == std::vector<int>{10, 20, 30});
+        REQUIRE(pack.contains(20));
+        REQUIRE_FALSE(pack.contains(15));
+        QImage img = pack.get(10);
+        REQUIRE(img.size() == blue.size());
+        REQUIRE(qBlue(img.pixel(5, 5)) > 200);
+        // Replacing a frame keeps a single entry
+        REQUIRE(pack.insert(10, red));
+        REQUIRE(pack.count() == 3);
+        REQUIRE(qRed(pack.get(10).pixel(5, 5)) > 200);
+        REQUIRE(pack.remove({20}));
+        REQUIRE(pack.frames() == std::vector<int>{10, 30});
+        pack.clear();
+        REQUIRE(pack.count() == 0);
+        REQUIRE_FALSE(QFile::exists(path));
+    }
+    SECTION("Pack is persistent")
+    {
+        {
+            ThumbnailPack pack(path);
+            REQUIRE(pack.insert({{1, red}, {2, blue}}));
+        }
+        ThumbnailPack pack(path);
+        REQUIRE(pack.frames() == std::vector<int>{1, 2});
+        REQUIRE(qBlue(pack.get(2).pixel(5, 5)) > 200);
+    }
+    SECTION("Thumbnails are appended in batches")
+    {
+        {
+            ThumbnailPack pack(path);
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(pack.insert(i, i % 2 ? red : blue));
+            }
+            // Waiting thumbnails are readable before they are written
+            REQUIRE(pack.count() == 100);
+            REQUIRE(qRed(pack.get(99).pixel(5, 5)) > 200);
+            REQUIRE(pack.remove({98}));
+            REQUIRE_FALSE(pack.contains(98));
+            REQUIRE(pack.flush());
+            REQUIRE(ThumbnailPack(path).count() == 99);
+            REQUIRE(pack.insert(200, red));
+        }
+        // Closing the pack writes the remaining thumbnails
+        ThumbnailPack pack(path);
+        REQUIRE(pack.count() == 100);
+        REQUIRE(qBlue(pack.get(0).pixel(5, 5)) > 200);
+        REQUIRE(pack.contains(200));
+    }
+    SECTION("Import legacy thumbnails")
+    {
+        REQUIRE(red.save(dir.filePath(QStringLiteral("abcd#5.jpg"))));
+        REQUIRE(blue.save(dir.filePath(QStringLiteral("abcd#12.jpg"))));
+        REQUIRE(blue.save(dir.filePath(QStringLiteral("efgh#5.jpg"))));
+        ThumbnailPack pack(path);
+        REQUIRE(pack.importLegacyFiles(dir.path(), QStringLiteral("abcd")) == 2);
+        REQUIRE(pack.frames() == std::vector<int>{5, 12});
+        REQUIRE_FALSE(QFile::exists(dir.filePath(QStringLiteral("abcd#5.jpg"))));
+        REQUIRE(QFile::exists(dir.filePath(QStringLiteral("efgh#5.jpg"))));
+    }
+    SECTION("Corrupted pack is discarded")
+    {
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(QByteArray(100, 'x'));
+        file.close();
+        ThumbnailPack pack(path);
+        REQUIRE(pack.count() == 0);
+        REQUIRE(pack.insert(3, red));
+        REQUIRE(pack.frames() == std::vector<int>{3});
+    }
+}
+
+namespace {
+QByteArray randomRgba(int width, int height)
+{
+    QByteArray data(width * height * 4, Qt::Uninitialized);
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> bytes(0, 255);
+    for (char &c : data) {
+        c = char(bytes(gen));
+    }
+    return data;
+}
+
+// The previous conversion: copy the rgba data, swap the red and blue channels, then scale
+QImage referenceConversion(const QByteArray &rgba, int width, int height, const QSize &size)
+{
+    QImage temp(width, height, QImage::Format_ARGB32);
+    memcpy(temp.scanLine(0), rgba.constData(), size_t(rgba.size()));
+    const QImage swapped = temp.rgbSwapped();
+    return size == swapped.size() ? swapped : swapped.scaled(size);
+}
+} // namespace
+
+TEST_CASE("Frame image conversion", "[Cache]")
+{
+    const int width = 67;
+    const int height = 37;
+    const QByteArray rgba = randomRgba(width, height);
+    const auto *pixels = reinterpret_cast<const uchar *>(rgba.constData());
+    for (const auto kernel : {KThumb::Kernel::Scalar, KThumb::Kernel::SSE2}) {
+        if (!KThumb::isSupported(kernel)) {
+            continue;
+        }
+        CAPTURE(KThumb::kernelName(kernel));
+        // Same size is an exact channel swap
+        {
+            QImage result(width, height, QImage::Format_ARGB32);
+            KThumb::convertRgba(kernel, pixels, width, height, result);
+            REQUIRE(result == referenceConversion(rgba, width, height, result.size()));
+        }
+        // Scaling samples the nearest pixel
+        {
+            for (const QSize &size : {QSize(90, 37), QSize(33, 37), QSize(120, 80), QSize(5, 3), QSize(1, 1)}) {
+                CAPTURE(size.width(), size.height());
+                QImage result(size, QImage::Format_ARGB32);
+                KThumb::convertRgba(kernel, pixels, width, height, result);
+                for (int y = 0; y < size.height(); ++y) {
+                    const int sy = (2 * y + 1) * height / (2 * size.height());
+                    for (int x = 0; x < size.width(); ++x) {
+                        const int sx = (2 * x + 1) * width / (2 * size.width());
+                        const uchar *p = pixels + 4 * (sy * width + sx);
+                        REQUIRE(result.pixel(x, y) == qRgba(p[0], p[1], p[2], p[3]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Thumbnails decoded with libav", "[Cache]")
+{
+    // 5 frames at 25 fps, only the first one is a keyframe
+    ThumbnailExtractor extractor(sourcesPath + QStringLiteral("/dataset/red.mp4"), -1, 25.);
+    REQUIRE(extractor.isValid());
+    QImage image(64, 48, QImage::Format_ARGB32);
+    // Decoded with the wrong range or matrix, the green and blue channels are no longer close to 0
+    auto isRed = [](QRgb pixel) { return qRed(pixel) > 230 && qGreen(pixel) < 8 && qBlue(pixel) < 8; };
+
+    SECTION("Exact frame")
+    {
+        REQUIRE(extractor.extract(3, true, image));
+        CHECK(extractor.lastFrame() == 3);
+        CHECK(isRed(image.pixel(32, 24)));
+        // Continues decoding forward
+        REQUIRE(extractor.extract(4, true, image));
+        CHECK(extractor.lastFrame() == 4);
+        CHECK(isRed(image.pixel(32, 24)));
+        // From the keyframe to frame 4
+        CHECK(extractor.framesDecoded() == 5);
+        CHECK(extractor.bytesRead() > 0);
+    }
+
+    SECTION("Snapped to the previous keyframe")
+    {
+        REQUIRE(extractor.extract(3, false, image));
+        CHECK(extractor.lastFrame() == 0);
+        CHECK(isRed(image.pixel(32, 24)));
+    }
+
+    SECTION("Invalid file")
+    {
+        ThumbnailExtractor missing(sourcesPath + QStringLiteral("/dataset/missing.mp4"), -1, 25.);
+        CHECK_FALSE(missing.isValid());
+        CHECK_FALSE(missing.extract(0, true, image));
+        CHECK(missing.lastFrame() == -1);
+    }
+}
+
+TEST_CASE("Frame image conversion benchmark", "[.benchmark]")
+{
+    // A 1080p frame, converted at full size and to a thumbnail width
+    const int width = 1920;
+    const int height = 1080;
+    const QByteArray rgba = randomRgba(width, height);
+    const auto *pixels = reinterpret_cast<const uchar *>(rgba.constData());
+    for (const QSize &size : {QSize(width, height), QSize(1440, height)}) {
+        const std::string suffix = QStringLiteral(", %1x%2").arg(size.width()).arg(size.height()).toStdString();
+        BENCHMARK("copy, swap and scale" + suffix)
+        {
+            return referenceConversion(rgba, width, height, size);
+        };
+        for (const auto kernel : {KThumb::Kernel::Scalar, KThumb::Kernel::SSE2}) {
+            if (!KThumb::isSupported(kernel)) {
+                continue;
+            }
+            BENCHMARK(KThumb::kernelName(kernel) + suffix)
+            {
+                QImage result(size, QImage::Format_ARGB32);
+                KThumb::convertRgba(kernel, pixels, width, height, result);
+                return result;
+            };
+        }
+    }
+}
+
+TEST_CASE("File hash cache", "[Cache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    FileHashCache::get()->clear();
+    std::mt19937 gen(5);
+    auto writeFile = [&gen](const QString &path, int size) {
+        QByteArray data(size, Qt::Uninitialized);
+        for (char &c : data) {
+            c = char(gen());
+        }
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(data);
+        file.close();
+        return data;
+    };
+    // The hash used so far, which is stored in the projects
+    auto expectedHash = [](const QByteArray &data) {
+        if (data.size() > 2000000) {
+            return QCryptographicHash::hash(data.left(1000000) + data.right(1000000), QCryptographicHash::Md5);
+        }
+        return QCryptographicHash::hash(data, QCryptographicHash::Md5);
+    };
+
+    SECTION("Same hash as reading the whole parts")
+    {
+        for (int size : {0, 1000, 2000000, 2000001, 5000000}) {
+            const QString path = dir.filePath(QStringLiteral("file%1").arg(size));
+            const QByteArray data = writeFile(path, size);
+            const QPair<QByteArray, qint64> hash = FileHashCache::get()->fileHash(path);
+            CHECK(hash.first == expectedHash(data));
+            CHECK(hash.second == size);
+            // From the cache
+            CHECK(FileHashCache::get()->fileHash(path) == hash);
+        }
+    }
+
+    SECTION("A modified file is hashed again")
+    {
+        const QString path = dir.filePath(QStringLiteral("modified"));
+        writeFile(path, 3000);
+        const QByteArray first = FileHashCache::get()->fileHash(path).first;
+        const QByteArray data = writeFile(path, 4000);
+        const QByteArray second = FileHashCache::get()->fileHash(path).first;
+        CHECK(first != second);
+        CHECK(second == expectedHash(data));
+    }
+
+    SECTION("Missing files have no hash")
+    {
+        const QPair<QByteArray, qint64> hash = FileHashCache::get()->fileHash(dir.filePath(QStringLiteral("missing")));
+        CHECK(hash.first.isEmpty());
+        CHECK(hash.second == 0);
+        CHECK(FileHashCache::get()->fileHash(dir.path()).first.isEmpty());
+    }
+}
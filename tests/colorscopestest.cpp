@@ -9,6 +9,15 @@
 #include "scopes/colorscopes/waveformgenerator.h"
 #include "scopes/colorscopes/rgbparadegenerator.h"
 #include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/scopeanalysis.h"
+#include "scopes/colorscopes/scopeframe.h"
+#include "scopes/colorscopes/scopekernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mlt++/MltFrame.h>
 
 // test for a bug where pixels were assumed to be RGB which was not true on
 // Windows, resulting in red and blue switched. BUG: 453149
@@ -69,3 +78,294 @@ TEST_CASE("Colorscope RGB/BGR handling")
         CHECK(rgbScope == bgrScope);
     }
 }
+
+namespace {
+// A frame with varied colors, so that every scope bin range gets used
+QImage gradientFrame(int width, int height, QImage::Format format)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        auto *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            line[x] = qRgb((x * 255) / width, (y * 255) / height, ((x + y) * 7) % 256);
+        }
+    }
+    return image.convertToFormat(format);
+}
+} // namespace
+
+TEST_CASE("Colorscope native pixel formats")
+{
+    // The monitor hands RGBA8888 frames to the scopes, they are read without conversion
+    QImage inputImage = gradientFrame(333, 217, QImage::Format_RGB32);
+    QImage rgbaInputImage = inputImage.convertToFormat(QImage::Format_RGBA8888);
+
+    QSize scopeSize{300, 280};
+    qreal scalingFactor = 1.0;
+
+    for (uint accelFactor : {1u, 3u}) {
+        WaveformGenerator waveform{};
+        CHECK(waveform.calculateWaveform(scopeSize, scalingFactor, inputImage, WaveformGenerator::PaintMode::PaintMode_Green, false, ITURec::Rec_601,
+                                         accelFactor) ==
+              waveform.calculateWaveform(scopeSize, scalingFactor, rgbaInputImage, WaveformGenerator::PaintMode::PaintMode_Green, false, ITURec::Rec_601,
+                                         accelFactor));
+
+        RGBParadeGenerator rgb{};
+        CHECK(rgb.calculateRGBParade(scopeSize, scalingFactor, inputImage, RGBParadeGenerator::PaintMode::PaintMode_RGB, false, false, accelFactor) ==
+              rgb.calculateRGBParade(scopeSize, scalingFactor, rgbaInputImage, RGBParadeGenerator::PaintMode::PaintMode_RGB, false, false, accelFactor));
+
+        const auto ALL_COMPONENTS = HistogramGenerator::Components::ComponentY | HistogramGenerator::Components::ComponentSum |
+                                    HistogramGenerator::Components::ComponentR | HistogramGenerator::Components::ComponentG |
+                                    HistogramGenerator::Components::ComponentB;
+        HistogramGenerator hist{};
+        CHECK(hist.calculateHistogram(scopeSize, scalingFactor, inputImage, ALL_COMPONENTS, ITURec::Rec_709, false, false, accelFactor) ==
+              hist.calculateHistogram(scopeSize, scalingFactor, rgbaInputImage, ALL_COMPONENTS, ITURec::Rec_709, false, false, accelFactor));
+
+        VectorscopeGenerator vectorscope{};
+        CHECK(vectorscope.calculateVectorscope(scopeSize, scalingFactor, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Original,
+                                               VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false, accelFactor) ==
+              vectorscope.calculateVectorscope(scopeSize, scalingFactor, rgbaInputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Original,
+                                               VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false, accelFactor));
+    }
+}
+
+TEST_CASE("Colorscope native Y'CbCr frames")
+{
+    // A limited range yuv420p frame as displayed by the monitor, black on the left half and white on the right half
+    const int width = 64;
+    const int height = 48;
+    const int size = width * height * 3 / 2;
+    auto *data = static_cast<uint8_t *>(malloc(size_t(size)));
+    for (int y = 0; y < height; ++y) {
+        memset(data + y * width, 16, size_t(width / 2));
+        memset(data + y * width + width / 2, 235, size_t(width / 2));
+    }
+    memset(data + width * height, 128, size_t(width * height / 2));
+    mlt_frame mltFrame = mlt_frame_init(nullptr);
+    Mlt::Frame frame(mltFrame);
+    mlt_frame_close(mltFrame);
+    frame.set_image(data, size, free);
+    frame.set("format", mlt_image_yuv420p);
+    frame.set("width", width);
+    frame.set("height", height);
+    const ScopeFrame scopeFrame(SharedFrame(frame), 601);
+
+    REQUIRE(scopeFrame.isValid());
+    CHECK(scopeFrame.format() == ScopeFrame::Format::Yuv420p);
+    CHECK(scopeFrame.width() == width);
+    CHECK(scopeFrame.height() == height);
+    CHECK(scopeFrame.hasNativeLuma(ITURec::Rec_601));
+    CHECK_FALSE(scopeFrame.hasNativeLuma(ITURec::Rec_709));
+    CHECK_FALSE(scopeFrame.isFullRange());
+
+    // The same frame as RGB
+    QImage inputImage(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            inputImage.setPixel(x, y, x < width / 2 ? qRgb(0, 0, 0) : qRgb(255, 255, 255));
+        }
+    }
+
+    QSize scopeSize{256, 256};
+    for (uint accelFactor : {1u, 3u}) {
+        WaveformGenerator waveform{};
+        CHECK(waveform.calculateWaveform(scopeSize, 1.0, scopeFrame, WaveformGenerator::PaintMode::PaintMode_Green, false, ITURec::Rec_601, accelFactor) ==
+              waveform.calculateWaveform(scopeSize, 1.0, inputImage, WaveformGenerator::PaintMode::PaintMode_Green, false, ITURec::Rec_601, accelFactor));
+
+        HistogramGenerator hist{};
+        CHECK(hist.calculateHistogram(scopeSize, 1.0, scopeFrame, HistogramGenerator::Components::ComponentY, ITURec::Rec_601, false, false, accelFactor) ==
+              hist.calculateHistogram(scopeSize, 1.0, inputImage, HistogramGenerator::Components::ComponentY, ITURec::Rec_601, false, false, accelFactor));
+
+        VectorscopeGenerator vectorscope{};
+        CHECK(vectorscope.calculateVectorscope(scopeSize, 1.0, scopeFrame, 1, VectorscopeGenerator::PaintMode::PaintMode_Green2,
+                                               VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false, accelFactor) ==
+              vectorscope.calculateVectorscope(scopeSize, 1.0, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Green2,
+                                               VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false, accelFactor));
+    }
+}
+
+TEST_CASE("Colorscope shared analysis")
+{
+    const QImage inputImage = gradientFrame(333, 217, QImage::Format_RGBA8888);
+    const QSize scopeSize{300, 280};
+    const auto ALL_COMPONENTS = HistogramGenerator::Components::ComponentY | HistogramGenerator::Components::ComponentSum |
+                                HistogramGenerator::Components::ComponentR | HistogramGenerator::Components::ComponentG |
+                                HistogramGenerator::Components::ComponentB;
+
+    SECTION("Requests are merged")
+    {
+        ScopeAnalysis::Request waveformRequest;
+        WaveformGenerator::addToRequest(waveformRequest, scopeSize, 1.0, ITURec::Rec_601, 3);
+        ScopeAnalysis::Request histogramRequest;
+        HistogramGenerator::addToRequest(histogramRequest, HistogramGenerator::Components::ComponentY, ITURec::Rec_709, 2);
+
+        ScopeAnalysis::Request request;
+        request.merge(waveformRequest);
+        CHECK(request.accelFactor == 3);
+        request.merge(histogramRequest);
+        CHECK(request.accelFactor == 2);
+        CHECK(request.covers(histogramRequest));
+        CHECK_FALSE(waveformRequest.covers(histogramRequest));
+        CHECK_FALSE(request.rgbHistogram);
+
+        // A resized scope needs its own pass
+        ScopeAnalysis::Request resized;
+        WaveformGenerator::addToRequest(resized, scopeSize + QSize(10, 0), 1.0, ITURec::Rec_601, 3);
+        CHECK_FALSE(request.covers(resized));
+    }
+
+    SECTION("All scopes render from one pass")
+    {
+        for (uint accelFactor : {1u, 3u}) {
+            ScopeAnalysis::Request request;
+            WaveformGenerator::addToRequest(request, scopeSize, 1.0, ITURec::Rec_601, accelFactor);
+            RGBParadeGenerator::addToRequest(request, scopeSize, accelFactor);
+            HistogramGenerator::addToRequest(request, ALL_COMPONENTS, ITURec::Rec_709, accelFactor);
+            VectorscopeGenerator::addToRequest(request, scopeSize, VectorscopeGenerator::PaintMode::PaintMode_Original,
+                                               VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, accelFactor);
+            ScopeAnalysis analysis(ScopeFrame(inputImage), request);
+            analysis.run();
+            REQUIRE(analysis.isValid());
+
+            WaveformGenerator waveform{};
+            CHECK(waveform.calculateWaveform(scopeSize, 1.0, analysis, WaveformGenerator::PaintMode::PaintMode_Green, false) ==
+                  waveform.calculateWaveform(scopeSize, 1.0, inputImage, WaveformGenerator::PaintMode::PaintMode_Green, false, ITURec::Rec_601, accelFactor));
+
+            RGBParadeGenerator rgb{};
+            CHECK(rgb.calculateRGBParade(scopeSize, 1.0, analysis, RGBParadeGenerator::PaintMode::PaintMode_RGB, false, false) ==
+                  rgb.calculateRGBParade(scopeSize, 1.0, inputImage, RGBParadeGenerator::PaintMode::PaintMode_RGB, false, false, accelFactor));
+
+            HistogramGenerator hist{};
+            CHECK(hist.calculateHistogram(scopeSize, 1.0, analysis, ALL_COMPONENTS, false, false) ==
+                  hist.calculateHistogram(scopeSize, 1.0, inputImage, ALL_COMPONENTS, ITURec::Rec_709, false, false, accelFactor));
+
+            VectorscopeGenerator vectorscope{};
+            CHECK(vectorscope.calculateVectorscope(scopeSize, 1.0, analysis, 1, VectorscopeGenerator::PaintMode::PaintMode_Original,
+                                                   VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false) ==
+                  vectorscope.calculateVectorscope(scopeSize, 1.0, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Original,
+                                                   VectorscopeGenerator::ColorSpace::ColorSpace_YPbPr, false, accelFactor));
+
+            // A scope that was not part of the request cannot render from the bins
+            CHECK(waveform.calculateWaveform(scopeSize + QSize(10, 0), 1.0, analysis, WaveformGenerator::PaintMode::PaintMode_Green, false).isNull());
+        }
+    }
+
+    SECTION("Bands of rows give the same result as a single pass")
+    {
+        // Large enough to be split between threads
+        const QImage hdImage = gradientFrame(1920, 1080, QImage::Format_RGBA8888);
+        for (auto paintMode : {VectorscopeGenerator::PaintMode::PaintMode_Original, VectorscopeGenerator::PaintMode::PaintMode_YUV,
+                               VectorscopeGenerator::PaintMode::PaintMode_Green}) {
+            ScopeAnalysis::Request request;
+            VectorscopeGenerator::addToRequest(request, scopeSize, paintMode, VectorscopeGenerator::ColorSpace::ColorSpace_YUV, 1);
+            ScopeAnalysis analysis(ScopeFrame(hdImage), request);
+            analysis.run();
+            REQUIRE(analysis.isValid());
+
+            // Reference: accumulate the bins pixel by pixel in reading order
+            const int cw = std::min(scopeSize.width(), scopeSize.height());
+            std::vector<uint> bins(size_t(cw * cw), 0);
+            for (int y = 0; y < hdImage.height(); ++y) {
+                for (int x = 0; x < hdImage.width(); ++x) {
+                    const QRgb pixel = hdImage.pixel(x, y);
+                    const double u = -0.0005781 * qRed(pixel) - 0.001135 * qGreen(pixel) + 0.001713 * qBlue(pixel);
+                    const double v = 0.002411 * qRed(pixel) - 0.002019 * qGreen(pixel) - 0.0003921 * qBlue(pixel);
+                    const QPoint pt =
+                        VectorscopeGenerator::mapToCircle(scopeSize, QPointF(VectorscopeGenerator::scaling * u, VectorscopeGenerator::scaling * v));
+                    if (pt.x() >= 0 && pt.y() >= 0 && pt.x() < cw && pt.y() < cw) {
+                        ++bins[size_t(pt.y() * cw + pt.x())];
+                    }
+                }
+            }
+            CHECK(analysis.bins().vectorscope == bins);
+        }
+    }
+}
+
+TEST_CASE("Colorscope luma kernels")
+{
+    QImage inputImage = gradientFrame(1001, 3, QImage::Format_RGB32);
+    inputImage.setPixel(0, 0, qRgb(255, 255, 255));
+    ScopeKernels::PixelLayout layout;
+    const QImage frame = ScopeKernels::scanlineImage(inputImage, layout);
+    std::vector<quint16> expected(size_t(frame.width()));
+    std::vector<quint16> luma(size_t(frame.width()));
+
+    for (ITURec rec : {ITURec::Rec_601, ITURec::Rec_709}) {
+        for (int y = 0; y < frame.height(); ++y) {
+            for (int step : {1, 2, 7}) {
+                const int first = ScopeKernels::firstSampleInRow(y, frame.width(), step);
+                const int count = ScopeKernels::lumaRow(ScopeKernels::Kernel::Scalar, frame.constScanLine(y), frame.width(), first, step, layout, rec,
+                                                        expected.data());
+                REQUIRE(count == (frame.width() - first + step - 1) / step);
+                // Fixed point luma stays close to the floating point factors
+                for (int k = 0; k < count; ++k) {
+                    const QRgb pixel = frame.pixel(first + k * step, y);
+                    const float reference = rec == ITURec::Rec_601 ? REC_601_R * qRed(pixel) + REC_601_G * qGreen(pixel) + REC_601_B * qBlue(pixel)
+                                                                   : REC_709_R * qRed(pixel) + REC_709_G * qGreen(pixel) + REC_709_B * qBlue(pixel);
+                    CHECK(std::abs(reference - expected[size_t(k)] / 256.f) < 0.02f);
+                    CHECK(expected[size_t(k)] <= 255 * 256);
+                }
+                for (auto kernel : {ScopeKernels::Kernel::Scalar, ScopeKernels::Kernel::SSE2}) {
+                    if (!ScopeKernels::isSupported(kernel)) {
+                        continue;
+                    }
+                    CAPTURE(ScopeKernels::kernelName(kernel));
+                    REQUIRE(ScopeKernels::lumaRow(kernel, frame.constScanLine(y), frame.width(), first, step, layout, rec, luma.data()) == count);
+                    CHECK(std::equal(luma.begin(), luma.begin() + count, expected.begin()));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Colorscope benchmark", "[.benchmark]")
+{
+    const QImage inputImage = gradientFrame(1920, 1080, QImage::Format_RGBA8888);
+    const QSize scopeSize{512, 300};
+
+    WaveformGenerator waveform{};
+    BENCHMARK("waveform")
+    {
+        return waveform.calculateWaveform(scopeSize, 1.0, inputImage, WaveformGenerator::PaintMode::PaintMode_Green, true, ITURec::Rec_709, 1);
+    };
+    RGBParadeGenerator rgb{};
+    BENCHMARK("rgb parade")
+    {
+        return rgb.calculateRGBParade(scopeSize, 1.0, inputImage, RGBParadeGenerator::PaintMode::PaintMode_RGB, true, true, 1);
+    };
+    HistogramGenerator hist{};
+    const auto ALL_COMPONENTS = HistogramGenerator::Components::ComponentY | HistogramGenerator::Components::ComponentSum |
+                                HistogramGenerator::Components::ComponentR | HistogramGenerator::Components::ComponentG |
+                                HistogramGenerator::Components::ComponentB;
+    BENCHMARK("histogram")
+    {
+        return hist.calculateHistogram(scopeSize, 1.0, inputImage, HistogramGenerator::Components::ComponentY, ITURec::Rec_709, false, false, 1);
+    };
+    BENCHMARK("histogram, all components")
+    {
+        return hist.calculateHistogram(scopeSize, 1.0, inputImage, ALL_COMPONENTS, ITURec::Rec_709, false, false, 1);
+    };
+    VectorscopeGenerator vectorscope{};
+    BENCHMARK("vectorscope")
+    {
+        return vectorscope.calculateVectorscope(scopeSize, 1.0, inputImage, 1, VectorscopeGenerator::PaintMode::PaintMode_Green2,
+                                                VectorscopeGenerator::ColorSpace::ColorSpace_YUV, false, 1);
+    };
+    std::vector<quint16> luma(size_t(inputImage.width()));
+    ScopeKernels::PixelLayout layout;
+    const QImage frame = ScopeKernels::scanlineImage(inputImage, layout);
+    for (auto kernel : {ScopeKernels::Kernel::Scalar, ScopeKernels::Kernel::SSE2}) {
+        if (!ScopeKernels::isSupported(kernel)) {
+            continue;
+        }
+        BENCHMARK(QStringLiteral("luma, %1").arg(ScopeKernels::kernelName(kernel)).toStdString())
+        {
+            int count = 0;
+            for (int y = 0; y < frame.height(); ++y) {
+                count += ScopeKernels::lumaRow(kernel, frame.constScanLine(y), frame.width(), 0, 1, layout, ITURec::Rec_709, luma.data());
+            }
+            return count;
+        };
+    }
+}
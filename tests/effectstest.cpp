@@ -7,8 +7,12 @@
 // test specific headers
 #include "doc/docundostack.hpp"
 #include "doc/kdenlivedoc.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
 #include <cmath>
 #include <iostream>
+#include <map>
 #include <tuple>
 #include <unordered_set>
 
@@ -108,3 +112,132 @@ TEST_CASE("Effects stack", "[Effects]")
     clip.reset();
     pCore->projectManager()->closeCurrentDocument(false, false);
 }
+
+// Effects repository reading its custom effects from a given folder, with its own cache file
+class TestEffectsRepository : public EffectsRepository
+{
+public:
+    explicit TestEffectsRepository(const QString &dir)
+        : EffectsRepository()
+        , m_dir(dir)
+    {
+        QFile::remove(cachePath());
+    }
+    QString cachePath() const { return AssetsCache::path(cacheName()); }
+    /** @brief Parse the assets again, from the cache if it is valid */
+    void reload()
+    {
+        m_assets.clear();
+        init();
+    }
+    /** @brief Everything stored for each asset, by id */
+    std::map<QString, QString> snapshot() const
+    {
+        std::map<QString, QString> result;
+        for (const auto &asset : m_assets) {
+            const Info &info = asset.second;
+            result[asset.first] = QStringList{info.id,
+                                              info.mltId,
+                                              info.name,
+                                              info.description,
+                                              info.author,
+                                              info.version_str,
+                                              QString::number(info.version),
+                                              QString::number(info.included),
+                                              QString::number(int(info.type)),
+                                              info.xml.isNull() ? QString() : info.xml.toString(-1)}
+                                      .join(QLatin1Char('\n'));
+        }
+        return result;
+    }
+
+protected:
+    QStringList assetDirs() const override { return {m_dir}; }
+    QString cacheName() const override { return QStringLiteral("effects-test"); }
+
+private:
+    QString m_dir;
+};
+
+TEST_CASE("Effects repository cache", "[Effects]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString custom = dir.filePath(QStringLiteral("audiobalance.xml"));
+    REQUIRE(QFile::copy(sourcesPath + QStringLiteral("/../data/effects/audiobalance.xml"), custom));
+    TestEffectsRepository repository(dir.path());
+
+    // Cold parse, writing the cache
+    repository.reload();
+    REQUIRE_FALSE(repository.initStats().fromCache);
+    REQUIRE(repository.exists(QStringLiteral("audiobalance")));
+    const auto parsed = repository.snapshot();
+    REQUIRE(QFile::exists(repository.cachePath()));
+
+    SECTION("Second run reads the same assets from the cache")
+    {
+        repository.reload();
+        REQUIRE(repository.initStats().fromCache);
+        REQUIRE(repository.initStats().assetCount == int(parsed.size()));
+        REQUIRE(repository.snapshot() == parsed);
+    }
+
+    SECTION("Touching a custom file invalidates the cache")
+    {
+        QFile file(custom);
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.setFileTime(QFileInfo(custom).lastModified().addSecs(10), QFileDevice::FileModificationTime));
+        file.close();
+        repository.reload();
+        REQUIRE_FALSE(repository.initStats().fromCache);
+        REQUIRE(repository.snapshot() == parsed);
+        // Cached again with the new key
+        repository.reload();
+        REQUIRE(repository.initStats().fromCache);
+    }
+
+    SECTION("Adding a custom file invalidates the cache")
+    {
+        QFile file(dir.filePath(QStringLiteral("testbalance.xml")));
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write(R"(<?xml version="1.0"?>
+<effect tag="panner" id="testbalance" type="audio">
+    <name>Test Balance</name>
+    <parameter type="fixed" name="start" min="0.5" max="0.5" default="0.5"/>
+</effect>
+)");
+        file.close();
+        repository.reload();
+        REQUIRE_FALSE(repository.initStats().fromCache);
+        REQUIRE(repository.exists(QStringLiteral("testbalance")));
+        REQUIRE(repository.getName(QStringLiteral("testbalance")) == QStringLiteral("Test Balance"));
+    }
+
+    SECTION("A truncated cache falls back to a full parse")
+    {
+        QFile file(repository.cachePath());
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        REQUIRE(file.resize(file.size() / 2));
+        file.close();
+        repository.reload();
+        REQUIRE_FALSE(repository.initStats().fromCache);
+        REQUIRE(repository.snapshot() == parsed);
+    }
+
+    SECTION("A corrupted cache falls back to a full parse")
+    {
+        QFile file(repository.cachePath());
+        REQUIRE(file.open(QIODevice::ReadWrite));
+        const QByteArray content = file.readAll();
+        // Keep the magic, version and key, garble the assets
+        QByteArray garbled = content.left(32);
+        garbled.append(QByteArray(content.size() - garbled.size(), char(0xff)));
+        REQUIRE(file.seek(0));
+        REQUIRE(file.write(garbled) == garbled.size());
+        file.close();
+        repository.reload();
+        REQUIRE_FALSE(repository.initStats().fromCache);
+        REQUIRE(repository.snapshot() == parsed);
+    }
+    QFile::remove(repository.cachePath());
+}
@@ -194,6 +194,36 @@ TEST_CASE("Keyframe model", "[KeyframeModel]")
         state0();
     }
 
+    SECTION("Interpolated values follow the keyframes")
+    {
+        const double fps = pCore->getCurrentFps();
+        const double start = model->getInterpolatedValue(0).toDouble();
+        REQUIRE(KdenliveTests::addKeyframe(model, GenTime(50, fps), KeyframeType::Linear, start + 10.));
+        auto checkMiddle = [&]() {
+            const double end = model->getInterpolatedValue(50).toDouble();
+            REQUIRE(model->getInterpolatedValue(25).toDouble() == Approx((start + end) / 2.));
+            // The batch query gives the same values as the single ones
+            const QList<QVariant> values = model->getInterpolatedValues(0, 60);
+            REQUIRE(values.size() == 61);
+            for (int i = 0; i <= 60; ++i) {
+                REQUIRE(values.at(i).toDouble() == Approx(model->getInterpolatedValue(i).toDouble()));
+            }
+            return end;
+        };
+        const double end = checkMiddle();
+        REQUIRE(end != Approx(start));
+
+        // The parsed animation is discarded when a keyframe changes
+        REQUIRE(model->updateKeyframe(GenTime(50, fps), QVariant(start + 20.)));
+        REQUIRE(checkMiddle() != Approx(end));
+        undoStack->undo();
+        REQUIRE(checkMiddle() == Approx(end));
+        REQUIRE(KdenliveTests::removeKeyframe(model, GenTime(50, fps)));
+        REQUIRE(model->getInterpolatedValue(25).toDouble() == Approx(start));
+        undoStack->undo();
+        REQUIRE(checkMiddle() == Approx(end));
+    }
+
     SECTION("Move keyframes + undo")
     {
         auto state0 = [&]() {
@@ -11,6 +11,8 @@
 #include "doc/docundostack.hpp"
 #include "doc/kdenlivedoc.h"
 
+#include <random>
+
 using namespace fakeit;
 
 TEST_CASE("Read subtitle file", "[Subtitles]")
@@ -213,6 +215,107 @@ TEST_CASE("Read subtitle file", "[Subtitles]")
         REQUIRE(subtitleModel->rowCount() == 0);
     }
 
+    SECTION("Query the subtitles in a range")
+    {
+        double fps = pCore->getCurrentFps();
+        subtitleModel->setMaxLayer(1);
+        auto addSub = [&](int layer, int start, int end) {
+            int id = KdenliveTests::getNextId();
+            REQUIRE(subtitleModel->addSubtitle(id, {layer, GenTime(start, fps)},
+                                               SubtitleEvent(true, GenTime(end, fps), "Default", "", 0, 0, 0, "", QStringLiteral("Sub")), false, false));
+            return id;
+        };
+        int subA = addSub(0, 10, 20);
+        int subB = addSub(0, 15, 40);
+        int subC = addSub(0, 50, 60);
+        int subD = addSub(1, 10, 30);
+        // Same start as subC, on another layer
+        int subE = addSub(1, 50, 55);
+        using Ids = std::unordered_set<int>;
+        CHECK(subtitleModel->getItemsInRange(0, 0, 5).empty());
+        CHECK(subtitleModel->getItemsInRange(0, 18, 18) == Ids({subA, subB}));
+        // A subtitle ending at the start of the range is not in it
+        CHECK(subtitleModel->getItemsInRange(0, 20, 20) == Ids({subB}));
+        CHECK(subtitleModel->getItemsInRange(0, 40, 50) == Ids({subC}));
+        CHECK(subtitleModel->getItemsInRange(-1, 12, 12) == Ids({subA, subB, subD}));
+        CHECK(subtitleModel->getItemsInRange(-1, 52, 52) == Ids({subC, subE}));
+        CHECK(subtitleModel->getItemsInRange(1, 0, -1) == Ids({subD, subE}));
+        CHECK(subtitleModel->getItemsInRange(0, 45, -1) == Ids({subC}));
+        CHECK(subtitleModel->getIdForStartPos(1, GenTime(50, fps)) == subE);
+        CHECK(subtitleModel->getIdForStartPos(-1, GenTime(50, fps)) == std::min(subC, subE));
+
+        // Resize from the end, then undo
+        REQUIRE(subtitleModel->requestResize(subC, 5, true));
+        CHECK(subtitleModel->getItemsInRange(0, 57, 57).empty());
+        undoStack->undo();
+        CHECK(subtitleModel->getItemsInRange(0, 57, 57) == Ids({subC}));
+        // Resize from the start
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+        REQUIRE(subtitleModel->requestResize(subA, 15, false, undo, redo, false));
+        CHECK(subtitleModel->getItemsInRange(0, 6, 6) == Ids({subA}));
+        CHECK(subtitleModel->getIdForStartPos(0, GenTime(5, fps)) == subA);
+        CHECK(subtitleModel->getIdForStartPos(0, GenTime(10, fps)) == -1);
+        undo();
+        CHECK(subtitleModel->getItemsInRange(0, 6, 6).empty());
+        // Move to another layer
+        REQUIRE(subtitleModel->moveSubtitle(subB, 1, GenTime(100, fps), false, false));
+        CHECK(subtitleModel->getItemsInRange(0, 30, 30).empty());
+        CHECK(subtitleModel->getItemsInRange(1, 110, 130) == Ids({subB}));
+        CHECK(subtitleModel->getItemsInRange(-1, 0, -1) == Ids({subA, subB, subC, subD, subE}));
+        // Delete
+        REQUIRE(subtitleModel->removeSubtitle(subD));
+        CHECK(subtitleModel->getItemsInRange(1, 12, 12).empty());
+        subtitleModel->removeAllSubtitles();
+        REQUIRE(subtitleModel->rowCount() == 0);
+        CHECK(subtitleModel->getItemsInRange(-1, 0, -1).empty());
+
+        // Random edits, compared with a scan of all the subtitles
+        std::mt19937 gen(7);
+        std::vector<int> ids;
+        for (int i = 0; i < 300; i++) {
+            const int layer = int(gen() % 2);
+            const int start = int(gen() % 3000);
+            const int id = KdenliveTests::getNextId();
+            if (subtitleModel->addSubtitle(id, {layer, GenTime(start, fps)},
+                                           SubtitleEvent(true, GenTime(start + 1 + int(gen() % 100), fps), "Default", "", 0, 0, 0, "", QStringLiteral("Sub")),
+                                           false, false)) {
+                ids.push_back(id);
+            }
+        }
+        for (int i = 0; i < 100; i++) {
+            const int id = ids[gen() % ids.size()];
+            switch (gen() % 3) {
+            case 0:
+                subtitleModel->moveSubtitle(id, int(gen() % 2), GenTime(int(gen() % 3000), fps), false, false);
+                break;
+            case 1:
+                REQUIRE(subtitleModel->requestResize(id, 1 + int(gen() % 50), true, undo, redo, false));
+                break;
+            default:
+                subtitleModel->requestResize(id, 1 + int(gen() % 50), false, undo, redo, false);
+                break;
+            }
+        }
+        for (int i = 0; i < 200; i++) {
+            const int layer = int(gen() % 3) - 1;
+            const int startFrame = int(gen() % 3200);
+            const int endFrame = i % 10 == 0 ? -1 : startFrame + int(gen() % 60);
+            Ids expected;
+            for (int id : ids) {
+                const int subLayer = subtitleModel->getLayerForId(id);
+                const int subStart = subtitleModel->getStartPosForId(id).frames(fps);
+                const int subEnd = subtitleModel->getSubtitleEnd(id);
+                if ((layer == -1 || layer == subLayer) && (endFrame == -1 || subStart <= endFrame) && (subStart >= startFrame || subEnd > startFrame)) {
+                    expected.insert(id);
+                }
+            }
+            CHECK(subtitleModel->getItemsInRange(layer, startFrame, endFrame) == expected);
+        }
+        subtitleModel->removeAllSubtitles();
+        REQUIRE(subtitleModel->rowCount() == 0);
+    }
+
     SECTION("Read start/end time of the subtitles")
     {
         // srt
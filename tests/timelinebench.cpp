@@ -0,0 +1,300 @@
+/*
+    SPDX-FileCopyrightText: 2026 Kdenlive contributors
+
+    SPDX-License-Identifier: GPL-3.0-only OR LicenseRef-KDE-Accepted-GPL
+*/
+#include "catch.hpp"
+#include "test_utils.hpp"
+// test specific headers
+#include "doc/docundostack.hpp"
+#include "doc/kdenlivedoc.h"
+
+#include "core.h"
+#include "definitions.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+
+/* Timeline editing benchmarks on large synthetic timelines.
+   They are built in the kdenlive_bench target, not run with the tests:
+     kdenlive_bench --reporter xml --benchmark-samples 20
+   KDENLIVE_BENCH_CLIPS sets the comma separated clip counts to test, 10000 by default (e.g. 10000,50000,100000).
+*/
+
+namespace {
+std::vector<int> benchClipCounts()
+{
+    std::vector<int> counts;
+    const QStringList values = qEnvironmentVariable("KDENLIVE_BENCH_CLIPS", QStringLiteral("10000")).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const QString &value : values) {
+        bool ok;
+        const int count = value.trimmed().toInt(&ok);
+        if (ok && count > 0) {
+            counts.push_back(count);
+        }
+    }
+    return counts;
+}
+
+QString findComposition()
+{
+    const QVector<QPair<QString, QString>> transitions = TransitionsRepository::get()->getNames();
+    for (const auto &trans : transitions) {
+        if (TransitionsRepository::get()->isComposition(trans.first)) {
+            return trans.first;
+        }
+    }
+    return QString();
+}
+
+/** @brief A reproducible timeline: clips of random duration on 4 video tracks, with groups, mixes and compositions */
+struct SyntheticTimeline
+{
+    std::shared_ptr<TimelineItemModel> timeline;
+    std::vector<int> videoTracks;
+    /** @brief Clips that are neither grouped nor mixed, they can be moved alone */
+    std::vector<int> freeClips;
+    std::vector<int> groups;
+    int mixes{0};
+    int compositions{0};
+    /** @brief First frame after all the items */
+    int end{0};
+};
+
+void buildTimeline(SyntheticTimeline &synthetic, std::shared_ptr<ProjectItemModel> binModel, int clipCount)
+{
+    auto timeline = synthetic.timeline;
+    for (int i = 0; i < timeline->getTracksCount(); ++i) {
+        const int tid = timeline->getTrackIndexFromPosition(i);
+        if (!timeline->isAudioTrack(tid)) {
+            synthetic.videoTracks.push_back(tid);
+        }
+    }
+    while (synthetic.videoTracks.size() < 4) {
+        int tid;
+        REQUIRE(timeline->requestTrackInsertion(-1, tid));
+        synthetic.videoTracks.push_back(tid);
+    }
+    const QString binId = KdenliveTests::createProducer(pCore->getProjectProfile(), "red", binModel, 100, false);
+    const QString compositionId = findComposition();
+    REQUIRE(!compositionId.isEmpty());
+
+    // Fixed seed, the same timeline is built on every run
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> durations(30, 120);
+    std::uniform_int_distribution<int> kinds(0, 9);
+    std::vector<int> positions(synthetic.videoTracks.size(), 0);
+    // Last free clip of each track, that can be mixed with the next one
+    std::vector<int> previous(synthetic.videoTracks.size(), -1);
+    std::unordered_set<int> pendingGroup;
+    for (int i = 0; i < clipCount; ++i) {
+        const size_t track = size_t(i) % synthetic.videoTracks.size();
+        const int tid = synthetic.videoTracks[track];
+        const int duration = durations(gen);
+        const int kind = kinds(gen);
+        // Leave a gap unless this clip is mixed with the previous one
+        const bool mixed = kind == 0 && previous[track] != -1;
+        if (!mixed) {
+            positions[track] += 10;
+        }
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, positions[track], cid, false));
+        REQUIRE(timeline->requestItemResize(cid, duration, true, false) == duration);
+        positions[track] += duration;
+        if (mixed && timeline->mixClip(cid)) {
+            synthetic.mixes++;
+            synthetic.freeClips.erase(std::find(synthetic.freeClips.rbegin(), synthetic.freeClips.rend(), previous[track]).base() - 1);
+            previous[track] = -1;
+            continue;
+        }
+        previous[track] = -1;
+        if (kind == 1 || kind == 2) {
+            // Groups of 3 clips spread over the tracks
+            pendingGroup.insert(cid);
+            if (pendingGroup.size() == 3) {
+                const int gid = timeline->requestClipsGroup(pendingGroup, false);
+                REQUIRE(gid != -1);
+                synthetic.groups.push_back(gid);
+                pendingGroup.clear();
+            }
+            continue;
+        }
+        if (kind == 3 && track > 0) {
+            int compoId;
+            if (timeline->requestCompositionInsertion(compositionId, tid, timeline->getClipPosition(cid), duration, nullptr, compoId, false)) {
+                synthetic.compositions++;
+            }
+        }
+        synthetic.freeClips.push_back(cid);
+        previous[track] = cid;
+    }
+    for (int position : positions) {
+        synthetic.end = std::max(synthetic.end, position);
+    }
+    REQUIRE(timeline->getClipsCount() == clipCount);
+    REQUIRE(!synthetic.freeClips.empty());
+    REQUIRE(!synthetic.groups.empty());
+}
+} // namespace
+
+TEST_CASE("Timeline editing at scale", "[timelinebench]")
+{
+    const std::vector<int> counts = benchClipCounts();
+    REQUIRE(!counts.empty());
+    const int clipCount = GENERATE_COPY(from_range(counts));
+
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    pCore->projectManager()->testSetDocument(&document);
+    QDateTime documentDate = QDateTime::currentDateTime();
+    KdenliveTests::updateTimeline(false, QString(), QString(), documentDate, 0);
+    SyntheticTimeline synthetic;
+    synthetic.timeline = document.getTimeline(document.uuid());
+    pCore->projectManager()->testSetActiveTimeline(synthetic.timeline);
+    auto timeline = synthetic.timeline;
+
+    QElapsedTimer timer;
+    timer.start();
+    buildTimeline(synthetic, binModel, clipCount);
+    WARN(QStringLiteral("%1 clips, %2 groups, %3 mixes, %4 compositions built in %5ms")
+             .arg(clipCount)
+             .arg(synthetic.groups.size())
+             .arg(synthetic.mixes)
+             .arg(synthetic.compositions)
+             .arg(timer.elapsed())
+             .toStdString());
+    REQUIRE(timeline->checkConsistency());
+
+    const std::string suffix = QStringLiteral(" (%1 clips)").arg(clipCount).toStdString();
+    // Items are moved back and forth between their place and the free space after the last item
+    const int cid = synthetic.freeClips[synthetic.freeClips.size() / 2];
+    const int tid = timeline->getClipTrackId(cid);
+    const int position = timeline->getClipPosition(cid);
+    const int farPosition = synthetic.end + 1000;
+
+    BENCHMARK_ADVANCED("requestClipMove" + suffix)(Catch::Benchmark::Chronometer meter)
+    {
+        bool away = false;
+        meter.measure([&] {
+            away = !away;
+            return timeline->requestClipMove(cid, tid, away ? farPosition : position);
+        });
+        if (away) {
+            timeline->requestClipMove(cid, tid, position);
+        }
+    };
+    REQUIRE(timeline->getClipPosition(cid) == position);
+
+    const int gid = synthetic.groups[synthetic.groups.size() / 2];
+    const int groupItem = *KdenliveTests::groupsModel(timeline)->getLeaves(gid).begin();
+    const int delta = farPosition - timeline->getItemPosition(groupItem);
+    BENCHMARK_ADVANCED("requestGroupMove" + suffix)(Catch::Benchmark::Chronometer meter)
+    {
+        bool away = false;
+        meter.measure([&] {
+            away = !away;
+            return timeline->requestGroupMove(groupItem, gid, 0, away ? delta : -delta);
+        });
+        if (away) {
+            timeline->requestGroupMove(groupItem, gid, 0, -delta);
+        }
+    };
+
+    const int duration = timeline->getClipPlaytime(cid);
+    BENCHMARK_ADVANCED("requestItemResize" + suffix)(Catch::Benchmark::Chronometer meter)
+    {
+        bool shrunk = false;
+        meter.measure([&] {
+            shrunk = !shrunk;
+            return timeline->requestItemResize(cid, shrunk ? duration - 1 : duration, true);
+        });
+        if (shrunk) {
+            timeline->requestItemResize(cid, duration, true);
+        }
+    };
+    REQUIRE(timeline->getClipPlaytime(cid) == duration);
+
+    REQUIRE(timeline->requestClipMove(cid, tid, farPosition));
+    BENCHMARK_ADVANCED("undo/redo clip move" + suffix)(Catch::Benchmark::Chronometer meter)
+    {
+        meter.measure([&] {
+            undoStack->undo();
+            undoStack->redo();
+        });
+    };
+    undoStack->undo();
+    REQUIRE(timeline->getClipPosition(cid) == position);
+
+    BENCHMARK("checkConsistency" + suffix)
+    {
+        return timeline->checkConsistency();
+    };
+
+    pCore->projectManager()->closeCurrentDocument(false, false);
+}
+
+TEST_CASE("Track rows at scale", "[timelinebench]")
+{
+    // Model notifications convert clip ids to rows, their cost must not depend on the number of clips on the track
+    const int clipCount = GENERATE(2000, 20000);
+
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    KdenliveDoc document(undoStack);
+    pCore->projectManager()->testSetDocument(&document);
+    QDateTime documentDate = QDateTime::currentDateTime();
+    KdenliveTests::updateTimeline(false, QString(), QString(), documentDate, 0);
+    auto timeline = document.getTimeline(document.uuid());
+    pCore->projectManager()->testSetActiveTimeline(timeline);
+
+    int tid = -1;
+    for (int i = 0; i < timeline->getTracksCount() && tid == -1; ++i) {
+        if (!timeline->isAudioTrack(timeline->getTrackIndexFromPosition(i))) {
+            tid = timeline->getTrackIndexFromPosition(i);
+        }
+    }
+    REQUIRE(tid != -1);
+    const QString binId = KdenliveTests::createProducer(pCore->getProjectProfile(), "red", binModel, 20);
+    std::vector<int> clips;
+    for (int i = 0; i < clipCount; ++i) {
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, i * 20, cid, false));
+        clips.push_back(cid);
+    }
+    const QModelIndex trackIndex = timeline->makeTrackIndexFromID(tid);
+    const std::string suffix = QStringLiteral(" (%1 clips on the track)").arg(clipCount).toStdString();
+    const int cid = clips[clips.size() / 2];
+    const int row = timeline->makeClipIndexFromID(cid).row();
+    REQUIRE(int(timeline->index(row, 0, trackIndex).internalId()) == cid);
+
+    BENCHMARK("clip index" + suffix)
+    {
+        return timeline->makeClipIndexFromID(cid);
+    };
+    BENCHMARK("clip by row" + suffix)
+    {
+        return timeline->index(row, 0, trackIndex);
+    };
+    // Removes the clip rows and inserts them back
+    const int position = timeline->getClipPosition(cid);
+    const int farPosition = clipCount * 20 + 1000;
+    BENCHMARK_ADVANCED("requestClipMove" + suffix)(Catch::Benchmark::Chronometer meter)
+    {
+        bool away = false;
+        meter.measure([&] {
+            away = !away;
+            return timeline->requestClipMove(cid, tid, away ? farPosition : position);
+        });
+        if (away) {
+            timeline->requestClipMove(cid, tid, position);
+        }
+    };
+    REQUIRE(timeline->checkConsistency());
+
+    pCore->projectManager()->closeCurrentDocument(false, false);
+}
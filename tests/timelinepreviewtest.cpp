@@ -7,6 +7,7 @@
 #include "test_utils.hpp"
 // test specific headers
 #include <QString>
+#include <QTemporaryDir>
 #include <cmath>
 #include <iostream>
 #include <tuple>
@@ -71,7 +72,7 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
     for (auto &file : list) {
         qDebug() << "::: FOUND FILE: " << dir.absoluteFilePath(file.fileName());
     }
-    if (list.size() != 3) {
+    if (timeline->previewManager()->previewChunks().first != QStringList{QStringLiteral("0-50")}) {
         QProcess p;
         const QString ffpath = QStandardPaths::findExecutable(QStringLiteral("melt"));
         p.start(ffpath, {QStringLiteral("-query"), QStringLiteral("formats")});
@@ -80,8 +81,9 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
                  << p.readAllStandardOutput() << "\n----------\n"
                  << p.readAllStandardError();
     }
-    // This should create 3 output chunks
-    REQUIRE(list.size() == 3);
+    // This should render 3 chunks. They show the same black frames, so they share one file
+    REQUIRE(timeline->previewManager()->previewChunks().first == QStringList{QStringLiteral("0-50")});
+    REQUIRE(list.size() == 1);
 
     // Create and insert clip
     int cid1 = -1;
@@ -96,10 +98,88 @@ TEST_CASE("Timeline preview insert-remove", "[TimelinePreview]")
     for (auto &file : list) {
         qDebug() << "::: FOUND FILE AFTER: " << file.fileName();
     }
-    // 2 chunks should remain
-    REQUIRE(list.size() == 2);
+    // 2 chunks should remain, the file is kept for the chunks still using it
+    REQUIRE(timeline->previewManager()->previewChunks().first == QStringList{QStringLiteral("0-25")});
+    REQUIRE(list.size() == 1);
+
+    // Undo the insertion, the chunk gets its previous file back without rendering
+    undoStack->undo();
+    REQUIRE(timeline->getClipsCount() == 0);
+    timeline->previewManager()->invalidatePreviews();
+    REQUIRE(timeline->previewManager()->previewChunks().first == QStringList{QStringLiteral("0-50")});
+    REQUIRE_FALSE(timeline->previewManager()->isRunning());
     timeline->resetPreviewManager();
     // Ensure preview project folder is deleted on close
     REQUIRE(dir.exists() == false);
     pCore->projectManager()->closeCurrentDocument(false, false);
 }
+
+TEST_CASE("Timeline preview of a changed clip", "[TimelinePreview]")
+{
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    pCore->setCurrentProfile("atsc_1080p_25");
+
+    KdenliveDoc document(undoStack);
+    pCore->projectManager()->testSetDocument(&document);
+    QDateTime documentDate = QDateTime::currentDateTime();
+    KdenliveTests::updateTimeline(false, QString(), QString(), documentDate, 0);
+    auto timeline = document.getTimeline(document.uuid());
+    pCore->projectManager()->testSetActiveTimeline(timeline);
+
+    QString documentId = QString::number(QDateTime::currentMSecsSinceEpoch());
+    document.setDocumentProperty(QStringLiteral("documentid"), documentId);
+    document.setDocumentProperty(QStringLiteral("previewextension"), QStringLiteral("avi"));
+    document.setDocumentProperty(QStringLiteral("previewparameters"), QStringLiteral("vcodec=mjpeg progressive=1 qscale=10"));
+
+    bool ok = false;
+    QDir dir = document.getCacheDir(CacheBase, &ok);
+    dir.mkpath(QStringLiteral("."));
+    dir.mkdir(QLatin1String("preview"));
+
+    // A clip whose file will be replaced
+    QTemporaryDir mediaDir;
+    const QString mediaPath = mediaDir.filePath(QStringLiteral("media.mp4"));
+    REQUIRE(QFile::copy(sourcesPath + QStringLiteral("/dataset/red.mp4"), mediaPath));
+    std::shared_ptr<Mlt::Producer> producer = std::make_shared<Mlt::Producer>(pCore->getProjectProfile(), mediaPath.toUtf8().constData());
+    REQUIRE(producer->is_valid());
+    QString binId = QString::number(binModel->getFreeClipId());
+    auto binClip = ProjectClip::construct(binId, QIcon(), binModel, producer);
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    REQUIRE(binModel->addItem(binClip, binModel->getRootFolder()->clipId(), undo, redo));
+
+    int tid3 = timeline->getTrackIndexFromPosition(2);
+    int cid1 = -1;
+    REQUIRE(timeline->requestClipInsertion(binId, tid3, 0, cid1, true, true, false));
+
+    timeline->initializePreviewManager();
+    timeline->buildPreviewTrack();
+    timeline->previewManager()->addPreviewRange({0, 0}, true);
+    timeline->previewManager()->startPreviewRender();
+    while (timeline->previewManager()->isRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        qApp->processEvents();
+    }
+    REQUIRE(timeline->previewManager()->previewChunks().first == QStringList{QStringLiteral("0")});
+
+    // Replace the file on disk and reload the clip, its properties don't change
+    REQUIRE(QFile::remove(mediaPath));
+    REQUIRE(QFile::copy(sourcesPath + QStringLiteral("/dataset/blue.mp4"), mediaPath));
+    QFile media(mediaPath);
+    REQUIRE(media.open(QIODevice::ReadWrite));
+    REQUIRE(media.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime));
+    media.close();
+    binClip->reloadProducer();
+    while (!binClip->statusReady()) {
+        qApp->processEvents();
+    }
+    Q_EMIT timeline->invalidateZone(0, timeline->getClipPlaytime(cid1));
+    timeline->previewManager()->invalidatePreviews();
+
+    // The rendered chunk shows the old file, it must not be reused
+    REQUIRE(timeline->previewManager()->previewChunks().first.isEmpty());
+    REQUIRE(timeline->previewManager()->previewChunks().second == QStringList{QStringLiteral("0")});
+    timeline->resetPreviewManager();
+    pCore->projectManager()->closeCurrentDocument(false, false);
+}
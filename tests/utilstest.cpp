@@ -6,10 +6,18 @@
 #include "catch.hpp"
 #include "test_utils.hpp"
 // test specific headers
+#include "jobs/taskstatistics.h"
+#include "utils/chunkset.h"
 #include "utils/gentime.h"
+#include "utils/multireplacer.h"
 #include "utils/qstringutils.h"
 #include "utils/timecode.h"
 
+#include "macros.hpp"
+#include "undohelper.hpp"
+#include <QJsonArray>
+#include <random>
+
 TEST_CASE("Testing for different utils", "[Utils]")
 {
 
@@ -161,3 +169,309 @@ TEST_CASE("Testing for timecodes", "[Timecodes]")
         REQUIRE(res == QStringLiteral("01:02:03:05"));
     }
 }
+
+TEST_CASE("Flattened undo operation list", "[Utils]")
+{
+    SECTION("Same order and result as nested closures")
+    {
+        // Build the same function with the operation list and with nested closures, from random pushes of operations that sometimes fail
+        std::mt19937 gen(7);
+        for (int run = 0; run < 200; ++run) {
+            std::vector<int> flatLog;
+            std::vector<int> nestedLog;
+            std::vector<bool> failing(40);
+            for (size_t i = 0; i < failing.size(); ++i) {
+                failing[i] = gen() % 6 == 0;
+            }
+            const auto operation = [&failing](std::vector<int> &log, int id) {
+                return Fun([&log, &failing, id]() {
+                    log.push_back(id);
+                    return !failing[size_t(id)];
+                });
+            };
+            Fun flat = operation(flatLog, 0);
+            Fun nested = operation(nestedLog, 0);
+            for (int id = 1; id < int(failing.size()); ++id) {
+                Fun flatOperation = operation(flatLog, id);
+                Fun nestedOperation = operation(nestedLog, id);
+                switch (gen() % 4) {
+                case 0:
+                    PUSH_LAMBDA(flatOperation, flat);
+                    nested = [nested, nestedOperation]() {
+                        bool v = nested();
+                        return v && nestedOperation();
+                    };
+                    break;
+                case 1:
+                    PUSH_FRONT_LAMBDA(flatOperation, flat);
+                    nested = [nested, nestedOperation]() {
+                        bool v = nestedOperation();
+                        return v && nested();
+                    };
+                    break;
+                default: {
+                    // Undo part of UPDATE_UNDO_REDO_NOLOCK when the redo part is unused, and the opposite
+                    Fun unused = []() { return true; };
+                    if (gen() % 2 == 0) {
+                        UPDATE_UNDO_REDO_NOLOCK(flatOperation, flatOperation, flat, unused);
+                        nested = [nested, nestedOperation]() {
+                            bool v = nestedOperation();
+                            return nested() && v;
+                        };
+                    } else {
+                        UPDATE_UNDO_REDO_NOLOCK(flatOperation, flatOperation, unused, flat);
+                        nested = [nested, nestedOperation]() {
+                            bool v = nested();
+                            return nestedOperation() && v;
+                        };
+                    }
+                    break;
+                }
+                }
+            }
+            // Copies are independent
+            Fun copy = flat;
+            Fun extra = []() { return true; };
+            PUSH_LAMBDA(extra, copy);
+            CHECK(copy.target<OperationList>()->size() == flat.target<OperationList>()->size() + 1);
+
+            CHECK(flat() == nested());
+            CHECK(flatLog == nestedLog);
+        }
+    }
+
+    SECTION("Huge operations don't recurse")
+    {
+        int value = 0;
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+        for (int i = 0; i < 1000000; ++i) {
+            Fun operation = [&value]() {
+                value++;
+                return true;
+            };
+            Fun reverse = [&value]() {
+                value--;
+                return true;
+            };
+            UPDATE_UNDO_REDO_NOLOCK(operation, reverse, undo, redo);
+        }
+        CHECK(undo.target<OperationList>()->size() == 1000000);
+        REQUIRE(redo());
+        CHECK(value == 1000000);
+        REQUIRE(undo());
+        CHECK(value == 0);
+    }
+}
+
+TEST_CASE("Replace several patterns in one pass", "[Utils]")
+{
+    SECTION("Same result as successive replacements of folder paths")
+    {
+        QMap<QString, QString> replacements;
+        replacements.insert(QStringLiteral("/tmp/project/proxy/"), QStringLiteral("/home/me/Vidéos/proxy/"));
+        replacements.insert(QStringLiteral(">proxy/"), QStringLiteral(">/home/me/Vidéos/proxy/"));
+        replacements.insert(QStringLiteral("\"/media/archive"), QStringLiteral("\"/home/me/restored"));
+        const QString scene = QStringLiteral("<mlt><producer><property name=\"resource\">proxy/clip1.mkv</property>"
+                                             "<property name=\"kdenlive:proxy\">/tmp/project/proxy/clip2.mkv</property>"
+                                             "<property name=\"file\" value=\"/media/archive/clip3.png\"/>"
+                                             "<property name=\"kdenlive:originalurl\">/tmp/project/proxy</property></producer></mlt>");
+        QString expected = scene;
+        for (auto i = replacements.cbegin(); i != replacements.cend(); ++i) {
+            expected.replace(i.key(), i.value());
+        }
+        MultiReplacer replacer(replacements);
+        CHECK(replacer.apply(scene) == expected);
+        CHECK(replacer.apply(scene.toUtf8()) == expected.toUtf8());
+        CHECK(replacer.apply(QString()).isEmpty());
+        CHECK(MultiReplacer(QMap<QString, QString>()).apply(scene) == scene);
+    }
+
+    SECTION("Leftmost longest matches")
+    {
+        QMap<QString, QString> replacements;
+        replacements.insert(QStringLiteral("ab"), QStringLiteral("1"));
+        replacements.insert(QStringLiteral("abc"), QStringLiteral("2"));
+        replacements.insert(QStringLiteral("bcd"), QStringLiteral("3"));
+        replacements.insert(QStringLiteral("d"), QStringLiteral("4"));
+        replacements.insert(QString(), QStringLiteral("ignored"));
+        MultiReplacer replacer(replacements);
+        CHECK(replacer.apply(QStringLiteral("abcd")) == QStringLiteral("24"));
+        CHECK(replacer.apply(QStringLiteral("xabxbcdab")) == QStringLiteral("x1x31"));
+        CHECK(replacer.apply(QByteArray("abcabd")) == QByteArray("214"));
+    }
+
+    SECTION("Random texts compared with a naive scan")
+    {
+        std::mt19937 gen(11);
+        for (int run = 0; run < 500; ++run) {
+            QMap<QString, QString> replacements;
+            const int patterns = 1 + int(gen() % 5);
+            for (int i = 0; i < patterns; ++i) {
+                QString pattern;
+                const int length = 1 + int(gen() % 4);
+                for (int j = 0; j < length; ++j) {
+                    pattern.append(QChar(u'a' + int(gen() % 3)));
+                }
+                replacements.insert(pattern, QString::number(i));
+            }
+            QString text;
+            const int length = int(gen() % 50);
+            for (int j = 0; j < length; ++j) {
+                text.append(QChar(u'a' + int(gen() % 3)));
+            }
+            // At each position, replace the longest pattern starting there
+            QString expected;
+            int pos = 0;
+            while (pos < text.size()) {
+                QString longest;
+                for (auto i = replacements.cbegin(); i != replacements.cend(); ++i) {
+                    if (text.mid(pos).startsWith(i.key()) && i.key().size() > longest.size()) {
+                        longest = i.key();
+                    }
+                }
+                if (longest.isEmpty()) {
+                    expected.append(text.at(pos));
+                    pos++;
+                } else {
+                    expected.append(replacements.value(longest));
+                    pos += longest.size();
+                }
+            }
+            MultiReplacer replacer(replacements);
+            REQUIRE(replacer.apply(text) == expected);
+            REQUIRE(replacer.apply(text.toUtf8()) == expected.toUtf8());
+        }
+    }
+}
+
+TEST_CASE("Chunk set stored as ranges", "[Utils]")
+{
+    SECTION("Insert and remove join and split ranges")
+    {
+        ChunkSet chunks(25);
+        REQUIRE(chunks.isEmpty());
+        CHECK(chunks.insert(50));
+        CHECK(chunks.insert(0));
+        CHECK(chunks.insert(100));
+        CHECK_FALSE(chunks.insert(50));
+        CHECK(chunks.toCompressedList() == QStringList{QStringLiteral("0"), QStringLiteral("50"), QStringLiteral("100")});
+        // Fill the gaps, the ranges are joined
+        CHECK(chunks.insert(25));
+        CHECK(chunks.insert(75));
+        CHECK(chunks.toCompressedList() == QStringList{QStringLiteral("0-100")});
+        CHECK(chunks.count() == 5);
+        CHECK(chunks.first() == 0);
+        CHECK(chunks.last() == 100);
+        // Remove in the middle, at the start and at the end of a range
+        CHECK(chunks.remove(50));
+        CHECK_FALSE(chunks.remove(50));
+        CHECK(chunks.remove(0));
+        CHECK(chunks.remove(100));
+        CHECK(chunks.toCompressedList() == QStringList{QStringLiteral("25"), QStringLiteral("75")});
+        CHECK(chunks.count() == 2);
+        CHECK(chunks.contains(25));
+        CHECK_FALSE(chunks.contains(50));
+        CHECK_FALSE(chunks.contains(0));
+        CHECK(chunks.toVariantList() == QVariantList{25, 75});
+        chunks.clear();
+        CHECK(chunks.isEmpty());
+        CHECK(chunks.count() == 0);
+        CHECK(chunks.toList().isEmpty());
+    }
+
+    SECTION("Range queries")
+    {
+        ChunkSet chunks(25);
+        for (int frame = 100; frame <= 300; frame += 25) {
+            chunks.insert(frame);
+        }
+        chunks.insert(1000);
+        CHECK(chunks.intersects(0, 100));
+        CHECK(chunks.intersects(300, 500));
+        CHECK(chunks.intersects(0, 5000));
+        CHECK(chunks.intersects(1000, 1000));
+        CHECK_FALSE(chunks.intersects(0, 75));
+        CHECK_FALSE(chunks.intersects(325, 975));
+        CHECK_FALSE(chunks.intersects(1025, 2000));
+        CHECK(chunks.values(150, 200) == QList<int>{150, 175, 200});
+        CHECK(chunks.values(140, 210) == QList<int>{150, 175, 200});
+        CHECK(chunks.values(275, 1500) == QList<int>{275, 300, 1000});
+        CHECK(chunks.values(325, 975).isEmpty());
+        CHECK(chunks.toList().count() == chunks.count());
+    }
+
+    SECTION("Frames between chunks are not members")
+    {
+        ChunkSet chunks(25);
+        for (int frame = 0; frame <= 50; frame += 25) {
+            chunks.insert(frame);
+        }
+        CHECK(chunks.contains(25));
+        CHECK_FALSE(chunks.contains(10));
+        CHECK_FALSE(chunks.contains(49));
+        CHECK_FALSE(chunks.insert(60));
+        CHECK_FALSE(chunks.remove(10));
+        CHECK(chunks.count() == 3);
+        CHECK(chunks.intersects(10, 25));
+        CHECK(chunks.intersects(40, 60));
+        CHECK_FALSE(chunks.intersects(10, 20));
+        CHECK_FALSE(chunks.intersects(30, 45));
+        CHECK(chunks.values(10, 20).isEmpty());
+    }
+
+    SECTION("Same content as a sorted list")
+    {
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<int> chunkDistribution(0, 60);
+        ChunkSet chunks(25);
+        QList<int> expected;
+        for (int i = 0; i < 2000; ++i) {
+            const int frame = chunkDistribution(generator) * 25;
+            if (generator() % 2 == 0) {
+                CHECK(chunks.insert(frame) == !expected.contains(frame));
+                if (!expected.contains(frame)) {
+                    expected << frame;
+                }
+            } else {
+                CHECK(chunks.remove(frame) == expected.contains(frame));
+                expected.removeAll(frame);
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        REQUIRE(chunks.toList() == expected);
+        REQUIRE(chunks.count() == expected.count());
+    }
+}
+
+TEST_CASE("Task statistics histograms", "[Utils]")
+{
+    TaskStatistics statistics;
+    for (qint64 runTime : {qint64(0), qint64(1), qint64(3), qint64(3), qint64(1) << 30}) {
+        statistics.addTask(AbstractTask::CACHEJOB, 1, 0, 10, 10 + runTime, 100, 2, false);
+    }
+    statistics.addDiscarded(AbstractTask::CACHEJOB, 0, 5);
+    const QJsonObject cache = statistics.toJson().value(QLatin1String("jobTypes")).toObject().value(QLatin1String("cache")).toObject();
+    CHECK(cache.value(QLatin1String("count")).toInt() == 5);
+    CHECK(cache.value(QLatin1String("discarded")).toInt() == 1);
+    CHECK(cache.value(QLatin1String("bytesRead")).toInteger() == 500);
+    CHECK(cache.value(QLatin1String("framesDecoded")).toInteger() == 10);
+
+    // Returns the (upper bound, count) of the non empty buckets, -1 for the unbounded one
+    auto buckets = [](const QJsonObject &histogram) {
+        std::vector<std::pair<qint64, int>> result;
+        for (const QJsonValue &bucket : histogram.value(QLatin1String("histogram")).toArray()) {
+            const QJsonValue below = bucket.toObject().value(QLatin1String("belowMs"));
+            result.emplace_back(below.isNull() ? -1 : below.toInteger(), bucket.toObject().value(QLatin1String("count")).toInt());
+        }
+        return result;
+    };
+    const QJsonObject run = cache.value(QLatin1String("runTime")).toObject();
+    CHECK(run.value(QLatin1String("maxMs")).toInteger() == qint64(1) << 30);
+    // 0 is under 1ms, 1 in [1, 2[, 3 in [2, 4[, and the longest one in the last bucket
+    const std::vector<std::pair<qint64, int>> expectedRun{{1, 1}, {2, 1}, {4, 2}, {-1, 1}};
+    CHECK(buckets(run) == expectedRun);
+    // The tasks waited 10ms, the discarded one 5ms
+    const std::vector<std::pair<qint64, int>> expectedWait{{8, 1}, {16, 5}};
+    CHECK(buckets(cache.value(QLatin1String("queueWait")).toObject()) == expectedWait);
+}